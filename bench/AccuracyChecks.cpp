@@ -0,0 +1,278 @@
+#include "AccuracyChecks.h"
+#include "analysis/DTMGenerator.h"
+#include "analysis/ElevationHistogram.h"
+#include "analysis/TINProcessor.h"
+#include "analysis/VolumeCalculator.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+constexpr int kCheckPoints = 10000;
+constexpr double kPi = 3.14159265358979323846;
+
+// Tilted plane for the TIN checks; every triangle of a TIN through its points
+// lies on it, so prism volumes have a closed form
+struct Plane {
+    double z0 = 1200.0;
+    double x0 = 50.0;
+    double y0 = 50.0;
+    double slopeX = 0.08;
+    double slopeY = 0.03;
+
+    double at(double x, double y) const { return z0 + slopeX * (x - x0) + slopeY * (y - y0); }
+};
+
+// Area and centroid of a ring given as x, y pairs
+void ringAreaCentroid(const std::vector<double> &ring, double &area, double &cx, double &cy)
+{
+    double twiceArea = 0.0;
+    cx = 0.0;
+    cy = 0.0;
+    size_t n = ring.size() / 2;
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = (i + 1) % n;
+        double cross = ring[i * 2] * ring[j * 2 + 1] - ring[j * 2] * ring[i * 2 + 1];
+        twiceArea += cross;
+        cx += (ring[i * 2] + ring[j * 2]) * cross;
+        cy += (ring[i * 2 + 1] + ring[j * 2 + 1]) * cross;
+    }
+    area = std::abs(twiceArea) / 2.0;
+    if (twiceArea != 0.0) {
+        cx /= 3.0 * twiceArea;
+        cy /= 3.0 * twiceArea;
+    }
+}
+
+// Volume of a plane above base over a convex ring: clip the ring to the side
+// where the plane is above base, then area times the depth at its centroid
+double planeCut(const std::vector<double> &ring, const Plane &plane, double base)
+{
+    std::vector<double> above;
+    size_t n = ring.size() / 2;
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = (i + 1) % n;
+        double di = plane.at(ring[i * 2], ring[i * 2 + 1]) - base;
+        double dj = plane.at(ring[j * 2], ring[j * 2 + 1]) - base;
+        if (di >= 0.0) {
+            above.push_back(ring[i * 2]);
+            above.push_back(ring[i * 2 + 1]);
+        }
+        if ((di >= 0.0) != (dj >= 0.0)) {
+            double t = di / (di - dj);
+            above.push_back(ring[i * 2] + t * (ring[j * 2] - ring[i * 2]));
+            above.push_back(ring[i * 2 + 1] + t * (ring[j * 2 + 1] - ring[i * 2 + 1]));
+        }
+    }
+    if (above.size() < 6) {
+        return 0.0;
+    }
+    double area, cx, cy;
+    ringAreaCentroid(above, area, cx, cy);
+    return area * (plane.at(cx, cy) - base);
+}
+
+// Run one check; run fills the largest deviation from the reference and the
+// tolerance it must stay within, or returns false with an error
+BenchResult check(const QString &name, QVariantMap parameters,
+                  const std::function<bool(double &deviation, double &tolerance, QString &error)> &run)
+{
+    QElapsedTimer timer;
+    timer.start();
+    double deviation = 0.0;
+    double tolerance = 0.0;
+    QString error;
+    bool ran = run(deviation, tolerance, error);
+
+    BenchResult result;
+    result.name = name;
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    result.ok = ran && deviation <= tolerance;
+    parameters["deviation"] = deviation;
+    parameters["tolerance"] = tolerance;
+    if (!error.isEmpty()) {
+        parameters["error"] = error;
+    }
+    result.parameters = parameters;
+
+    if (!result.ok) {
+        std::fprintf(stderr, "  %s: deviation %g exceeds %g %s\n", name.toUtf8().constData(),
+                     deviation, tolerance, error.toUtf8().constData());
+    }
+    return result;
+}
+
+// Stage-storage from one histogram pass against calculateGrid at each level
+bool checkStageStorageGrid(const EngineBenchConfig &config, const QString &dtmPath,
+                           double &deviation, double &tolerance, QString &error)
+{
+    std::vector<double> levels;
+    for (double level = 1165.0; level <= 1235.0; level += 5.0) {
+        levels.push_back(level);
+    }
+
+    VolumeCalculator calculator;
+    QVariantList stages = calculator.calculateStageStorageGrid(dtmPath, levels, QVariantList(), error);
+    if (stages.size() != static_cast<int>(levels.size())) {
+        return false;
+    }
+
+    // The histogram rounds each cell to 1 / kScale; allow that per cell on top
+    // of double rounding in the totals
+    double pixelArea = config.pixelSize * config.pixelSize;
+    for (int i = 0; i < stages.size(); ++i) {
+        QVariantMap stage = stages[i].toMap();
+        QVariantMap reference = calculator.calculateGrid(dtmPath, levels[i], QVariantList(), error);
+        if (!error.isEmpty()) {
+            return false;
+        }
+        double cells = reference["area"].toDouble() / pixelArea;
+        double scale = reference["cut"].toDouble() + reference["fill"].toDouble();
+        tolerance = std::max(tolerance, cells * pixelArea / ElevationHistogram::kScale + scale * 1e-9);
+        deviation = std::max({deviation,
+                              std::abs(stage["cut"].toDouble() - reference["cut"].toDouble()),
+                              std::abs(stage["fill"].toDouble() - reference["fill"].toDouble()),
+                              std::abs(stage["area"].toDouble() - reference["area"].toDouble())});
+    }
+    return true;
+}
+
+// Grid volume of the synthetic surface sampled at cell centres against its
+// exact integral. Sampling at centres is the midpoint rule, whose error per
+// unit area is at most pixel^2 / 24 times the surface's |zxx| + |zyy| (below
+// 1.25 here); float storage adds up to half an ulp per cell.
+bool checkAnalyticGrid(double &deviation, double &tolerance, QString &error)
+{
+    constexpr int kCells = 800;
+    constexpr double kPixel = 0.25;
+    DTMRaster raster = SyntheticTerrain::raster(kCells, kPixel);
+    double side = kCells * kPixel;
+    double area = side * side;
+    double integral = SyntheticTerrain::integral(side, side);
+    tolerance = area * (kPixel * kPixel / 24.0 * 1.25 + 1e-4);
+
+    VolumeCalculator calculator;
+
+    // Below the surface everything is cut, so cut is exact; across it only the net is
+    QVariantMap below = calculator.calculateGrid(raster, 1150.0, QVariantList(), error);
+    QVariantMap across = calculator.calculateGrid(raster, 1200.0, QVariantList(), error);
+    if (!error.isEmpty()) {
+        return false;
+    }
+
+    deviation = std::max({std::abs(below["cut"].toDouble() - (integral - 1150.0 * area)),
+                          std::abs(below["fill"].toDouble()),
+                          std::abs(below["area"].toDouble() - area),
+                          std::abs(across["net"].toDouble() - (integral - 1200.0 * area))});
+    return true;
+}
+
+// Prism volumes of a planar TIN inside a convex boundary against the closed
+// form, at bases below, across and above the plane
+bool checkPlanarTIN(const EngineBenchConfig &config, double &deviation, double &tolerance, QString &error)
+{
+    Plane plane;
+    QVariantList points = SyntheticTerrain::points(SyntheticTerrain::Pattern::Gridded,
+                                                   kCheckPoints, config.seed);
+    for (QVariant &point : points) {
+        QVariantMap pt = point.toMap();
+        pt["z"] = plane.at(pt["x"].toDouble(), pt["y"].toDouble());
+        point = pt;
+    }
+
+    TINProcessor tin;
+    if (!tin.generate(points, error)["success"].toBool()) {
+        return false;
+    }
+
+    // Octagon well inside the points, so the TIN covers it; its edges and the
+    // base lines cut across triangles rather than along them
+    std::vector<double> ring;
+    QVariantList boundary;
+    for (int i = 0; i < 8; ++i) {
+        double angle = 2.0 * kPi * (i + 0.3) / 8.0;
+        double x = plane.x0 + 35.0 * std::cos(angle);
+        double y = plane.y0 + 35.0 * std::sin(angle);
+        ring.push_back(x);
+        ring.push_back(y);
+        QVariantMap pt;
+        pt["x"] = x;
+        pt["y"] = y;
+        boundary.append(pt);
+    }
+    double area, cx, cy;
+    ringAreaCentroid(ring, area, cx, cy);
+
+    VolumeCalculator calculator;
+    for (double base : {1190.0, 1197.3, 1200.0, 1201.9, 1210.0}) {
+        QVariantMap volume = calculator.calculateTIN(&tin, base, boundary, error);
+        if (!error.isEmpty()) {
+            return false;
+        }
+        double net = area * (plane.at(cx, cy) - base);
+        double cut = planeCut(ring, plane, base);
+        double fill = cut - net;
+
+        tolerance = std::max(tolerance, 1e-7 * (std::abs(cut) + std::abs(fill) + area));
+        deviation = std::max({deviation,
+                              std::abs(volume["cut"].toDouble() - cut),
+                              std::abs(volume["fill"].toDouble() - fill),
+                              std::abs(volume["net"].toDouble() - net),
+                              std::abs(volume["area"].toDouble() - area)});
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<BenchResult> runAccuracyChecks(const EngineBenchConfig &config)
+{
+    std::vector<BenchResult> results;
+    auto wanted = [&](const QString &name) {
+        return config.filter.isEmpty() || name.contains(config.filter);
+    };
+
+    QVariantMap parameters;
+    parameters["points"] = kCheckPoints;
+    parameters["seed"] = static_cast<qint64>(config.seed);
+
+    // Grid checks on one DTM of the synthetic surface
+    if (wanted("check_stage_storage_grid")) {
+        QString dtmPath = config.tempDir + "/sitesurveyor_check_dtm.tif";
+        QVariantList points = SyntheticTerrain::points(SyntheticTerrain::Pattern::Gridded,
+                                                       kCheckPoints, config.seed);
+        QString error;
+        DTMGenerator generator;
+        bool generated = generator.generate(points, config.pixelSize, dtmPath, error);
+
+        results.push_back(check("check_stage_storage_grid", parameters,
+                                [&](double &deviation, double &tolerance, QString &checkError) {
+            if (!generated) {
+                checkError = error;
+                return false;
+            }
+            return checkStageStorageGrid(config, dtmPath, deviation, tolerance, checkError);
+        }));
+        QFile::remove(dtmPath);
+    }
+
+    if (wanted("check_volume_analytic")) {
+        results.push_back(check("check_volume_analytic", QVariantMap(),
+                                [&](double &deviation, double &tolerance, QString &error) {
+            return checkAnalyticGrid(deviation, tolerance, error);
+        }));
+    }
+
+    if (wanted("check_tin_planar")) {
+        results.push_back(check("check_tin_planar", parameters,
+                                [&](double &deviation, double &tolerance, QString &error) {
+            return checkPlanarTIN(config, deviation, tolerance, error);
+        }));
+    }
+
+    return results;
+}
@@ -0,0 +1,19 @@
+#ifndef ACCURACYCHECKS_H
+#define ACCURACYCHECKS_H
+
+#include "BenchResult.h"
+#include "EngineBench.h"
+#include <vector>
+
+/**
+ * @brief Check analysis results against reference values
+ *
+ * Each check runs an engine and compares it with an independent answer: a
+ * brute-force calculation or a closed form. A result is ok only when the
+ * largest deviation is within the check's tolerance; both are reported in its
+ * parameters ("deviation", "tolerance"), so a regression fails the bench run.
+ * Checks use config.seed, config.pixelSize and config.tempDir and honour config.filter.
+ */
+std::vector<BenchResult> runAccuracyChecks(const EngineBenchConfig &config);
+
+#endif // ACCURACYCHECKS_H
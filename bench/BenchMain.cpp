@@ -0,0 +1,152 @@
+#include "AccuracyChecks.h"
+#include "EngineBench.h"
+#include "ObjExportBench.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QThreadPool>
+#include <gdal.h>
+#include <cstdio>
+
+namespace {
+
+void printResult(const BenchResult &result)
+{
+    QString label = result.name;
+    if (result.parameters.contains("pattern")) {
+        label += QString(" %1/%2").arg(result.parameters["pattern"].toString())
+                                  .arg(result.parameters["points"].toInt());
+    }
+    std::printf("  %-40s %s %9.3f s", label.toUtf8().constData(),
+                result.ok ? "ok  " : "FAIL", result.seconds);
+    if (result.bytes > 0) {
+        std::printf(" %10.1f MB %8.1f MB/s", result.bytes / 1e6, result.megabytesPerSecond());
+    }
+    if (result.parameters.contains("acmrBefore")) {
+        std::printf("  ACMR %.2f -> %.2f", result.parameters["acmrBefore"].toDouble(),
+                    result.parameters["acmrAfter"].toDouble());
+    }
+    std::printf("\n");
+}
+
+bool writeJson(const std::vector<BenchResult> &results, const QVariantMap &settings,
+               const QString &filePath)
+{
+    QJsonArray cases;
+    for (const BenchResult &result : results) {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["ok"] = result.ok;
+        entry["seconds"] = result.seconds;
+        entry["bytes"] = result.bytes;
+        entry["parameters"] = QJsonObject::fromVariantMap(result.parameters);
+        cases.append(entry);
+    }
+
+    QJsonObject report;
+    report["suite"] = "sitesurveyor_bench";
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["settings"] = QJsonObject::fromVariantMap(settings);
+    report["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+    report["cpu"] = QSysInfo::currentCpuArchitecture();
+    report["os"] = QSysInfo::prettyProductName();
+    report["qt"] = qVersion();
+    report["gdal"] = GDALVersionInfo("RELEASE_NAME");
+    report["results"] = cases;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(report).toJson());
+    return true;
+}
+
+} // namespace
+
+// Usage: sitesurveyor_bench [--sizes 1000,10000] [--patterns random,gridded,clustered]
+//                           [--seed 42] [--repeat 1] [--filter name] [--obj-grid 2000] [--json out.json]
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Analysis engine benchmarks on synthetic terrain");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma-separated point counts (1000 to 10000000).",
+                                   "list", "1000,10000,100000,1000000");
+    QCommandLineOption patternsOption("patterns", "Comma-separated: random, gridded, clustered.",
+                                      "list", "random,gridded,clustered");
+    QCommandLineOption seedOption("seed", "Random seed for the synthetic points.", "seed", "42");
+    QCommandLineOption repeatOption("repeat", "Runs per case; the fastest is reported.", "count", "1");
+    QCommandLineOption filterOption("filter", "Only cases whose name contains this text.", "text");
+    QCommandLineOption objGridOption("obj-grid", "Grid size for the OBJ writer comparison (0 = skip).",
+                                     "cells", "2000");
+    QCommandLineOption jsonOption("json", "Write results as JSON to this file.", "path");
+    parser.addOptions({sizesOption, patternsOption, seedOption, repeatOption, filterOption,
+                       objGridOption, jsonOption});
+    parser.process(app);
+
+    GDALAllRegister();
+
+    EngineBenchConfig config;
+    for (const QString &size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        config.sizes.push_back(size.toInt());
+    }
+    for (const QString &name : parser.value(patternsOption).split(',', Qt::SkipEmptyParts)) {
+        SyntheticTerrain::Pattern pattern;
+        if (!SyntheticTerrain::parsePattern(name.trimmed(), pattern)) {
+            std::fprintf(stderr, "Unknown pattern: %s\n", name.toUtf8().constData());
+            return 2;
+        }
+        config.patterns.push_back(pattern);
+    }
+    config.seed = parser.value(seedOption).toUInt();
+    config.repeat = parser.value(repeatOption).toInt();
+    config.filter = parser.value(filterOption);
+    config.tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+    int objGrid = parser.value(objGridOption).toInt();
+
+    std::vector<BenchResult> results = runEngineBench(config);
+    for (BenchResult &result : runAccuracyChecks(config)) {
+        results.push_back(result);
+    }
+
+    if (objGrid > 0) {
+        for (BenchResult &result : runObjExportBench(objGrid, config.tempDir)) {
+            result.parameters["gridSize"] = objGrid;
+            if (config.filter.isEmpty() || result.name.contains(config.filter)) {
+                results.push_back(result);
+            }
+        }
+    }
+
+    std::printf("%d threads\n", QThreadPool::globalInstance()->maxThreadCount());
+    bool allOk = true;
+    for (const BenchResult &result : results) {
+        printResult(result);
+        allOk = allOk && result.ok;
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QVariantMap settings;
+        settings["sizes"] = parser.value(sizesOption);
+        settings["patterns"] = parser.value(patternsOption);
+        settings["seed"] = static_cast<qint64>(config.seed);
+        settings["repeat"] = config.repeat;
+        settings["filter"] = config.filter;
+        settings["objGrid"] = objGrid;
+        if (!writeJson(results, settings, parser.value(jsonOption))) {
+            std::fprintf(stderr, "Failed to write %s\n", parser.value(jsonOption).toUtf8().constData());
+            return 1;
+        }
+    }
+
+    return allOk ? 0 : 1;
+}
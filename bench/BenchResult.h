@@ -0,0 +1,20 @@
+#ifndef BENCHRESULT_H
+#define BENCHRESULT_H
+
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * @brief One timed benchmark case
+ */
+struct BenchResult {
+    QString name;
+    bool ok = false;
+    double seconds = 0.0;
+    qint64 bytes = 0;
+    QVariantMap parameters;     // case inputs, e.g. pattern and point count
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? bytes / 1e6 / seconds : 0.0; }
+};
+
+#endif // BENCHRESULT_H
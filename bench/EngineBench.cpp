@@ -0,0 +1,340 @@
+#include "EngineBench.h"
+#include "analysis/DTMGenerator.h"
+#include "analysis/MeshExporter.h"
+#include "analysis/MeshOptimizer.h"
+#include "analysis/TINProcessor.h"
+#include "analysis/VolumeCalculator.h"
+#include "analysis/VolumeKernel.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+// Run a case repeat times and keep the fastest run; bytes is set by the case
+BenchResult measure(const QString &name, const QVariantMap &parameters, int repeat,
+                    const std::function<bool(qint64 &bytes)> &run)
+{
+    BenchResult result;
+    result.name = name;
+    result.parameters = parameters;
+    result.ok = true;
+    result.seconds = 0.0;
+
+    for (int i = 0; i < std::max(1, repeat) && result.ok; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 bytes = 0;
+        result.ok = run(bytes);
+        double seconds = timer.nsecsElapsed() / 1e9;
+
+        if (i == 0 || seconds < result.seconds) {
+            result.seconds = seconds;
+        }
+        result.bytes = bytes;
+    }
+    return result;
+}
+
+// Base elevation for the volume cases and target resolution for the balance cases
+constexpr double kBaseElevation = 1200.0;
+constexpr double kBalanceTolerance = 0.01;
+
+// Whether an engine value matches its reference; reports a mismatch on stderr
+bool matches(const char *what, double value, double reference, double tolerance)
+{
+    if (std::abs(value - reference) <= tolerance) {
+        return true;
+    }
+    std::fprintf(stderr, "  %s: %.6f, reference %.6f (tolerance %g)\n", what, value, reference, tolerance);
+    return false;
+}
+
+// Grid references from a plain loop over the DTM cells: cut/fill at a base
+// and the balance elevation, which for cut factor 1 is the mean cell elevation
+struct GridReference {
+    double cut = 0.0;
+    double fill = 0.0;
+    double area = 0.0;
+    double balance = 0.0;
+};
+
+GridReference gridReference(const DTMRaster &raster, double base)
+{
+    GridReference reference;
+    double sum = 0.0;
+    qint64 cells = 0;
+    for (float z : raster.values) {
+        if (z == VolumeKernel::kNoData) continue;
+        double depth = z - base;
+        if (depth > 0.0) {
+            reference.cut += depth;
+        } else {
+            reference.fill -= depth;
+        }
+        sum += z;
+        ++cells;
+    }
+    double pixelArea = std::abs(raster.geoTransform[1] * raster.geoTransform[5]);
+    reference.cut *= pixelArea;
+    reference.fill *= pixelArea;
+    reference.area = cells * pixelArea;
+    reference.balance = cells > 0 ? sum / cells : 0.0;
+    return reference;
+}
+
+// TIN references from the triangles: each prism's net volume is its plan
+// area times its mean depth, and the balance for cut factor 1 is the
+// area-weighted mean elevation
+struct TINReference {
+    double net = 0.0;
+    double area = 0.0;
+    double balance = 0.0;
+};
+
+TINReference tinReference(const TINProcessor &tin, double base)
+{
+    const std::vector<double> &xyz = tin.packedVertices();
+    const std::vector<int> &triangles = tin.packedTriangles();
+    TINReference reference;
+    double weighted = 0.0;
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        const double *a = &xyz[triangles[t] * 3];
+        const double *b = &xyz[triangles[t + 1] * 3];
+        const double *c = &xyz[triangles[t + 2] * 3];
+        double area = std::abs((b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1])) / 2.0;
+        double meanZ = (a[2] + b[2] + c[2]) / 3.0;
+        reference.net += area * (meanZ - base);
+        reference.area += area;
+        weighted += area * meanZ;
+    }
+    reference.balance = reference.area > 0.0 ? weighted / reference.area : 0.0;
+    return reference;
+}
+
+BenchResult skipped(const QString &name, const QVariantMap &parameters)
+{
+    BenchResult result;
+    result.name = name;
+    result.parameters = parameters;
+    return result;
+}
+
+// Time buildChunks on a mesh and record the modelled vertex cache misses per
+// triangle (ACMR) of the mesh's own order and of the Tipsify-ordered chunks
+BenchResult measureChunks(const QString &name, const QVariantMap &parameters, int repeat,
+                          MeshExporter &exporter, const MeshBuffers &mesh, QString &error)
+{
+    std::vector<MeshChunk> chunks;
+    BenchResult result = measure(name, parameters, repeat, [&](qint64 &bytes) {
+        chunks.clear();
+        bool ok = exporter.buildChunks(mesh, chunks, error);
+        bytes = 0;
+        for (const MeshChunk &chunk : chunks) {
+            bytes += chunk.vertexData.size() + chunk.indexData.size();
+        }
+        return ok;
+    });
+    if (!result.ok) {
+        return result;
+    }
+
+    const auto *indices = reinterpret_cast<const std::uint32_t *>(mesh.indexData.constData());
+    result.parameters["acmrBefore"] = MeshOptimizer::averageCacheMissRatio(indices, mesh.indexCount / 3,
+                                                                           mesh.vertexCount);
+
+    double misses = 0.0;
+    qint64 triangles = 0;
+    std::vector<std::uint32_t> local;
+    for (const MeshChunk &chunk : chunks) {
+        const auto *chunkIndices = reinterpret_cast<const quint16 *>(chunk.indexData.constData());
+        local.assign(chunkIndices, chunkIndices + chunk.indexCount);
+        int count = chunk.indexCount / 3;
+        misses += MeshOptimizer::averageCacheMissRatio(local.data(), count, chunk.vertexCount) * count;
+        triangles += count;
+    }
+    result.parameters["acmrAfter"] = triangles > 0 ? misses / triangles : 0.0;
+    result.parameters["chunks"] = static_cast<int>(chunks.size());
+    return result;
+}
+
+} // namespace
+
+std::vector<BenchResult> runEngineBench(const EngineBenchConfig &config)
+{
+    std::vector<BenchResult> results;
+    QString dtmPath = config.tempDir + "/sitesurveyor_bench_dtm.tif";
+    QString meshPath = config.tempDir + "/sitesurveyor_bench_mesh.glb";
+
+    // Cases outside the filter still run when later cases need their output
+    auto record = [&](const BenchResult &result) {
+        if (config.filter.isEmpty() || result.name.contains(config.filter)) {
+            results.push_back(result);
+        }
+    };
+    auto wanted = [&](const QString &name) {
+        return config.filter.isEmpty() || name.contains(config.filter);
+    };
+
+    for (SyntheticTerrain::Pattern pattern : config.patterns) {
+        for (int size : config.sizes) {
+            QVariantMap parameters;
+            parameters["pattern"] = SyntheticTerrain::patternName(pattern);
+            parameters["points"] = size;
+            parameters["seed"] = static_cast<qint64>(config.seed);
+            parameters["repeat"] = config.repeat;
+
+            std::fprintf(stderr, "%s %d points...\n",
+                         SyntheticTerrain::patternName(pattern).toUtf8().constData(), size);
+            QVariantList points = SyntheticTerrain::points(pattern, size, config.seed);
+            QString error;
+
+            // Grid engines
+            DTMGenerator dtmGenerator;
+            VolumeCalculator volumeCalculator;
+            MeshExporter meshExporter;
+
+            bool gridCases = wanted("dtm_get_data") || wanted("contours") || wanted("volume_grid")
+                || wanted("balance_grid") || wanted("mesh_export_grid") || wanted("mesh_chunks_grid");
+            BenchResult generated = skipped("dtm_generate", parameters);
+            if (gridCases || wanted("dtm_generate")) {
+                generated = measure("dtm_generate", parameters, config.repeat, [&](qint64 &bytes) {
+                    bool ok = dtmGenerator.generate(points, config.pixelSize, dtmPath, error);
+                    bytes = QFileInfo(dtmPath).size();
+                    return ok;
+                });
+                record(generated);
+            }
+
+            if (generated.ok && gridCases) {
+                record(measure("dtm_get_data", parameters, config.repeat, [&](qint64 &) {
+                    return !dtmGenerator.getData(dtmPath, error).isEmpty();
+                }));
+                record(measure("contours", parameters, config.repeat, [&](qint64 &) {
+                    error.clear();
+                    dtmGenerator.generateContours(dtmPath, config.contourInterval, error);
+                    return error.isEmpty();
+                }));
+                GridReference reference;
+                bool haveReference = false;
+                if (wanted("volume_grid") || wanted("balance_grid")) {
+                    DTMRaster raster;
+                    haveReference = dtmGenerator.readRaster(dtmPath, raster, error);
+                    if (haveReference) {
+                        reference = gridReference(raster, kBaseElevation);
+                    }
+                }
+
+                record(measure("volume_grid", parameters, config.repeat, [&](qint64 &) {
+                    error.clear();
+                    QVariantMap volume = volumeCalculator.calculateGrid(dtmPath, kBaseElevation, QVariantList(), error);
+                    // Double sums over the same cells; only rounding separates them
+                    double tolerance = 1e-9 * (reference.cut + reference.fill) + 1e-6;
+                    return error.isEmpty() && haveReference
+                        && matches("volume_grid cut", volume["cut"].toDouble(), reference.cut, tolerance)
+                        && matches("volume_grid fill", volume["fill"].toDouble(), reference.fill, tolerance)
+                        && matches("volume_grid area", volume["area"].toDouble(), reference.area, 1e-6);
+                }));
+                record(measure("balance_grid", parameters, config.repeat, [&](qint64 &) {
+                    error.clear();
+                    QVariantMap balance = volumeCalculator.findBalanceGrid(dtmPath, QVariantList(),
+                                                                           kBalanceTolerance, 1.0, error);
+                    return error.isEmpty() && haveReference && balance["toleranceMet"].toBool()
+                        && matches("balance_grid elevation", balance["elevation"].toDouble(),
+                                   reference.balance, kBalanceTolerance);
+                }));
+                record(measure("mesh_export_grid", parameters, config.repeat, [&](qint64 &bytes) {
+                    DTMRaster raster;
+                    MeshBuffers mesh;
+                    bool ok = dtmGenerator.readRaster(dtmPath, raster, error)
+                        && meshExporter.buildGridMesh(raster, 1.0, mesh, error)
+                        && meshExporter.exportMesh(mesh, meshPath, "glb", error);
+                    bytes = QFileInfo(meshPath).size();
+                    return ok;
+                }));
+                if (wanted("mesh_chunks_grid")) {
+                    DTMRaster raster;
+                    MeshBuffers mesh;
+                    if (dtmGenerator.readRaster(dtmPath, raster, error)
+                        && meshExporter.buildGridMesh(raster, 1.0, mesh, error)) {
+                        record(measureChunks("mesh_chunks_grid", parameters, config.repeat,
+                                             meshExporter, mesh, error));
+                    } else {
+                        record(skipped("mesh_chunks_grid", parameters));
+                    }
+                }
+            } else if (gridCases) {
+                for (const char *name : {"dtm_get_data", "contours", "volume_grid", "balance_grid",
+                                         "mesh_export_grid", "mesh_chunks_grid"}) {
+                    record(skipped(name, parameters));
+                }
+            }
+
+            // TIN engines
+            bool tinCases = wanted("tin_generate") || wanted("volume_tin") || wanted("balance_tin")
+                || wanted("mesh_export_tin") || wanted("mesh_chunks_tin");
+            if (tinCases) {
+                TINProcessor tinProcessor;
+                BenchResult triangulated = measure("tin_generate", parameters, config.repeat, [&](qint64 &) {
+                    return tinProcessor.generate(points, error)["success"].toBool();
+                });
+                record(triangulated);
+
+                if (triangulated.ok) {
+                    TINReference reference = tinReference(tinProcessor, kBaseElevation);
+                    record(measure("volume_tin", parameters, config.repeat, [&](qint64 &) {
+                        error.clear();
+                        QVariantMap volume = volumeCalculator.calculateTIN(&tinProcessor, kBaseElevation,
+                                                                           QVariantList(), error);
+                        double tolerance = 1e-9 * (volume["cut"].toDouble() + volume["fill"].toDouble()) + 1e-6;
+                        return error.isEmpty()
+                            && matches("volume_tin net", volume["net"].toDouble(), reference.net, tolerance)
+                            && matches("volume_tin area", volume["area"].toDouble(), reference.area,
+                                       1e-9 * reference.area);
+                    }));
+                    record(measure("balance_tin", parameters, config.repeat, [&](qint64 &) {
+                        error.clear();
+                        QVariantMap balance = volumeCalculator.findBalanceTIN(&tinProcessor, QVariantList(),
+                                                                              kBalanceTolerance, 1.0, error);
+                        return error.isEmpty()
+                            && matches("balance_tin elevation", balance["elevation"].toDouble(),
+                                       reference.balance, kBalanceTolerance);
+                    }));
+                    record(measure("mesh_export_tin", parameters, config.repeat, [&](qint64 &bytes) {
+                        MeshBuffers mesh;
+                        bool ok = meshExporter.buildTINMesh(&tinProcessor, 1.0, mesh, error)
+                            && meshExporter.exportMesh(mesh, meshPath, "glb", error);
+                        bytes = QFileInfo(meshPath).size();
+                        return ok;
+                    }));
+                    if (wanted("mesh_chunks_tin")) {
+                        MeshBuffers mesh;
+                        if (meshExporter.buildTINMesh(&tinProcessor, 1.0, mesh, error)) {
+                            record(measureChunks("mesh_chunks_tin", parameters, config.repeat,
+                                                 meshExporter, mesh, error));
+                        } else {
+                            record(skipped("mesh_chunks_tin", parameters));
+                        }
+                    }
+                } else {
+                    record(skipped("volume_tin", parameters));
+                    record(skipped("balance_tin", parameters));
+                    record(skipped("mesh_export_tin", parameters));
+                    record(skipped("mesh_chunks_tin", parameters));
+                }
+            }
+
+            if (!error.isEmpty()) {
+                std::fprintf(stderr, "  last error: %s\n", error.toUtf8().constData());
+            }
+            QFile::remove(dtmPath);
+            QFile::remove(meshPath);
+        }
+    }
+
+    return results;
+}
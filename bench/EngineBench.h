@@ -0,0 +1,40 @@
+#ifndef ENGINEBENCH_H
+#define ENGINEBENCH_H
+
+#include "BenchResult.h"
+#include "SyntheticTerrain.h"
+#include <QString>
+#include <vector>
+
+/**
+ * @brief Settings for the analysis engine benchmarks
+ */
+struct EngineBenchConfig {
+    std::vector<int> sizes;                            // point counts
+    std::vector<SyntheticTerrain::Pattern> patterns;
+    std::uint32_t seed = 42;
+    int repeat = 1;                                    // runs per case; the fastest is kept
+    double pixelSize = 1.0;
+    double contourInterval = 5.0;
+    QString filter;                                    // only cases whose name contains this
+    QString tempDir;
+};
+
+/**
+ * @brief Time the analysis engines on synthetic terrain
+ *
+ * For every pattern and size the same point set goes through
+ * DTMGenerator::generate, getData and generateContours,
+ * VolumeCalculator::calculateGrid, TINProcessor::generate,
+ * VolumeCalculator::calculateTIN, MeshExporter GLB export of the grid
+ * and TIN meshes and MeshExporter::buildChunks on both, whose results also
+ * carry the vertex cache misses per triangle before and after Tipsify
+ * ("acmrBefore", "acmrAfter"). Each result carries the pattern, point count
+ * and seed in its parameters. The volume cases, and the balance cases
+ * (findBalanceGrid, findBalanceTIN), are ok only when they match references
+ * computed by plain loops over the DTM cells or TIN triangles. Cases that
+ * depend on a failed one are reported as not ok with zero time.
+ */
+std::vector<BenchResult> runEngineBench(const EngineBenchConfig &config);
+
+#endif // ENGINEBENCH_H
@@ -0,0 +1,142 @@
+#include "ObjExportBench.h"
+#include "SyntheticTerrain.h"
+#include "analysis/DTMGenerator.h"
+#include "analysis/GridMesh.h"
+#include "analysis/MeshExporter.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QVector3D>
+#include <functional>
+
+namespace {
+
+// The DTM as the previous getData returned it, which the previous exporter took
+QVariantMap legacyData(const DTMRaster &raster)
+{
+    QVariantList data;
+    data.reserve(static_cast<qsizetype>(raster.values.size()));
+    for (float value : raster.values) {
+        data.append(value);
+    }
+
+    QVariantMap dtmData;
+    dtmData["width"] = raster.width;
+    dtmData["height"] = raster.height;
+    dtmData["data"] = data;
+    dtmData["minElev"] = raster.minElev;
+    dtmData["maxElev"] = raster.maxElev;
+    dtmData["pixelWidth"] = raster.geoTransform[1];
+    dtmData["pixelHeight"] = raster.geoTransform[5];
+    return dtmData;
+}
+
+// The previous MeshExporter::exportAsOBJ as it was: QVariant cells and
+// QString::number through a QTextStream on one thread. Its colour helper was
+// moved to GridMesh::elevationColor unchanged.
+bool writeLegacyOBJ(const QVariantMap &dtmData, const QString &filePath, double verticalScale)
+{
+    int width = dtmData["width"].toInt();
+    int height = dtmData["height"].toInt();
+    QVariantList data = dtmData["data"].toList();
+    double minElev = dtmData["minElev"].toDouble();
+    double maxElev = dtmData["maxElev"].toDouble();
+    double pixelWidth = dtmData["pixelWidth"].toDouble();
+    double pixelHeight = qAbs(dtmData["pixelHeight"].toDouble());
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+
+    out << "# Wavefront OBJ file\n";
+    out << "# Generated by SiteSurveyor - DTM Export\n";
+    out << "# Vertices: " << (width * height) << "\n";
+    out << "# Elevation range: " << minElev << "m - " << maxElev << "m\n";
+    out << "# Vertical scale: " << verticalScale << "x\n\n";
+
+    double centerX = width * pixelWidth / 2.0;
+    double centerY = height * pixelHeight / 2.0;
+
+    out << "# Vertices\n";
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int idx = row * width + col;
+            float elev = data[idx].toFloat();
+
+            float x = (col * pixelWidth - centerX);
+            float z = -(row * pixelHeight - centerY);
+            float y = (elev == -9999.0f ? minElev : elev) * verticalScale;
+
+            float rgb[3];
+            GridMesh::elevationColor(elev, static_cast<float>(minElev), static_cast<float>(maxElev),
+                                     -9999.0f, rgb);
+            QVector3D color(rgb[0], rgb[1], rgb[2]);
+
+            out << "v " << QString::number(x, 'f', 3) << " "
+                << QString::number(y, 'f', 3) << " "
+                << QString::number(z, 'f', 3) << " "
+                << QString::number(color.x(), 'f', 3) << " "
+                << QString::number(color.y(), 'f', 3) << " "
+                << QString::number(color.z(), 'f', 3) << "\n";
+        }
+    }
+
+    out << "\n# Faces\n";
+
+    for (int row = 0; row < height - 1; row++) {
+        for (int col = 0; col < width - 1; col++) {
+            int topLeft = row * width + col + 1;
+            int topRight = topLeft + 1;
+            int bottomLeft = (row + 1) * width + col + 1;
+            int bottomRight = bottomLeft + 1;
+
+            out << "f " << topLeft << " " << bottomLeft << " " << topRight << "\n";
+            out << "f " << topRight << " " << bottomLeft << " " << bottomRight << "\n";
+        }
+    }
+
+    file.close();
+    return true;
+}
+
+BenchResult measure(const QString &name, const QString &filePath, const std::function<bool()> &run)
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = run();
+    double seconds = timer.nsecsElapsed() / 1e9;
+
+    BenchResult result;
+    result.name = name;
+    result.ok = ok;
+    result.seconds = seconds;
+    result.bytes = QFileInfo(filePath).size();
+    QFile::remove(filePath);
+    return result;
+}
+
+} // namespace
+
+std::vector<BenchResult> runObjExportBench(int gridSize, const QString &tempDir)
+{
+    DTMRaster raster = SyntheticTerrain::raster(gridSize, 0.5);
+    QString path = tempDir + "/sitesurveyor_bench.obj";
+
+    std::vector<BenchResult> results;
+    {
+        QVariantMap dtmData = legacyData(raster);
+        results.push_back(measure("obj_legacy_qtextstream", path, [&]() {
+            return writeLegacyOBJ(dtmData, path, 1.0);
+        }));
+    }
+    results.push_back(measure("obj_to_chars_chunked", path, [&]() {
+        MeshExporter exporter;
+        QString error;
+        return exporter.exportAsOBJ(raster, path, 1.0, error);
+    }));
+    return results;
+}
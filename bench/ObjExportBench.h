@@ -0,0 +1,17 @@
+#ifndef OBJEXPORTBENCH_H
+#define OBJEXPORTBENCH_H
+
+#include "BenchResult.h"
+#include <QString>
+#include <vector>
+
+/**
+ * @brief Write the same grid of the synthetic terrain with the previous
+ *        QTextStream exporter and with MeshExporter::exportAsOBJ, measuring
+ *        output throughput
+ * @param gridSize Grid width and height in cells
+ * @param tempDir Directory for the temporary OBJ files
+ */
+std::vector<BenchResult> runObjExportBench(int gridSize, const QString &tempDir);
+
+#endif // OBJEXPORTBENCH_H
@@ -0,0 +1,163 @@
+#include "SyntheticTerrain.h"
+#include <QVariantMap>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace SyntheticTerrain {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kPointsPerCluster = 500;
+
+// Uniform in [0, 1) with 53 bits, independent of the standard library
+double uniform(std::mt19937 &engine)
+{
+    std::uint64_t high = engine() >> 5;
+    std::uint64_t low = engine() >> 6;
+    return (high * 67108864.0 + low) / 9007199254740992.0;
+}
+
+// Standard normal by Box-Muller
+double normal(std::mt19937 &engine)
+{
+    double u1 = 1.0 - uniform(engine);
+    double u2 = uniform(engine);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * kPi * u2);
+}
+
+QVariantMap point(double x, double y)
+{
+    QVariantMap pt;
+    pt["x"] = x;
+    pt["y"] = y;
+    pt["z"] = elevation(x, y);
+    return pt;
+}
+
+} // namespace
+
+bool parsePattern(const QString &name, Pattern &pattern)
+{
+    if (name == "random") {
+        pattern = Pattern::Random;
+    } else if (name == "gridded") {
+        pattern = Pattern::Gridded;
+    } else if (name == "clustered") {
+        pattern = Pattern::Clustered;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString patternName(Pattern pattern)
+{
+    switch (pattern) {
+    case Pattern::Random: return "random";
+    case Pattern::Gridded: return "gridded";
+    case Pattern::Clustered: return "clustered";
+    }
+    return QString();
+}
+
+double elevation(double x, double y)
+{
+    return 1200.0
+        + 25.0 * std::sin(x / 40.0) * std::cos(y / 55.0)
+        + 8.0 * std::sin((x + y) / 17.0)
+        + 0.3 * std::sin(x * 1.7 + y);
+}
+
+double integral(double width, double height)
+{
+    // Term by term: each is a product or sum of sines and cosines
+    double hills = 25.0 * 40.0 * (1.0 - std::cos(width / 40.0)) * 55.0 * std::sin(height / 55.0);
+    double ridges = 8.0 * 17.0 * 17.0
+        * (std::sin(width / 17.0) + std::sin(height / 17.0) - std::sin((width + height) / 17.0));
+    double roughness = 0.3 * (std::sin(1.7 * width) + std::sin(height) - std::sin(1.7 * width + height)) / 1.7;
+    return 1200.0 * width * height + hills + ridges + roughness;
+}
+
+DTMRaster raster(int cells, double pixelSize)
+{
+    DTMRaster result;
+    result.width = cells;
+    result.height = cells;
+    double top = cells * pixelSize;
+    double geoTransform[6] = {0.0, pixelSize, 0.0, top, 0.0, -pixelSize};
+    std::copy(geoTransform, geoTransform + 6, result.geoTransform);
+
+    result.values.resize(static_cast<size_t>(cells) * cells);
+    result.minElev = std::numeric_limits<float>::max();
+    result.maxElev = std::numeric_limits<float>::lowest();
+    for (int row = 0; row < cells; ++row) {
+        double y = top - (row + 0.5) * pixelSize;
+        for (int col = 0; col < cells; ++col) {
+            float z = static_cast<float>(elevation((col + 0.5) * pixelSize, y));
+            result.values[static_cast<size_t>(row) * cells + col] = z;
+            result.minElev = std::min(result.minElev, z);
+            result.maxElev = std::max(result.maxElev, z);
+        }
+    }
+    return result;
+}
+
+double siteSize(int count)
+{
+    return std::ceil(std::sqrt(static_cast<double>(std::max(count, 1))));
+}
+
+QVariantList points(Pattern pattern, int count, std::uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    double size = siteSize(count);
+
+    QVariantList result;
+    result.reserve(count);
+
+    switch (pattern) {
+    case Pattern::Random:
+        for (int i = 0; i < count; ++i) {
+            double x = uniform(engine) * size;
+            double y = uniform(engine) * size;
+            result.append(point(x, y));
+        }
+        break;
+
+    case Pattern::Gridded: {
+        // Row-major grid over the site with a little jitter, as set out in the field
+        int side = static_cast<int>(size);
+        for (int i = 0; i < count; ++i) {
+            double x = (i % side) + 0.5 + (uniform(engine) - 0.5) * 0.05;
+            double y = (i / side) + 0.5 + (uniform(engine) - 0.5) * 0.05;
+            result.append(point(x, y));
+        }
+        break;
+    }
+
+    case Pattern::Clustered: {
+        // Cluster spread scales with the site so clusters cover it at any count
+        int clusters = std::max(1, count / kPointsPerCluster);
+        double spread = size / std::sqrt(static_cast<double>(clusters)) / 4.0;
+        std::vector<double> centres(static_cast<size_t>(clusters) * 2);
+        for (double &c : centres) {
+            c = uniform(engine) * size;
+        }
+        for (int i = 0; i < count; ++i) {
+            int k = i % clusters;
+            double x = std::clamp(centres[k * 2] + normal(engine) * spread, 0.0, size);
+            double y = std::clamp(centres[k * 2 + 1] + normal(engine) * spread, 0.0, size);
+            result.append(point(x, y));
+        }
+        break;
+    }
+    }
+
+    return result;
+}
+
+} // namespace SyntheticTerrain
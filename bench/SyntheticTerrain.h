@@ -0,0 +1,65 @@
+#ifndef SYNTHETICTERRAIN_H
+#define SYNTHETICTERRAIN_H
+
+#include "analysis/DTMGenerator.h"
+#include <QString>
+#include <QVariantList>
+#include <cstdint>
+
+/**
+ * @brief Reproducible synthetic survey points for benchmarks
+ *
+ * Points sample one smooth terrain surface (rolling hills plus a little
+ * roughness) over a square site whose side grows with the point count, so
+ * the density stays about one point per square metre. Random numbers come
+ * straight from std::mt19937, whose output sequence is fixed by the
+ * standard, and are turned into doubles here rather than through the
+ * library distributions, so a seed gives the same points on every compiler
+ * and platform.
+ */
+namespace SyntheticTerrain {
+
+enum class Pattern {
+    Random,     // uniform over the site
+    Gridded,    // regular grid, as from a levelling survey
+    Clustered   // Gaussian clusters, as from spot shots around features
+};
+
+/**
+ * @brief Pattern from its name ("random", "gridded", "clustered")
+ * @return false for an unknown name
+ */
+bool parsePattern(const QString &name, Pattern &pattern);
+QString patternName(Pattern pattern);
+
+/**
+ * @brief Terrain elevation at a site position
+ */
+double elevation(double x, double y);
+
+/**
+ * @brief Exact integral of elevation() over [0, width] x [0, height]
+ */
+double integral(double width, double height);
+
+/**
+ * @brief The surface sampled at cell centres of a north-up grid over [0, cells * pixelSize]^2
+ */
+DTMRaster raster(int cells, double pixelSize);
+
+/**
+ * @brief Side length of the square site for a point count
+ */
+double siteSize(int count);
+
+/**
+ * @brief Generate points as {x, y, z} maps, the form the engines take
+ * @param pattern Horizontal distribution
+ * @param count Number of points
+ * @param seed Random seed
+ */
+QVariantList points(Pattern pattern, int count, std::uint32_t seed);
+
+} // namespace SyntheticTerrain
+
+#endif // SYNTHETICTERRAIN_H
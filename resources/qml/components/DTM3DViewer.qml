@@ -2,6 +2,7 @@ import QtQuick
 import QtQuick.Controls
 import QtQuick3D
 import QtQuick3D.Helpers
+import SiteSurveyor.Analysis
 
 Window {
     id: dtmViewer
@@ -12,12 +13,102 @@ Window {
     color: "#1E1E1E"
 
     property var meshData: null
+    property real verticalScale: 1.0
+
+    property real maxPixelError: 2.0
+    property bool showTIN: false
+
+    // Open the current DTM as level-of-detail tiles; tiles stream in as the camera moves
+    function loadTerrain(scale) {
+        if (scale !== undefined) verticalScale = scale
+        showTIN = false
+        chunkModel.clear()
+        tileModel.clear()
+        var info = Earthwork.openTerrainTiles(verticalScale)
+        if (info.levelCount === undefined) {
+            meshData = null
+            return
+        }
+        meshData = info
+        console.log("3D Viewer: Terrain with", info.levelCount, "detail levels")
+        resetView()
+        updateTiles()
+    }
+
+    // Show the TIN from generateTIN instead of the DTM tiles, as 16-bit cache-ordered chunks
+    function loadTIN(scale) {
+        if (scale !== undefined) verticalScale = scale
+        tileModel.clear()
+        chunkModel.clear()
+        var info = Earthwork.buildTerrainChunks(verticalScale, "tin")
+        if (info.chunkCount === undefined) {
+            showTIN = false
+            meshData = null
+            return
+        }
+        showTIN = true
+        meshData = info
+        for (var i = 0; i < info.chunkCount; i++) {
+            chunkModel.append({ chunkIndex: i })
+        }
+        console.log("3D Viewer: TIN with", info.indexCount / 3, "triangles in", info.chunkCount, "chunks")
+        resetView()
+    }
+
+    // Keep exactly the tiles selected for the current camera in the model
+    function updateTiles() {
+        if (!meshData || showTIN) return
+        var selected = Earthwork.selectTerrainTiles(camera.scenePosition, camera.fieldOfView,
+                                                    view3D.height, maxPixelError)
+        var wanted = {}
+        for (var i = 0; i < selected.length; i++) {
+            wanted[selected[i].key] = selected[i]
+        }
+        for (var j = tileModel.count - 1; j >= 0; j--) {
+            var key = tileModel.get(j).key
+            if (wanted[key]) {
+                delete wanted[key]
+            } else {
+                tileModel.remove(j)
+            }
+        }
+        for (var k in wanted) {
+            tileModel.append({ key: k, level: wanted[k].level, tileX: wanted[k].x, tileY: wanted[k].y })
+        }
+    }
+
+    // Frame the whole terrain from the default viewpoint
+    function viewDistance() {
+        if (!meshData) return 100
+        var size = meshData.boundsMax.minus(meshData.boundsMin).length()
+        return Math.max(size, 10)
+    }
 
-    // Load mesh data
-    function loadMesh(data) {
-        meshData = data
-        console.log("3D Viewer: Loading", data.vertexCount, "vertices,", data.indexCount / 3, "triangles")
-        terrainModel.visible = true
+    function resetView() {
+        var d = viewDistance()
+        camera.position = Qt.vector3d(0, d * 0.55, d * 0.8)
+        camera.eulerRotation = Qt.vector3d(-35, 0, 0)
+        camera.clipFar = d * 10
+    }
+
+    ListModel {
+        id: tileModel
+    }
+
+    ListModel {
+        id: chunkModel
+    }
+
+    // Re-select tiles shortly after the camera stops moving
+    Timer {
+        id: tileTimer
+        interval: 100
+        onTriggered: updateTiles()
+    }
+
+    Connections {
+        target: camera
+        function onScenePositionChanged() { tileTimer.restart() }
     }
 
     View3D {
@@ -64,28 +155,60 @@ Window {
             color: Qt.rgba(1, 1, 1, 1)
         }
 
-        // Terrain Model with custom geometry
-        Model {
-            id: terrainModel
-            visible: false
-
-            geometry: GeometryView {
-                id: geometryView
+        // Terrain tiles, one model per selected quadtree tile
+        Node {
+            id: terrainRoot
+
+            Repeater3D {
+                model: tileModel
+
+                delegate: Model {
+                    geometry: TerrainGeometry {
+                        id: tileGeometry
+                    }
+
+                    materials: [
+                        PrincipledMaterial {
+                            lighting: PrincipledMaterial.FragmentLighting
+                            vertexColorsEnabled: true
+                            baseColor: "#FFFFFF"
+                            metalness: 0.1
+                            roughness: 0.8
+                            cullMode: Material.NoCulling   // skirts face either way
+                        }
+                    ]
+
+                    Component.onCompleted: Earthwork.loadTerrainTile(tileGeometry, model.level, model.tileX, model.tileY)
+                }
             }
 
-            materials: [
-                PrincipledMaterial {
-                    lighting: PrincipledMaterial.FragmentLighting
-                    baseColor: "#60A0D0"
-                    metalness: 0.1
-                    roughness: 0.8
+            // TIN surface, shown instead of the tiles, one model per chunk
+            Repeater3D {
+                model: chunkModel
+
+                delegate: Model {
+                    geometry: TerrainGeometry {
+                        id: chunkGeometry
+                    }
+
+                    materials: [
+                        PrincipledMaterial {
+                            lighting: PrincipledMaterial.FragmentLighting
+                            vertexColorsEnabled: true
+                            baseColor: "#FFFFFF"
+                            metalness: 0.1
+                            roughness: 0.8
+                        }
+                    ]
+
+                    Component.onCompleted: Earthwork.loadTerrainChunk(chunkGeometry, model.chunkIndex)
                 }
-            ]
+            }
         }
 
         // Camera controller
         OrbitCameraController {
-            origin: terrainModel
+            origin: terrainRoot
             camera: camera
             panEnabled: true
             xSpeed: 0.5
@@ -93,44 +216,6 @@ Window {
         }
     }
 
-    // Custom geometry
-    Component {
-        id: geometryComponent
-
-        GeometryView {
-            property var meshData: dtmViewer.meshData
-        }
-    }
-
-    // Geometry defined inline
-    GeometryView {
-        id: geometryView
-
-        Component.onCompleted: {
-            if (dtmViewer.meshData) {
-                updateMesh()
-            }
-        }
-
-        Connections {
-            target: dtmViewer
-            function onMeshDataChanged() {
-                if (dtmViewer.meshData) {
-                    geometryView.updateMesh()
-                }
-            }
-        }
-
-        function updateMesh() {
-            var data =dtmViewer.meshData
-            if (!data) return
-
-            // Note: Qt Quick 3D requires C++ Geometry implementation
-            // For now this is a placeholder - mesh won't render without C++ backend
-            console.log("Geometry update requested for", data.vertexCount, "vertices")
-        }
-    }
-
     // Controls panel
     Rectangle {
         anchors.right: parent.right
@@ -169,17 +254,20 @@ Window {
             Button {
                 text: "↺ Reset View"
                 width: parent.width
-                onClicked: {
-                    camera.position = Qt.vector3d(0, 80, 120)
-                    camera.eulerRotation = Qt.vector3d(-35, 0, 0)
-                }
+                onClicked: resetView()
+            }
+
+            Button {
+                text: showTIN ? "▦ Show DTM" : "△ Show TIN"
+                width: parent.width
+                onClicked: showTIN ? loadTerrain() : loadTIN()
             }
 
             Button {
                 text: "⬇ Top View"
                 width: parent.width
                 onClicked: {
-                    camera.position = Qt.vector3d(0, 150, 0)
+                    camera.position = Qt.vector3d(0, viewDistance(), 0)
                     camera.eulerRotation = Qt.vector3d(-90, 0, 0)
                 }
             }
@@ -214,46 +302,22 @@ Window {
             Text {
                 color: "#C0C0D0"
                 font.pixelSize: 10
-                text: meshData ?
-                      "Vertices: " + meshData.vertexCount + " | Triangles: " + (meshData.indexCount / 3) :
-                      ""
+                text: !meshData ? "" :
+                      showTIN ? "TIN: " + meshData.vertexCount + " vertices | " + (meshData.indexCount / 3) + " triangles | "
+                                + meshData.chunkCount + " chunks" :
+                      "Tiles: " + tileModel.count + " | Detail levels: " + meshData.levelCount
                 visible: meshData !== null
             }
 
             Text {
                 color: "#C0C0D0"
                 font.pixelSize: 10
-                text: meshData && meshData.minElev !== undefined ?
-                      "Elevation: " + meshData.minElev.toFixed(2) + "m - " + meshData.maxElev.toFixed(2) + "m" :
+                text: meshData ?
+                      "Elevation: " + (meshData.boundsMin.y / verticalScale).toFixed(2) + "m - " +
+                      (meshData.boundsMax.y / verticalScale).toFixed(2) + "m" :
                       ""
-                visible: meshData !== null && meshData.minElev !== undefined
+                visible: meshData !== null && verticalScale > 0
             }
         }
     }
-
-    // Warning message
-    Rectangle {
-        anchors.centerIn: parent
-        width: warningText.width + 40
-        height: warningText.height + 40
-        color: "#3A3A4E"
-        radius: 10
-        border.color: "#FFA500"
-        border.width: 3
-        visible: terrainModel.visible && meshData !== null
-
-        Text {
-            id: warningText
-            anchors.centerIn: parent
-            color: "#FFD700"
-            font.pixelSize: 14
-            font.bold: true
-            horizontalAlignment: Text.AlignHCenter
-            text: "⚠️ Custom Geometry Requires C++ Implementation\n\n" +
-                  "Qt Quick 3D needs a C++ QQuick3DGeometry class\n" +
-                  "to render custom mesh data.\n\n" +
-                  "Use 'Export DTM as 3D Mesh (OBJ)' menu option\n" +
-                  "and open with MeshLab for full 3D visualization."
-        }
-    }
 }
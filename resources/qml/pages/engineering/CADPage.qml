@@ -129,6 +129,7 @@ Window {
     }
     property var contourLines: [] // Array of {elevation, points}
     property var dtmData: null    // DTM raster data for visualization
+    property var isopachData: null // Cut/fill isopach from the last grid volume (preview PNG + extent)
     property var tinData: null    // TIN mesh data for visualization
     property bool showDTM: true   // Toggle DTM visualization
     property bool showTIN: true   // Toggle TIN visualization
@@ -2583,6 +2584,7 @@ Window {
                         // Auto-zoom when canvas size is ready
                         onWidthChanged: if (width > 0 && height > 0) recalculateBounds()
                         onHeightChanged: if (width > 0 && height > 0) recalculateBounds()
+                        onImageLoaded: requestPaint()
 
                         onPaint: {
                             var ctx = getContext("2d")
@@ -2741,6 +2743,17 @@ Window {
                                 ctx.restore()
                             }
 
+                            // Draw cut/fill isopach preview (red = cut, blue = fill)
+                            if (isopachData && isImageLoaded(isopachData.previewUrl)) {
+                                ctx.save()
+                                ctx.globalAlpha = 0.6
+                                var isoTopLeft = worldToScreen(isopachData.extent.minX, isopachData.extent.maxY)
+                                var isoBottomRight = worldToScreen(isopachData.extent.maxX, isopachData.extent.minY)
+                                ctx.drawImage(isopachData.previewUrl, isoTopLeft.x, isoTopLeft.y,
+                                              isoBottomRight.x - isoTopLeft.x, isoBottomRight.y - isoTopLeft.y)
+                                ctx.restore()
+                            }
+
                             // Draw TIN (Triangulated Irregular Network)
                             if (showTIN && tinData && tinData.success) {
                                 ctx.save()
@@ -5609,12 +5622,31 @@ Window {
                 // DTM-based calculation
                 method = "DTM"
                 baseElev = dtmData.minElev
+                // Use the drawn boundary as-is; without one, mask to the hull of the survey points
                 var pointsToUse = []
-                for(var i=0; i<importedPoints.count; i++) {
-                    var p = importedPoints.get(i)
-                    pointsToUse.push({x: p.x, y: p.y, z: p.z || 0})
+                if (boundaryPolygon && boundaryPolygon.length >= 3) {
+                    pointsToUse = boundaryPolygon
+                } else {
+                    var surveyPoints = []
+                    for(var i=0; i<importedPoints.count; i++) {
+                        var p = importedPoints.get(i)
+                        surveyPoints.push({x: p.x, y: p.y})
+                    }
+                    pointsToUse = Earthwork.convexHull(surveyPoints)
+                }
+                // Write the cut/fill isopach in the same pass and overlay its preview
+                var tempDir = Platform.StandardPaths.writableLocation(Platform.StandardPaths.TempLocation)
+                var isopachPath = tempDir.toString().replace("file://", "") + "/sitesurveyor_isopach.tif"
+                var result = Earthwork.calculateVolume(baseElev, pointsToUse, "gdal", isopachPath)
+                if (result.isopach) {
+                    if (isopachData) pointsCanvas.unloadImage(isopachData.previewUrl)
+                    // Unique URL per run so the canvas does not reuse a cached image
+                    isopachData = {
+                        previewUrl: "file://" + result.isopach.previewPath + "?v=" + Date.now(),
+                        extent: result.isopach.previewExtent
+                    }
+                    pointsCanvas.loadImage(isopachData.previewUrl)
                 }
-                var result = Earthwork.calculateVolume(baseElev, pointsToUse, "gdal")
                 cutVol = result.cut
                 fillVol = result.fill
                 netVol = result.net
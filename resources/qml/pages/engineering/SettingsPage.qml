@@ -605,6 +605,114 @@ Item {
                 }
             }
 
+            // ============ DIAGNOSTICS ============
+            Rectangle {
+                Layout.fillWidth: true
+                implicitHeight: diagnosticsColumn.height + 40
+                color: cardColor
+                radius: 6
+                border.color: borderColor
+
+                ColumnLayout {
+                    id: diagnosticsColumn
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.top: parent.top
+                    anchors.margins: 20
+                    spacing: 16
+
+                    RowLayout {
+                        spacing: 10
+                        Rectangle {
+                            width: 32; height: 32; radius: 6
+                            color: Qt.lighter(warningColor, 1.85)
+                            Text { anchors.centerIn: parent; text: "\uf201"; font.family: "Font Awesome 5 Pro Solid"; font.pixelSize: 11; color: warningColor }
+                        }
+                        Text { text: "Diagnostics"; font.family: "Codec Pro"; font.pixelSize: 12; font.bold: true; color: textPrimary }
+                    }
+
+                    RowLayout {
+                        Layout.fillWidth: true
+                        spacing: 10
+
+                        ColumnLayout {
+                            Layout.fillWidth: true
+                            spacing: 2
+                            Text { text: "Record performance trace"; font.family: "Codec Pro"; font.pixelSize: 10; color: textPrimary }
+                            Text {
+                                Layout.fillWidth: true
+                                text: "Times DTM, volume, mesh, database and cloud stages. Written on exit, or now with Export Trace; open in ui.perfetto.dev."
+                                font.family: "Codec Pro"; font.pixelSize: 9; color: textSecondary
+                                wrapMode: Text.WordWrap
+                            }
+                        }
+                        Switch {
+                            id: tracingSwitch
+                            checked: Earthwork.tracingEnabled()
+                            Layout.alignment: Qt.AlignVCenter
+                            onToggled: Earthwork.setTracingEnabled(checked)
+                        }
+                    }
+
+                    RowLayout {
+                        Layout.fillWidth: true
+                        spacing: 10
+
+                        ColumnLayout {
+                            Layout.fillWidth: true
+                            spacing: 2
+                            Text { text: "Analysis memory budget (MB)"; font.family: "Codec Pro"; font.pixelSize: 10; color: textPrimary }
+                            Text {
+                                Layout.fillWidth: true
+                                text: "Larger DTMs are streamed or meshed at reduced resolution instead. 0 uses half of the installed RAM."
+                                font.family: "Codec Pro"; font.pixelSize: 9; color: textSecondary
+                                wrapMode: Text.WordWrap
+                            }
+                        }
+                        SpinBox {
+                            id: memoryBudgetSpin
+                            from: 0
+                            to: Math.max(1024, Math.round(Earthwork.memoryUsage().physical / 1048576))
+                            stepSize: 256
+                            editable: true
+                            value: Math.round(Earthwork.memoryUsage().limit / 1048576)
+                            Layout.alignment: Qt.AlignVCenter
+                            onValueModified: Earthwork.setMemoryBudget(value)
+
+                            background: Rectangle {
+                                radius: 4
+                                color: "#f8f9fa"
+                                border.color: borderColor
+                            }
+                        }
+                    }
+
+                    Button {
+                        id: exportTraceBtn
+                        text: "\uf56e  Export Trace"
+                        enabled: tracingSwitch.checked
+                        font.family: "Codec Pro"
+                        font.pixelSize: 10
+                        onClicked: {
+                            var path = Earthwork.exportTrace("")
+                            if (path !== "") showSuccess("Trace written to " + path)
+                            else showError(Earthwork.lastError)
+                        }
+                        background: Rectangle {
+                            radius: 4
+                            color: exportTraceBtn.enabled ? accentColor : Qt.lighter(accentColor, 1.5)
+                        }
+                        contentItem: Text {
+                            text: parent.text
+                            font: parent.font
+                            color: "white"
+                            horizontalAlignment: Text.AlignHCenter
+                            verticalAlignment: Text.AlignVCenter
+                        }
+                    }
+                }
+            }
+
             // Spacer
             Item { Layout.preferredHeight: 20 }
         }
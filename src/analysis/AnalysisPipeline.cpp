@@ -0,0 +1,195 @@
+#include "AnalysisPipeline.h"
+#include "DTMGenerator.h"
+#include "VolumeCalculator.h"
+#include "MeshExporter.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QFuture>
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace {
+
+struct Stage {
+    QString name;
+    std::function<QVariant(QString &errorOut)> run;
+    QVariant result;
+    QString error;
+};
+
+} // namespace
+
+AnalysisPipeline::AnalysisPipeline(DTMGenerator *dtmGenerator,
+                                   VolumeCalculator *volumeCalculator,
+                                   MeshExporter *meshExporter)
+    : m_dtmGenerator(dtmGenerator)
+    , m_volumeCalculator(volumeCalculator)
+    , m_meshExporter(meshExporter)
+{
+}
+
+QVariantMap AnalysisPipeline::run(const QVariantMap &spec,
+                                  const QString &dtmPath,
+                                  JobScheduler::Context &context,
+                                  QString &errorOut)
+{
+    QVariantMap result;
+    bool generate = spec.contains("dtm");
+    result["dtm"] = generate;
+
+    // Progress: DTM generation 0-40%, reading to 50% (20% without generation),
+    // then an equal share per finished stage
+    int readEnd = generate ? 50 : 20;
+
+    if (generate) {
+        QVariantMap parameters = spec["dtm"].toMap();
+        bool ok = m_dtmGenerator->generate(parameters["points"].toList(),
+                                           parameters.value("pixelSize", 1.0).toDouble(),
+                                           dtmPath, errorOut,
+                                           [&context](int prog) { context.setProgress(prog * 40 / 100); },
+                                           [&context]() { return context.isCanceled(); });
+        if (!ok) {
+            errorOut = "dtm: " + errorOut;
+            return result;
+        }
+    }
+    if (context.isCanceled()) {
+        return result;
+    }
+
+    // A raster over the memory budget is not shared: contours and volume
+    // stream from the file instead, and the mesh reads its own copy at
+    // whatever resolution fits
+    DTMRaster raster;
+    bool streamed = false;
+    if (!m_dtmGenerator->readRaster(dtmPath, raster, errorOut, &streamed)) {
+        if (!streamed) {
+            errorOut = "dtm: " + errorOut;
+            return result;
+        }
+        qDebug() << "Pipeline: DTM over the memory budget, streaming stages from" << dtmPath;
+        errorOut.clear();
+    }
+    result["streamed"] = streamed;
+    context.setProgress(readEnd);
+
+    std::vector<Stage> stages;
+    if (spec.contains("contours")) {
+        double interval = spec["contours"].toMap().value("interval", 1.0).toDouble();
+        stages.push_back({"contours", [this, &raster, &dtmPath, streamed, interval](QString &error) -> QVariant {
+            QVariantList contours = streamed
+                ? m_dtmGenerator->generateContours(dtmPath, interval, error)
+                : m_dtmGenerator->generateContours(raster, interval, error);
+            return error.isEmpty() ? QVariant(contours) : QVariant();
+        }, QVariant(), QString()});
+    }
+    if (spec.contains("volume")) {
+        QVariantMap parameters = spec["volume"].toMap();
+        stages.push_back({"volume", [this, &raster, &dtmPath, streamed, parameters](QString &error) -> QVariant {
+            double baseElevation = parameters["baseElevation"].toDouble();
+            QVariantList points = parameters["points"].toList();
+            QString isopachPath = parameters["isopachPath"].toString();
+            QVariantMap volume = streamed
+                ? m_volumeCalculator->calculateGrid(dtmPath, baseElevation, points, error, isopachPath)
+                : m_volumeCalculator->calculateGrid(raster, baseElevation, points, error, isopachPath);
+            // Volumes stay valid when only the isopach output failed
+            return volume["area"].toDouble() > 0.0 || error.isEmpty() ? QVariant(volume) : QVariant();
+        }, QVariant(), QString()});
+    }
+    if (spec.contains("mesh")) {
+        QVariantMap parameters = spec["mesh"].toMap();
+        stages.push_back({"mesh", [this, &raster, &dtmPath, streamed, parameters](QString &error) -> QVariant {
+            if (!streamed) {
+                return runMesh(raster, parameters, error);
+            }
+            DTMRaster reduced;
+            if (!m_dtmGenerator->readRasterWithinBudget(dtmPath, reduced,
+                                                        MeshExporter::kGridBytesPerCell, error)) {
+                return QVariant();
+            }
+            return runMesh(reduced, parameters, error);
+        }, QVariant(), QString()});
+    }
+
+    // The stages only read the raster, each through its own GDAL handle. A
+    // private pool keeps their nested parallel loops on the global pool free
+    // of blocked stage threads.
+    QThreadPool stagePool;
+    stagePool.setMaxThreadCount(std::max(1, static_cast<int>(stages.size())));
+
+    // Stage reservations count towards this job's peak
+    std::shared_ptr<MemoryBudget::Usage> usage = MemoryBudget::currentUsage();
+
+    QMutex progressMutex;
+    int finished = 0;
+    std::vector<QFuture<void>> futures;
+    futures.reserve(stages.size());
+
+    for (Stage &stage : stages) {
+        futures.push_back(QtConcurrent::run(&stagePool, [&]() {
+            MemoryBudget::UsageScope scope(usage);
+            if (!context.isCanceled()) {
+                stage.result = stage.run(stage.error);
+            }
+            QMutexLocker locker(&progressMutex);
+            ++finished;
+            context.setProgress(readEnd + (100 - readEnd) * finished / static_cast<int>(stages.size()));
+        }));
+    }
+    for (QFuture<void> &future : futures) {
+        future.waitForFinished();
+    }
+
+    QVariantMap errors;
+    for (const Stage &stage : stages) {
+        if (!stage.error.isEmpty()) {
+            errors[stage.name] = stage.error;
+            if (errorOut.isEmpty()) {
+                errorOut = stage.name + ": " + stage.error;
+            }
+        }
+        if (stage.result.isValid()) {
+            result[stage.name] = stage.result;
+        }
+    }
+    result["errors"] = errors;
+    result["peakMemory"] = context.peakMemory();
+
+    qDebug() << "Pipeline finished:" << stages.size() << "stages," << errors.size() << "failed,"
+             << "peak" << MemoryBudget::formatBytes(context.peakMemory());
+
+    context.setProgress(100);
+    return result;
+}
+
+QVariant AnalysisPipeline::runMesh(const DTMRaster &raster, const QVariantMap &parameters, QString &errorOut)
+{
+    double verticalScale = parameters.value("verticalScale", 1.0).toDouble();
+    QString filePath = parameters["filePath"].toString();
+    if (filePath.isEmpty()) {
+        QVariantMap mesh = m_meshExporter->generate3DMesh(raster, verticalScale, errorOut);
+        return errorOut.isEmpty() ? QVariant(mesh) : QVariant();
+    }
+
+    QString format = parameters.value("format", QFileInfo(filePath).suffix()).toString().toLower();
+    bool ok = false;
+    if (format == "obj") {
+        ok = m_meshExporter->exportAsOBJ(raster, filePath, verticalScale, errorOut);
+    } else {
+        MeshBuffers mesh;
+        ok = m_meshExporter->buildGridMesh(raster, verticalScale, mesh, errorOut)
+             && m_meshExporter->exportMesh(mesh, filePath, format, errorOut);
+    }
+    if (!ok) {
+        return QVariant();
+    }
+
+    QVariantMap exported;
+    exported["filePath"] = filePath;
+    exported["format"] = format;
+    return exported;
+}
@@ -0,0 +1,63 @@
+#ifndef ANALYSISPIPELINE_H
+#define ANALYSISPIPELINE_H
+
+#include "JobScheduler.h"
+#include <QString>
+#include <QVariantMap>
+
+class DTMGenerator;
+class VolumeCalculator;
+class MeshExporter;
+struct DTMRaster;
+
+/**
+ * @brief Runs DTM -> contours / volume / mesh as one job over a shared raster
+ *
+ * The spec is declarative; each key present enables a stage:
+ * - "dtm": {points, pixelSize} regenerates the DTM first (otherwise the
+ *   existing DTM is used)
+ * - "contours": {interval}
+ * - "volume": {baseElevation, points, isopachPath}
+ * - "mesh": {verticalScale, filePath, format}; without a filePath the
+ *   viewer buffers of MeshExporter::generate3DMesh are returned, otherwise
+ *   the mesh is exported ("obj", "glb", "ply" or "stl", default from the
+ *   file suffix)
+ *
+ * The DTM is read once. Contours, volume and mesh then run concurrently on
+ * that raster, each on its own thread, and report into one progress value.
+ * When the raster does not fit the MemoryBudget, contours and volume stream
+ * from the DTM file instead and the mesh is built from a reduced-resolution
+ * read.
+ */
+class AnalysisPipeline
+{
+public:
+    AnalysisPipeline(DTMGenerator *dtmGenerator,
+                     VolumeCalculator *volumeCalculator,
+                     MeshExporter *meshExporter);
+
+    /**
+     * @brief Run the stages in spec on the job's thread
+     * @param spec Stage parameters, see the class description
+     * @param dtmPath DTM file to (re)generate and read
+     * @param context Job context for progress and cancellation
+     * @param errorOut Output parameter for the first failure ("stage: message")
+     * @return Map with "dtm" (true when regenerated), "streamed" (true when the
+     *         raster was over the memory budget), one entry per stage that
+     *         produced a result under the stage's key, "errors" mapping failed
+     *         stages to their messages, and the job's "peakMemory" in bytes
+     */
+    QVariantMap run(const QVariantMap &spec,
+                    const QString &dtmPath,
+                    JobScheduler::Context &context,
+                    QString &errorOut);
+
+private:
+    QVariant runMesh(const DTMRaster &raster, const QVariantMap &parameters, QString &errorOut);
+
+    DTMGenerator *m_dtmGenerator;
+    VolumeCalculator *m_volumeCalculator;
+    MeshExporter *m_meshExporter;
+};
+
+#endif // ANALYSISPIPELINE_H
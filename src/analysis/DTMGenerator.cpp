@@ -1,5 +1,7 @@
 #include "DTMGenerator.h"
 #include "GDALHelpers.h"
+#include "MemoryBudget.h"
+#include "utilities/Trace.h"
 #include <gdal_priv.h>
 #include <gdal_utils.h>
 #include <gdal_alg.h>
@@ -10,6 +12,7 @@
 #include <QUuid>
 #include <QStandardPaths>
 #include <QFileInfo>
+#include <algorithm>
 
 using namespace GDALHelpers;
 
@@ -66,12 +69,32 @@ bool DTMGenerator::createVRTFile(const QString &csvPath, const QString &vrtPath,
     return true;
 }
 
+namespace {
+
+struct GridProgress {
+    DTMGenerator::ProgressCallback progress;
+    DTMGenerator::CancelCheck isCanceled;
+};
+
+// GDALGrid progress: report 70-100% and stop when the job is cancelled
+int CPL_STDCALL gridProgress(double complete, const char *, void *data)
+{
+    auto *grid = static_cast<GridProgress *>(data);
+    if (grid->progress) grid->progress(70 + static_cast<int>(complete * 29.0));
+    return grid->isCanceled && grid->isCanceled() ? FALSE : TRUE;
+}
+
+} // namespace
+
 bool DTMGenerator::generate(const QVariantList &points,
                            double pixelSize,
                            const QString &outputPath,
                            QString &errorOut,
-                           ProgressCallback progressCallback)
+                           ProgressCallback progressCallback,
+                           CancelCheck isCanceled)
 {
+    TRACE_SCOPE("dtm", "DTMGenerator::generate");
+
     // Validate input
     if (!validatePoints(points, errorOut)) {
         return false;
@@ -99,25 +122,27 @@ bool DTMGenerator::generate(const QVariantList &points,
         return false;
     }
 
-    QTextStream out(&csvFile);
-    out << "X,Y,Z\n";
-
     double minX = 1e9, maxX = -1e9, minY = 1e9, maxY = -1e9;
-
-    for (const QVariant &v : points) {
-        QVariantMap pt = v.toMap();
-        double x = pt["x"].toDouble();
-        double y = pt["y"].toDouble();
-        double z = pt["z"].toDouble();
-
-        out << QString::number(x, 'f', 6) << ","
-            << QString::number(y, 'f', 6) << ","
-            << QString::number(z, 'f', 6) << "\n";
-
-        if (x < minX) minX = x;
-        if (x > maxX) maxX = x;
-        if (y < minY) minY = y;
-        if (y > maxY) maxY = y;
+    {
+        TRACE_SCOPE("dtm", "write point CSV");
+        QTextStream out(&csvFile);
+        out << "X,Y,Z\n";
+
+        for (const QVariant &v : points) {
+            QVariantMap pt = v.toMap();
+            double x = pt["x"].toDouble();
+            double y = pt["y"].toDouble();
+            double z = pt["z"].toDouble();
+
+            out << QString::number(x, 'f', 6) << ","
+                << QString::number(y, 'f', 6) << ","
+                << QString::number(z, 'f', 6) << "\n";
+
+            if (x < minX) minX = x;
+            if (x > maxX) maxX = x;
+            if (y < minY) minY = y;
+            if (y > maxY) maxY = y;
+        }
     }
     csvFile.close();
 
@@ -137,6 +162,13 @@ bool DTMGenerator::generate(const QVariantList &points,
 
     if (progressCallback) progressCallback(40);
 
+    if (isCanceled && isCanceled()) {
+        errorOut = "Canceled";
+        QFile::remove(tempCsvPath);
+        QFile::remove(vrtPath);
+        return false;
+    }
+
     // Open source dataset using RAII guard
     DatasetGuard srcDataset(GDALOpenEx(vrtPath.toUtf8().constData(),
                                        GDAL_OF_VECTOR, nullptr, nullptr, nullptr));
@@ -186,14 +218,21 @@ bool DTMGenerator::generate(const QVariantList &points,
 
     if (progressCallback) progressCallback(70);
 
+    GridProgress progress{progressCallback, isCanceled};
+    GDALGridOptionsSetProgress(gridOptions.get(), gridProgress, &progress);
+
     // Generate DTM using RAII guard for output dataset
-    DatasetGuard dstDataset(GDALGrid(outputPath.toUtf8().constData(),
-                                    srcDataset.get(),
-                                    gridOptions.get(),
-                                    nullptr));
+    DatasetGuard dstDataset;
+    {
+        TRACE_SCOPE("dtm", "GDALGrid");
+        dstDataset = DatasetGuard(GDALGrid(outputPath.toUtf8().constData(),
+                                           srcDataset.get(),
+                                           gridOptions.get(),
+                                           nullptr));
+    }
 
     if (!dstDataset) {
-        errorOut = "GDAL Grid failed to generate DTM";
+        errorOut = isCanceled && isCanceled() ? "Canceled" : "GDAL Grid failed to generate DTM";
         QFile::remove(tempCsvPath);
         QFile::remove(vrtPath);
         return false;
@@ -214,103 +253,161 @@ bool DTMGenerator::generate(const QVariantList &points,
 
 QVariantMap DTMGenerator::getData(const QString &dtmPath, QString &errorOut)
 {
+    TRACE_SCOPE("dtm", "DTMGenerator::getData");
     QVariantMap result;
 
+    // Every cell becomes a QVariant, so large DTMs come back at reduced resolution.
+    // If other work takes the budget between the read and the list reservation,
+    // read once more at the resolution that now fits before giving up.
+    DTMRaster raster;
+    MemoryBudget::Reservation listReservation;
+    for (int attempt = 0; attempt < 2 && !listReservation; ++attempt) {
+        raster = DTMRaster();
+        if (!readRasterWithinBudget(dtmPath, raster, sizeof(QVariant), errorOut)) {
+            return result;
+        }
+        listReservation = MemoryBudget::tryReserve(static_cast<qint64>(raster.values.size()) * sizeof(QVariant));
+    }
+    if (!listReservation) {
+        errorOut = QString("DTM data %1 x %2 does not fit the memory budget (%3 free)")
+                       .arg(raster.width).arg(raster.height)
+                       .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return result;
+    }
+
+    // Convert to QVariantList
+    QVariantList dataList;
+    dataList.reserve(static_cast<qsizetype>(raster.values.size()));
+    for (float value : raster.values) {
+        dataList.append(value);
+    }
+
+    result["width"] = raster.width;
+    result["height"] = raster.height;
+    result["step"] = raster.step;
+    result["data"] = dataList;
+    result["minElev"] = raster.minElev;
+    result["maxElev"] = raster.maxElev;
+    result["originX"] = raster.geoTransform[0];
+    result["originY"] = raster.geoTransform[3];
+    result["pixelWidth"] = raster.geoTransform[1];
+    result["pixelHeight"] = raster.geoTransform[5];
+
+    return result;
+}
+
+namespace {
+
+// Read band 1 with every step-th cell along each axis (nearest neighbour, so
+// nodata stays nodata). The values are reserved against the memory budget;
+// extraBytesPerCell is what the caller will need on top. With step 0 the
+// smallest step that fits the budget is chosen; otherwise overBudget is set
+// when the requested step does not fit.
+bool readBand(const QString &dtmPath, int step, qint64 extraBytesPerCell, DTMRaster &raster,
+              bool *overBudget, QString &errorOut)
+{
     // Open DTM using RAII guard
     DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
     if (!dataset) {
         errorOut = QString("Failed to open DTM: %1").arg(dtmPath);
-        return result;
+        return false;
     }
 
     // Get raster band
     GDALRasterBandH hBand = GDALGetRasterBand(dataset.get(), 1);
     if (!hBand) {
         errorOut = "Failed to get DTM raster band";
-        return result;
+        return false;
     }
 
-    // Get dimensions
-    int width = GDALGetRasterBandXSize(hBand);
-    int height = GDALGetRasterBandYSize(hBand);
-
     // Get geotransform
-    double adfGeoTransform[6];
-    if (GDALGetGeoTransform(dataset.get(), adfGeoTransform) != CE_None) {
+    if (GDALGetGeoTransform(dataset.get(), raster.geoTransform) != CE_None) {
         errorOut = "Failed to get DTM geotransform";
-        return result;
+        return false;
     }
 
-    // Read raster data using RAII guard
-    CPLMemoryGuard<float> scanline((float*)CPLMalloc(sizeof(float) * width * height));
-    if (!scanline) {
-        errorOut = "Failed to allocate memory for DTM data";
-        return result;
+    int sourceWidth = GDALGetRasterBandXSize(hBand);
+    int sourceHeight = GDALGetRasterBandYSize(hBand);
+    qint64 bytesPerCell = sizeof(float) + extraBytesPerCell;
+    auto cellsAt = [&](int s) {
+        return static_cast<qint64>((sourceWidth + s - 1) / s) * ((sourceHeight + s - 1) / s);
+    };
+
+    if (step <= 0) {
+        qint64 available = MemoryBudget::available();
+        step = 1;
+        while (cellsAt(step) * bytesPerCell > available && step < std::max(sourceWidth, sourceHeight)) {
+            ++step;
+        }
     }
 
-    CPLErr err = GDALRasterIO(hBand, GF_Read, 0, 0, width, height,
-                              scanline.get(), width, height, GDT_Float32, 0, 0);
+    raster.step = step;
+    raster.width = (sourceWidth + step - 1) / step;
+    raster.height = (sourceHeight + step - 1) / step;
+    qint64 cells = static_cast<qint64>(raster.width) * raster.height;
+
+    raster.reservation = MemoryBudget::tryReserve(cells * static_cast<qint64>(sizeof(float)));
+    if (!raster.reservation || cells * bytesPerCell > MemoryBudget::available() + raster.reservation.bytes()) {
+        raster.reservation.release();
+        if (overBudget) *overBudget = true;
+        errorOut = QString("DTM %1 x %2 needs %3, more than the %4 left in the memory budget")
+                       .arg(raster.width).arg(raster.height)
+                       .arg(MemoryBudget::formatBytes(cells * bytesPerCell))
+                       .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return false;
+    }
+    raster.values.resize(static_cast<size_t>(cells));
+
+    GDALRasterIOExtraArg extra;
+    INIT_RASTERIO_EXTRA_ARG(extra);
+    extra.eResampleAlg = GRIORA_NearestNeighbour;
+    CPLErr err = GDALRasterIOEx(hBand, GF_Read, 0, 0, sourceWidth, sourceHeight,
+                                raster.values.data(), raster.width, raster.height, GDT_Float32, 0, 0, &extra);
     if (err != CE_None) {
         errorOut = "Failed to read DTM raster data";
-        return result;
+        return false;
     }
-
-    // Find min/max elevation
-    float minElev = scanline[0];
-    float maxElev = scanline[0];
-    for (int i = 0; i < width * height; i++) {
-        if (scanline[i] != -9999.0f) {  // Skip nodata
-            if (scanline[i] < minElev) minElev = scanline[i];
-            if (scanline[i] > maxElev) maxElev = scanline[i];
-        }
+    raster.geoTransform[1] *= static_cast<double>(sourceWidth) / raster.width;
+    raster.geoTransform[5] *= static_cast<double>(sourceHeight) / raster.height;
+
+    // Find min/max elevation over valid cells
+    bool any = false;
+    for (float value : raster.values) {
+        if (value == -9999.0f) continue;  // Skip nodata
+        if (!any || value < raster.minElev) raster.minElev = value;
+        if (!any || value > raster.maxElev) raster.maxElev = value;
+        any = true;
     }
 
-    // Convert to QVariantList
-    QVariantList dataList;
-    dataList.reserve(width * height);
-    for (int i = 0; i < width * height; i++) {
-        dataList.append(scanline[i]);
-    }
+    qDebug() << "DTM data retrieved:" << raster.width << "x" << raster.height
+             << (step > 1 ? QString("(1 in %1 cells per axis, to fit the memory budget)").arg(step) : QString())
+             << "Elevation range:" << raster.minElev << "-" << raster.maxElev;
 
-    result["width"] = width;
-    result["height"] = height;
-    result["data"] = dataList;
-    result["minElev"] = minElev;
-    result["maxElev"] = maxElev;
-    result["originX"] = adfGeoTransform[0];
-    result["originY"] = adfGeoTransform[3];
-    result["pixelWidth"] = adfGeoTransform[1];
-    result["pixelHeight"] = adfGeoTransform[5];
+    return true;
+}
 
-    qDebug() << "DTM data retrieved:" << width << "x" << height
-             << "Elevation range:" << minElev << "-" << maxElev;
+} // namespace
 
-    return result;
+bool DTMGenerator::readRaster(const QString &dtmPath, DTMRaster &raster, QString &errorOut, bool *overBudget)
+{
+    TRACE_SCOPE("dtm", "DTMGenerator::readRaster");
+    return readBand(dtmPath, 1, 0, raster, overBudget, errorOut);
 }
 
-QVariantList DTMGenerator::generateContours(const QString &dtmPath,
-                                           double interval,
-                                           QString &errorOut)
+bool DTMGenerator::readRasterWithinBudget(const QString &dtmPath, DTMRaster &raster,
+                                          qint64 extraBytesPerCell, QString &errorOut)
 {
-    QVariantList results;
+    TRACE_SCOPE("dtm", "DTMGenerator::readRasterWithinBudget");
+    return readBand(dtmPath, 0, extraBytesPerCell, raster, nullptr, errorOut);
+}
 
-    if (interval <= 0) {
-        errorOut = QString("Invalid contour interval: %1 (must be > 0)").arg(interval);
-        return results;
-    }
+namespace {
 
-    // Open DTM using RAII guard
-    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
-    if (!dataset) {
-        errorOut = QString("Failed to open DTM for contours: %1").arg(dtmPath);
-        return results;
-    }
-
-    GDALRasterBandH hBand = GDALGetRasterBand(dataset.get(), 1);
-    if (!hBand) {
-        errorOut = "Failed to get raster band for contours";
-        return results;
-    }
+// Trace contours of a band into a list of {elevation, points} maps
+QVariantList contoursFromBand(GDALRasterBandH hBand, double interval, QString &errorOut)
+{
+    TRACE_SCOPE("dtm", "DTMGenerator::generateContours");
+    QVariantList results;
 
     // Create memory datasource for contours
     OGRSFDriverH hOgrDriver = OGRGetDriverByName("Memory");
@@ -333,9 +430,13 @@ QVariantList DTMGenerator::generateContours(const QString &dtmPath,
     OGR_Fld_Destroy(hFieldDefn);
 
     // Generate contours
-    CPLErr err = GDALContourGenerate(hBand, interval, 0.0, 0, nullptr,
-                                     FALSE, -9999.0, hLayer, -1, 0,
-                                     nullptr, nullptr);
+    CPLErr err;
+    {
+        TRACE_SCOPE("dtm", "GDALContourGenerate");
+        err = GDALContourGenerate(hBand, interval, 0.0, 0, nullptr,
+                                  FALSE, -9999.0, hLayer, -1, 0,
+                                  nullptr, nullptr);
+    }
 
     if (err != CE_None) {
         errorOut = QString("GDAL contour generation failed (code: %1)").arg(err);
@@ -376,3 +477,49 @@ QVariantList DTMGenerator::generateContours(const QString &dtmPath,
 
     return results;
 }
+
+} // namespace
+
+QVariantList DTMGenerator::generateContours(const QString &dtmPath,
+                                           double interval,
+                                           QString &errorOut)
+{
+    if (interval <= 0) {
+        errorOut = QString("Invalid contour interval: %1 (must be > 0)").arg(interval);
+        return QVariantList();
+    }
+
+    // Open DTM using RAII guard
+    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
+    if (!dataset) {
+        errorOut = QString("Failed to open DTM for contours: %1").arg(dtmPath);
+        return QVariantList();
+    }
+
+    GDALRasterBandH hBand = GDALGetRasterBand(dataset.get(), 1);
+    if (!hBand) {
+        errorOut = "Failed to get raster band for contours";
+        return QVariantList();
+    }
+
+    return contoursFromBand(hBand, interval, errorOut);
+}
+
+QVariantList DTMGenerator::generateContours(const DTMRaster &raster,
+                                           double interval,
+                                           QString &errorOut)
+{
+    if (interval <= 0) {
+        errorOut = QString("Invalid contour interval: %1 (must be > 0)").arg(interval);
+        return QVariantList();
+    }
+
+    DatasetGuard dataset = wrapFloatRaster(raster.values.data(), raster.width, raster.height,
+                                           raster.geoTransform, -9999.0);
+    if (!dataset) {
+        errorOut = "Failed to wrap DTM raster for contours";
+        return QVariantList();
+    }
+
+    return contoursFromBand(GDALGetRasterBand(dataset.get(), 1), interval, errorOut);
+}
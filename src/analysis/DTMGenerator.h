@@ -1,11 +1,27 @@
 #ifndef DTMGENERATOR_H
 #define DTMGENERATOR_H
 
+#include "MemoryBudget.h"
 #include <QObject>
 #include <QString>
 #include <QVariantList>
 #include <QVariantMap>
 #include <functional>
+#include <vector>
+
+/**
+ * @brief A DTM band held as raw floats, for consumers that must not go through QVariant
+ */
+struct DTMRaster {
+    int width = 0;
+    int height = 0;
+    double geoTransform[6] = {0.0, 1.0, 0.0, 0.0, 0.0, -1.0};
+    float minElev = 0.0f;            // over valid cells only
+    float maxElev = 0.0f;
+    std::vector<float> values;       // row-major, nodata = VolumeKernel::kNoData
+    int step = 1;                    // source cells per raster cell along each axis
+    MemoryBudget::Reservation reservation;  // budget held for values
+};
 
 /**
  * @brief Handles Digital Terrain Model generation and operations
@@ -21,6 +37,7 @@ class DTMGenerator : public QObject
 
 public:
     using ProgressCallback = std::function<void(int)>;
+    using CancelCheck = std::function<bool()>;
 
     explicit DTMGenerator(QObject *parent = nullptr);
     ~DTMGenerator();
@@ -32,22 +49,53 @@ public:
      * @param outputPath Path where DTM will be saved
      * @param errorOut Output parameter for error message
      * @param progressCallback Optional callback for progress updates (0-100)
+     * @param isCanceled Optional check, polled between steps and during gridding;
+     *                   returning true stops generation with error "Canceled"
      * @return true on success, false on failure
      */
     bool generate(const QVariantList &points, 
                   double pixelSize,
                   const QString &outputPath,
                   QString &errorOut,
-                  ProgressCallback progressCallback = nullptr);
+                  ProgressCallback progressCallback = nullptr,
+                  CancelCheck isCanceled = nullptr);
 
     /**
      * @brief Get DTM raster data for visualization
      * @param dtmPath Path to DTM file
      * @param errorOut Output parameter for error message
-     * @return Map containing width, height, data, minElev, maxElev, geotransform params
+     * @return Map containing width, height, data, minElev, maxElev, geotransform params,
+     *         and step (> 1 when reduced to fit the memory budget)
      */
     QVariantMap getData(const QString &dtmPath, QString &errorOut);
 
+    /**
+     * @brief Read the DTM band into a raw float raster
+     * @param dtmPath Path to DTM file
+     * @param raster Receives the values, size, geotransform and elevation range
+     * @param errorOut Output parameter for error message
+     * @param overBudget Optional; set when the raster does not fit the memory
+     *                   budget, so the caller can stream from dtmPath instead
+     * @return true on success, false on failure
+     */
+    bool readRaster(const QString &dtmPath, DTMRaster &raster, QString &errorOut,
+                    bool *overBudget = nullptr);
+
+    /**
+     * @brief Read the DTM at the finest resolution that fits the memory budget
+     *
+     * When the full raster, plus extraBytesPerCell for whatever the caller
+     * builds from it, would exceed the budget, every step-th cell along each
+     * axis is read instead and the geotransform scaled to match.
+     * @param dtmPath Path to DTM file
+     * @param raster Receives the values; raster.step is 1 at full resolution
+     * @param extraBytesPerCell Caller's own memory per raster cell (e.g. mesh buffers)
+     * @param errorOut Output parameter for error message
+     * @return true on success, false on failure
+     */
+    bool readRasterWithinBudget(const QString &dtmPath, DTMRaster &raster,
+                                qint64 extraBytesPerCell, QString &errorOut);
+
     /**
      * @brief Generate contour lines from DTM
      * @param dtmPath Path to DTM file
@@ -59,6 +107,20 @@ public:
                                    double interval,
                                    QString &errorOut);
 
+    /**
+     * @brief Generate contour lines from a DTM already in memory
+     *
+     * The raster is traced in place through a MEM dataset, so callers that
+     * hold the values (e.g. a pipeline) do not re-read the file.
+     * @param raster DTM values and geotransform
+     * @param interval Contour interval in elevation units
+     * @param errorOut Output parameter for error message
+     * @return List of contour line maps with elevation and points
+     */
+    QVariantList generateContours(const DTMRaster &raster,
+                                  double interval,
+                                  QString &errorOut);
+
 private:
     bool createVRTFile(const QString &csvPath, const QString &vrtPath, QString &errorOut);
     bool validatePoints(const QVariantList &points, QString &errorOut);
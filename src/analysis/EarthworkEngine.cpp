@@ -3,6 +3,16 @@
 #include "TINProcessor.h"
 #include "VolumeCalculator.h"
 #include "MeshExporter.h"
+#include "TerrainGeometry.h"
+#include "TerrainTiles.h"
+#include "SectionSampler.h"
+#include "MassHaulCalculator.h"
+#include "JobScheduler.h"
+#include "AnalysisPipeline.h"
+#include "MemoryBudget.h"
+#include "GDALHelpers.h"
+#include "VolumeKernel.h"
+#include "utilities/Trace.h"
 #include <gdal_priv.h>
 #include <proj.h>
 #include <geos_c.h>
@@ -11,25 +21,10 @@
 #include <QFileInfo>
 #include <QDebug>
 #include <QUuid>
+#include <QSettings>
+#include <cmath>
 
-// GEOS Message Handlers
-void geosNotice(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    char buf[1024];
-    vsnprintf(buf, sizeof(buf), fmt, ap);
-    va_end(ap);
-    qDebug() << "GEOS Notice:" << buf;
-}
-
-void geosError(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    char buf[1024];
-    vsnprintf(buf, sizeof(buf), fmt, ap);
-    va_end(ap);
-    qCritical() << "GEOS Error:" << buf;
-}
+using namespace GDALHelpers;
 
 EarthworkEngine::EarthworkEngine(QObject *parent) 
     : QObject(parent)
@@ -39,8 +34,23 @@ EarthworkEngine::EarthworkEngine(QObject *parent)
     , m_tinProcessor(new TINProcessor(this))
     , m_volumeCalculator(new VolumeCalculator(this))
     , m_meshExporter(new MeshExporter(this))
+    , m_sectionSampler(new SectionSampler(this))
+    , m_massHaulCalculator(new MassHaulCalculator(this))
+    , m_terrainTiles(new TerrainTiles(this))
+    , m_jobScheduler(new JobScheduler(this))
 {
-    initGEOS(geosNotice, geosError);
+    connect(m_jobScheduler.data(), &JobScheduler::jobStarted, this, &EarthworkEngine::jobStarted);
+    connect(m_jobScheduler.data(), &JobScheduler::jobProgress, this, &EarthworkEngine::jobProgressChanged);
+    connect(m_jobScheduler.data(), &JobScheduler::jobFinished, this, &EarthworkEngine::jobFinished);
+    connect(m_jobScheduler.data(), &JobScheduler::jobCanceled, this, &EarthworkEngine::jobCanceled);
+    connect(m_jobScheduler.data(), &JobScheduler::activeCountChanged, this, [this](int count) {
+        bool wasProcessing = isProcessing();
+        m_activeJobs = count;
+        if (isProcessing() != wasProcessing) {
+            emit processingChanged();
+        }
+    });
+
     GDALAllRegister();
     QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
     QString uuid = QUuid::createUuid().toString(QUuid::Id128);
@@ -53,7 +63,8 @@ EarthworkEngine::EarthworkEngine(QObject *parent)
 
 EarthworkEngine::~EarthworkEngine()
 {
-    finishGEOS();
+    // Running jobs use the components
+    m_jobScheduler->shutdown();
 }
 
 void EarthworkEngine::setError(const QString &error)
@@ -79,18 +90,33 @@ void EarthworkEngine::setProgress(int value)
     }
 }
 
+void EarthworkEngine::releaseDTM()
+{
+    m_massHaulCalculator->invalidate();
+    m_terrainTiles->close();
+    m_terrainChunks.clear();
+}
+
 void EarthworkEngine::generateDTM(const QVariantList &points, double pixelSize)
 {
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return;
+    }
+
     setProcessing(true);
     setProgress(0);
+    releaseDTM();
 
-    QString error;
     bool success = m_dtmGenerator->generate(points, pixelSize, m_dtmPath, error,
         [this](int prog) {
             setProgress(prog);
         });
 
     setProcessing(false);
+    releaseDTM();
 
     if (!success) {
         setError(error);
@@ -100,9 +126,205 @@ void EarthworkEngine::generateDTM(const QVariantList &points, double pixelSize)
     }
 }
 
+int EarthworkEngine::startJob(const QString &operation, const QVariantMap &parameters, int priority)
+{
+    using Context = JobScheduler::Context;
+
+    QString dtmPath = m_dtmPath;
+    DTMGenerator *dtmGenerator = m_dtmGenerator.data();
+    TINProcessor *tinProcessor = m_tinProcessor.data();
+    VolumeCalculator *volumeCalculator = m_volumeCalculator.data();
+    MeshExporter *meshExporter = m_meshExporter.data();
+
+    QString resource;
+    JobScheduler::Job job;
+    JobScheduler::Completion done;
+
+    if (operation == "generateDTM") {
+        QVariantList points = parameters["points"].toList();
+        double pixelSize = parameters.value("pixelSize", 1.0).toDouble();
+        resource = dtmResource();
+        // Stop reading the DTM before it is rewritten; nothing reopens it
+        // while the job holds the key
+        releaseDTM();
+        job = [=](Context &context, QString &errorOut) -> QVariant {
+            return dtmGenerator->generate(points, pixelSize, dtmPath, errorOut,
+                                          [&context](int prog) { context.setProgress(prog); },
+                                          [&context]() { return context.isCanceled(); });
+        };
+        done = [this](const QVariant &, const QString &) {
+            releaseDTM();
+        };
+    } else if (operation == "generateContours") {
+        double interval = parameters.value("interval", 1.0).toDouble();
+        resource = dtmResource();
+        job = [=](Context &, QString &errorOut) -> QVariant {
+            return dtmGenerator->generateContours(dtmPath, interval, errorOut);
+        };
+    } else if (operation == "calculateVolume") {
+        double baseElevation = parameters["baseElevation"].toDouble();
+        QVariantList points = parameters["points"].toList();
+        QString isopachPath = parameters["isopachPath"].toString();
+        resource = dtmResource();
+        job = [=](Context &, QString &errorOut) -> QVariant {
+            return volumeCalculator->calculateGrid(dtmPath, baseElevation, points, errorOut, isopachPath);
+        };
+    } else if (operation == "generateTIN") {
+        QVariantList points = parameters["points"].toList();
+        resource = tinResource();
+        job = [=](Context &, QString &errorOut) -> QVariant {
+            return tinProcessor->generate(points, errorOut);
+        };
+        done = [this](const QVariant &, const QString &) {
+            m_massHaulCalculator->invalidate();
+        };
+    } else if (operation == "calculateVolumeTIN") {
+        double baseElevation = parameters["baseElevation"].toDouble();
+        QVariantList boundary = parameters["boundaryPolygon"].toList();
+        resource = tinResource();
+        job = [=](Context &, QString &errorOut) -> QVariant {
+            return volumeCalculator->calculateTIN(tinProcessor, baseElevation, boundary, errorOut);
+        };
+    } else if (operation == "generate3DMesh" || operation == "exportDTMasOBJ") {
+        double verticalScale = parameters.value("verticalScale", 1.0).toDouble();
+        QString filePath = parameters["filePath"].toString();
+        bool exportOBJ = operation == "exportDTMasOBJ";
+        resource = dtmResource();
+        job = [=](Context &context, QString &errorOut) -> QVariant {
+            DTMRaster raster;
+            if (!dtmGenerator->readRasterWithinBudget(dtmPath, raster, MeshExporter::kGridBytesPerCell, errorOut)) {
+                return QVariant();
+            }
+            context.setProgress(50);
+            if (context.isCanceled()) {
+                return QVariant();
+            }
+            if (exportOBJ) {
+                return meshExporter->exportAsOBJ(raster, filePath, verticalScale, errorOut);
+            }
+            return meshExporter->generate3DMesh(raster, verticalScale, errorOut);
+        };
+    } else {
+        setError(QString("Unknown job operation: %1").arg(operation));
+        return -1;
+    }
+
+    JobScheduler::Completion report = [this, done](const QVariant &result, const QString &error) {
+        if (done) {
+            done(result, error);
+        }
+        if (!error.isEmpty() && error != "Canceled") {
+            setError(error);
+        }
+    };
+
+    return m_jobScheduler->submit(operation, resource, priority, job, report);
+}
+
+int EarthworkEngine::runPipeline(const QVariantMap &spec, int priority)
+{
+    static const QStringList stages = {"dtm", "contours", "volume", "mesh"};
+    bool any = false;
+    for (const QString &stage : stages) {
+        any = any || spec.contains(stage);
+    }
+    if (!any) {
+        setError("Pipeline has no stages");
+        return -1;
+    }
+
+    QString dtmPath = m_dtmPath;
+    DTMGenerator *dtmGenerator = m_dtmGenerator.data();
+    VolumeCalculator *volumeCalculator = m_volumeCalculator.data();
+    MeshExporter *meshExporter = m_meshExporter.data();
+    bool generate = spec.contains("dtm");
+    if (generate) {
+        // Stop reading the DTM before it is rewritten
+        releaseDTM();
+    }
+
+    JobScheduler::Job job = [=](JobScheduler::Context &context, QString &errorOut) -> QVariant {
+        AnalysisPipeline pipeline(dtmGenerator, volumeCalculator, meshExporter);
+        return pipeline.run(spec, dtmPath, context, errorOut);
+    };
+
+    JobScheduler::Completion done = [this, generate](const QVariant &, const QString &error) {
+        if (generate) {
+            releaseDTM();
+        }
+        if (!error.isEmpty() && error != "Canceled") {
+            setError(error);
+        }
+    };
+
+    return m_jobScheduler->submit("pipeline", dtmResource(), priority, job, done);
+}
+
+bool EarthworkEngine::cancelJob(int jobId)
+{
+    return m_jobScheduler->cancel(jobId);
+}
+
+int EarthworkEngine::jobProgress(int jobId) const
+{
+    return m_jobScheduler->progress(jobId);
+}
+
+QVariantList EarthworkEngine::activeJobs() const
+{
+    return m_jobScheduler->jobs();
+}
+
+void EarthworkEngine::setTracingEnabled(bool enabled)
+{
+    Trace::setEnabled(enabled);
+    QSettings settings;
+    settings.setValue("diagnostics/tracing", enabled);
+}
+
+bool EarthworkEngine::tracingEnabled() const
+{
+    return Trace::isEnabled();
+}
+
+QString EarthworkEngine::exportTrace(const QString &filePath)
+{
+    QString path = filePath.isEmpty() ? Trace::defaultFilePath() : filePath;
+    QString error;
+    if (!Trace::writeChromeJson(path, error)) {
+        setError(error);
+        return QString();
+    }
+    return path;
+}
+
+void EarthworkEngine::setMemoryBudget(double megabytes)
+{
+    qint64 bytes = megabytes > 0.0 ? static_cast<qint64>(megabytes * 1024.0 * 1024.0) : 0;
+    MemoryBudget::setLimit(bytes);
+    QSettings settings;
+    settings.setValue("analysis/memoryBudgetMB", megabytes > 0.0 ? megabytes : 0.0);
+}
+
+QVariantMap EarthworkEngine::memoryUsage() const
+{
+    QVariantMap usage;
+    usage["limit"] = MemoryBudget::limit();
+    usage["used"] = MemoryBudget::used();
+    usage["peak"] = MemoryBudget::peak();
+    usage["physical"] = MemoryBudget::physicalMemory();
+    return usage;
+}
+
 QVariantList EarthworkEngine::generateContours(double interval)
 {
     QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantList();
+    }
+
     QVariantList contours = m_dtmGenerator->generateContours(m_dtmPath, interval, error);
     
     if (contours.isEmpty() && !error.isEmpty()) {
@@ -115,6 +337,12 @@ QVariantList EarthworkEngine::generateContours(double interval)
 QVariantMap EarthworkEngine::getDTMData()
 {
     QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
     QVariantMap data = m_dtmGenerator->getData(m_dtmPath, error);
     
     if (data.isEmpty() && !error.isEmpty()) {
@@ -127,14 +355,19 @@ QVariantMap EarthworkEngine::getDTMData()
 QVariantMap EarthworkEngine::generate3DMesh(double verticalScale)
 {
     QString error;
-    QVariantMap dtmData = m_dtmGenerator->getData(m_dtmPath, error);
-    
-    if (dtmData.isEmpty()) {
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    DTMRaster raster;
+    if (!m_dtmGenerator->readRasterWithinBudget(m_dtmPath, raster, MeshExporter::kGridBytesPerCell, error)) {
         setError(error.isEmpty() ? "DTM data not available" : error);
         return QVariantMap();
     }
     
-    QVariantMap mesh = m_meshExporter->generate3DMesh(dtmData, verticalScale, error);
+    QVariantMap mesh = m_meshExporter->generate3DMesh(raster, verticalScale, error);
     
     if (mesh.isEmpty() && !error.isEmpty()) {
         setError(error);
@@ -143,17 +376,261 @@ QVariantMap EarthworkEngine::generate3DMesh(double verticalScale)
     return mesh;
 }
 
+QVariantMap EarthworkEngine::generateTINMesh(double verticalScale)
+{
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap mesh = m_meshExporter->generateTINMesh(m_tinProcessor.data(), verticalScale, error);
+
+    if (mesh.isEmpty() && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return mesh;
+}
+
+QVariantMap EarthworkEngine::loadTerrainMesh(QObject *geometry, double verticalScale)
+{
+    QVariantMap result;
+
+    TerrainGeometry *terrain = qobject_cast<TerrainGeometry *>(geometry);
+    if (!terrain) {
+        setError("loadTerrainMesh needs a TerrainGeometry");
+        return result;
+    }
+
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return result;
+    }
+
+    DTMRaster raster;
+    if (!m_dtmGenerator->readRasterWithinBudget(m_dtmPath, raster, MeshExporter::kGridBytesPerCell, error)) {
+        setError(error.isEmpty() ? "DTM data not available" : error);
+        return result;
+    }
+
+    MeshBuffers mesh;
+    if (!m_meshExporter->buildGridMesh(raster, verticalScale, mesh, error)) {
+        setError(error);
+        return result;
+    }
+
+    terrain->setMesh(mesh);
+
+    result["vertexCount"] = mesh.vertexCount;
+    result["indexCount"] = mesh.indexCount;
+    result["minElev"] = mesh.minElev;
+    result["maxElev"] = mesh.maxElev;
+    result["width"] = raster.width;
+    result["height"] = raster.height;
+    result["boundsMin"] = mesh.boundsMin;
+    result["boundsMax"] = mesh.boundsMax;
+    return result;
+}
+
+QVariantMap EarthworkEngine::loadTINMesh(QObject *geometry, double verticalScale)
+{
+    QVariantMap result;
+
+    TerrainGeometry *terrain = qobject_cast<TerrainGeometry *>(geometry);
+    if (!terrain) {
+        setError("loadTINMesh needs a TerrainGeometry");
+        return result;
+    }
+
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return result;
+    }
+
+    MeshBuffers mesh;
+    if (!m_meshExporter->buildTINMesh(m_tinProcessor.data(), verticalScale, mesh, error)) {
+        setError(error);
+        return result;
+    }
+
+    terrain->setMesh(mesh);
+
+    result["vertexCount"] = mesh.vertexCount;
+    result["indexCount"] = mesh.indexCount;
+    result["minElev"] = mesh.minElev;
+    result["maxElev"] = mesh.maxElev;
+    result["boundsMin"] = mesh.boundsMin;
+    result["boundsMax"] = mesh.boundsMax;
+    return result;
+}
+
+QVariantMap EarthworkEngine::buildTerrainChunks(double verticalScale, const QString &surface)
+{
+    QVariantMap result;
+    bool useTIN = surface.compare("tin", Qt::CaseInsensitive) == 0;
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({useTIN ? tinResource() : dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return result;
+    }
+
+    m_terrainChunks.clear();
+
+    MeshBuffers mesh;
+    if (useTIN) {
+        if (!m_meshExporter->buildTINMesh(m_tinProcessor.data(), verticalScale, mesh, error)) {
+            setError(error);
+            return result;
+        }
+    } else {
+        DTMRaster raster;
+        if (!m_dtmGenerator->readRasterWithinBudget(m_dtmPath, raster, MeshExporter::kGridBytesPerCell, error)) {
+            setError(error.isEmpty() ? "DTM data not available" : error);
+            return result;
+        }
+        if (!m_meshExporter->buildGridMesh(raster, verticalScale, mesh, error)) {
+            setError(error);
+            return result;
+        }
+    }
+
+    if (!m_meshExporter->buildChunks(mesh, m_terrainChunks, error)) {
+        setError(error);
+        return result;
+    }
+
+    QVariantList chunks;
+    for (const MeshChunk &chunk : m_terrainChunks) {
+        QVariantMap info;
+        info["vertexCount"] = chunk.vertexCount;
+        info["triangleCount"] = chunk.indexCount / 3;
+        info["boundsMin"] = chunk.boundsMin;
+        info["boundsMax"] = chunk.boundsMax;
+        chunks.append(info);
+    }
+
+    result["chunkCount"] = static_cast<int>(m_terrainChunks.size());
+    result["chunks"] = chunks;
+    result["vertexCount"] = mesh.vertexCount;
+    result["indexCount"] = mesh.indexCount;
+    result["minElev"] = mesh.minElev;
+    result["maxElev"] = mesh.maxElev;
+    result["boundsMin"] = mesh.boundsMin;
+    result["boundsMax"] = mesh.boundsMax;
+    return result;
+}
+
+bool EarthworkEngine::loadTerrainChunk(QObject *geometry, int index)
+{
+    TerrainGeometry *terrain = qobject_cast<TerrainGeometry *>(geometry);
+    if (!terrain || index < 0 || index >= static_cast<int>(m_terrainChunks.size())) {
+        return false;
+    }
+
+    terrain->setChunk(m_terrainChunks[index]);
+    return true;
+}
+
+QVariantMap EarthworkEngine::openTerrainTiles(double verticalScale)
+{
+    QVariantMap result;
+
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return result;
+    }
+
+    if (!m_terrainTiles->open(m_dtmPath, verticalScale, error)) {
+        setError(error);
+        return result;
+    }
+
+    // Overviews are built off the GUI thread while holding the DTM; coarse
+    // tiles decimate the base band until they are in
+    if (m_terrainTiles->needsOverviews()) {
+        QString dtmPath = m_dtmPath;
+        JobScheduler::Job job = [dtmPath](JobScheduler::Context &context, QString &errorOut) -> QVariant {
+            return TerrainTiles::buildOverviews(dtmPath, errorOut,
+                                                [&context](int prog) { context.setProgress(prog); },
+                                                [&context]() { return context.isCanceled(); });
+        };
+        JobScheduler::Completion done = [this](const QVariant &built, const QString &error) {
+            if (built.toBool()) {
+                m_terrainTiles->reloadOverviews();
+            } else if (!error.isEmpty() && error != "Canceled") {
+                qWarning() << error << "- coarse tiles will decimate the base band";
+            }
+        };
+        m_jobScheduler->submit("terrainOverviews", dtmResource(), -1, job, done);
+    }
+
+    result["levelCount"] = m_terrainTiles->levelCount();
+    result["tileCells"] = TerrainTiles::kTileCells;
+    result["boundsMin"] = m_terrainTiles->boundsMin();
+    result["boundsMax"] = m_terrainTiles->boundsMax();
+    return result;
+}
+
+QVariantList EarthworkEngine::selectTerrainTiles(const QVector3D &cameraPosition,
+                                                 double fieldOfView,
+                                                 double viewportHeight,
+                                                 double maxPixelError)
+{
+    QVariantList tiles;
+    for (const TerrainTiles::TileKey &key : m_terrainTiles->select(cameraPosition, fieldOfView,
+                                                                    viewportHeight, maxPixelError)) {
+        QVariantMap tile;
+        tile["level"] = key.level;
+        tile["x"] = key.x;
+        tile["y"] = key.y;
+        tile["key"] = QString("%1/%2/%3").arg(key.level).arg(key.x).arg(key.y);
+        tiles.append(tile);
+    }
+    return tiles;
+}
+
+bool EarthworkEngine::loadTerrainTile(QObject *geometry, int level, int x, int y)
+{
+    TerrainGeometry *terrain = qobject_cast<TerrainGeometry *>(geometry);
+    if (!terrain || !m_terrainTiles->isOpen()) {
+        return false;
+    }
+
+    m_terrainTiles->requestTile({level, x, y}, terrain, [this, terrain](const MeshBuffers &mesh, const QString &error) {
+        if (!error.isEmpty()) {
+            setError(error);
+            return;
+        }
+        terrain->setMesh(mesh);
+    });
+    return true;
+}
+
 bool EarthworkEngine::exportDTMasOBJ(const QString &filePath, double verticalScale)
 {
     QString error;
-    QVariantMap dtmData = m_dtmGenerator->getData(m_dtmPath, error);
-    
-    if (dtmData.isEmpty()) {
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return false;
+    }
+
+    DTMRaster raster;
+    if (!m_dtmGenerator->readRasterWithinBudget(m_dtmPath, raster, MeshExporter::kGridBytesPerCell, error)) {
         setError(error.isEmpty() ? "DTM data not available" : error);
         return false;
     }
     
-    bool success = m_meshExporter->exportAsOBJ(dtmData, filePath, verticalScale, error);
+    bool success = m_meshExporter->exportAsOBJ(raster, filePath, verticalScale, error);
     
     if (!success) {
         setError(error);
@@ -162,6 +639,48 @@ bool EarthworkEngine::exportDTMasOBJ(const QString &filePath, double verticalSca
     return success;
 }
 
+bool EarthworkEngine::exportDTMMesh(const QString &filePath, const QString &format, double verticalScale)
+{
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return false;
+    }
+
+    DTMRaster raster;
+    if (!m_dtmGenerator->readRasterWithinBudget(m_dtmPath, raster, MeshExporter::kGridBytesPerCell, error)) {
+        setError(error.isEmpty() ? "DTM data not available" : error);
+        return false;
+    }
+
+    MeshBuffers mesh;
+    if (!m_meshExporter->buildGridMesh(raster, verticalScale, mesh, error)
+        || !m_meshExporter->exportMesh(mesh, filePath, format, error)) {
+        setError(error);
+        return false;
+    }
+    return true;
+}
+
+bool EarthworkEngine::exportTINMesh(const QString &filePath, const QString &format, double verticalScale)
+{
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return false;
+    }
+
+    MeshBuffers mesh;
+    if (!m_meshExporter->buildTINMesh(m_tinProcessor.data(), verticalScale, mesh, error)
+        || !m_meshExporter->exportMesh(mesh, filePath, format, error)) {
+        setError(error);
+        return false;
+    }
+    return true;
+}
+
 bool EarthworkEngine::openInQGIS(const QString &filePath)
 {
     if (filePath.isEmpty()) {
@@ -191,86 +710,226 @@ bool EarthworkEngine::openInQGIS(const QString &filePath)
     return true;
 }
 
-QVariantList EarthworkEngine::createBuffer(const QVariantList &points, double distance)
+namespace {
+
+// Buffer one closed ring of QPointF; returns the outer ring of the result
+QVariantList bufferPolygon(GEOSContextHandle_t context, const QVariantList &points, double distance,
+                           QString &errorOut)
 {
     QVariantList result;
     if (points.size() < 3) return result;
 
     // Convert QVariantList to GEOS Coordinates
-    GEOSCoordSequence* seq = GEOSCoordSeq_create(points.size() + 1, 2);
+    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(context, points.size() + 1, 2);
 
     for (int i = 0; i < points.size(); ++i) {
         QPointF p = points[i].toPointF();
-        GEOSCoordSeq_setX(seq, i, p.x());
-        GEOSCoordSeq_setY(seq, i, p.y());
+        GEOSCoordSeq_setX_r(context, seq, i, p.x());
+        GEOSCoordSeq_setY_r(context, seq, i, p.y());
     }
     
     // Close the ring
     QPointF p0 = points[0].toPointF();
-    GEOSCoordSeq_setX(seq, points.size(), p0.x());
-    GEOSCoordSeq_setY(seq, points.size(), p0.y());
+    GEOSCoordSeq_setX_r(context, seq, points.size(), p0.x());
+    GEOSCoordSeq_setY_r(context, seq, points.size(), p0.y());
 
     // Create Polygon
-    GEOSGeometry* ring = GEOSGeom_createLinearRing(seq);
+    GEOSGeometry* ring = GEOSGeom_createLinearRing_r(context, seq);
     if (!ring) {
-        setError("Failed to create GEOS linear ring");
-        GEOSCoordSeq_destroy(seq);
+        errorOut = "Failed to create GEOS linear ring";
+        GEOSCoordSeq_destroy_r(context, seq);
         return result;
     }
 
-    GEOSGeometry* poly = GEOSGeom_createPolygon(ring, nullptr, 0);
+    GeometryGuard poly(context, GEOSGeom_createPolygon_r(context, ring, nullptr, 0));
     if (!poly) {
-        setError("Failed to create GEOS polygon");
+        errorOut = "Failed to create GEOS polygon";
+        GEOSGeom_destroy_r(context, ring);
         return result;
     }
 
     // Create Buffer
-    GEOSGeometry* buffered = GEOSBuffer(poly, distance, 8);
+    GeometryGuard buffered(context, GEOSBuffer_r(context, poly.get(), distance, 8));
 
     if (buffered) {
-        const GEOSGeometry* rawResult = buffered;
-        if (GEOSGeomTypeId(buffered) == GEOS_MULTIPOLYGON) {
-            rawResult = GEOSGetGeometryN(buffered, 0);
+        const GEOSGeometry* rawResult = buffered.get();
+        if (GEOSGeomTypeId_r(context, rawResult) == GEOS_MULTIPOLYGON) {
+            rawResult = GEOSGetGeometryN_r(context, rawResult, 0);
         }
 
-        const GEOSGeometry* shell = GEOSGetExteriorRing(rawResult);
+        const GEOSGeometry* shell = GEOSGetExteriorRing_r(context, rawResult);
         if (shell) {
-            const GEOSCoordSequence* resSeq = GEOSGeom_getCoordSeq(shell);
+            const GEOSCoordSequence* resSeq = GEOSGeom_getCoordSeq_r(context, shell);
             unsigned int size;
-            GEOSCoordSeq_getSize(resSeq, &size);
+            GEOSCoordSeq_getSize_r(context, resSeq, &size);
 
             for (unsigned int i = 0; i < size; ++i) {
                 double x, y;
-                GEOSCoordSeq_getX(resSeq, i, &x);
-                GEOSCoordSeq_getY(resSeq, i, &y);
+                GEOSCoordSeq_getX_r(context, resSeq, i, &x);
+                GEOSCoordSeq_getY_r(context, resSeq, i, &y);
                 result.append(QPointF(x, y));
             }
         }
-        GEOSGeom_destroy(buffered);
     }
 
-    GEOSGeom_destroy(poly);
     return result;
 }
 
-QVariantMap EarthworkEngine::calculateVolume(double baseElevation, const QVariantList &points, const QString &engine)
+} // namespace
+
+QVariantList EarthworkEngine::createBuffer(const QVariantList &points, double distance)
+{
+    QString error;
+    QVariantList result = bufferPolygon(GEOSContext::forThread(), points, distance, error);
+
+    if (result.isEmpty() && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
+QVariantList EarthworkEngine::createBuffers(const QVariantList &polygons, double distance)
+{
+    // Each polygon is buffered on a pool thread with that thread's GEOS context
+    std::vector<QVariantList> buffered(polygons.size());
+    std::vector<QString> errors(polygons.size());
+    VolumeKernel::runBlocks(static_cast<int>(polygons.size()), [&](int i) {
+        buffered[i] = bufferPolygon(GEOSContext::forThread(), polygons[i].toList(), distance, errors[i]);
+    });
+
+    QVariantList result;
+    for (size_t i = 0; i < buffered.size(); ++i) {
+        if (!errors[i].isEmpty()) {
+            setError(QString("Polygon %1: %2").arg(i + 1).arg(errors[i]));
+        }
+        result.append(QVariant(buffered[i]));
+    }
+    return result;
+}
+
+QVariantList EarthworkEngine::convexHull(const QVariantList &points)
+{
+    QVariantList result;
+    if (points.size() < 3) return result;
+
+    GEOSContextHandle_t context = GEOSContext::forThread();
+
+    std::vector<GEOSGeometry*> pointGeoms(points.size());
+    for (int i = 0; i < points.size(); ++i) {
+        QVariantMap m = points[i].toMap();
+        GEOSCoordSequence* s = GEOSCoordSeq_create_r(context, 1, 2);
+        GEOSCoordSeq_setX_r(context, s, 0, m["x"].toDouble());
+        GEOSCoordSeq_setY_r(context, s, 0, m["y"].toDouble());
+        pointGeoms[i] = GEOSGeom_createPoint_r(context, s);
+    }
+
+    GeometryGuard collection(context, GEOSGeom_createCollection_r(context, GEOS_MULTIPOINT, pointGeoms.data(),
+                                                                  static_cast<unsigned int>(pointGeoms.size())));
+
+    if (!collection) {
+        setError("Failed to create point collection for convex hull");
+        return result;
+    }
+
+    GeometryGuard hull(context, GEOSConvexHull_r(context, collection.get()));
+
+    // Collinear input gives a line, which encloses nothing
+    if (hull && GEOSGeomTypeId_r(context, hull.get()) == GEOS_POLYGON) {
+        const GEOSGeometry* shell = GEOSGetExteriorRing_r(context, hull.get());
+        const GEOSCoordSequence* seq = shell ? GEOSGeom_getCoordSeq_r(context, shell) : nullptr;
+        unsigned int size = 0;
+        if (seq) GEOSCoordSeq_getSize_r(context, seq, &size);
+
+        // Drop the closing vertex; boundary rings are implicitly closed
+        for (unsigned int i = 0; i + 1 < size; ++i) {
+            double x, y;
+            GEOSCoordSeq_getX_r(context, seq, i, &x);
+            GEOSCoordSeq_getY_r(context, seq, i, &y);
+            QVariantMap pt;
+            pt["x"] = x;
+            pt["y"] = y;
+            result.append(pt);
+        }
+    }
+
+    return result;
+}
+
+QVariantMap EarthworkEngine::calculateVolume(double baseElevation, const QVariantList &points, const QString &engine,
+                                             const QString &isopachPath)
 {
     Q_UNUSED(engine);
-    
+
     QString error;
-    QVariantMap result = m_volumeCalculator->calculateGrid(m_dtmPath, baseElevation, points, error);
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap result = m_volumeCalculator->calculateGrid(m_dtmPath, baseElevation, points, error, isopachPath);
     
-    if (result["area"].toDouble() == 0.0 && !error.isEmpty()) {
+    if ((result["area"].toDouble() == 0.0 || (!isopachPath.isEmpty() && !result.contains("isopach")))
+        && !error.isEmpty()) {
         setError(error);
     }
     
     return result;
 }
 
+QVariantMap EarthworkEngine::calculateVolumeBetweenSurfaces(const QString &designPath, const QVariantList &points,
+                                                            const QString &isopachPath)
+{
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap result = m_volumeCalculator->calculateSurfaceDifference(m_dtmPath, designPath, points, error,
+                                                                         isopachPath);
+
+    if ((result["area"].toDouble() == 0.0 || (!isopachPath.isEmpty() && !result.contains("isopach")))
+        && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
+QVariantMap EarthworkEngine::calculateVolumeAgainstTIN(const QVariantList &points, const QString &isopachPath)
+{
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({dtmResource(), tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap result = m_volumeCalculator->calculateSurfaceDifference(m_dtmPath, m_tinProcessor.data(),
+                                                                         points, error, isopachPath);
+
+    if ((result["area"].toDouble() == 0.0 || (!isopachPath.isEmpty() && !result.contains("isopach")))
+        && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
 QVariantMap EarthworkEngine::generateTIN(const QVariantList &points)
 {
     QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
     QVariantMap result = m_tinProcessor->generate(points, error);
+    m_massHaulCalculator->invalidate();
     
     if (!result["success"].toBool() && !error.isEmpty()) {
         setError(error);
@@ -282,6 +941,12 @@ QVariantMap EarthworkEngine::generateTIN(const QVariantList &points)
 QVariantMap EarthworkEngine::calculateVolumeTIN(double baseElevation, const QVariantList &boundaryPolygon)
 {
     QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({tinResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
     QVariantMap result = m_volumeCalculator->calculateTIN(m_tinProcessor.data(), 
                                                            baseElevation, 
                                                            boundaryPolygon, 
@@ -293,3 +958,162 @@ QVariantMap EarthworkEngine::calculateVolumeTIN(double baseElevation, const QVar
     
     return result;
 }
+
+QVariantList EarthworkEngine::calculateStageStorage(const QVariantList &elevations,
+                                                   const QVariantList &points,
+                                                   const QString &method)
+{
+    std::vector<double> levels;
+    levels.reserve(elevations.size());
+    for (const QVariant &v : elevations) {
+        bool ok = false;
+        double z = v.toDouble(&ok);
+        if (!ok || !std::isfinite(z)) {
+            setError(QString("Invalid stage-storage elevation: %1").arg(v.toString()));
+            return QVariantList();
+        }
+        levels.push_back(z);
+    }
+
+    bool useTIN = method.compare("tin", Qt::CaseInsensitive) == 0;
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({useTIN ? tinResource() : dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantList();
+    }
+
+    QVariantList result;
+    if (useTIN) {
+        result = m_volumeCalculator->calculateStageStorageTIN(m_tinProcessor.data(), levels, points, error);
+    } else {
+        result = m_volumeCalculator->calculateStageStorageGrid(m_dtmPath, levels, points, error);
+    }
+
+    if (result.isEmpty() && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
+QVariantList EarthworkEngine::calculateStageStorageRange(double startElevation, double step, int count,
+                                                        const QVariantList &points,
+                                                        const QString &method)
+{
+    if (!std::isfinite(startElevation) || !std::isfinite(step)) {
+        setError("Stage-storage range needs a finite start elevation and step");
+        return QVariantList();
+    }
+    if (count <= 0 || step <= 0.0) {
+        setError("Stage-storage range needs a positive step and count");
+        return QVariantList();
+    }
+
+    QVariantList elevations;
+    elevations.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        elevations.append(startElevation + i * step);
+    }
+
+    return calculateStageStorage(elevations, points, method);
+}
+
+QVariantMap EarthworkEngine::findBalanceElevation(const QVariantList &boundary,
+                                                  double tolerance,
+                                                  const QString &method,
+                                                  double cutFactor)
+{
+    bool useTIN = method.compare("tin", Qt::CaseInsensitive) == 0;
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({useTIN ? tinResource() : dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap result;
+    if (useTIN) {
+        result = m_volumeCalculator->findBalanceTIN(m_tinProcessor.data(), boundary, tolerance, cutFactor, error);
+    } else {
+        result = m_volumeCalculator->findBalanceGrid(m_dtmPath, boundary, tolerance, cutFactor, error);
+    }
+
+    if (result["area"].toDouble() == 0.0 && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
+QVariantMap EarthworkEngine::sampleSections(const QVariantList &alignment,
+                                            double interval,
+                                            double offsetWidth,
+                                            double baseElevation,
+                                            double sampleSpacing,
+                                            const QString &method)
+{
+    bool useTIN = method.compare("tin", Qt::CaseInsensitive) == 0;
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({useTIN ? tinResource() : dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QVariantMap result;
+    if (useTIN) {
+        result = m_sectionSampler->sampleTIN(m_tinProcessor.data(), alignment, interval, offsetWidth,
+                                             sampleSpacing, baseElevation, error);
+    } else {
+        result = m_sectionSampler->sampleGrid(m_dtmPath, alignment, interval, offsetWidth,
+                                              sampleSpacing, baseElevation, error);
+    }
+
+    if (result.isEmpty() && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
+
+QVariantMap EarthworkEngine::calculateMassHaul(const QVariantList &alignment,
+                                               double interval,
+                                               double offsetWidth,
+                                               double baseElevation,
+                                               double cutFactor,
+                                               double freeHaulDistance,
+                                               double balanceLine,
+                                               const QString &method)
+{
+    bool useTIN = method.compare("tin", Qt::CaseInsensitive) == 0;
+    QString error;
+    JobScheduler::ResourceLock lock = m_jobScheduler->tryLock({useTIN ? tinResource() : dtmResource()}, error);
+    if (!lock) {
+        setError(error);
+        return QVariantMap();
+    }
+
+    QString sectionKey = QString("%1|%2|%3|%4").arg(useTIN ? "tin" : "grid")
+                             .arg(interval, 0, 'g', 17)
+                             .arg(offsetWidth, 0, 'g', 17)
+                             .arg(baseElevation, 0, 'g', 17);
+
+    auto sample = [&](double fromChainage, QString &errorOut) {
+        if (useTIN) {
+            return m_sectionSampler->sampleTIN(m_tinProcessor.data(), alignment, interval, offsetWidth,
+                                               0.0, baseElevation, errorOut, fromChainage);
+        }
+        return m_sectionSampler->sampleGrid(m_dtmPath, alignment, interval, offsetWidth,
+                                            0.0, baseElevation, errorOut, fromChainage);
+    };
+
+    QVariantMap result = m_massHaulCalculator->calculate(alignment, sectionKey, sample, cutFactor,
+                                                         freeHaulDistance, balanceLine, error);
+
+    if (result.isEmpty() && !error.isEmpty()) {
+        setError(error);
+    }
+
+    return result;
+}
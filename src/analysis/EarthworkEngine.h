@@ -5,12 +5,20 @@
 #include <QVariantList>
 #include <QDebug>
 #include <QScopedPointer>
+#include <QtNumeric>
+#include <QVector3D>
+#include <vector>
 
 // Forward declarations
 class DTMGenerator;
 class TINProcessor;
 class VolumeCalculator;
 class MeshExporter;
+class SectionSampler;
+class MassHaulCalculator;
+class TerrainTiles;
+class JobScheduler;
+struct MeshChunk;
 
 /**
  * @brief Facade for earthwork analysis operations
@@ -34,18 +42,119 @@ public:
     Q_INVOKABLE QVariantList generateContours(double interval);
     Q_INVOKABLE QVariantMap getDTMData();
     Q_INVOKABLE QVariantMap generate3DMesh(double verticalScale = 1.0);
+    // Same buffers as generate3DMesh, built from the current TIN
+    Q_INVOKABLE QVariantMap generateTINMesh(double verticalScale = 1.0);
+    // Fill a TerrainGeometry with the DTM mesh directly; returns counts and bounds
+    Q_INVOKABLE QVariantMap loadTerrainMesh(QObject *geometry, double verticalScale = 1.0);
+    Q_INVOKABLE QVariantMap loadTINMesh(QObject *geometry, double verticalScale = 1.0);
+    // Split the DTM or TIN mesh (surface "dtm" or "tin") into 16-bit, cache-ordered chunks
+    // (returns count and per-chunk bounds), then fill one TerrainGeometry per chunk
+    Q_INVOKABLE QVariantMap buildTerrainChunks(double verticalScale = 1.0, const QString &surface = "dtm");
+    Q_INVOKABLE bool loadTerrainChunk(QObject *geometry, int index);
+
+    // Level-of-detail terrain: open the DTM as a tile quadtree, pick tiles for a camera,
+    // and fill a TerrainGeometry with one tile (built in the background when not cached)
+    Q_INVOKABLE QVariantMap openTerrainTiles(double verticalScale = 1.0);
+    Q_INVOKABLE QVariantList selectTerrainTiles(const QVector3D &cameraPosition,
+                                                double fieldOfView,
+                                                double viewportHeight,
+                                                double maxPixelError = 2.0);
+    Q_INVOKABLE bool loadTerrainTile(QObject *geometry, int level, int x, int y);
     Q_INVOKABLE bool exportDTMasOBJ(const QString &filePath, double verticalScale = 1.5);
+    // Binary mesh export; format is "glb", "ply" or "stl"
+    Q_INVOKABLE bool exportDTMMesh(const QString &filePath, const QString &format = "glb",
+                                   double verticalScale = 1.0);
+    Q_INVOKABLE bool exportTINMesh(const QString &filePath, const QString &format = "glb",
+                                   double verticalScale = 1.0);
     Q_INVOKABLE bool openInQGIS(const QString &filePath);
     Q_INVOKABLE QVariantList createBuffer(const QVariantList &points, double distance);
-    Q_INVOKABLE QVariantMap calculateVolume(double baseElevation, const QVariantList &points, const QString &engine = "gdal");
+    // Buffers each polygon (a list of points) in parallel; returns one ring per polygon
+    Q_INVOKABLE QVariantList createBuffers(const QVariantList &polygons, double distance);
+    Q_INVOKABLE QVariantList convexHull(const QVariantList &points);
+    // points is a boundary polygon (holes allowed) or a list of regions; see VolumeCalculator::calculateGrid.
+    // A non-empty isopachPath also writes the cut/fill depth GeoTIFF and a preview PNG in the same pass.
+    Q_INVOKABLE QVariantMap calculateVolume(double baseElevation, const QVariantList &points, const QString &engine = "gdal",
+                                            const QString &isopachPath = QString());
+
+    // Surface-to-surface methods (existing DTM vs design raster or current TIN)
+    Q_INVOKABLE QVariantMap calculateVolumeBetweenSurfaces(const QString &designPath, const QVariantList &points = QVariantList(),
+                                                           const QString &isopachPath = QString());
+    Q_INVOKABLE QVariantMap calculateVolumeAgainstTIN(const QVariantList &points = QVariantList(),
+                                                      const QString &isopachPath = QString());
     
     // TIN-based methods
     Q_INVOKABLE QVariantMap generateTIN(const QVariantList &points);
     Q_INVOKABLE QVariantMap calculateVolumeTIN(double baseElevation, const QVariantList &boundaryPolygon = QVariantList());
 
+    // Stage-storage methods (cut/fill at many levels; method is "grid" or "tin")
+    Q_INVOKABLE QVariantList calculateStageStorage(const QVariantList &elevations,
+                                                   const QVariantList &points = QVariantList(),
+                                                   const QString &method = "grid");
+    Q_INVOKABLE QVariantList calculateStageStorageRange(double startElevation, double step, int count,
+                                                        const QVariantList &points = QVariantList(),
+                                                        const QString &method = "grid");
+
+    // Base elevation where cut * cutFactor equals fill (method is "grid" or "tin")
+    Q_INVOKABLE QVariantMap findBalanceElevation(const QVariantList &boundary,
+                                                 double tolerance = 0.01,
+                                                 const QString &method = "grid",
+                                                 double cutFactor = 1.0);
+
+    // Cross sections every interval along an alignment, plus a long section (method is "grid" or "tin")
+    Q_INVOKABLE QVariantMap sampleSections(const QVariantList &alignment,
+                                           double interval,
+                                           double offsetWidth,
+                                           double baseElevation,
+                                           double sampleSpacing = 0.0,
+                                           const QString &method = "grid");
+
+    // Mass-haul diagram along an alignment; re-samples only what changed since the last call.
+    // balanceLine NaN picks the line with least total haul (method is "grid" or "tin")
+    Q_INVOKABLE QVariantMap calculateMassHaul(const QVariantList &alignment,
+                                              double interval,
+                                              double offsetWidth,
+                                              double baseElevation,
+                                              double cutFactor = 1.0,
+                                              double freeHaulDistance = 0.0,
+                                              double balanceLine = qQNaN(),
+                                              const QString &method = "grid");
+
+    // Asynchronous jobs. operation is generateDTM, generateContours, calculateVolume, generateTIN,
+    // calculateVolumeTIN, generate3DMesh or exportDTMasOBJ; parameters holds that invokable's
+    // arguments by name (points, pixelSize, interval, baseElevation, isopachPath,
+    // boundaryPolygon, verticalScale, filePath). Jobs on the same DTM, or on the TIN, run one at
+    // a time in priority/FIFO order; others run concurrently. Returns the job ID, or -1.
+    // The synchronous invokables above take the same DTM / TIN keys and fail with an error
+    // while a queued or running job holds them.
+    Q_INVOKABLE int startJob(const QString &operation, const QVariantMap &parameters = QVariantMap(),
+                             int priority = 0);
+
+    // DTM -> contours / volume / mesh as one job. spec keys enable stages: "dtm" {points,
+    // pixelSize} regenerates the DTM, "contours" {interval}, "volume" {baseElevation, points,
+    // isopachPath}, "mesh" {verticalScale, filePath, format}. The DTM is read once and the other
+    // stages run concurrently on it; the job reports one progress value and finishes with a map
+    // of stage results plus "errors" (see AnalysisPipeline). Returns the job ID, or -1.
+    Q_INVOKABLE int runPipeline(const QVariantMap &spec, int priority = 0);
+    Q_INVOKABLE bool cancelJob(int jobId);
+    Q_INVOKABLE int jobProgress(int jobId) const;
+    Q_INVOKABLE QVariantList activeJobs() const;
+
+    // Trace spans (utilities/Trace.h). The toggle is saved as diagnostics/tracing and restored at
+    // startup. exportTrace writes the spans recorded so far as Chrome/Perfetto JSON to filePath,
+    // or to Trace::defaultFilePath() when empty, and returns the path written ("" on failure).
+    Q_INVOKABLE void setTracingEnabled(bool enabled);
+    Q_INVOKABLE bool tracingEnabled() const;
+    Q_INVOKABLE QString exportTrace(const QString &filePath = QString());
+
+    // Memory budget for analysis buffers (MemoryBudget.h). megabytes <= 0 restores the default
+    // share of physical RAM; the value is saved as analysis/memoryBudgetMB and restored at
+    // startup. memoryUsage returns {limit, used, peak, physical} in bytes.
+    Q_INVOKABLE void setMemoryBudget(double megabytes);
+    Q_INVOKABLE QVariantMap memoryUsage() const;
+
     // Property getters
     QString lastError() const { return m_lastError; }
-    bool isProcessing() const { return m_isProcessing; }
+    bool isProcessing() const { return m_isProcessing || m_activeJobs > 0; }
     int progress() const { return m_progress; }
 
 signals:
@@ -53,15 +162,29 @@ signals:
     void errorChanged();
     void processingChanged();
     void progressChanged(int value);
+    void jobStarted(int jobId, const QString &operation);
+    void jobProgressChanged(int jobId, int percent);
+    void jobFinished(int jobId, const QString &operation, const QVariant &result, const QString &error,
+                     qint64 peakMemory);
+    void jobCanceled(int jobId, const QString &operation);
 
 private:
     void setError(const QString &error);
     void setProcessing(bool processing);
     void setProgress(int value);
 
+    // Scheduler keys for the DTM file and the TIN
+    QString dtmResource() const { return "dtm:" + m_dtmPath; }
+    static QString tinResource() { return QStringLiteral("tin"); }
+
+    // Drop tiles, chunks and mass-haul sections read from the DTM; called
+    // before and after every rewrite of it
+    void releaseDTM();
+
     QString m_dtmPath;
     QString m_lastError;
     bool m_isProcessing;
+    int m_activeJobs = 0;
     int m_progress;
 
     // Component instances
@@ -69,6 +192,11 @@ private:
     QScopedPointer<TINProcessor> m_tinProcessor;
     QScopedPointer<VolumeCalculator> m_volumeCalculator;
     QScopedPointer<MeshExporter> m_meshExporter;
+    QScopedPointer<SectionSampler> m_sectionSampler;
+    QScopedPointer<MassHaulCalculator> m_massHaulCalculator;
+    QScopedPointer<TerrainTiles> m_terrainTiles;
+    std::vector<MeshChunk> m_terrainChunks;
+    QScopedPointer<JobScheduler> m_jobScheduler;
 };
 
 #endif // EARTHWORKENGINE_H
@@ -0,0 +1,268 @@
+#include "ElevationHistogram.h"
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+
+void ElevationHistogram::WideSum::add(qint64 value)
+{
+    quint64 previous = low;
+    low += static_cast<quint64>(value);
+    high += (value < 0 ? -1 : 0) + (low < previous ? 1 : 0);
+}
+
+void ElevationHistogram::WideSum::add(const WideSum &other)
+{
+    quint64 previous = low;
+    low += other.low;
+    high += other.high + (low < previous ? 1 : 0);
+}
+
+ElevationHistogram::WideSum ElevationHistogram::WideSum::operator-(const WideSum &other) const
+{
+    WideSum difference;
+    difference.low = low - other.low;
+    difference.high = high - other.high - (low < other.low ? 1 : 0);
+    return difference;
+}
+
+double ElevationHistogram::WideSum::toDouble() const
+{
+    constexpr double kTwo64 = 18446744073709551616.0;
+    if (high < 0) {
+        // Convert the magnitude so small negative sums keep their precision
+        WideSum magnitude = WideSum() - *this;
+        return -(static_cast<double>(magnitude.high) * kTwo64 + static_cast<double>(magnitude.low));
+    }
+    return static_cast<double>(high) * kTwo64 + static_cast<double>(low);
+}
+
+ElevationHistogram::ElevationHistogram(std::vector<double> edges)
+    : m_edges(std::move(edges))
+{
+    std::sort(m_edges.begin(), m_edges.end());
+    m_counts.assign(m_edges.size() + 1, 0);
+    m_sums.assign(m_edges.size() + 1, WideSum());
+    // Sums are kept relative to the first edge to keep them small
+    m_origin = m_edges.empty() ? 0.0 : m_edges.front();
+}
+
+ElevationHistogram ElevationHistogram::uniform(double minElevation, double binWidth, int binCount)
+{
+    std::vector<double> edges(binCount + 1);
+    for (int i = 0; i <= binCount; ++i) {
+        edges[i] = minElevation + i * binWidth;
+    }
+
+    ElevationHistogram histogram(std::move(edges));
+    histogram.m_uniform = true;
+    histogram.m_origin = minElevation;
+    histogram.m_binWidth = binWidth;
+    return histogram;
+}
+
+qint64 ElevationHistogram::totalCells() const
+{
+    qint64 total = 0;
+    for (qint64 count : m_counts) {
+        total += count;
+    }
+    return total;
+}
+
+int ElevationHistogram::binOf(double z) const
+{
+    if (std::isnan(z)) {
+        return 0;
+    }
+    if (m_uniform) {
+        double t = std::floor((z - m_origin) / m_binWidth) + 1.0;
+        return static_cast<int>(std::clamp(t, 0.0, static_cast<double>(m_edges.size())));
+    }
+    return static_cast<int>(std::upper_bound(m_edges.begin(), m_edges.end(), z) - m_edges.begin());
+}
+
+void ElevationHistogram::addTo(std::vector<qint64> &counts, std::vector<WideSum> &sums, double z) const
+{
+    // NaN or infinite heights have no bin and would overflow the fixed-point sum
+    if (!std::isfinite(z)) {
+        return;
+    }
+    int bin = binOf(z);
+    counts[bin] += 1;
+    sums[bin].add(static_cast<qint64>(std::nearbyint((z - m_origin) * kScale)));
+}
+
+void ElevationHistogram::add(double z)
+{
+    addTo(m_counts, m_sums, z);
+}
+
+void ElevationHistogram::merge(const ElevationHistogram &other)
+{
+    for (size_t k = 0; k < m_counts.size() && k < other.m_counts.size(); ++k) {
+        m_counts[k] += other.m_counts[k];
+        m_sums[k].add(other.m_sums[k]);
+    }
+}
+
+void ElevationHistogram::addStrip(const float *data, int width, int rows, int firstRow,
+                                  const VolumeKernel::RasterMask *mask)
+{
+    int blockCount = (rows + VolumeKernel::kBlockRows - 1) / VolumeKernel::kBlockRows;
+    int workers = std::max(1, std::min(blockCount, QThreadPool::globalInstance()->maxThreadCount()));
+
+    // One partial per worker over a contiguous run of blocks; integer sums make
+    // the merged result independent of the split. The partials live until
+    // finish(), so a streamed raster allocates them once, not once per strip.
+    if (static_cast<int>(m_partials.size()) < workers) {
+        m_partials.resize(workers);
+        for (Bins &partial : m_partials) {
+            partial.counts.resize(m_counts.size(), 0);
+            partial.sums.resize(m_sums.size());
+        }
+    }
+
+    VolumeKernel::runBlocks(workers, [&](int worker) {
+        Bins &partial = m_partials[worker];
+        int rowBegin = (blockCount * worker / workers) * VolumeKernel::kBlockRows;
+        int rowEnd = std::min(rows, (blockCount * (worker + 1) / workers) * VolumeKernel::kBlockRows);
+
+        for (int r = rowBegin; r < rowEnd; ++r) {
+            const float *row = data + static_cast<size_t>(r) * width;
+            VolumeKernel::forEachRun(mask, width, firstRow + r, [&](int begin, int end) {
+                for (int col = begin; col < end; ++col) {
+                    if (row[col] != VolumeKernel::kNoData) {
+                        addTo(partial.counts, partial.sums, row[col]);
+                    }
+                }
+            });
+        }
+    });
+}
+
+void ElevationHistogram::finish()
+{
+    for (const Bins &partial : m_partials) {
+        for (size_t k = 0; k < m_counts.size(); ++k) {
+            m_counts[k] += partial.counts[k];
+            m_sums[k].add(partial.sums[k]);
+        }
+    }
+    m_partials.clear();
+    m_partials.shrink_to_fit();
+}
+
+std::vector<ElevationHistogram::Level> ElevationHistogram::levelsAtEdges() const
+{
+    std::vector<Level> levels;
+    levels.reserve(m_edges.size());
+
+    qint64 totalCount = 0;
+    WideSum totalSum;
+    for (size_t k = 0; k < m_counts.size(); ++k) {
+        totalCount += m_counts[k];
+        totalSum.add(m_sums[k]);
+    }
+
+    qint64 belowCount = 0;
+    WideSum belowSum;
+
+    for (size_t j = 0; j < m_edges.size(); ++j) {
+        // Bins 0..j lie below edge j, bins j+1.. at or above it
+        belowCount += m_counts[j];
+        belowSum.add(m_sums[j]);
+
+        double h = m_edges[j] - m_origin;
+        qint64 aboveCount = totalCount - belowCount;
+
+        Level level;
+        level.elevation = m_edges[j];
+        level.cut = (totalSum - belowSum).toDouble() / kScale - h * static_cast<double>(aboveCount);
+        level.fill = h * static_cast<double>(belowCount) - belowSum.toDouble() / kScale;
+        level.cellsAbove = aboveCount;
+        level.cellsBelow = belowCount;
+        levels.push_back(level);
+    }
+
+    return levels;
+}
+
+ElevationHistogram::Level ElevationHistogram::levelAt(double elevation) const
+{
+    Level level{elevation, 0.0, 0.0, 0, 0};
+    if (m_counts.empty()) {
+        return level;
+    }
+
+    int bin = binOf(elevation);
+    double h = elevation - m_origin;
+
+    WideSum aboveSum;
+    WideSum belowSum;
+
+    for (int k = 0; k < static_cast<int>(m_counts.size()); ++k) {
+        qint64 n = m_counts[k];
+        if (n == 0) continue;
+
+        // Cells of the bin containing h are placed at the bin mean
+        bool above = k > bin || (k == bin && m_sums[k].toDouble() / kScale > h * n);
+        if (above) {
+            aboveSum.add(m_sums[k]);
+            level.cellsAbove += n;
+        } else {
+            belowSum.add(m_sums[k]);
+            level.cellsBelow += n;
+        }
+    }
+
+    level.cut = aboveSum.toDouble() / kScale - h * static_cast<double>(level.cellsAbove);
+    level.fill = h * static_cast<double>(level.cellsBelow) - belowSum.toDouble() / kScale;
+    return level;
+}
+
+ElevationHistogram::Level ElevationHistogram::balanceLevel(double cutFactor) const
+{
+    qint64 totalCount = 0;
+    WideSum totalSum;
+    for (size_t k = 0; k < m_counts.size(); ++k) {
+        totalCount += m_counts[k];
+        totalSum.add(m_sums[k]);
+    }
+    if (totalCount == 0) {
+        return Level{m_origin, 0.0, 0.0, 0, 0};
+    }
+
+    // With bins below the split counted as fill and the rest as cut,
+    //   cutFactor * (S_above - h N_above) = h N_below - S_below
+    // is linear in h. The split is valid when h lies between the means of the
+    // non-empty bins on either side of it; g(h) is monotone, so exactly one is.
+    qint64 belowCount = 0;
+    WideSum belowSum;
+    double lowerMean = -INFINITY;
+    double h = 0.0;
+
+    for (size_t split = 0; split <= m_counts.size(); ++split) {
+        if (split < m_counts.size() && m_counts[split] == 0) continue;
+
+        double aboveSum = (totalSum - belowSum).toDouble() / kScale;
+        double aboveCount = static_cast<double>(totalCount - belowCount);
+        h = (cutFactor * aboveSum + belowSum.toDouble() / kScale)
+            / (cutFactor * aboveCount + static_cast<double>(belowCount));
+
+        double upperMean = INFINITY;
+        if (split < m_counts.size()) {
+            upperMean = m_sums[split].toDouble() / kScale / static_cast<double>(m_counts[split]);
+        }
+        if (h >= lowerMean && h <= upperMean) {
+            break;
+        }
+
+        if (split < m_counts.size()) {
+            belowCount += m_counts[split];
+            belowSum.add(m_sums[split]);
+            lowerMean = upperMean;
+        }
+    }
+
+    return levelAt(m_origin + h);
+}
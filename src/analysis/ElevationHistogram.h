@@ -0,0 +1,134 @@
+#ifndef ELEVATIONHISTOGRAM_H
+#define ELEVATIONHISTOGRAM_H
+
+#include "VolumeKernel.h"
+#include <vector>
+
+/**
+ * @brief Histogram of cell elevations with exact per-bin counts and sums
+ *
+ * Bin k holds the cells with edge[k-1] <= z < edge[k]; bin 0 and the last bin
+ * are open-ended. Each bin keeps its cell count and the sum of its elevations.
+ * That is enough to get cut and fill at any edge elevation h exactly, using
+ * one prefix-sum pass over the bins:
+ *   cut(h)  = S_above - h * N_above
+ *   fill(h) = h * N_below - S_below
+ * So volumes at many levels cost one pass over the raster plus O(bins).
+ *
+ * Sums are kept as 128-bit fixed point (2^20 steps per elevation unit, relative
+ * to the first edge, rounded half-to-even). That is at least as fine as
+ * float32 DTM precision, cannot overflow for any raster GDAL can hold, and the
+ * integer sums do not depend on the order cells are added. Workers can
+ * therefore use one partial each and still give reproducible totals.
+ */
+class ElevationHistogram
+{
+public:
+    static constexpr double kScale = 1048576.0;
+
+    /**
+     * @brief Two's-complement 128-bit integer, just enough for the bin sums
+     */
+    struct WideSum {
+        quint64 low = 0;
+        qint64 high = 0;
+
+        void add(qint64 value);
+        void add(const WideSum &other);
+        WideSum operator-(const WideSum &other) const;
+        double toDouble() const;
+    };
+
+    struct Level {
+        double elevation;
+        double cut;         // in elevation units x cells (multiply by cell area)
+        double fill;
+        qint64 cellsAbove;
+        qint64 cellsBelow;
+    };
+
+    ElevationHistogram() = default;
+
+    /**
+     * @param edges Bin edges in ascending order
+     */
+    explicit ElevationHistogram(std::vector<double> edges);
+
+    /**
+     * @brief Histogram with equal-width bins, for fine searches
+     * @param minElevation Lower edge of the first closed bin
+     * @param binWidth Width of each bin
+     * @param binCount Number of closed bins
+     */
+    static ElevationHistogram uniform(double minElevation, double binWidth, int binCount);
+
+    const std::vector<double> &edges() const { return m_edges; }
+    int binCount() const { return static_cast<int>(m_counts.size()); }
+    qint64 totalCells() const;
+
+    int binOf(double z) const;
+    void add(double z);
+    void merge(const ElevationHistogram &other);
+
+    /**
+     * @brief Add all masked valid cells of a DTM strip in parallel
+     *
+     * Each worker counts into its own bins, which are allocated on the first
+     * strip and kept for the following ones; call finish() after the last
+     * strip to fold them in.
+     * @param data Strip values, width * rows
+     * @param width Grid width in cells
+     * @param rows Rows in the strip
+     * @param firstRow Global index of the strip's first row
+     * @param mask Optional boundary mask (nullptr = all cells)
+     */
+    void addStrip(const float *data, int width, int rows, int firstRow,
+                  const VolumeKernel::RasterMask *mask);
+
+    /**
+     * @brief Merge and free the per-worker bins of addStrip()
+     */
+    void finish();
+
+    /**
+     * @brief Cut/fill at every edge, from a single prefix-sum sweep
+     */
+    std::vector<Level> levelsAtEdges() const;
+
+    /**
+     * @brief Cut/fill at any elevation
+     *
+     * Exact at edges. Inside a bin, the bin's cells are treated as sitting at
+     * the bin's mean elevation, so the error is at most one bin width per cell.
+     */
+    Level levelAt(double elevation) const;
+
+    /**
+     * @brief Elevation where cut * cutFactor equals fill, from one prefix-sum sweep
+     *
+     * Uses the same bin-mean model as levelAt. The net volume (and with
+     * cutFactor 1 the elevation itself) is exact; the cut/fill split is
+     * within one bin width per cell of the straddling bin.
+     * @param cutFactor Fill volume produced per unit of cut (shrinkage < 1, bulking > 1)
+     */
+    Level balanceLevel(double cutFactor) const;
+
+private:
+    struct Bins {
+        std::vector<qint64> counts;
+        std::vector<WideSum> sums;
+    };
+
+    void addTo(std::vector<qint64> &counts, std::vector<WideSum> &sums, double z) const;
+
+    std::vector<double> m_edges;
+    std::vector<qint64> m_counts;
+    std::vector<WideSum> m_sums;  // fixed-point sums of (z - m_origin)
+    std::vector<Bins> m_partials; // per addStrip worker, until finish()
+
+    bool m_uniform = false;
+    double m_origin = 0.0;
+    double m_binWidth = 0.0;
+};
+
+#endif // ELEVATIONHISTOGRAM_H
@@ -4,6 +4,9 @@
 #include <gdal_priv.h>
 #include <gdal_utils.h>
 #include <geos_c.h>
+#include <QDebug>
+#include <algorithm>
+#include <string>
 #include <vector>
 #include <cstdlib>
 
@@ -96,32 +99,106 @@ private:
     GDALGridOptions* m_options;
 };
 
+/**
+ * @brief RAII wrapper for GDALWarpAppOptions
+ * Automatically frees options on destruction
+ */
+class WarpOptionsGuard {
+public:
+    explicit WarpOptionsGuard(GDALWarpAppOptions* options = nullptr) : m_options(options) {}
+    
+    ~WarpOptionsGuard() {
+        if (m_options) {
+            GDALWarpAppOptionsFree(m_options);
+        }
+    }
+    
+    WarpOptionsGuard(const WarpOptionsGuard&) = delete;
+    WarpOptionsGuard& operator=(const WarpOptionsGuard&) = delete;
+    
+    GDALWarpAppOptions* get() const { return m_options; }
+    operator bool() const { return m_options != nullptr; }
+    
+private:
+    GDALWarpAppOptions* m_options;
+};
+
+/**
+ * @brief RAII wrapper for a reentrant GEOS context (GEOS_init_r)
+ *
+ * GEOS calls must go through the _r API with a context that only one thread
+ * uses at a time. forThread() hands out one context per thread, created on
+ * first use and finished when the thread exits, so parallel workers can each
+ * build and destroy their own geometries. Geometries may be read from other
+ * threads' contexts as long as nobody modifies them.
+ */
+class GEOSContext {
+public:
+    GEOSContext() : m_handle(GEOS_init_r()) {
+        GEOSContext_setNoticeMessageHandler_r(m_handle, &GEOSContext::notice, nullptr);
+        GEOSContext_setErrorMessageHandler_r(m_handle, &GEOSContext::error, nullptr);
+    }
+    
+    ~GEOSContext() {
+        if (m_handle) {
+            GEOS_finish_r(m_handle);
+        }
+    }
+    
+    GEOSContext(const GEOSContext&) = delete;
+    GEOSContext& operator=(const GEOSContext&) = delete;
+    
+    GEOSContextHandle_t get() const { return m_handle; }
+    
+    /**
+     * @brief The calling thread's context
+     */
+    static GEOSContextHandle_t forThread() {
+        thread_local GEOSContext context;
+        return context.get();
+    }
+    
+private:
+    static void notice(const char* message, void*) {
+        qDebug() << "GEOS Notice:" << message;
+    }
+    
+    static void error(const char* message, void*) {
+        qCritical() << "GEOS Error:" << message;
+    }
+    
+    GEOSContextHandle_t m_handle;
+};
+
 /**
  * @brief RAII wrapper for GEOS geometry handles
- * Automatically destroys geometry on destruction
+ * Automatically destroys geometry on destruction, in the given context
  */
 class GeometryGuard {
 public:
-    explicit GeometryGuard(GEOSGeometry* geom = nullptr) : m_geom(geom) {}
+    explicit GeometryGuard(GEOSContextHandle_t context = nullptr, GEOSGeometry* geom = nullptr)
+        : m_context(context), m_geom(geom) {}
     
     ~GeometryGuard() {
         if (m_geom) {
-            GEOSGeom_destroy(m_geom);
+            GEOSGeom_destroy_r(m_context, m_geom);
         }
     }
     
     GeometryGuard(const GeometryGuard&) = delete;
     GeometryGuard& operator=(const GeometryGuard&) = delete;
     
-    GeometryGuard(GeometryGuard&& other) noexcept : m_geom(other.m_geom) {
+    GeometryGuard(GeometryGuard&& other) noexcept
+        : m_context(other.m_context), m_geom(other.m_geom) {
         other.m_geom = nullptr;
     }
     
     GeometryGuard& operator=(GeometryGuard&& other) noexcept {
         if (this != &other) {
             if (m_geom) {
-                GEOSGeom_destroy(m_geom);
+                GEOSGeom_destroy_r(m_context, m_geom);
             }
+            m_context = other.m_context;
             m_geom = other.m_geom;
             other.m_geom = nullptr;
         }
@@ -129,7 +206,6 @@ public:
     }
     
     GEOSGeometry* get() const { return m_geom; }
-    GEOSGeometry** ptr() { return &m_geom; }
     operator bool() const { return m_geom != nullptr; }
     
     GEOSGeometry* release() {
@@ -139,6 +215,7 @@ public:
     }
     
 private:
+    GEOSContextHandle_t m_context;
     GEOSGeometry* m_geom;
 };
 
@@ -147,12 +224,13 @@ private:
  */
 class PreparedGeometryGuard {
 public:
-    explicit PreparedGeometryGuard(const GEOSPreparedGeometry* geom = nullptr) 
-        : m_geom(geom) {}
+    explicit PreparedGeometryGuard(GEOSContextHandle_t context = nullptr,
+                                   const GEOSPreparedGeometry* geom = nullptr)
+        : m_context(context), m_geom(geom) {}
     
     ~PreparedGeometryGuard() {
         if (m_geom) {
-            GEOSPreparedGeom_destroy(m_geom);
+            GEOSPreparedGeom_destroy_r(m_context, m_geom);
         }
     }
     
@@ -163,6 +241,7 @@ public:
     operator bool() const { return m_geom != nullptr; }
     
 private:
+    GEOSContextHandle_t m_context;
     const GEOSPreparedGeometry* m_geom;
 };
 
@@ -258,6 +337,42 @@ private:
     T* m_ptr;
 };
 
+/**
+ * @brief Wrap a float32 raster buffer as a single-band MEM dataset
+ *
+ * The band points at the buffer, so nothing is copied and the buffer must
+ * outlive the dataset. The dataset is only meant for reading. Each caller
+ * gets its own handle, so several threads can read one buffer through
+ * separate datasets.
+ */
+inline DatasetGuard wrapFloatRaster(const float* data, int width, int height,
+                                    const double geoTransform[6], double noData)
+{
+    GDALDriverH driver = GDALGetDriverByName("MEM");
+    if (!driver) {
+        return DatasetGuard();
+    }
+
+    DatasetGuard dataset(GDALCreate(driver, "", width, height, 0, GDT_Float32, nullptr));
+    if (!dataset) {
+        return dataset;
+    }
+
+    char pointer[64] = {0};
+    CPLPrintPointer(pointer, const_cast<float*>(data), sizeof(pointer) - 1);
+    CStringArrayGuard options;
+    options.add((std::string("DATAPOINTER=") + pointer).c_str());
+    if (GDALAddBand(dataset.get(), GDT_Float32, options.data()) != CE_None) {
+        return DatasetGuard();
+    }
+
+    double transform[6];
+    std::copy(geoTransform, geoTransform + 6, transform);
+    GDALSetGeoTransform(dataset.get(), transform);
+    GDALSetRasterNoDataValue(GDALGetRasterBand(dataset.get(), 1), noData);
+    return dataset;
+}
+
 } // namespace GDALHelpers
 
 #endif // GDALHELPERS_H
@@ -0,0 +1,218 @@
+#include "GridMesh.h"
+#include "VolumeKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace GridMesh {
+
+namespace {
+
+// Row heights with nodata replaced, scaled to mesh units; returns whether
+// the row has any nodata
+bool loadRow(const float *raster, int width, int row, float verticalScale,
+             float noData, float fillElevation, float *heights)
+{
+    const float *in = raster + static_cast<size_t>(row) * width;
+    bool hasNoData = false;
+    for (int col = 0; col < width; ++col) {
+        bool missing = in[col] == noData;
+        hasNoData |= missing;
+        heights[col] = (missing ? fillElevation : in[col]) * verticalScale;
+    }
+    return hasNoData;
+}
+
+// Slope from heights at offsets -1, 0, +1, skipping neighbours that are gaps
+float gapAwareSlope(float before, float centre, float after, bool hasBefore, bool hasAfter,
+                    float spacing)
+{
+    if (hasBefore && hasAfter) {
+        return (after - before) / (2.0f * spacing);
+    }
+    if (hasAfter) {
+        return (after - centre) / spacing;
+    }
+    if (hasBefore) {
+        return (centre - before) / spacing;
+    }
+    return 0.0f;
+}
+
+} // namespace
+
+void elevationColor(float elevation, float minElev, float maxElev, float noData, float rgb[3])
+{
+    float elevRange = maxElev - minElev;
+    if (elevation == noData || elevRange <= 0) {
+        rgb[0] = rgb[1] = rgb[2] = 0.5f;  // Gray for nodata
+        return;
+    }
+
+    float normalized = (elevation - minElev) / elevRange;
+    float &r = rgb[0];
+    float &g = rgb[1];
+    float &b = rgb[2];
+
+    if (normalized < 0.25f) {
+        float t = normalized * 4.0f;
+        r = 0; g = t; b = 1.0f;
+    } else if (normalized < 0.5f) {
+        float t = (normalized - 0.25f) * 4.0f;
+        r = 0; g = 1.0f; b = 1.0f - t;
+    } else if (normalized < 0.75f) {
+        float t = (normalized - 0.5f) * 4.0f;
+        r = t; g = 1.0f; b = 0;
+    } else {
+        float t = (normalized - 0.75f) * 4.0f;
+        r = 1.0f; g = 1.0f - t; b = 0;
+    }
+}
+
+std::int64_t compactVertices(const float *raster, int width, int height, float noData,
+                             std::vector<int> &remap)
+{
+    remap.resize(static_cast<size_t>(width) * height);
+    int blockCount = (height + VolumeKernel::kBlockRows - 1) / VolumeKernel::kBlockRows;
+    std::vector<std::int64_t> blockStart(blockCount + 1, 0);
+
+    VolumeKernel::forEachBlock(height, [&](int block, int rowBegin, int rowEnd) {
+        const float *in = raster + static_cast<size_t>(rowBegin) * width;
+        const float *end = raster + static_cast<size_t>(rowEnd) * width;
+        blockStart[block + 1] = std::count_if(in, end, [noData](float z) { return z != noData; });
+    });
+    for (int block = 0; block < blockCount; ++block) {
+        blockStart[block + 1] += blockStart[block];
+    }
+
+    VolumeKernel::forEachBlock(height, [&](int block, int rowBegin, int rowEnd) {
+        int next = static_cast<int>(blockStart[block]);
+        for (size_t i = static_cast<size_t>(rowBegin) * width; i < static_cast<size_t>(rowEnd) * width; ++i) {
+            remap[i] = raster[i] != noData ? next++ : -1;
+        }
+    });
+
+    return blockStart[blockCount];
+}
+
+void compactQuads(const std::vector<int> &remap, int width, int height,
+                  std::vector<std::int64_t> &quadOffsets)
+{
+    quadOffsets.assign(std::max(height, 1), 0);
+    if (width < 2 || height < 2) {
+        return;
+    }
+
+    // Count each cell row's complete quads in parallel, then prefix-sum them
+    VolumeKernel::forEachBlock(height - 1, [&](int, int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const int *top = remap.data() + static_cast<size_t>(row) * width;
+            const int *bottom = top + width;
+            std::int64_t quads = 0;
+            for (int col = 0; col + 1 < width; ++col) {
+                quads += (top[col] | top[col + 1] | bottom[col] | bottom[col + 1]) >= 0;
+            }
+            quadOffsets[row + 1] = quads;
+        }
+    });
+    for (int row = 1; row < height; ++row) {
+        quadOffsets[row] += quadOffsets[row - 1];
+    }
+}
+
+void centralDifferenceNormals(const float *raster, int width, int height,
+                              float cellX, float cellZ, float verticalScale,
+                              float noData, float fillElevation,
+                              float *out, size_t outStride,
+                              const int *remap)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    VolumeKernel::forEachBlock(height, [&](int, int rowBegin, int rowEnd) {
+        std::vector<float> above(width), centre(width), below(width);
+        std::vector<float> gx(width), gz(width);
+        bool gapAbove = false;
+        bool gapCentre = false;
+        bool gapBelow = false;
+
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            int up = std::max(row - 1, 0);
+            int down = std::min(row + 1, height - 1);
+            if (row == rowBegin) {
+                gapAbove = loadRow(raster, width, up, verticalScale, noData, fillElevation, above.data());
+                gapCentre = loadRow(raster, width, row, verticalScale, noData, fillElevation, centre.data());
+            } else {
+                // Slide the three-row window down by one row
+                std::swap(above, centre);
+                std::swap(centre, below);
+                gapAbove = gapCentre;
+                gapCentre = gapBelow;
+            }
+            gapBelow = loadRow(raster, width, down, verticalScale, noData, fillElevation, below.data());
+
+            // One-sided at the first/last row, where up or down is the row itself
+            float invDz = down > up ? 1.0f / ((down - up) * cellZ) : 0.0f;
+            const float *a = above.data();
+            const float *b = below.data();
+            float *dz = gz.data();
+            for (int col = 0; col < width; ++col) {
+                dz[col] = (b[col] - a[col]) * invDz;
+            }
+
+            const float *c = centre.data();
+            float *dx = gx.data();
+            float invCentral = 1.0f / (2.0f * cellX);
+            for (int col = 1; col + 1 < width; ++col) {
+                dx[col] = (c[col + 1] - c[col - 1]) * invCentral;
+            }
+            if (width > 1) {
+                dx[0] = (c[1] - c[0]) / cellX;
+                dx[width - 1] = (c[width - 1] - c[width - 2]) / cellX;
+            } else {
+                dx[0] = 0.0f;
+            }
+
+            if (!remap) {
+                float *normal = out + static_cast<size_t>(row) * width * outStride;
+                for (int col = 0; col < width; ++col) {
+                    float inv = 1.0f / std::sqrt(dx[col] * dx[col] + dz[col] * dz[col] + 1.0f);
+                    normal[0] = -dx[col] * inv;
+                    normal[1] = inv;
+                    normal[2] = -dz[col] * inv;
+                    normal += outStride;
+                }
+                continue;
+            }
+
+            // Compacted: redo the differences of cells next to a gap, which
+            // only exist in windows that contain nodata
+            const int *rowRemap = remap + static_cast<size_t>(row) * width;
+            const int *upRemap = remap + static_cast<size_t>(up) * width;
+            const int *downRemap = remap + static_cast<size_t>(down) * width;
+            bool gaps = gapAbove || gapCentre || gapBelow;
+            for (int col = 0; col < width; ++col) {
+                if (rowRemap[col] < 0) continue;
+
+                if (gaps) {
+                    bool hasLeft = col > 0 && rowRemap[col - 1] >= 0;
+                    bool hasRight = col + 1 < width && rowRemap[col + 1] >= 0;
+                    dx[col] = gapAwareSlope(hasLeft ? c[col - 1] : 0.0f, c[col],
+                                            hasRight ? c[col + 1] : 0.0f, hasLeft, hasRight, cellX);
+                    bool hasUp = up < row && upRemap[col] >= 0;
+                    bool hasDown = down > row && downRemap[col] >= 0;
+                    dz[col] = gapAwareSlope(a[col], c[col], b[col], hasUp, hasDown, cellZ);
+                }
+
+                float *normal = out + static_cast<size_t>(rowRemap[col]) * outStride;
+                float inv = 1.0f / std::sqrt(dx[col] * dx[col] + dz[col] * dz[col] + 1.0f);
+                normal[0] = -dx[col] * inv;
+                normal[1] = inv;
+                normal[2] = -dz[col] * inv;
+            }
+        }
+    });
+}
+
+} // namespace GridMesh
@@ -0,0 +1,79 @@
+#ifndef GRIDMESH_H
+#define GRIDMESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Kernels for meshes built directly on a regular DTM grid
+ *
+ * Grid meshes use the viewer's axes: x along columns, z along rows and y up,
+ * with y = elevation * verticalScale. Nodata cells are either drawn at a fill
+ * elevation, with the kernels using the same substitution so normals match the
+ * drawn surface, or dropped from a compacted mesh through a vertex remap table.
+ */
+namespace GridMesh {
+
+/**
+ * @brief Blue-green-yellow-red elevation ramp; grey for nodata or a flat range
+ * @param rgb Receives the colour components in [0, 1]
+ */
+void elevationColor(float elevation, float minElev, float maxElev, float noData, float rgb[3]);
+
+/**
+ * @brief Vertex remap table over the valid cells
+ *
+ * Valid cells are numbered in row-major order, so the compacted vertices keep
+ * the grid's ordering. Blocks of rows are counted and numbered in parallel.
+ * @param remap Receives width * height entries: the cell's compacted vertex
+ *              index, or -1 for nodata
+ * @return Number of valid cells
+ */
+std::int64_t compactVertices(const float *raster, int width, int height, float noData,
+                             std::vector<int> &remap);
+
+/**
+ * @brief Position of each cell row's quads among the quads with four valid corners
+ *
+ * Only those quads are emitted for a compacted mesh.
+ * @param remap Table from compactVertices
+ * @param quadOffsets Receives height entries; entry r is the number of complete
+ *                    quads in cell rows before r, so the last entry is the total
+ */
+void compactQuads(const std::vector<int> &remap, int width, int height,
+                  std::vector<std::int64_t> &quadOffsets);
+
+/**
+ * @brief Per-vertex normals from central differences of neighbouring heights
+ *
+ * For y = f(x, z) the unnormalised normal is (-df/dx, 1, -df/dz). Interior
+ * vertices use central differences, edge vertices one-sided ones. Each row
+ * only reads its neighbours and writes itself, so rows are computed in
+ * parallel kernel blocks. The inner loop runs over contiguous row buffers so
+ * the compiler can vectorise it.
+ *
+ * @param raster Row-major elevations, width * height
+ * @param width Grid width in cells
+ * @param height Grid height in cells
+ * @param cellX Cell size along columns (x)
+ * @param cellZ Cell size along rows (z)
+ * @param verticalScale Vertical exaggeration applied to elevations
+ * @param noData Nodata value in raster
+ * @param fillElevation Elevation drawn for nodata cells
+ * @param out First normal component of vertex 0; receives nx, ny, nz per vertex
+ * @param outStride Distance between consecutive vertices in out, in floats
+ * @param remap Optional table from compactVertices. When given, normals are
+ *              written at the compacted vertex index, nodata cells are skipped
+ *              and nodata neighbours are gaps: differences next to them are
+ *              one-sided instead of reaching down to fillElevation.
+ */
+void centralDifferenceNormals(const float *raster, int width, int height,
+                              float cellX, float cellZ, float verticalScale,
+                              float noData, float fillElevation,
+                              float *out, size_t outStride,
+                              const int *remap = nullptr);
+
+} // namespace GridMesh
+
+#endif // GRIDMESH_H
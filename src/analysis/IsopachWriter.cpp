@@ -0,0 +1,208 @@
+#include "IsopachWriter.h"
+#include "GDALHelpers.h"
+#include <QtConcurrent>
+#include <QDebug>
+#include <QFileInfo>
+#include <QImage>
+#include <algorithm>
+#include <cmath>
+
+using namespace GDALHelpers;
+
+IsopachWriter::IsopachWriter(const QString &path, GDALDatasetH source,
+                             const double geoTransform[6], int width, int height)
+    : m_path(path)
+    , m_dataset(nullptr)
+    , m_band(nullptr)
+    , m_width(width)
+    , m_height(height)
+    , m_error(false)
+    , m_slot(0)
+    , m_previewWidth(0)
+    , m_previewHeight(0)
+    , m_minDifference(INFINITY)
+    , m_maxDifference(-INFINITY)
+{
+    std::copy(geoTransform, geoTransform + 6, m_geoTransform);
+
+    // Writes go through one thread: GDAL handles must not be used concurrently
+    m_ioPool.setMaxThreadCount(1);
+
+    GDALDriverH driver = GDALGetDriverByName("GTiff");
+    if (!driver || width <= 0 || height <= 0) {
+        return;
+    }
+
+    CStringArrayGuard options;
+    options.add("COMPRESS=DEFLATE");
+    options.add("PREDICTOR=3");
+    options.add("BIGTIFF=IF_SAFER");
+
+    m_dataset = GDALCreate(driver, path.toUtf8().constData(), width, height, 1, GDT_Float32, options.data());
+    if (!m_dataset) {
+        return;
+    }
+
+    GDALSetGeoTransform(m_dataset, m_geoTransform);
+    if (source) {
+        const char *wkt = GDALGetProjectionRef(source);
+        if (wkt && *wkt) {
+            GDALSetProjection(m_dataset, wkt);
+        }
+    }
+    m_band = GDALGetRasterBand(m_dataset, 1);
+    GDALSetRasterNoDataValue(m_band, VolumeKernel::kNoData);
+
+    double scale = std::min(1.0, static_cast<double>(kPreviewSize) / std::max(width, height));
+    m_previewWidth = std::max(1, static_cast<int>(std::lround(width * scale)));
+    m_previewHeight = std::max(1, static_cast<int>(std::lround(height * scale)));
+    m_preview.assign(static_cast<size_t>(m_previewWidth) * m_previewHeight, VolumeKernel::kNoData);
+}
+
+IsopachWriter::~IsopachWriter()
+{
+    waitForWrite();
+    if (m_dataset) {
+        GDALClose(m_dataset);
+    }
+}
+
+void IsopachWriter::waitForWrite()
+{
+    if (m_pending.isValid()) {
+        if (!m_pending.result()) {
+            m_error = true;
+        }
+        m_pending = QFuture<bool>();
+    }
+}
+
+void IsopachWriter::writeStrip(const float *data, const float *reference, int firstRow, int rows,
+                               double baseElevation, const VolumeKernel::RasterMask *mask)
+{
+    if (!m_dataset || m_error || rows <= 0) {
+        return;
+    }
+
+    // The other slot may still be in flight; this slot's previous write has finished
+    std::vector<float> &buffer = m_buffers[m_slot];
+    buffer.assign(static_cast<size_t>(m_width) * rows, VolumeKernel::kNoData);
+
+    int blockCount = (rows + VolumeKernel::kBlockRows - 1) / VolumeKernel::kBlockRows;
+    std::vector<float> blockMin(blockCount, INFINITY);
+    std::vector<float> blockMax(blockCount, -INFINITY);
+
+    VolumeKernel::forEachBlock(rows, [&](int block, int rowBegin, int rowEnd) {
+        for (int r = rowBegin; r < rowEnd; ++r) {
+            size_t offset = static_cast<size_t>(r) * m_width;
+            const float *row = data + offset;
+            const float *refRow = reference ? reference + offset : nullptr;
+            float *out = buffer.data() + offset;
+
+            VolumeKernel::forEachRun(mask, m_width, firstRow + r, [&](int begin, int end) {
+                for (int col = begin; col < end; ++col) {
+                    if (row[col] == VolumeKernel::kNoData) continue;
+                    double base = baseElevation;
+                    if (refRow) {
+                        if (refRow[col] == VolumeKernel::kNoData) continue;
+                        base = refRow[col];
+                    }
+                    float diff = static_cast<float>(row[col] - base);
+                    out[col] = diff;
+                    blockMin[block] = std::min(blockMin[block], diff);
+                    blockMax[block] = std::max(blockMax[block], diff);
+                }
+            });
+        }
+    });
+
+    for (int block = 0; block < blockCount; ++block) {
+        m_minDifference = std::min(m_minDifference, blockMin[block]);
+        m_maxDifference = std::max(m_maxDifference, blockMax[block]);
+    }
+
+    // Sample preview rows whose source row falls in this strip
+    for (int pr = 0; pr < m_previewHeight; ++pr) {
+        int sourceRow = static_cast<int>((pr + 0.5) * m_height / m_previewHeight);
+        if (sourceRow < firstRow || sourceRow >= firstRow + rows) continue;
+        const float *row = buffer.data() + static_cast<size_t>(sourceRow - firstRow) * m_width;
+        float *previewRow = m_preview.data() + static_cast<size_t>(pr) * m_previewWidth;
+        for (int pc = 0; pc < m_previewWidth; ++pc) {
+            previewRow[pc] = row[static_cast<int>((pc + 0.5) * m_width / m_previewWidth)];
+        }
+    }
+
+    waitForWrite();
+
+    float *rowsData = buffer.data();
+    m_pending = QtConcurrent::run(&m_ioPool, [this, rowsData, firstRow, rows]() {
+        return GDALRasterIO(m_band, GF_Write, 0, firstRow, m_width, rows,
+                            rowsData, m_width, rows, GDT_Float32, 0, 0) == CE_None;
+    });
+    m_slot = 1 - m_slot;
+}
+
+QVariantMap IsopachWriter::finish(const QString &previewPath, QString &errorOut)
+{
+    QVariantMap result;
+
+    if (!m_dataset) {
+        errorOut = QString("Failed to create isopach raster: %1").arg(m_path);
+        return result;
+    }
+
+    waitForWrite();
+    if (m_error) {
+        errorOut = "Failed to write isopach raster data";
+        return result;
+    }
+    GDALFlushCache(m_dataset);
+
+    // Symmetric ramp so equal cut and fill depths get equal colour strength
+    bool hasCells = m_minDifference <= m_maxDifference;
+    double range = hasCells ? std::max(std::abs(m_minDifference), std::abs(m_maxDifference)) : 0.0;
+
+    QImage preview(m_previewWidth, m_previewHeight, QImage::Format_ARGB32);
+    for (int pr = 0; pr < m_previewHeight; ++pr) {
+        QRgb *line = reinterpret_cast<QRgb *>(preview.scanLine(pr));
+        const float *values = m_preview.data() + static_cast<size_t>(pr) * m_previewWidth;
+        for (int pc = 0; pc < m_previewWidth; ++pc) {
+            if (values[pc] == VolumeKernel::kNoData) {
+                line[pc] = qRgba(0, 0, 0, 0);
+                continue;
+            }
+            double t = range > 0.0 ? std::clamp(values[pc] / range, -1.0, 1.0) : 0.0;
+            int fade = static_cast<int>(std::lround(255.0 * (1.0 - std::abs(t))));
+            line[pc] = t >= 0.0 ? qRgba(255, fade, fade, 255)   // cut: white to red
+                                : qRgba(fade, fade, 255, 255);  // fill: white to blue
+        }
+    }
+
+    if (!preview.save(previewPath, "PNG")) {
+        errorOut = QString("Failed to write isopach preview: %1").arg(previewPath);
+        return result;
+    }
+
+    QVariantMap extent;
+    extent["minX"] = std::min(m_geoTransform[0], m_geoTransform[0] + m_width * m_geoTransform[1]);
+    extent["maxX"] = std::max(m_geoTransform[0], m_geoTransform[0] + m_width * m_geoTransform[1]);
+    extent["minY"] = std::min(m_geoTransform[3], m_geoTransform[3] + m_height * m_geoTransform[5]);
+    extent["maxY"] = std::max(m_geoTransform[3], m_geoTransform[3] + m_height * m_geoTransform[5]);
+
+    result["isopachPath"] = m_path;
+    result["previewPath"] = previewPath;
+    result["previewExtent"] = extent;
+    result["minDifference"] = hasCells ? m_minDifference : 0.0;
+    result["maxDifference"] = hasCells ? m_maxDifference : 0.0;
+
+    qDebug() << "Isopach written:" << m_path << "range" << result["minDifference"].toDouble()
+             << "to" << result["maxDifference"].toDouble();
+
+    return result;
+}
+
+QString IsopachWriter::previewPathFor(const QString &isopachPath)
+{
+    QFileInfo info(isopachPath);
+    return info.path() + "/" + info.completeBaseName() + "_preview.png";
+}
@@ -0,0 +1,92 @@
+#ifndef ISOPACHWRITER_H
+#define ISOPACHWRITER_H
+
+#include "VolumeKernel.h"
+#include <gdal.h>
+#include <QFuture>
+#include <QString>
+#include <QThreadPool>
+#include <QVariantMap>
+#include <vector>
+
+/**
+ * @brief Writes the per-cell cut/fill depth of a volume pass as a GeoTIFF isopach
+ *
+ * The volume pass hands over each DTM strip after summing it. The writer works
+ * out elev - base (or elev - reference) for the masked cells, then writes the
+ * strip on a background thread while the next strip is summed. No extra read
+ * of the DTM is needed. A nearest-neighbour preview of at most kPreviewSize
+ * cells per side is collected along the way and colour-ramped into a PNG in
+ * finish(): fill blue, cut red, white at zero.
+ */
+class IsopachWriter
+{
+public:
+    static constexpr int kPreviewSize = 1024;
+
+    /**
+     * @param path Output GeoTIFF path
+     * @param source Dataset to copy the spatial reference from (may be nullptr)
+     * @param geoTransform Geotransform of the volume grid
+     * @param width Grid width in cells
+     * @param height Grid height in cells
+     */
+    IsopachWriter(const QString &path, GDALDatasetH source,
+                  const double geoTransform[6], int width, int height);
+    ~IsopachWriter();
+
+    IsopachWriter(const IsopachWriter&) = delete;
+    IsopachWriter& operator=(const IsopachWriter&) = delete;
+
+    bool isOpen() const { return m_dataset != nullptr; }
+
+    /**
+     * @brief Compute and queue the difference rows of one strip
+     * @param data DTM strip values
+     * @param reference Matching reference rows, or nullptr for a flat base
+     * @param firstRow Global index of the strip's first row
+     * @param rows Rows in the strip
+     * @param baseElevation Base used when reference is nullptr
+     * @param mask Optional boundary mask; cells outside get nodata
+     */
+    void writeStrip(const float *data, const float *reference, int firstRow, int rows,
+                    double baseElevation, const VolumeKernel::RasterMask *mask);
+
+    /**
+     * @brief Flush the GeoTIFF and render the preview PNG
+     * @param previewPath Output PNG path for the colour-ramped preview
+     * @param errorOut Output parameter for error message
+     * @return Map with isopachPath, previewPath, previewExtent, minDifference,
+     *         maxDifference, or an empty map on failure
+     */
+    QVariantMap finish(const QString &previewPath, QString &errorOut);
+
+    /**
+     * @brief Preview PNG path next to an isopach GeoTIFF (name_preview.png)
+     */
+    static QString previewPathFor(const QString &isopachPath);
+
+private:
+    void waitForWrite();
+
+    QString m_path;
+    GDALDatasetH m_dataset;
+    GDALRasterBandH m_band;
+    double m_geoTransform[6];
+    int m_width;
+    int m_height;
+    bool m_error;
+
+    std::vector<float> m_buffers[2];
+    int m_slot;
+    QFuture<bool> m_pending;
+    QThreadPool m_ioPool;
+
+    int m_previewWidth;
+    int m_previewHeight;
+    std::vector<float> m_preview;
+    float m_minDifference;
+    float m_maxDifference;
+};
+
+#endif // ISOPACHWRITER_H
@@ -0,0 +1,284 @@
+#include "JobScheduler.h"
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+
+void JobScheduler::Context::setProgress(int percent)
+{
+    percent = std::clamp(percent, 0, 100);
+    if (m_state->progress.exchange(percent) == percent) {
+        return;
+    }
+
+    // Signals go out on the scheduler's thread; the scheduler outlives its jobs
+    JobScheduler *scheduler = m_scheduler;
+    int jobId = m_jobId;
+    QMetaObject::invokeMethod(scheduler, [scheduler, jobId, percent]() {
+        if (scheduler->m_jobs.contains(jobId)) {
+            emit scheduler->jobProgress(jobId, percent);
+        }
+    }, Qt::QueuedConnection);
+}
+
+JobScheduler::JobScheduler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+    shutdown();
+}
+
+int JobScheduler::submit(const QString &name, const QString &resource, int priority,
+                         Job job, Completion done)
+{
+    Entry entry;
+    entry.id = m_nextId++;
+    entry.name = name;
+    entry.resource = resource;
+    entry.priority = priority;
+    entry.job = std::move(job);
+    entry.done = std::move(done);
+    entry.state = std::make_shared<State>();
+
+    // Insert after every queued job of the same or higher priority
+    auto position = std::find_if(m_queue.begin(), m_queue.end(), [&](int id) {
+        return m_jobs.value(id).priority < priority;
+    });
+    m_queue.insert(position, entry.id);
+    m_jobs.insert(entry.id, entry);
+
+    qDebug() << "Job" << entry.id << name << "queued"
+             << (resource.isEmpty() ? QString() : "on " + resource);
+    emit activeCountChanged(m_jobs.size());
+
+    dispatch();
+    return entry.id;
+}
+
+bool JobScheduler::cancel(int jobId)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return false;
+    }
+
+    it->state->canceled = true;
+    if (it->running) {
+        // Reported when the job returns
+        return true;
+    }
+
+    QString name = it->name;
+    m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), jobId), m_queue.end());
+    m_jobs.erase(it);
+
+    emit jobCanceled(jobId, name);
+    emit activeCountChanged(m_jobs.size());
+    return true;
+}
+
+void JobScheduler::cancelAll()
+{
+    const QList<int> ids = m_jobs.keys();
+    for (int id : ids) {
+        cancel(id);
+    }
+}
+
+JobScheduler::ResourceLock JobScheduler::tryLock(const QStringList &resources, QString &errorOut)
+{
+    ResourceLock lock;
+    for (const QString &resource : resources) {
+        if (m_locked.contains(resource)) {
+            continue;
+        }
+        for (auto it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it) {
+            if (it->resource == resource) {
+                errorOut = QString("%1 is in use by job %2 (%3, %4); wait for it or cancel it")
+                               .arg(resource).arg(it.key()).arg(it->name)
+                               .arg(it->running ? "running" : "queued");
+                return lock;
+            }
+        }
+    }
+
+    for (const QString &resource : resources) {
+        if (m_locked[resource]++ == 0) {
+            m_busyResources.insert(resource);
+        }
+    }
+    lock.m_scheduler = this;
+    lock.m_resources = resources;
+    return lock;
+}
+
+void JobScheduler::unlock(const QStringList &resources)
+{
+    for (const QString &resource : resources) {
+        if (--m_locked[resource] == 0) {
+            m_locked.remove(resource);
+            m_busyResources.remove(resource);
+        }
+    }
+    dispatch();
+}
+
+JobScheduler::ResourceLock::ResourceLock(ResourceLock &&other) noexcept
+    : m_scheduler(other.m_scheduler)
+    , m_resources(std::move(other.m_resources))
+{
+    other.m_scheduler = nullptr;
+}
+
+JobScheduler::ResourceLock &JobScheduler::ResourceLock::operator=(ResourceLock &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_scheduler = other.m_scheduler;
+        m_resources = std::move(other.m_resources);
+        other.m_scheduler = nullptr;
+    }
+    return *this;
+}
+
+void JobScheduler::ResourceLock::release()
+{
+    if (m_scheduler) {
+        JobScheduler *scheduler = m_scheduler;
+        m_scheduler = nullptr;
+        scheduler->unlock(m_resources);
+    }
+}
+
+int JobScheduler::progress(int jobId) const
+{
+    auto it = m_jobs.constFind(jobId);
+    return it == m_jobs.constEnd() ? -1 : it->state->progress.load();
+}
+
+QVariantList JobScheduler::jobs() const
+{
+    QVariantList list;
+    for (auto it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it) {
+        QVariantMap job;
+        job["id"] = it->id;
+        job["name"] = it->name;
+        job["resource"] = it->resource;
+        job["priority"] = it->priority;
+        job["state"] = it->running ? "running" : "queued";
+        job["progress"] = it->state->progress.load();
+        job["canceled"] = it->state->canceled.load();
+        job["memory"] = it->state->memory->current();
+        job["peakMemory"] = it->state->memory->peak();
+        list.append(job);
+    }
+    return list;
+}
+
+void JobScheduler::shutdown()
+{
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+void JobScheduler::dispatch()
+{
+    int slots = std::max(1, m_pool.maxThreadCount()) - m_running;
+
+    // Walk the queue in order; a job whose resource is busy waits, but does
+    // not hold back independent jobs behind it. Jobs are picked first and
+    // started afterwards, since signal handlers may submit or cancel.
+    std::vector<int> ready;
+    QSet<QString> claimed = m_busyResources;
+    for (auto it = m_queue.begin(); it != m_queue.end() && static_cast<int>(ready.size()) < slots;) {
+        const QString &resource = m_jobs[*it].resource;
+        if (!resource.isEmpty() && claimed.contains(resource)) {
+            ++it;
+            continue;
+        }
+        if (!resource.isEmpty()) {
+            claimed.insert(resource);
+        }
+        ready.push_back(*it);
+        it = m_queue.erase(it);
+    }
+
+    for (int jobId : ready) {
+        start(jobId);
+    }
+}
+
+void JobScheduler::start(int jobId)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    it->running = true;
+    ++m_running;
+    if (!it->resource.isEmpty()) {
+        m_busyResources.insert(it->resource);
+    }
+
+    Context context;
+    context.m_scheduler = this;
+    context.m_state = it->state;
+    context.m_jobId = jobId;
+
+    Job job = it->job;
+    QString name = it->name;
+
+    (void)QtConcurrent::run(&m_pool, [this, jobId, job, context]() mutable {
+        QString error;
+        QVariant result;
+        if (!context.isCanceled()) {
+            MemoryBudget::UsageScope usage(context.m_state->memory);
+            result = job(context, error);
+        }
+        QMetaObject::invokeMethod(this, [this, jobId, result, error]() {
+            finish(jobId, result, error);
+        }, Qt::QueuedConnection);
+    });
+
+    qDebug() << "Job" << jobId << name << "started";
+    emit jobStarted(jobId, name);
+}
+
+void JobScheduler::finish(int jobId, const QVariant &result, const QString &error)
+{
+    auto it = m_jobs.find(jobId);
+    if (it == m_jobs.end()) {
+        return;
+    }
+
+    Entry entry = *it;
+    m_jobs.erase(it);
+    --m_running;
+    if (!entry.resource.isEmpty()) {
+        m_busyResources.remove(entry.resource);
+    }
+
+    if (entry.state->canceled) {
+        qDebug() << "Job" << jobId << entry.name << "canceled";
+        if (entry.done) {
+            entry.done(QVariant(), QStringLiteral("Canceled"));
+        }
+        emit jobCanceled(jobId, entry.name);
+    } else {
+        qint64 peakMemory = entry.state->memory->peak();
+        if (!error.isEmpty()) {
+            qWarning() << "Job" << jobId << entry.name << "failed:" << error;
+        }
+        qDebug() << "Job" << jobId << entry.name << "peak memory" << MemoryBudget::formatBytes(peakMemory);
+        if (entry.done) {
+            entry.done(result, error);
+        }
+        emit jobFinished(jobId, entry.name, result, error, peakMemory);
+    }
+    emit activeCountChanged(m_jobs.size());
+
+    dispatch();
+}
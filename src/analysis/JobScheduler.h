@@ -0,0 +1,194 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include "MemoryBudget.h"
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariant>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Runs heavy analysis jobs on a thread pool
+ *
+ * Provides functionality for:
+ * - Job IDs with per-job progress and cancellation tokens
+ * - A priority queue, FIFO within one priority
+ * - Resource keys: jobs with the same key (e.g. the same DTM) run one at a
+ *   time in queue order, while jobs with different or empty keys run
+ *   concurrently up to the pool size
+ * - Result signals and completion callbacks delivered on the scheduler's thread
+ * - Per-job MemoryBudget usage: reservations made on the job's thread are
+ *   charged to the job, and its peak is reported when it finishes
+ * - Resource locks for synchronous work on the scheduler's thread, so it
+ *   cannot overlap jobs on the same keys (tryLock)
+ *
+ * Submitting, cancelling and all signals happen on the thread the scheduler
+ * lives on; only the job functions run on the pool.
+ */
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+    struct State {
+        std::atomic<bool> canceled{false};
+        std::atomic<int> progress{0};
+        std::shared_ptr<MemoryBudget::Usage> memory = std::make_shared<MemoryBudget::Usage>();
+    };
+
+public:
+    enum Priority {
+        LowPriority = -1,
+        NormalPriority = 0,
+        HighPriority = 1
+    };
+
+    /**
+     * @brief Handle passed to a running job
+     */
+    class Context
+    {
+    public:
+        int jobId() const { return m_jobId; }
+
+        /**
+         * @brief Whether cancel() was called; jobs should check between steps
+         */
+        bool isCanceled() const { return m_state->canceled.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Report progress (0-100) from the job's thread
+         */
+        void setProgress(int percent);
+
+        /**
+         * @brief Most budgeted memory the job has held at once so far, in bytes
+         */
+        qint64 peakMemory() const { return m_state->memory->peak(); }
+
+    private:
+        friend class JobScheduler;
+        JobScheduler *m_scheduler = nullptr;
+        std::shared_ptr<State> m_state;
+        int m_jobId = 0;
+    };
+
+    /**
+     * @brief Resource keys held by tryLock() until destroyed or released
+     */
+    class ResourceLock
+    {
+    public:
+        ResourceLock() = default;
+        ~ResourceLock() { release(); }
+
+        ResourceLock(ResourceLock &&other) noexcept;
+        ResourceLock &operator=(ResourceLock &&other) noexcept;
+        ResourceLock(const ResourceLock &) = delete;
+        ResourceLock &operator=(const ResourceLock &) = delete;
+
+        explicit operator bool() const { return m_scheduler != nullptr; }
+        void release();
+
+    private:
+        friend class JobScheduler;
+        JobScheduler *m_scheduler = nullptr;
+        QStringList m_resources;
+    };
+
+    using Job = std::function<QVariant(Context &context, QString &errorOut)>;
+    using Completion = std::function<void(const QVariant &result, const QString &error)>;
+
+    explicit JobScheduler(QObject *parent = nullptr);
+    ~JobScheduler();
+
+    /**
+     * @brief Queue a job
+     * @param name Operation name reported with the job
+     * @param resource Serialisation key; empty for jobs that can run with anything
+     * @param priority Higher runs first; equal priorities run in submission order
+     * @param job Work to run on the pool
+     * @param done Optional callback on the scheduler's thread when the job
+     *             returns; a job cancelled while running gets error "Canceled".
+     *             Not called for jobs cancelled while still queued.
+     * @return Job ID
+     */
+    int submit(const QString &name, const QString &resource, int priority,
+               Job job, Completion done = nullptr);
+
+    /**
+     * @brief Cancel a queued or running job
+     *
+     * Queued jobs are dropped at once. Running jobs see isCanceled() and are
+     * reported as cancelled when they return, whatever their result.
+     * @return false if the job is unknown or already finished
+     */
+    bool cancel(int jobId);
+    void cancelAll();
+
+    /**
+     * @brief Hold resource keys for synchronous work on the scheduler's thread
+     *
+     * Jobs on those keys do not start while the lock is held. Locks on the
+     * same keys may nest.
+     * @return An empty lock with errorOut set if a queued or running job
+     *         holds one of the keys
+     */
+    ResourceLock tryLock(const QStringList &resources, QString &errorOut);
+
+    bool isActive(int jobId) const { return m_jobs.contains(jobId); }
+    int progress(int jobId) const;
+    int activeCount() const { return m_jobs.size(); }
+
+    /**
+     * @brief Queued and running jobs: id, name, state ("queued"/"running"), progress,
+     *        memory and peakMemory (budgeted bytes)
+     */
+    QVariantList jobs() const;
+
+    /**
+     * @brief Cancel everything and wait for running jobs to return
+     */
+    void shutdown();
+
+signals:
+    void jobStarted(int jobId, const QString &name);
+    void jobProgress(int jobId, int percent);
+    void jobFinished(int jobId, const QString &name, const QVariant &result, const QString &error,
+                     qint64 peakMemory);
+    void jobCanceled(int jobId, const QString &name);
+    void activeCountChanged(int count);
+
+private:
+    struct Entry {
+        int id;
+        QString name;
+        QString resource;
+        int priority;
+        Job job;
+        Completion done;
+        std::shared_ptr<State> state;
+        bool running = false;
+    };
+
+    void dispatch();
+    void start(int jobId);
+    void finish(int jobId, const QVariant &result, const QString &error);
+    void unlock(const QStringList &resources);
+
+    QHash<int, Entry> m_jobs;          // queued and running
+    std::vector<int> m_queue;          // queued IDs, highest priority first, FIFO within one
+    QSet<QString> m_busyResources;
+    QHash<QString, int> m_locked;      // keys held by ResourceLocks, with nesting depth
+    int m_running = 0;
+    int m_nextId = 1;
+    QThreadPool m_pool;
+};
+
+#endif // JOBSCHEDULER_H
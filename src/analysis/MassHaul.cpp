@@ -0,0 +1,241 @@
+#include "MassHaul.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MassHaul {
+
+namespace {
+
+struct Point {
+    double x;
+    double v;  // ordinate minus balance line
+};
+
+// Mass curve relative to a balance line, with a vertex inserted wherever it crosses
+std::vector<Point> relativeCurve(const std::vector<double> &chainages,
+                                 const std::vector<double> &ordinates,
+                                 double balanceLine)
+{
+    std::vector<Point> curve;
+    curve.reserve(chainages.size() + chainages.size() / 4);
+    for (size_t i = 0; i < chainages.size(); ++i) {
+        double v = ordinates[i] - balanceLine;
+        if (i > 0) {
+            double prev = curve.back().v;
+            if ((prev < 0.0 && v > 0.0) || (prev > 0.0 && v < 0.0)) {
+                double t = prev / (prev - v);
+                curve.push_back({chainages[i - 1] + t * (chainages[i] - chainages[i - 1]), 0.0});
+            }
+        }
+        curve.push_back({chainages[i], v});
+    }
+    return curve;
+}
+
+// Length of a linear segment (values a0, a1 over length d) at or above level
+double lengthAbove(double a0, double a1, double d, double level)
+{
+    double lo = std::min(a0, a1);
+    double hi = std::max(a0, a1);
+    if (lo >= level) return d;
+    if (hi <= level) return 0.0;
+    return d * (hi - level) / (hi - lo);
+}
+
+// Integral of min(value, level) over a linear segment
+double integralBelow(double a0, double a1, double d, double level)
+{
+    double lo = std::min(a0, a1);
+    double hi = std::max(a0, a1);
+    if (hi <= level) return 0.5 * (a0 + a1) * d;
+    if (lo >= level) return level * d;
+    double t = (level - lo) / (hi - lo);
+    return 0.5 * (lo + level) * t * d + level * (1.0 - t) * d;
+}
+
+Loop analyseLoop(const std::vector<Point> &curve, size_t begin, size_t end, double freeHaulDistance)
+{
+    Loop loop{};
+    loop.startChainage = curve[begin].x;
+    loop.endChainage = curve[end].x;
+    loop.closed = curve[begin].v == 0.0 && curve[end].v == 0.0;
+
+    double sign = 0.0;
+    for (size_t k = begin; k <= end && sign == 0.0; ++k) {
+        sign = curve[k].v > 0.0 ? 1.0 : (curve[k].v < 0.0 ? -1.0 : 0.0);
+    }
+    loop.forward = sign > 0.0;
+
+    for (size_t k = begin; k <= end; ++k) {
+        loop.volume = std::max(loop.volume, sign * curve[k].v);
+    }
+    for (size_t k = begin; k < end; ++k) {
+        loop.haul += 0.5 * sign * (curve[k].v + curve[k + 1].v) * (curve[k + 1].x - curve[k].x);
+    }
+
+    double length = loop.endChainage - loop.startChainage;
+    if (freeHaulDistance >= length) {
+        loop.freeHaulVolume = loop.volume;
+        return loop;
+    }
+    if (freeHaulDistance <= 0.0) {
+        loop.overhaulVolume = loop.volume;
+        loop.overhaul = loop.haul;
+        return loop;
+    }
+
+    // Length above a level shrinks from the loop length to 0 as the level rises
+    double low = 0.0;
+    double high = loop.volume;
+    for (int iteration = 0; iteration < 64 && high - low > 1e-9 * std::max(1.0, loop.volume); ++iteration) {
+        double level = 0.5 * (low + high);
+        double above = 0.0;
+        for (size_t k = begin; k < end; ++k) {
+            above += lengthAbove(sign * curve[k].v, sign * curve[k + 1].v, curve[k + 1].x - curve[k].x, level);
+        }
+        if (above > freeHaulDistance) {
+            low = level;
+        } else {
+            high = level;
+        }
+    }
+
+    double level = 0.5 * (low + high);
+    double below = 0.0;
+    for (size_t k = begin; k < end; ++k) {
+        below += integralBelow(sign * curve[k].v, sign * curve[k + 1].v, curve[k + 1].x - curve[k].x, level);
+    }
+
+    loop.freeHaulVolume = loop.volume - level;
+    loop.overhaulVolume = level;
+    loop.overhaul = std::max(0.0, below - level * freeHaulDistance);
+    return loop;
+}
+
+} // namespace
+
+void Profile::setCutFactor(double cutFactor)
+{
+    if (cutFactor == m_cutFactor) {
+        return;
+    }
+    m_cutFactor = cutFactor;
+    updateOrdinates(0);
+}
+
+void Profile::clear()
+{
+    m_chainages.clear();
+    m_cutAreas.clear();
+    m_fillAreas.clear();
+    m_cutVolumes.clear();
+    m_fillVolumes.clear();
+    m_ordinates.clear();
+}
+
+void Profile::replaceFrom(int firstStation, const double *chainages,
+                          const double *cutAreas, const double *fillAreas, int count)
+{
+    size_t first = static_cast<size_t>(std::clamp(firstStation, 0, stationCount()));
+
+    m_chainages.resize(first);
+    m_cutAreas.resize(first);
+    m_fillAreas.resize(first);
+    m_chainages.insert(m_chainages.end(), chainages, chainages + count);
+    m_cutAreas.insert(m_cutAreas.end(), cutAreas, cutAreas + count);
+    m_fillAreas.insert(m_fillAreas.end(), fillAreas, fillAreas + count);
+
+    updateOrdinates(static_cast<int>(first));
+}
+
+void Profile::updateOrdinates(int firstStation)
+{
+    size_t n = m_chainages.size();
+    size_t first = static_cast<size_t>(std::max(firstStation, 0));
+    m_cutVolumes.resize(n);
+    m_fillVolumes.resize(n);
+    m_ordinates.resize(n);
+
+    for (size_t i = first; i < n; ++i) {
+        if (i == 0) {
+            m_cutVolumes[0] = 0.0;
+            m_fillVolumes[0] = 0.0;
+            m_ordinates[0] = 0.0;
+            continue;
+        }
+
+        // Average end area over the interval ending at station i
+        double length = m_chainages[i] - m_chainages[i - 1];
+        m_cutVolumes[i] = 0.5 * (m_cutAreas[i - 1] + m_cutAreas[i]) * length;
+        m_fillVolumes[i] = 0.5 * (m_fillAreas[i - 1] + m_fillAreas[i]) * length;
+        m_ordinates[i] = m_ordinates[i - 1] + m_cutFactor * m_cutVolumes[i] - m_fillVolumes[i];
+    }
+}
+
+std::vector<double> Profile::balancePoints(double balanceLine) const
+{
+    std::vector<double> points;
+    std::vector<Point> curve = relativeCurve(m_chainages, m_ordinates, balanceLine);
+
+    // A point on the line bounds a loop when a neighbour is off the line
+    for (size_t k = 0; k < curve.size(); ++k) {
+        if (curve[k].v != 0.0) continue;
+        bool bounds = (k > 0 && curve[k - 1].v != 0.0) || (k + 1 < curve.size() && curve[k + 1].v != 0.0);
+        if (bounds && (points.empty() || points.back() != curve[k].x)) {
+            points.push_back(curve[k].x);
+        }
+    }
+    return points;
+}
+
+double Profile::optimalBalanceLine() const
+{
+    if (m_ordinates.size() < 2) {
+        return 0.0;
+    }
+
+    double low = *std::min_element(m_ordinates.begin(), m_ordinates.end());
+    double high = *std::max_element(m_ordinates.begin(), m_ordinates.end());
+    double halfLength = 0.5 * (m_chainages.back() - m_chainages.front());
+
+    for (int iteration = 0; iteration < 64 && high - low > 1e-9 * std::max(1.0, std::abs(high)); ++iteration) {
+        double level = 0.5 * (low + high);
+        double above = 0.0;
+        for (size_t i = 1; i < m_ordinates.size(); ++i) {
+            above += lengthAbove(m_ordinates[i - 1], m_ordinates[i], m_chainages[i] - m_chainages[i - 1], level);
+        }
+        if (above > halfLength) {
+            low = level;
+        } else {
+            high = level;
+        }
+    }
+    return 0.5 * (low + high);
+}
+
+std::vector<Loop> Profile::loops(double balanceLine, double freeHaulDistance) const
+{
+    std::vector<Loop> result;
+    std::vector<Point> curve = relativeCurve(m_chainages, m_ordinates, balanceLine);
+    if (curve.size() < 2) {
+        return result;
+    }
+
+    // Split at every point on the line; runs lying on the line move nothing
+    size_t begin = 0;
+    for (size_t k = 1; k < curve.size(); ++k) {
+        if (curve[k].v != 0.0 && k + 1 < curve.size()) continue;
+
+        bool moves = false;
+        for (size_t j = begin; j <= k && !moves; ++j) {
+            moves = curve[j].v != 0.0;
+        }
+        if (moves) {
+            result.push_back(analyseLoop(curve, begin, k, freeHaulDistance));
+        }
+        begin = k;
+    }
+    return result;
+}
+
+} // namespace MassHaul
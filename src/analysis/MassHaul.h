@@ -0,0 +1,108 @@
+#ifndef MASSHAUL_H
+#define MASSHAUL_H
+
+#include <vector>
+
+/**
+ * @brief Mass-haul ordinates, balance points and free-haul analysis
+ *
+ * Interval volumes come from average end areas between consecutive sections.
+ * Cut is multiplied by cutFactor (compacted fill per bank unit of cut:
+ * shrinkage < 1, bulking > 1) before it is set against fill. The mass ordinate
+ * at a station is the running sum of (cutFactor * cut - fill) from the start,
+ * so a rising curve means cut and a falling curve means fill.
+ *
+ * Stations can be replaced from any index onwards. Only the ordinates from
+ * that index are recomputed, which keeps edits near the end of a long
+ * alignment cheap. The running sum is formed in the same order either way, so
+ * an edited profile has the same ordinates as one built from scratch.
+ */
+namespace MassHaul {
+
+/**
+ * @brief Material moved between two consecutive balance points
+ *
+ * Ordinates are taken relative to the balance line. Loops that run into an
+ * end of the alignment are open: their material is borrowed or wasted rather
+ * than balanced.
+ */
+struct Loop {
+    double startChainage;
+    double endChainage;
+    bool forward;           // cut hauled towards increasing chainage
+    bool closed;            // bounded by balance points at both ends
+    double volume;          // largest |ordinate| in the loop
+    double haul;            // area between curve and balance line (volume x distance)
+    double freeHaulVolume;  // material moved no further than the free-haul distance
+    double overhaulVolume;  // material moved beyond it
+    double overhaul;        // overhaul volume x distance beyond the free-haul distance
+};
+
+class Profile
+{
+public:
+    void setCutFactor(double cutFactor);
+    double cutFactor() const { return m_cutFactor; }
+
+    /**
+     * @brief Replace stations from firstStation onwards
+     * @param firstStation Index of the first replaced station (<= current count)
+     * @param chainages Chainages of the new stations, ascending
+     * @param cutAreas Cut area of each new section
+     * @param fillAreas Fill area of each new section
+     * @param count Number of new stations
+     */
+    void replaceFrom(int firstStation, const double *chainages,
+                     const double *cutAreas, const double *fillAreas, int count);
+
+    void clear();
+
+    int stationCount() const { return static_cast<int>(m_chainages.size()); }
+    const std::vector<double> &chainages() const { return m_chainages; }
+    const std::vector<double> &cutAreas() const { return m_cutAreas; }
+    const std::vector<double> &fillAreas() const { return m_fillAreas; }
+    const std::vector<double> &ordinates() const { return m_ordinates; }
+
+    // Cut and fill volume of the interval ending at each station (0 at the first)
+    const std::vector<double> &cutVolumes() const { return m_cutVolumes; }
+    const std::vector<double> &fillVolumes() const { return m_fillVolumes; }
+
+    /**
+     * @brief Chainages where the mass curve crosses a balance line
+     */
+    std::vector<double> balancePoints(double balanceLine) const;
+
+    /**
+     * @brief Balance line that minimises total haul (volume x distance)
+     *
+     * Total haul is the area between the curve and the line. Its derivative
+     * with respect to the line is the length below it minus the length above
+     * it, so the optimum is the chainage-weighted median of the curve.
+     */
+    double optimalBalanceLine() const;
+
+    /**
+     * @brief Haul loops between balance points with free-haul and overhaul split
+     *
+     * Within a loop the free-haul level is where the length of the curve
+     * beyond that level equals the free-haul distance. Material above the
+     * level is free haul. Material below it is overhaul, charged for the
+     * distance beyond the free-haul distance.
+     */
+    std::vector<Loop> loops(double balanceLine, double freeHaulDistance) const;
+
+private:
+    void updateOrdinates(int firstStation);
+
+    double m_cutFactor = 1.0;
+    std::vector<double> m_chainages;
+    std::vector<double> m_cutAreas;
+    std::vector<double> m_fillAreas;
+    std::vector<double> m_cutVolumes;
+    std::vector<double> m_fillVolumes;
+    std::vector<double> m_ordinates;
+};
+
+} // namespace MassHaul
+
+#endif // MASSHAUL_H
@@ -0,0 +1,168 @@
+#include "MassHaulCalculator.h"
+#include "SectionSampler.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+QList<double> toList(const std::vector<double> &values)
+{
+    return QList<double>(values.begin(), values.end());
+}
+
+// Chainage from which stations of the new alignment differ from the cached one
+double firstChangedChainage(const std::vector<double> &previous, const std::vector<double> &current)
+{
+    size_t vertices = std::min(previous.size(), current.size()) / 2;
+    size_t same = 0;
+    while (same < vertices
+           && previous[2 * same] == current[2 * same]
+           && previous[2 * same + 1] == current[2 * same + 1]) {
+        ++same;
+    }
+
+    if (same == vertices && previous.size() == current.size()) {
+        return INFINITY;
+    }
+    if (same == 0) {
+        return 0.0;
+    }
+
+    // The segment ending at the first changed vertex starts at vertex same - 1
+    double chainage = 0.0;
+    for (size_t i = 1; i < same; ++i) {
+        chainage += std::hypot(current[2 * i] - current[2 * i - 2], current[2 * i + 1] - current[2 * i - 1]);
+    }
+    return chainage;
+}
+
+} // namespace
+
+MassHaulCalculator::MassHaulCalculator(QObject *parent)
+    : QObject(parent)
+{
+}
+
+MassHaulCalculator::~MassHaulCalculator() = default;
+
+void MassHaulCalculator::invalidate()
+{
+    m_profile.clear();
+    m_alignment.clear();
+    m_sectionKey.clear();
+}
+
+QVariantMap MassHaulCalculator::calculate(const QVariantList &alignment,
+                                          const QString &sectionKey,
+                                          const SampleFunction &sample,
+                                          double cutFactor,
+                                          double freeHaulDistance,
+                                          double balanceLine,
+                                          QString &errorOut)
+{
+    QVariantMap result;
+
+    std::vector<double> xy = SectionSampler::alignmentCoordinates(alignment);
+    if (xy.size() < 4) {
+        errorOut = "Mass haul needs an alignment of at least two points";
+        return result;
+    }
+    if (cutFactor <= 0.0) {
+        errorOut = "Cut factor must be positive";
+        return result;
+    }
+
+    double fromChainage = 0.0;
+    if (sectionKey == m_sectionKey && m_profile.stationCount() > 0) {
+        fromChainage = firstChangedChainage(m_alignment, xy);
+    }
+
+    int resampled = 0;
+    if (std::isfinite(fromChainage)) {
+        QVariantMap sections = sample(fromChainage, errorOut);
+        if (sections.isEmpty()) {
+            invalidate();
+            return result;
+        }
+
+        QList<double> chainages = sections["chainages"].value<QList<double>>();
+        QList<double> cutAreas = sections["cutAreas"].value<QList<double>>();
+        QList<double> fillAreas = sections["fillAreas"].value<QList<double>>();
+        int firstStation = sections["firstStation"].toInt();
+        resampled = static_cast<int>(chainages.size());
+
+        m_profile.setCutFactor(cutFactor);
+        m_profile.replaceFrom(firstStation, chainages.constData(), cutAreas.constData(),
+                              fillAreas.constData(), resampled);
+        m_alignment = xy;
+        m_sectionKey = sectionKey;
+    } else {
+        m_profile.setCutFactor(cutFactor);
+    }
+
+    qDebug() << "Mass haul:" << m_profile.stationCount() << "stations," << resampled
+             << "re-sampled from chainage" << (std::isfinite(fromChainage) ? fromChainage : -1.0);
+
+    bool optimise = std::isnan(balanceLine);
+    if (optimise) {
+        balanceLine = m_profile.optimalBalanceLine();
+    }
+
+    double totalCut = 0.0;
+    double totalFill = 0.0;
+    for (int i = 0; i < m_profile.stationCount(); ++i) {
+        totalCut += m_profile.cutVolumes()[i];
+        totalFill += m_profile.fillVolumes()[i];
+    }
+
+    QVariantList loops;
+    double totalHaul = 0.0;
+    double freeHaulVolume = 0.0;
+    double overhaulVolume = 0.0;
+    double overhaul = 0.0;
+    for (const MassHaul::Loop &loop : m_profile.loops(balanceLine, freeHaulDistance)) {
+        QVariantMap item;
+        item["startChainage"] = loop.startChainage;
+        item["endChainage"] = loop.endChainage;
+        item["forward"] = loop.forward;
+        item["closed"] = loop.closed;
+        item["volume"] = loop.volume;
+        item["haul"] = loop.haul;
+        item["freeHaulVolume"] = loop.freeHaulVolume;
+        item["overhaulVolume"] = loop.overhaulVolume;
+        item["overhaul"] = loop.overhaul;
+        loops.append(item);
+
+        totalHaul += loop.haul;
+        freeHaulVolume += loop.freeHaulVolume;
+        overhaulVolume += loop.overhaulVolume;
+        overhaul += loop.overhaul;
+    }
+
+    const std::vector<double> &ordinates = m_profile.ordinates();
+
+    result["stationCount"] = m_profile.stationCount();
+    result["chainages"] = QVariant::fromValue(toList(m_profile.chainages()));
+    result["ordinates"] = QVariant::fromValue(toList(ordinates));
+    result["cutVolumes"] = QVariant::fromValue(toList(m_profile.cutVolumes()));
+    result["fillVolumes"] = QVariant::fromValue(toList(m_profile.fillVolumes()));
+    result["balanceLine"] = balanceLine;
+    result["optimisedBalanceLine"] = optimise;
+    result["balancePoints"] = QVariant::fromValue(toList(m_profile.balancePoints(balanceLine)));
+    result["loops"] = loops;
+    result["cutFactor"] = cutFactor;
+    result["freeHaulDistance"] = freeHaulDistance;
+    result["totalCut"] = totalCut;
+    result["totalFill"] = totalFill;
+    result["totalHaul"] = totalHaul;
+    result["freeHaulVolume"] = freeHaulVolume;
+    result["overhaulVolume"] = overhaulVolume;
+    result["overhaul"] = overhaul;
+    // Material left over at each end relative to the balance line: positive is waste, negative borrow
+    result["startImbalance"] = ordinates.empty() ? 0.0 : balanceLine - ordinates.front();
+    result["endImbalance"] = ordinates.empty() ? 0.0 : ordinates.back() - balanceLine;
+    result["resampledFrom"] = std::isfinite(fromChainage) ? fromChainage : -1.0;
+    result["resampledStations"] = resampled;
+    return result;
+}
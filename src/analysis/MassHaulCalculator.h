@@ -0,0 +1,70 @@
+#ifndef MASSHAULCALCULATOR_H
+#define MASSHAULCALCULATOR_H
+
+#include "MassHaul.h"
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Mass-haul diagrams from sampled cross sections
+ *
+ * Provides functionality for:
+ * - Mass ordinates (cumulative cut/fill) at every station of an alignment
+ * - Bulking/shrinkage through a cut factor
+ * - Balance points on a given or optimised balance line
+ * - Free-haul, overhaul and borrow/waste per haul loop
+ *
+ * Section areas of the last alignment are kept. When the alignment is edited,
+ * only the stations from the first changed segment onwards are re-sampled and
+ * only their ordinates are recomputed.
+ */
+class MassHaulCalculator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Samples sections from a chainage onwards (see SectionSampler)
+     */
+    using SampleFunction = std::function<QVariantMap(double fromChainage, QString &errorOut)>;
+
+    explicit MassHaulCalculator(QObject *parent = nullptr);
+    ~MassHaulCalculator();
+
+    /**
+     * @brief Compute the mass-haul diagram for an alignment
+     * @param alignment Polyline points (maps with x, y keys)
+     * @param sectionKey Identifies the surface and section settings; cached
+     *        sections are only reused while it is unchanged
+     * @param sample Section sampler for the current surface
+     * @param cutFactor Compacted fill volume per unit of cut (shrinkage < 1, bulking > 1)
+     * @param freeHaulDistance Haul distance included in the excavation price
+     * @param balanceLine Mass ordinate of the balance line (NaN = minimise total haul)
+     * @param errorOut Output parameter for error message
+     * @return Map with chainages, ordinates, cutVolumes, fillVolumes (packed arrays),
+     *         balanceLine, balancePoints, loops, totals and resampledFrom
+     */
+    QVariantMap calculate(const QVariantList &alignment,
+                          const QString &sectionKey,
+                          const SampleFunction &sample,
+                          double cutFactor,
+                          double freeHaulDistance,
+                          double balanceLine,
+                          QString &errorOut);
+
+    /**
+     * @brief Drop cached sections, e.g. after the surface was regenerated
+     */
+    void invalidate();
+
+private:
+    MassHaul::Profile m_profile;
+    std::vector<double> m_alignment;
+    QString m_sectionKey;
+};
+
+#endif // MASSHAULCALCULATOR_H
@@ -0,0 +1,183 @@
+#include "MemoryBudget.h"
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/sysctl.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace MemoryBudget {
+
+namespace {
+
+std::atomic<qint64> g_limit{0};     // 0 until first use or reset, then resolved
+std::atomic<qint64> g_used{0};
+std::atomic<qint64> g_peak{0};
+
+thread_local std::shared_ptr<Usage> t_usage;
+
+qint64 defaultLimit()
+{
+    qint64 physical = physicalMemory();
+    if (physical <= 0) {
+        return std::numeric_limits<qint64>::max();
+    }
+    return static_cast<qint64>(physical * kDefaultFraction);
+}
+
+void raisePeak(std::atomic<qint64> &peak, qint64 value)
+{
+    qint64 previous = peak.load(std::memory_order_relaxed);
+    while (value > previous && !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+qint64 physicalMemory()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? static_cast<qint64>(status.ullTotalPhys) : 0;
+#elif defined(Q_OS_MACOS)
+    int64_t memory = 0;
+    size_t length = sizeof(memory);
+    return sysctlbyname("hw.memsize", &memory, &length, nullptr, 0) == 0 ? memory : 0;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pages > 0 && pageSize > 0 ? static_cast<qint64>(pages) * pageSize : 0;
+#endif
+}
+
+void setLimit(qint64 bytes)
+{
+    g_limit.store(bytes > 0 ? bytes : defaultLimit(), std::memory_order_relaxed);
+    qDebug() << "Memory budget:" << formatBytes(limit());
+}
+
+qint64 limit()
+{
+    qint64 current = g_limit.load(std::memory_order_relaxed);
+    if (current == 0) {
+        qint64 resolved = defaultLimit();
+        g_limit.compare_exchange_strong(current, resolved, std::memory_order_relaxed);
+        return g_limit.load(std::memory_order_relaxed);
+    }
+    return current;
+}
+
+qint64 used()
+{
+    return g_used.load(std::memory_order_relaxed);
+}
+
+qint64 peak()
+{
+    return g_peak.load(std::memory_order_relaxed);
+}
+
+qint64 available()
+{
+    return std::max<qint64>(0, limit() - used());
+}
+
+QString formatBytes(qint64 bytes)
+{
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+void Usage::add(qint64 bytes)
+{
+    qint64 value = m_current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    raisePeak(m_peak, value);
+}
+
+UsageScope::UsageScope(std::shared_ptr<Usage> usage)
+    : m_previous(std::move(t_usage))
+{
+    t_usage = std::move(usage);
+}
+
+UsageScope::~UsageScope()
+{
+    t_usage = std::move(m_previous);
+}
+
+std::shared_ptr<Usage> currentUsage()
+{
+    return t_usage;
+}
+
+Reservation::Reservation(Reservation &&other) noexcept
+    : m_bytes(other.m_bytes)
+    , m_usage(std::move(other.m_usage))
+    , m_valid(other.m_valid)
+{
+    other.m_bytes = 0;
+    other.m_valid = false;
+}
+
+Reservation &Reservation::operator=(Reservation &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_bytes = other.m_bytes;
+        m_usage = std::move(other.m_usage);
+        m_valid = other.m_valid;
+        other.m_bytes = 0;
+        other.m_valid = false;
+    }
+    return *this;
+}
+
+void Reservation::shrink(qint64 bytes)
+{
+    qint64 freed = m_bytes - std::clamp<qint64>(bytes, 0, m_bytes);
+    if (freed <= 0) {
+        return;
+    }
+    g_used.fetch_sub(freed, std::memory_order_relaxed);
+    if (m_usage) {
+        m_usage->add(-freed);
+    }
+    m_bytes -= freed;
+}
+
+void Reservation::release()
+{
+    shrink(0);
+    m_usage.reset();
+    m_valid = false;
+}
+
+Reservation tryReserve(qint64 bytes)
+{
+    Reservation reservation;
+    bytes = std::max<qint64>(0, bytes);
+
+    qint64 cap = limit();
+    qint64 current = g_used.load(std::memory_order_relaxed);
+    do {
+        if (bytes > cap - current) {
+            return reservation;
+        }
+    } while (!g_used.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+    raisePeak(g_peak, current + bytes);
+
+    reservation.m_bytes = bytes;
+    reservation.m_valid = true;
+    reservation.m_usage = t_usage;
+    if (reservation.m_usage) {
+        reservation.m_usage->add(bytes);
+    }
+    return reservation;
+}
+
+} // namespace MemoryBudget
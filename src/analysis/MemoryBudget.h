@@ -0,0 +1,134 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Process-wide memory budget for large analysis buffers
+ *
+ * Components reserve against the budget before allocating full rasters,
+ * meshes or point structures. A reservation that would take the total over
+ * the limit fails instead, and the caller switches to a strip-streamed or
+ * reduced-resolution path, or reports an error, rather than letting the
+ * process run out of memory. The limit defaults to kDefaultFraction of
+ * physical RAM.
+ *
+ * Reservations are also charged to the Usage made current on the reserving
+ * thread by a UsageScope, which is how JobScheduler reports the peak memory
+ * of each job. Scopes do not follow work onto other threads: code that hands
+ * reserving work to another thread opens a scope there for currentUsage().
+ *
+ * Only the buffers that scale with the input are counted, so the figures are
+ * a lower bound on the real footprint.
+ */
+namespace MemoryBudget {
+
+constexpr double kDefaultFraction = 0.5;
+
+/**
+ * @brief Installed physical memory in bytes, or 0 if it cannot be determined
+ */
+qint64 physicalMemory();
+
+/**
+ * @brief Set the limit in bytes; 0 or less restores the default
+ */
+void setLimit(qint64 bytes);
+qint64 limit();
+
+/**
+ * @brief Bytes currently reserved, and the most ever reserved at once
+ */
+qint64 used();
+qint64 peak();
+qint64 available();
+
+/**
+ * @brief Bytes as "12.3 MB" for messages and reports
+ */
+QString formatBytes(qint64 bytes);
+
+/**
+ * @brief Reserved bytes of one job
+ */
+class Usage
+{
+public:
+    qint64 current() const { return m_current.load(std::memory_order_relaxed); }
+    qint64 peak() const { return m_peak.load(std::memory_order_relaxed); }
+
+    void add(qint64 bytes);
+
+private:
+    std::atomic<qint64> m_current{0};
+    std::atomic<qint64> m_peak{0};
+};
+
+/**
+ * @brief Charges reservations made on this thread to usage while in scope
+ */
+class UsageScope
+{
+public:
+    explicit UsageScope(std::shared_ptr<Usage> usage);
+    ~UsageScope();
+
+    UsageScope(const UsageScope &) = delete;
+    UsageScope &operator=(const UsageScope &) = delete;
+
+private:
+    std::shared_ptr<Usage> m_previous;
+};
+
+/**
+ * @brief The Usage of the innermost UsageScope on this thread, or nullptr
+ */
+std::shared_ptr<Usage> currentUsage();
+
+/**
+ * @brief Bytes held against the budget until destroyed or released
+ */
+class Reservation
+{
+public:
+    Reservation() = default;
+    ~Reservation() { release(); }
+
+    Reservation(Reservation &&other) noexcept;
+    Reservation &operator=(Reservation &&other) noexcept;
+    Reservation(const Reservation &) = delete;
+    Reservation &operator=(const Reservation &) = delete;
+
+    /**
+     * @brief Whether the reservation was granted
+     */
+    bool isValid() const { return m_valid; }
+    explicit operator bool() const { return m_valid; }
+    qint64 bytes() const { return m_bytes; }
+
+    /**
+     * @brief Give back all but bytes, once the real size is known
+     */
+    void shrink(qint64 bytes);
+    void release();
+
+private:
+    friend Reservation tryReserve(qint64 bytes);
+
+    qint64 m_bytes = 0;
+    std::shared_ptr<Usage> m_usage;      // kept alive past the job if need be
+    bool m_valid = false;
+};
+
+/**
+ * @brief Reserve bytes, charged to currentUsage()
+ * @return An invalid reservation if the limit would be exceeded
+ */
+Reservation tryReserve(qint64 bytes);
+
+} // namespace MemoryBudget
+
+#endif // MEMORYBUDGET_H
@@ -1,9 +1,274 @@
 #include "MeshExporter.h"
+#include "DTMGenerator.h"
+#include "GridMesh.h"
+#include "MeshOptimizer.h"
+#include "TINProcessor.h"
+#include "VolumeKernel.h"
+#include "utilities/Trace.h"
+#include <QtConcurrent>
 #include <QFile>
-#include <QTextStream>
 #include <QDebug>
-#include <QVector>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Lines per formatted chunk; a batch holds a few chunks per pool thread
+constexpr int kChunkLines = 32768;
+
+// Items formatted between chunk buffer capacity checks
+constexpr int kGroupItems = 1024;
+
+// Upper bounds for one line: fixed-point floats need at most 39 integer digits
+constexpr size_t kFixedBytes = 1 + 39 + 1 + 3;
+constexpr size_t kVertexLineBytes = 2 + 6 * (1 + kFixedBytes);
+constexpr size_t kFaceLineBytes = 2 + 3 * (1 + 20);
+
+char *appendFixed3(char *p, float value)
+{
+    return std::to_chars(p, p + kFixedBytes, value, std::chars_format::fixed, 3).ptr;
+}
+
+char *appendFace(char *p, qint64 a, qint64 b, qint64 c)
+{
+    *p++ = 'f';
+    for (qint64 index : {a, b, c}) {
+        *p++ = ' ';
+        p = std::to_chars(p, p + 20, index).ptr;
+    }
+    *p++ = '\n';
+    return p;
+}
+
+/**
+ * @brief Appends batches of chunks to a file in order on one background thread
+ *
+ * At most one batch is being written while the caller formats the next, so
+ * memory stays bounded to two batches. A batch and its budget reservation
+ * are released as soon as it is written.
+ */
+class OrderedWriter
+{
+public:
+    explicit OrderedWriter(QFile &file)
+        : m_file(file)
+    {
+        m_pool.setMaxThreadCount(1);
+    }
+
+    ~OrderedWriter() { finish(); }
+
+    bool ok() const { return m_ok; }
+
+    void write(std::vector<QByteArray> chunks,
+               std::shared_ptr<MemoryBudget::Reservation> reservation = nullptr)
+    {
+        if (m_pending.isValid()) {
+            m_pending.waitForFinished();
+        }
+        m_pending = QtConcurrent::run(&m_pool, [this, chunks = std::move(chunks), reservation]() mutable {
+            for (const QByteArray &chunk : chunks) {
+                if (!m_ok) break;
+                if (m_file.write(chunk) != chunk.size()) {
+                    m_ok = false;
+                }
+            }
+            chunks.clear();
+            if (reservation) {
+                reservation->release();
+            }
+        });
+    }
+
+    bool finish()
+    {
+        if (m_pending.isValid()) {
+            m_pending.waitForFinished();
+            m_pending = QFuture<void>();
+        }
+        return m_ok;
+    }
+
+private:
+    QFile &m_file;
+    QThreadPool m_pool;
+    QFuture<void> m_pending;
+    std::atomic<bool> m_ok{true};
+};
+
+/**
+ * @brief Format rows into chunks in parallel and queue them on the writer in row order
+ *
+ * Chunk buffers start at the average bytes per item measured on the chunks
+ * so far (the first batch is one chunk, to measure it) and grow only when
+ * the next group of items might not fit, so no chunk holds worst-case line
+ * space. Each batch is reserved in MemoryBudget until it is written; a short
+ * budget shrinks the batch, down to one chunk after the writer drains.
+ * @param itemsPerRow Items (cells or quads) per row
+ * @param linesPerItem Lines formatItems writes per item at most
+ * @param lineBytes Upper bound for one line
+ * @param formatItems char *formatItems(int row, int begin, int end, char *p) writes
+ *        items [begin, end) of a row at p and returns its end
+ * @return false if a single chunk does not fit the budget or the write failed
+ */
+template <typename FormatItems>
+bool writeChunked(OrderedWriter &writer, int rows, int itemsPerRow, int linesPerItem, size_t lineBytes,
+                  FormatItems formatItems, QString &errorOut)
+{
+    int rowsPerChunk = std::max(1, kChunkLines / std::max(1, itemsPerRow * linesPerItem));
+    int chunkCount = (rows + rowsPerChunk - 1) / rowsPerChunk;
+    int batchSize = 2 * QThreadPool::globalInstance()->maxThreadCount();
+    qsizetype groupBytes = static_cast<qsizetype>(kGroupItems * linesPerItem * lineBytes);
+
+    // Until the first chunk is measured, guess a quarter of the upper bound
+    std::atomic<qint64> formattedBytes{0};
+    std::atomic<qint64> formattedItems{0};
+    double bytesPerItem = linesPerItem * lineBytes / 4.0;
+
+    for (int first = 0; first < chunkCount && writer.ok();) {
+        if (formattedItems > 0) {
+            bytesPerItem = static_cast<double>(formattedBytes) / static_cast<double>(formattedItems);
+        }
+        qsizetype chunkBytes = static_cast<qsizetype>(bytesPerItem * rowsPerChunk * itemsPerRow) + groupBytes;
+        int count = std::min(first == 0 ? 1 : batchSize, chunkCount - first);
+
+        MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(count * chunkBytes);
+        while (!reservation && count > 1) {
+            count /= 2;
+            reservation = MemoryBudget::tryReserve(count * chunkBytes);
+        }
+        if (!reservation) {
+            writer.finish();
+            reservation = MemoryBudget::tryReserve(chunkBytes);
+        }
+        if (!reservation) {
+            errorOut = QString("OBJ export buffers do not fit the memory budget (%1 free)")
+                           .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+            return false;
+        }
+
+        std::vector<QByteArray> batch(count);
+        VolumeKernel::runBlocks(count, [&](int i) {
+            int rowBegin = (first + i) * rowsPerChunk;
+            int rowEnd = std::min(rows, rowBegin + rowsPerChunk);
+            QByteArray chunk(chunkBytes, Qt::Uninitialized);
+            qsizetype used = 0;
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                for (int begin = 0; begin < itemsPerRow; begin += kGroupItems) {
+                    if (chunk.size() - used < groupBytes) {
+                        chunk.resize(std::max(chunk.size() * 2, used + groupBytes));
+                    }
+                    char *start = chunk.data();
+                    used = formatItems(row, begin, std::min(itemsPerRow, begin + kGroupItems), start + used) - start;
+                }
+            }
+            chunk.truncate(used);
+            formattedBytes += used;
+            formattedItems += static_cast<qint64>(rowEnd - rowBegin) * itemsPerRow;
+            batch[i] = std::move(chunk);
+        });
+
+        writer.write(std::move(batch), std::make_shared<MemoryBudget::Reservation>(std::move(reservation)));
+        first += count;
+    }
+    return writer.ok();
+}
+
+// Items per parallel range when repacking mesh buffers into file records
+constexpr int kRecordsPerRange = 65536;
+
+void forEachRange(int count, const std::function<void(int begin, int end)> &fn)
+{
+    int rangeCount = (count + kRecordsPerRange - 1) / kRecordsPerRange;
+    VolumeKernel::runBlocks(rangeCount, [&](int range) {
+        int begin = range * kRecordsPerRange;
+        fn(begin, std::min(count, begin + kRecordsPerRange));
+    });
+}
+
+template <typename T>
+char *put(char *p, T value)
+{
+    std::memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+}
+
+/**
+ * @brief Write prepared buffers to a file one after another
+ *
+ * The binary formats here are little-endian, as are the float and index
+ * buffers they are written from.
+ */
+bool writeBuffers(const QString &filePath, const std::vector<QByteArray> &buffers, QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "write mesh file");
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorOut = QString("Failed to open file for writing: %1").arg(filePath);
+        return false;
+    }
+    for (const QByteArray &buffer : buffers) {
+        if (file.write(buffer) != buffer.size()) {
+            errorOut = QString("Failed to write %1: %2").arg(filePath, file.errorString());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkMesh(const MeshBuffers &mesh, QString &errorOut)
+{
+    if (mesh.vertexCount <= 0 || mesh.indexCount <= 0
+        || mesh.vertexData.size() != static_cast<qsizetype>(mesh.vertexCount) * MeshBuffers::kStride
+        || mesh.indexData.size() != static_cast<qsizetype>(mesh.indexCount) * static_cast<qsizetype>(sizeof(quint32))) {
+        errorOut = "Mesh is empty or invalid";
+        return false;
+    }
+    return true;
+}
+
+// Mesh axes (x east, y up, z south) to z-up file axes (x east, y north, z up)
+inline void toZUp(const float *v, float out[3])
+{
+    out[0] = v[0];
+    out[1] = -v[2];
+    out[2] = v[1];
+}
+
+} // namespace
+
+void MeshChunk::decodeVertices(QByteArray &out) const
+{
+    out.resize(static_cast<qsizetype>(vertexCount) * MeshBuffers::kStride);
+    float *v = reinterpret_cast<float *>(out.data());
+    const char *in = vertexData.constData();
+    QVector3D step = (boundsMax - boundsMin) / 65535.0f;
+
+    for (int i = 0; i < vertexCount; ++i, in += kStride, v += MeshBuffers::kStride / sizeof(float)) {
+        quint16 q[3];
+        qint8 n[3];
+        quint8 c[4];
+        std::memcpy(q, in + kPositionOffset, sizeof(q));
+        std::memcpy(n, in + kNormalOffset, sizeof(n));
+        std::memcpy(c, in + kColorOffset, sizeof(c));
+        for (int k = 0; k < 3; ++k) {
+            v[k] = boundsMin[k] + q[k] * step[k];
+            v[3 + k] = n[k] / 127.0f;
+        }
+        for (int k = 0; k < 4; ++k) {
+            v[6 + k] = c[k] / 255.0f;
+        }
+    }
+}
 
 MeshExporter::MeshExporter(QObject *parent)
     : QObject(parent)
@@ -14,251 +279,879 @@ MeshExporter::~MeshExporter() = default;
 
 QVector3D MeshExporter::getElevationColor(float elevation, float minElev, float maxElev)
 {
-    if (elevation == -9999.0f) {
-        return QVector3D(0.5, 0.5, 0.5);  // Gray for nodata
+    float rgb[3];
+    GridMesh::elevationColor(elevation, minElev, maxElev, -9999.0f, rgb);
+    return QVector3D(rgb[0], rgb[1], rgb[2]);
+}
+
+bool MeshExporter::buildGridMesh(const DTMRaster &raster,
+                                 double verticalScale,
+                                 MeshBuffers &mesh,
+                                 QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::buildGridMesh");
+    int width = raster.width;
+    int height = raster.height;
+    if (width < 2 || height < 2 || raster.values.size() != static_cast<size_t>(width) * height) {
+        errorOut = "DTM data is empty or invalid";
+        return false;
     }
 
-    float elevRange = maxElev - minElev;
-    if (elevRange <= 0) {
-        return QVector3D(0.5, 0.5, 0.5);
+    if (static_cast<qint64>(width) * height > std::numeric_limits<int>::max()) {
+        errorOut = QString("DTM too large for a single mesh: %1 x %2").arg(width).arg(height);
+        return false;
+    }
+
+    MemoryBudget::Reservation reservation =
+        MemoryBudget::tryReserve(static_cast<qint64>(width) * height * kGridBytesPerCell);
+    if (!reservation) {
+        errorOut = QString("DTM mesh %1 x %2 does not fit the memory budget (%3 free)")
+                       .arg(width).arg(height).arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return false;
     }
 
-    float normalized = (elevation - minElev) / elevRange;
-    float r, g, b;
+    qDebug() << "Generating 3D mesh from DTM:" << width << "x" << height;
+
+    const float *data = raster.values.data();
 
-    if (normalized < 0.25f) {
-        float t = normalized * 4.0f;
-        r = 0; g = t; b = 1.0f;
-    } else if (normalized < 0.5f) {
-        float t = (normalized - 0.25f) * 4.0f;
-        r = 0; g = 1.0f; b = 1.0f - t;
-    } else if (normalized < 0.75f) {
-        float t = (normalized - 0.5f) * 4.0f;
-        r = t; g = 1.0f; b = 0;
-    } else {
-        float t = (normalized - 0.75f) * 4.0f;
-        r = 1.0f; g = 1.0f - t; b = 0;
+    // Only valid cells become vertices, and only quads with four valid
+    // corners become triangles
+    std::vector<int> remap;
+    std::vector<std::int64_t> quadOffsets;
+    qint64 vertexCount = GridMesh::compactVertices(data, width, height, -9999.0f, remap);
+    GridMesh::compactQuads(remap, width, height, quadOffsets);
+    qint64 indexCount = quadOffsets.back() * 6;
+
+    if (vertexCount == 0 || indexCount == 0) {
+        errorOut = "DTM has no valid cells to mesh";
+        return false;
     }
+    if (indexCount > std::numeric_limits<int>::max() / static_cast<int>(sizeof(quint32))) {
+        errorOut = QString("DTM too large for a single mesh: %1 x %2").arg(width).arg(height);
+        return false;
+    }
+
+    float minElev = raster.minElev;
+    float maxElev = raster.maxElev;
+    float pixelWidth = static_cast<float>(raster.geoTransform[1]);
+    float pixelHeight = static_cast<float>(std::abs(raster.geoTransform[5]));
+    float scale = static_cast<float>(verticalScale);
+
+    // Normalize to centered coordinates
+    float centerX = width * pixelWidth / 2.0f;
+    float centerY = height * pixelHeight / 2.0f;
+
+    // Keep only what the buffers need once the remap table is gone
+    reservation.shrink(vertexCount * MeshBuffers::kStride + indexCount * static_cast<qint64>(sizeof(quint32)));
+    mesh.reservation = std::make_shared<MemoryBudget::Reservation>(std::move(reservation));
+    mesh.vertexData.resize(vertexCount * MeshBuffers::kStride);
+    mesh.indexData.resize(indexCount * sizeof(quint32));
+    float *vertices = reinterpret_cast<float *>(mesh.vertexData.data());
+    quint32 *indices = reinterpret_cast<quint32 *>(mesh.indexData.data());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+
+    // Positions and colours; rows are independent
+    VolumeKernel::forEachBlock(height, [&](int, int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; row++) {
+            for (int col = 0; col < width; col++) {
+                size_t cell = static_cast<size_t>(row) * width + col;
+                if (remap[cell] < 0) continue;
+
+                float elev = data[cell];
+                float *v = vertices + static_cast<size_t>(remap[cell]) * stride;
+
+                v[0] = col * pixelWidth - centerX;
+                v[1] = elev * scale;
+                v[2] = row * pixelHeight - centerY;
+
+                QVector3D color = getElevationColor(elev, minElev, maxElev);
+                v[6] = color.x();
+                v[7] = color.y();
+                v[8] = color.z();
+                v[9] = 1.0f;
+            }
+        }
+    });
+
+    // Two triangles per complete cell
+    VolumeKernel::forEachBlock(height - 1, [&](int, int rowBegin, int rowEnd) {
+        quint32 *out = indices + quadOffsets[rowBegin] * 6;
+        for (int row = rowBegin; row < rowEnd; row++) {
+            const int *top = remap.data() + static_cast<size_t>(row) * width;
+            const int *bottom = top + width;
+            for (int col = 0; col < width - 1; col++) {
+                if ((top[col] | top[col + 1] | bottom[col] | bottom[col + 1]) < 0) continue;
 
-    return QVector3D(r, g, b);
+                quint32 topLeft = static_cast<quint32>(top[col]);
+                quint32 topRight = static_cast<quint32>(top[col + 1]);
+                quint32 bottomLeft = static_cast<quint32>(bottom[col]);
+                quint32 bottomRight = static_cast<quint32>(bottom[col + 1]);
+
+                *out++ = topLeft;
+                *out++ = bottomLeft;
+                *out++ = topRight;
+
+                *out++ = topRight;
+                *out++ = bottomLeft;
+                *out++ = bottomRight;
+            }
+        }
+    });
+
+    // Normals straight from neighbouring heights, one-sided next to nodata
+    GridMesh::centralDifferenceNormals(data, width, height, pixelWidth, pixelHeight, scale,
+                                       -9999.0f, minElev, vertices + 3, stride, remap.data());
+
+    mesh.vertexCount = static_cast<int>(vertexCount);
+    mesh.indexCount = static_cast<int>(indexCount);
+    mesh.minElev = minElev;
+    mesh.maxElev = maxElev;
+    // Vertex (0, 0) is the centre of cell (0, 0)
+    VolumeKernel::GridTransform transform(raster.geoTransform);
+    transform.toWorld(0.0, 0.0, mesh.originX, mesh.originY);
+    mesh.originX += centerX;
+    mesh.originY -= centerY;
+    mesh.verticalScale = verticalScale;
+    mesh.boundsMin = QVector3D(-centerX, minElev * scale, -centerY);
+    mesh.boundsMax = QVector3D((width - 1) * pixelWidth - centerX, maxElev * scale,
+                               (height - 1) * pixelHeight - centerY);
+    if (scale < 0.0f) {
+        std::swap(mesh.boundsMin[1], mesh.boundsMax[1]);
+    }
+
+    qDebug() << "3D mesh generated:" << vertexCount << "of" << static_cast<qint64>(width) * height
+             << "vertices," << indexCount / 3 << "triangles";
+
+    return true;
 }
 
-QVariantMap MeshExporter::generate3DMesh(const QVariantMap &dtmData,
-                                        double verticalScale,
-                                        QString &errorOut)
+bool MeshExporter::buildTINMesh(const TINProcessor *tinProcessor,
+                                double verticalScale,
+                                MeshBuffers &mesh,
+                                QString &errorOut)
 {
-    QVariantMap result;
+    TRACE_SCOPE("mesh", "MeshExporter::buildTINMesh");
+    if (!tinProcessor || !tinProcessor->hasData()) {
+        errorOut = "No TIN available. Generate TIN first.";
+        return false;
+    }
 
-    if (dtmData.isEmpty() || dtmData["width"].toInt() == 0) {
-        errorOut = "DTM data is empty or invalid";
-        return result;
+    const std::vector<double> &points = tinProcessor->packedVertices();
+    const std::vector<int> &triangles = tinProcessor->packedTriangles();
+    size_t vertexCount = points.size() / 3;
+    size_t indexCount = triangles.size() - triangles.size() % 3;
+    if (indexCount > static_cast<size_t>(std::numeric_limits<int>::max() / static_cast<int>(sizeof(quint32)))
+        || vertexCount > static_cast<size_t>(std::numeric_limits<int>::max() / MeshBuffers::kStride)) {
+        errorOut = QString("TIN too large for a single mesh: %1 vertices").arg(vertexCount);
+        return false;
     }
 
-    int width = dtmData["width"].toInt();
-    int height = dtmData["height"].toInt();
-    QVariantList data = dtmData["data"].toList();
-    double minElev = dtmData["minElev"].toDouble();
-    double maxElev = dtmData["maxElev"].toDouble();
-    double pixelWidth = dtmData["pixelWidth"].toDouble();
-    double pixelHeight = qAbs(dtmData["pixelHeight"].toDouble());
+    double minX = std::numeric_limits<double>::max();
+    double minY = minX;
+    double minZ = minX;
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = maxX;
+    double maxZ = maxX;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        minX = std::min(minX, points[3 * i]);
+        maxX = std::max(maxX, points[3 * i]);
+        minY = std::min(minY, points[3 * i + 1]);
+        maxY = std::max(maxY, points[3 * i + 1]);
+        minZ = std::min(minZ, points[3 * i + 2]);
+        maxZ = std::max(maxZ, points[3 * i + 2]);
+    }
 
-    if (data.size() != width * height) {
-        errorOut = QString("Data size mismatch: expected %1, got %2")
-                   .arg(width * height).arg(data.size());
-        return result;
+    // Buffers plus the vertex-to-face table
+    qint64 meshBytes = static_cast<qint64>(vertexCount) * (MeshBuffers::kStride + 2 * sizeof(int))
+                       + static_cast<qint64>(indexCount) * (sizeof(quint32) + sizeof(int));
+    MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(meshBytes);
+    if (!reservation) {
+        errorOut = QString("TIN mesh of %1 vertices needs %2, more than the %3 left in the memory budget")
+                       .arg(vertexCount).arg(MemoryBudget::formatBytes(meshBytes))
+                       .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return false;
     }
+    mesh.reservation = std::make_shared<MemoryBudget::Reservation>(std::move(reservation));
 
-    qDebug() << "Generating 3D mesh from DTM:" << width << "x" << height;
+    double centerX = (minX + maxX) / 2.0;
+    double centerY = (minY + maxY) / 2.0;
+    float minElev = static_cast<float>(minZ);
+    float maxElev = static_cast<float>(maxZ);
+    float scale = static_cast<float>(verticalScale);
 
-    // Generate vertices
-    QVariantList vertices;
-    QVariantList normals;
-    QVariantList colors;
+    mesh.vertexData.resize(static_cast<qsizetype>(vertexCount) * MeshBuffers::kStride);
+    mesh.indexData.resize(static_cast<qsizetype>(indexCount * sizeof(quint32)));
+    float *vertices = reinterpret_cast<float *>(mesh.vertexData.data());
+    quint32 *indices = reinterpret_cast<quint32 *>(mesh.indexData.data());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
 
-    // Normalize to centered coordinates
-    double centerX = width * pixelWidth / 2.0;
-    double centerY = height * pixelHeight / 2.0;
+    int vertexTotal = static_cast<int>(vertexCount);
+    int triangleTotal = static_cast<int>(indexCount / 3);
 
-    // Create vertex grid
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            int idx = row * width + col;
-            float elev = data[idx].toFloat();
-
-            // Vertex position (centered and scaled)
-            float x = (col * pixelWidth - centerX);
-            float z = (row * pixelHeight - centerY);
-            float y = (elev == -9999.0f ? minElev : elev) * verticalScale;
-
-            vertices.append(x);
-            vertices.append(y);
-            vertices.append(z);
-
-            // Color
-            QVector3D color = getElevationColor(elev, minElev, maxElev);
-            colors.append(color.x());
-            colors.append(color.y());
-            colors.append(color.z());
-
-            // Normals (will calculate properly later)
-            normals.append(0.0f);
-            normals.append(1.0f);
-            normals.append(0.0f);
+    // Positions and elevation colours
+    forEachRange(vertexTotal, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            float *v = vertices + static_cast<size_t>(i) * stride;
+            v[0] = static_cast<float>(points[3 * i] - centerX);
+            v[1] = static_cast<float>(points[3 * i + 2]) * scale;
+            v[2] = static_cast<float>(centerY - points[3 * i + 1]);
+            GridMesh::elevationColor(static_cast<float>(points[3 * i + 2]), minElev, maxElev,
+                                     -9999.0f, v + 6);
+            v[9] = 1.0f;
         }
+    });
+
+    // Wind every face counter-clockwise from above (normal y > 0). The
+    // unnormalised face normal is kept, which weights it by area.
+    std::vector<QVector3D> faceNormals(triangleTotal);
+    std::atomic<int> badTriangle{-1};
+    forEachRange(triangleTotal, [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+            quint32 a = static_cast<quint32>(triangles[3 * t]);
+            quint32 b = static_cast<quint32>(triangles[3 * t + 1]);
+            quint32 c = static_cast<quint32>(triangles[3 * t + 2]);
+            if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+                badTriangle = t;
+                return;
+            }
+
+            QVector3D pa(vertices[a * stride], vertices[a * stride + 1], vertices[a * stride + 2]);
+            QVector3D pb(vertices[b * stride], vertices[b * stride + 1], vertices[b * stride + 2]);
+            QVector3D pc(vertices[c * stride], vertices[c * stride + 1], vertices[c * stride + 2]);
+            QVector3D normal = QVector3D::crossProduct(pb - pa, pc - pa);
+            if (normal.y() < 0.0f) {
+                std::swap(b, c);
+                normal = -normal;
+            }
+
+            indices[3 * t] = a;
+            indices[3 * t + 1] = b;
+            indices[3 * t + 2] = c;
+            faceNormals[t] = normal;
+        }
+    });
+    if (badTriangle >= 0) {
+        errorOut = QString("TIN triangle %1 references a missing vertex").arg(badTriangle.load());
+        return false;
+    }
+
+    // Vertex -> face adjacency, so each vertex gathers its own normal and
+    // vertices can be summed in parallel without atomics
+    std::vector<int> faceOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ++faceOffsets[indices[i] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        faceOffsets[v + 1] += faceOffsets[v];
+    }
+    std::vector<int> faces(indexCount);
+    std::vector<int> fill(faceOffsets.begin(), faceOffsets.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i) {
+        faces[fill[indices[i]]++] = static_cast<int>(i / 3);
     }
 
-    // Generate indices for triangle mesh
-    QVariantList indices;
-    for (int row = 0; row < height - 1; row++) {
-        for (int col = 0; col < width - 1; col++) {
-            int topLeft = row * width + col;
-            int topRight = topLeft + 1;
-            int bottomLeft = (row + 1) * width + col;
-            int bottomRight = bottomLeft + 1;
-
-            // First triangle
-            indices.append(topLeft);
-            indices.append(bottomLeft);
-            indices.append(topRight);
-
-            // Second triangle
-            indices.append(topRight);
-            indices.append(bottomLeft);
-            indices.append(bottomRight);
+    forEachRange(vertexTotal, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            QVector3D sum;
+            for (int f = faceOffsets[i]; f < faceOffsets[i + 1]; ++f) {
+                sum += faceNormals[faces[f]];
+            }
+            sum = sum.lengthSquared() > 0.0f ? sum.normalized() : QVector3D(0.0f, 1.0f, 0.0f);
+
+            float *n = vertices + static_cast<size_t>(i) * stride + 3;
+            n[0] = sum.x();
+            n[1] = sum.y();
+            n[2] = sum.z();
         }
+    });
+
+    mesh.vertexCount = static_cast<int>(vertexCount);
+    mesh.indexCount = static_cast<int>(indexCount);
+    mesh.minElev = minElev;
+    mesh.maxElev = maxElev;
+    mesh.originX = centerX;
+    mesh.originY = centerY;
+    mesh.verticalScale = verticalScale;
+    mesh.boundsMin = QVector3D(static_cast<float>(minX - centerX), minElev * scale,
+                               static_cast<float>(centerY - maxY));
+    mesh.boundsMax = QVector3D(static_cast<float>(maxX - centerX), maxElev * scale,
+                               static_cast<float>(centerY - minY));
+    if (scale < 0.0f) {
+        std::swap(mesh.boundsMin[1], mesh.boundsMax[1]);
     }
 
-    // Calculate proper normals
-    QVector<QVector3D> normalVectors(width * height, QVector3D(0, 0, 0));
+    qDebug() << "TIN mesh generated:" << vertexCount << "vertices," << indexCount / 3 << "triangles";
+
+    return true;
+}
 
-    for (int i = 0; i < indices.size(); i += 3) {
-        int i0 = indices[i].toInt();
-        int i1 = indices[i + 1].toInt();
-        int i2 = indices[i + 2].toInt();
+bool MeshExporter::buildChunks(const MeshBuffers &mesh,
+                               std::vector<MeshChunk> &chunks,
+                               QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::buildChunks");
+    chunks.clear();
+    if (!checkMesh(mesh, errorOut)) {
+        return false;
+    }
 
-        QVector3D v0(vertices[i0 * 3].toFloat(), vertices[i0 * 3 + 1].toFloat(), vertices[i0 * 3 + 2].toFloat());
-        QVector3D v1(vertices[i1 * 3].toFloat(), vertices[i1 * 3 + 1].toFloat(), vertices[i1 * 3 + 2].toFloat());
-        QVector3D v2(vertices[i2 * 3].toFloat(), vertices[i2 * 3 + 1].toFloat(), vertices[i2 * 3 + 2].toFloat());
+    const float *vertices = reinterpret_cast<const float *>(mesh.vertexData.constData());
+    const quint32 *indices = reinterpret_cast<const quint32 *>(mesh.indexData.constData());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+    int triangleCount = mesh.indexCount / 3;
 
-        QVector3D normal = QVector3D::crossProduct(v1 - v0, v2 - v0).normalized();
+    std::vector<int> order = MeshOptimizer::mortonOrder(vertices, stride, indices, triangleCount);
 
-        normalVectors[i0] += normal;
-        normalVectors[i1] += normal;
-        normalVectors[i2] += normal;
+    // Cut the curve greedily; a chunk closes when the next triangle's new
+    // vertices would not fit
+    std::vector<int> chunkStart{0};
+    std::vector<int> seenIn(mesh.vertexCount, -1);
+    int chunkVertices = 0;
+    for (int i = 0; i < triangleCount; ++i) {
+        const quint32 *tri = indices + 3 * order[i];
+        int chunk = static_cast<int>(chunkStart.size()) - 1;
+        int fresh = (seenIn[tri[0]] != chunk) + (seenIn[tri[1]] != chunk) + (seenIn[tri[2]] != chunk);
+        if (chunkVertices + fresh > MeshChunk::kMaxVertices) {
+            chunkStart.push_back(i);
+            chunkVertices = 0;
+            ++chunk;
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (seenIn[tri[k]] != chunk) {
+                seenIn[tri[k]] = chunk;
+                ++chunkVertices;
+            }
+        }
     }
+    chunkStart.push_back(triangleCount);
+
+    int chunkCount = static_cast<int>(chunkStart.size()) - 1;
+    chunks.resize(chunkCount);
+
+    VolumeKernel::runBlocks(chunkCount, [&](int c) {
+        TRACE_SCOPE("mesh", "optimise chunk");
+        int first = chunkStart[c];
+        int count = chunkStart[c + 1] - first;
+
+        // Local vertex numbering: sorted unique global indices
+        std::vector<quint32> globals;
+        globals.reserve(3 * count);
+        for (int i = first; i < first + count; ++i) {
+            const quint32 *tri = indices + 3 * order[i];
+            globals.insert(globals.end(), tri, tri + 3);
+        }
+        std::sort(globals.begin(), globals.end());
+        globals.erase(std::unique(globals.begin(), globals.end()), globals.end());
+        int localCount = static_cast<int>(globals.size());
+
+        std::vector<std::uint32_t> local(3 * count);
+        for (int i = 0; i < count; ++i) {
+            const quint32 *tri = indices + 3 * order[first + i];
+            for (int k = 0; k < 3; ++k) {
+                local[3 * i + k] = static_cast<std::uint32_t>(
+                    std::lower_bound(globals.begin(), globals.end(), tri[k]) - globals.begin());
+            }
+        }
 
-    // Normalize and write back
-    for (int i = 0; i < normalVectors.size(); i++) {
-        QVector3D n = normalVectors[i].normalized();
-        normals[i * 3] = n.x();
-        normals[i * 3 + 1] = n.y();
-        normals[i * 3 + 2] = n.z();
+        // Cache order, then renumber vertices in order of first use so
+        // vertex fetches walk the buffer forwards
+        std::vector<int> emitOrder = MeshOptimizer::tipsify(local.data(), count, localCount);
+        std::vector<int> renumbered(localCount, -1);
+        std::vector<quint32> sourceOf(localCount);
+        int next = 0;
+
+        MeshChunk &chunk = chunks[c];
+        chunk.indexData.resize(static_cast<qsizetype>(3 * count) * sizeof(quint16));
+        quint16 *out = reinterpret_cast<quint16 *>(chunk.indexData.data());
+        for (int t : emitOrder) {
+            for (int k = 0; k < 3; ++k) {
+                std::uint32_t v = local[3 * t + k];
+                if (renumbered[v] < 0) {
+                    renumbered[v] = next;
+                    sourceOf[next++] = globals[v];
+                }
+                *out++ = static_cast<quint16>(renumbered[v]);
+            }
+        }
+
+        QVector3D min(vertices[sourceOf[0] * stride], vertices[sourceOf[0] * stride + 1],
+                      vertices[sourceOf[0] * stride + 2]);
+        QVector3D max = min;
+        for (int i = 1; i < localCount; ++i) {
+            const float *v = vertices + static_cast<size_t>(sourceOf[i]) * stride;
+            for (int k = 0; k < 3; ++k) {
+                min[k] = std::min(min[k], v[k]);
+                max[k] = std::max(max[k], v[k]);
+            }
+        }
+
+        chunk.vertexData.fill(0, static_cast<qsizetype>(localCount) * MeshChunk::kStride);
+        char *packed = chunk.vertexData.data();
+        for (int i = 0; i < localCount; ++i, packed += MeshChunk::kStride) {
+            const float *v = vertices + static_cast<size_t>(sourceOf[i]) * stride;
+            quint16 q[3];
+            qint8 n[3];
+            quint8 rgba[4];
+            for (int k = 0; k < 3; ++k) {
+                float extent = max[k] - min[k];
+                q[k] = extent > 0.0f
+                    ? static_cast<quint16>(std::lround((v[k] - min[k]) / extent * 65535.0f))
+                    : 0;
+                n[k] = static_cast<qint8>(std::lround(std::clamp(v[3 + k], -1.0f, 1.0f) * 127.0f));
+            }
+            for (int k = 0; k < 4; ++k) {
+                rgba[k] = static_cast<quint8>(std::lround(std::clamp(v[6 + k], 0.0f, 1.0f) * 255.0f));
+            }
+            std::memcpy(packed + MeshChunk::kPositionOffset, q, sizeof(q));
+            std::memcpy(packed + MeshChunk::kNormalOffset, n, sizeof(n));
+            std::memcpy(packed + MeshChunk::kColorOffset, rgba, sizeof(rgba));
+        }
+
+        chunk.vertexCount = localCount;
+        chunk.indexCount = 3 * count;
+        chunk.boundsMin = min;
+        chunk.boundsMax = max;
+    });
+
+    qDebug() << "Mesh split into" << chunkCount << "chunks of up to" << MeshChunk::kMaxVertices << "vertices";
+
+    return true;
+}
+
+QVariantMap MeshExporter::generate3DMesh(const DTMRaster &raster,
+                                        double verticalScale,
+                                        QString &errorOut)
+{
+    MeshBuffers mesh;
+    if (!buildGridMesh(raster, verticalScale, mesh, errorOut)) {
+        return QVariantMap();
     }
 
-    result["vertices"] = vertices;
-    result["normals"] = normals;
-    result["colors"] = colors;
-    result["indices"] = indices;
-    result["vertexCount"] = width * height;
-    result["indexCount"] = indices.size();
-    result["minElev"] = minElev;
-    result["maxElev"] = maxElev;
-    result["width"] = width;
-    result["height"] = height;
+    QVariantMap result = meshToVariantMap(mesh);
+    result["width"] = raster.width;
+    result["height"] = raster.height;
 
-    qDebug() << "3D mesh generated:" << vertices.size() / 3 << "vertices," << indices.size() / 3 << "triangles";
+    return result;
+}
+
+QVariantMap MeshExporter::generateTINMesh(const TINProcessor *tinProcessor,
+                                          double verticalScale,
+                                          QString &errorOut)
+{
+    MeshBuffers mesh;
+    if (!buildTINMesh(tinProcessor, verticalScale, mesh, errorOut)) {
+        return QVariantMap();
+    }
 
+    return meshToVariantMap(mesh);
+}
+
+QVariantMap MeshExporter::meshToVariantMap(const MeshBuffers &mesh)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::meshToVariantMap");
+    QVariantMap result;
+    result["vertexData"] = mesh.vertexData;
+    result["indexData"] = mesh.indexData;
+    result["stride"] = MeshBuffers::kStride;
+    result["positionOffset"] = MeshBuffers::kPositionOffset;
+    result["normalOffset"] = MeshBuffers::kNormalOffset;
+    result["colorOffset"] = MeshBuffers::kColorOffset;
+    result["vertexCount"] = mesh.vertexCount;
+    result["indexCount"] = mesh.indexCount;
+    result["minElev"] = mesh.minElev;
+    result["maxElev"] = mesh.maxElev;
+    result["boundsMin"] = mesh.boundsMin;
+    result["boundsMax"] = mesh.boundsMax;
+    // The buffers are shared with the map, so the budget is held for as long as any copy of it is
+    result["reservation"] = QVariant::fromValue(mesh.reservation);
     return result;
 }
 
-bool MeshExporter::exportAsOBJ(const QVariantMap &dtmData,
+bool MeshExporter::exportAsOBJ(const DTMRaster &raster,
                               const QString &filePath,
                               double verticalScale,
                               QString &errorOut)
 {
-    if (dtmData.isEmpty() || dtmData["width"].toInt() == 0) {
+    TRACE_SCOPE("mesh", "MeshExporter::exportAsOBJ");
+    int width = raster.width;
+    int height = raster.height;
+    if (width < 2 || height < 2 || raster.values.size() != static_cast<size_t>(width) * height) {
         errorOut = "DTM data is empty or invalid";
         return false;
     }
+    if (static_cast<qint64>(width) * height > std::numeric_limits<int>::max()) {
+        errorOut = QString("DTM too large for OBJ export: %1 x %2").arg(width).arg(height);
+        return false;
+    }
 
-    int width = dtmData["width"].toInt();
-    int height = dtmData["height"].toInt();
-    QVariantList data = dtmData["data"].toList();
-    double minElev = dtmData["minElev"].toDouble();
-    double maxElev = dtmData["maxElev"].toDouble();
-    double pixelWidth = dtmData["pixelWidth"].toDouble();
-    double pixelHeight = qAbs(dtmData["pixelHeight"].toDouble());
+    const float *data = raster.values.data();
+    float minElev = raster.minElev;
+    float maxElev = raster.maxElev;
+    double pixelWidth = raster.geoTransform[1];
+    double pixelHeight = std::abs(raster.geoTransform[5]);
 
     qDebug() << "Exporting DTM as OBJ:" << width << "x" << height << "to" << filePath;
 
+    // Nodata cells are dropped, along with every quad that touches one
+    std::vector<int> remap;
+    std::vector<std::int64_t> quadOffsets;
+    qint64 vertexCount = GridMesh::compactVertices(data, width, height, -9999.0f, remap);
+    GridMesh::compactQuads(remap, width, height, quadOffsets);
+    qint64 triangleCount = quadOffsets.back() * 2;
+    if (triangleCount == 0) {
+        errorOut = "DTM has no valid cells to export";
+        return false;
+    }
+
     // Open output file
     QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::WriteOnly)) {
         errorOut = QString("Failed to open file for writing: %1").arg(filePath);
         return false;
     }
 
-    QTextStream out(&file);
+    OrderedWriter writer(file);
 
     // Write OBJ header
-    out << "# Wavefront OBJ file\n";
-    out << "# Generated by SiteSurveyor - DTM Export\n";
-    out << "# Vertices: " << (width * height) << "\n";
-    out << "# Elevation range: " << minElev << "m - " << maxElev << "m\n";
-    out << "# Vertical scale: " << verticalScale << "x\n\n";
+    QByteArray header;
+    header += "# Wavefront OBJ file\n";
+    header += "# Generated by SiteSurveyor - DTM Export\n";
+    header += "# Vertices: " + QByteArray::number(vertexCount) + "\n";
+    header += "# Elevation range: " + QByteArray::number(minElev) + "m - " + QByteArray::number(maxElev) + "m\n";
+    header += "# Vertical scale: " + QByteArray::number(verticalScale) + "x\n\n";
+    header += "# Vertices\n";
+    writer.write({header});
 
     // Center coordinates
     double centerX = width * pixelWidth / 2.0;
     double centerY = height * pixelHeight / 2.0;
 
-    // Write vertices
-    out << "# Vertices\n";
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            int idx = row * width + col;
-            float elev = data[idx].toFloat();
-
-            float x = (col * pixelWidth - centerX);
-            float z = -(row * pixelHeight - centerY);  // Negate for proper orientation
-            float y = (elev == -9999.0f ? minElev : elev) * verticalScale;
-
-            // Get color for this vertex
-            QVector3D color = getElevationColor(elev, minElev, maxElev);
-
-            // Write vertex with color (vx vy vz r g b)
-            out << "v " << QString::number(x, 'f', 3) << " "
-                << QString::number(y, 'f', 3) << " "
-                << QString::number(z, 'f', 3) << " "
-                << QString::number(color.x(), 'f', 3) << " "
-                << QString::number(color.y(), 'f', 3) << " "
-                << QString::number(color.z(), 'f', 3) << "\n";
+    // Vertices with colour (v x y z r g b)
+    bool written = writeChunked(writer, height, width, 1, kVertexLineBytes,
+                                [&](int row, int begin, int end, char *p) {
+        for (int col = begin; col < end; col++) {
+            size_t cell = static_cast<size_t>(row) * width + col;
+            if (remap[cell] < 0) continue;
+            float elev = data[cell];
+
+            float x = static_cast<float>(col * pixelWidth - centerX);
+            float z = static_cast<float>(-(row * pixelHeight - centerY));  // Negate for proper orientation
+            float y = static_cast<float>(elev * verticalScale);
+
+            float rgb[3];
+            GridMesh::elevationColor(elev, minElev, maxElev, -9999.0f, rgb);
+
+            *p++ = 'v';
+            for (float value : {x, y, z, rgb[0], rgb[1], rgb[2]}) {
+                *p++ = ' ';
+                p = appendFixed3(p, value);
+            }
+            *p++ = '\n';
         }
-    }
+        return p;
+    }, errorOut);
 
-    out << "\n# Faces\n";
+    writer.write({QByteArray("\n# Faces\n")});
 
-    // Write faces (triangles)
-    for (int row = 0; row < height - 1; row++) {
-        for (int col = 0; col < width - 1; col++) {
-            // OBJ indices are 1-based
-            int topLeft = row * width + col + 1;
-            int topRight = topLeft + 1;
-            int bottomLeft = (row + 1) * width + col + 1;
-            int bottomRight = bottomLeft + 1;
+    // Faces; OBJ indices are 1-based, counter-clockwise winding
+    written = written && writeChunked(writer, height - 1, width - 1, 2, kFaceLineBytes,
+                                      [&](int row, int begin, int end, char *p) {
+        const int *top = remap.data() + static_cast<size_t>(row) * width;
+        const int *bottom = top + width;
+        for (int col = begin; col < end; col++) {
+            if ((top[col] | top[col + 1] | bottom[col] | bottom[col + 1]) < 0) continue;
 
-            // First triangle (counter-clockwise winding)
-            out << "f " << topLeft << " " << bottomLeft << " " << topRight << "\n";
+            qint64 topLeft = top[col] + 1;
+            qint64 topRight = top[col + 1] + 1;
+            qint64 bottomLeft = bottom[col] + 1;
+            qint64 bottomRight = bottom[col + 1] + 1;
 
-            // Second triangle
-            out << "f " << topRight << " " << bottomLeft << " " << bottomRight << "\n";
+            p = appendFace(p, topLeft, bottomLeft, topRight);
+            p = appendFace(p, topRight, bottomLeft, bottomRight);
         }
-    }
+        return p;
+    }, errorOut);
 
+    bool finished = writer.finish();
+    if (!written || !finished) {
+        if (errorOut.isEmpty()) {
+            errorOut = QString("Failed to write OBJ file: %1").arg(file.errorString());
+        }
+        return false;
+    }
     file.close();
 
-    int triangleCount = (width - 1) * (height - 1) * 2;
-    qDebug() << "OBJ export successful:" << (width * height) << "vertices," << triangleCount << "triangles";
+    qDebug() << "OBJ export successful:" << vertexCount << "vertices,"
+             << triangleCount << "triangles";
     qDebug() << "File saved to:" << filePath;
 
     return true;
 }
+
+bool MeshExporter::exportAsGLB(const MeshBuffers &mesh, const QString &filePath, QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::exportAsGLB");
+    if (!checkMesh(mesh, errorOut)) {
+        return false;
+    }
+
+    qsizetype vertexBytes = mesh.vertexData.size();
+    qsizetype indexBytes = mesh.indexData.size();
+    if (vertexBytes + indexBytes > std::numeric_limits<quint32>::max() - (1 << 20)) {
+        errorOut = "Mesh too large for GLB (4 GiB limit)";
+        return false;
+    }
+
+    // Accessor bounds must be exact, so take them from the positions
+    float minPos[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                       std::numeric_limits<float>::max()};
+    float maxPos[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                       std::numeric_limits<float>::lowest()};
+    const float *vertices = reinterpret_cast<const float *>(mesh.vertexData.constData());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+    for (int i = 0; i < mesh.vertexCount; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            minPos[k] = std::min(minPos[k], vertices[i * stride + k]);
+            maxPos[k] = std::max(maxPos[k], vertices[i * stride + k]);
+        }
+    }
+
+    auto accessor = [&](int offset, const char *type) {
+        QJsonObject object;
+        object["bufferView"] = 0;
+        object["byteOffset"] = offset;
+        object["componentType"] = 5126;  // FLOAT
+        object["count"] = mesh.vertexCount;
+        object["type"] = type;
+        return object;
+    };
+
+    QJsonObject position = accessor(MeshBuffers::kPositionOffset, "VEC3");
+    position["min"] = QJsonArray{minPos[0], minPos[1], minPos[2]};
+    position["max"] = QJsonArray{maxPos[0], maxPos[1], maxPos[2]};
+
+    QJsonObject indexAccessor;
+    indexAccessor["bufferView"] = 1;
+    indexAccessor["componentType"] = 5125;  // UNSIGNED_INT
+    indexAccessor["count"] = mesh.indexCount;
+    indexAccessor["type"] = "SCALAR";
+
+    QJsonObject vertexView;
+    vertexView["buffer"] = 0;
+    vertexView["byteLength"] = static_cast<qint64>(vertexBytes);
+    vertexView["byteStride"] = MeshBuffers::kStride;
+    vertexView["target"] = 34962;  // ARRAY_BUFFER
+
+    QJsonObject indexView;
+    indexView["buffer"] = 0;
+    indexView["byteOffset"] = static_cast<qint64>(vertexBytes);
+    indexView["byteLength"] = static_cast<qint64>(indexBytes);
+    indexView["target"] = 34963;  // ELEMENT_ARRAY_BUFFER
+
+    QJsonObject attributes;
+    attributes["POSITION"] = 0;
+    attributes["NORMAL"] = 1;
+    attributes["COLOR_0"] = 2;
+
+    QJsonObject primitive;
+    primitive["attributes"] = attributes;
+    primitive["indices"] = 3;
+    primitive["mode"] = 4;  // TRIANGLES
+
+    QJsonObject extras;
+    extras["originX"] = mesh.originX;
+    extras["originY"] = mesh.originY;
+    extras["verticalScale"] = mesh.verticalScale;
+
+    QJsonObject node;
+    node["mesh"] = 0;
+    node["name"] = "Terrain";
+    node["extras"] = extras;
+
+    QJsonObject gltf;
+    gltf["asset"] = QJsonObject{{"version", "2.0"}, {"generator", "SiteSurveyor"}};
+    gltf["scene"] = 0;
+    gltf["scenes"] = QJsonArray{QJsonObject{{"nodes", QJsonArray{0}}}};
+    gltf["nodes"] = QJsonArray{node};
+    gltf["meshes"] = QJsonArray{QJsonObject{{"primitives", QJsonArray{primitive}}}};
+    gltf["accessors"] = QJsonArray{position,
+                                   accessor(MeshBuffers::kNormalOffset, "VEC3"),
+                                   accessor(MeshBuffers::kColorOffset, "VEC4"),
+                                   indexAccessor};
+    gltf["bufferViews"] = QJsonArray{vertexView, indexView};
+    gltf["buffers"] = QJsonArray{QJsonObject{{"byteLength", static_cast<qint64>(vertexBytes + indexBytes)}}};
+
+    // Chunks are 4-byte aligned; JSON is padded with spaces. The vertex and
+    // index buffers are already multiples of 4.
+    QByteArray json = QJsonDocument(gltf).toJson(QJsonDocument::Compact);
+    while (json.size() % 4 != 0) {
+        json.append(' ');
+    }
+
+    quint32 binLength = static_cast<quint32>(vertexBytes + indexBytes);
+    quint32 totalLength = static_cast<quint32>(12 + 8 + json.size() + 8 + binLength);
+
+    QByteArray header(12 + 8, Qt::Uninitialized);
+    char *p = header.data();
+    p = put<quint32>(p, 0x46546C67);  // "glTF"
+    p = put<quint32>(p, 2);
+    p = put<quint32>(p, totalLength);
+    p = put<quint32>(p, static_cast<quint32>(json.size()));
+    put<quint32>(p, 0x4E4F534A);      // "JSON"
+
+    QByteArray binHeader(8, Qt::Uninitialized);
+    p = binHeader.data();
+    p = put<quint32>(p, binLength);
+    put<quint32>(p, 0x004E4942);      // "BIN\0"
+
+    if (!writeBuffers(filePath, {header, json, binHeader, mesh.vertexData, mesh.indexData}, errorOut)) {
+        return false;
+    }
+
+    qDebug() << "GLB export successful:" << mesh.vertexCount << "vertices," << mesh.indexCount / 3
+             << "triangles to" << filePath;
+    return true;
+}
+
+bool MeshExporter::exportAsPLY(const MeshBuffers &mesh, const QString &filePath, QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::exportAsPLY");
+    if (!checkMesh(mesh, errorOut)) {
+        return false;
+    }
+
+    constexpr qsizetype kVertexRecord = 6 * sizeof(float) + 3;
+    constexpr qsizetype kFaceRecord = 1 + 3 * sizeof(qint32);
+    int faceCount = mesh.indexCount / 3;
+
+    QByteArray header;
+    header += "ply\n";
+    header += "format binary_little_endian 1.0\n";
+    header += "comment Generated by SiteSurveyor\n";
+    header += "comment originX " + QByteArray::number(mesh.originX, 'f', 3) + "\n";
+    header += "comment originY " + QByteArray::number(mesh.originY, 'f', 3) + "\n";
+    header += "comment verticalScale " + QByteArray::number(mesh.verticalScale) + "\n";
+    header += "element vertex " + QByteArray::number(mesh.vertexCount) + "\n";
+    header += "property float x\nproperty float y\nproperty float z\n";
+    header += "property float nx\nproperty float ny\nproperty float nz\n";
+    header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    header += "element face " + QByteArray::number(faceCount) + "\n";
+    header += "property list uchar int vertex_indices\n";
+    header += "end_header\n";
+
+    qsizetype bodySize = mesh.vertexCount * kVertexRecord + faceCount * kFaceRecord;
+    QByteArray body(bodySize, Qt::Uninitialized);
+    char *out = body.data();
+    const float *vertices = reinterpret_cast<const float *>(mesh.vertexData.constData());
+    const quint32 *indices = reinterpret_cast<const quint32 *>(mesh.indexData.constData());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+
+    forEachRange(mesh.vertexCount, [&](int begin, int end) {
+        char *p = out + begin * kVertexRecord;
+        for (int i = begin; i < end; ++i) {
+            const float *v = vertices + static_cast<size_t>(i) * stride;
+            float position[3];
+            float normal[3];
+            toZUp(v, position);
+            toZUp(v + 3, normal);
+            for (float value : position) p = put(p, value);
+            for (float value : normal) p = put(p, value);
+            for (int k = 6; k < 9; ++k) {
+                p = put(p, static_cast<quint8>(std::lround(std::clamp(v[k], 0.0f, 1.0f) * 255.0f)));
+            }
+        }
+    });
+
+    char *faces = out + mesh.vertexCount * kVertexRecord;
+    forEachRange(faceCount, [&](int begin, int end) {
+        char *p = faces + begin * kFaceRecord;
+        for (int f = begin; f < end; ++f) {
+            p = put<quint8>(p, 3);
+            for (int k = 0; k < 3; ++k) {
+                p = put(p, static_cast<qint32>(indices[3 * f + k]));
+            }
+        }
+    });
+
+    if (!writeBuffers(filePath, {header, body}, errorOut)) {
+        return false;
+    }
+
+    qDebug() << "PLY export successful:" << mesh.vertexCount << "vertices," << faceCount
+             << "faces to" << filePath;
+    return true;
+}
+
+bool MeshExporter::exportAsSTL(const MeshBuffers &mesh, const QString &filePath, QString &errorOut)
+{
+    TRACE_SCOPE("mesh", "MeshExporter::exportAsSTL");
+    if (!checkMesh(mesh, errorOut)) {
+        return false;
+    }
+
+    constexpr qsizetype kFacetRecord = 12 * sizeof(float) + sizeof(quint16);
+    int faceCount = mesh.indexCount / 3;
+
+    QByteArray body(84 + faceCount * kFacetRecord, Qt::Uninitialized);
+    char *out = body.data();
+
+    // 80-byte header that must not start with "solid"
+    QByteArray title = "SiteSurveyor terrain, origin " + QByteArray::number(mesh.originX, 'f', 3)
+                       + " " + QByteArray::number(mesh.originY, 'f', 3);
+    std::memset(out, 0, 80);
+    std::memcpy(out, title.constData(), std::min<qsizetype>(title.size(), 80));
+    put<quint32>(out + 80, static_cast<quint32>(faceCount));
+
+    const float *vertices = reinterpret_cast<const float *>(mesh.vertexData.constData());
+    const quint32 *indices = reinterpret_cast<const quint32 *>(mesh.indexData.constData());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+
+    forEachRange(faceCount, [&](int begin, int end) {
+        char *p = out + 84 + begin * kFacetRecord;
+        for (int f = begin; f < end; ++f) {
+            float corner[3][3];
+            for (int k = 0; k < 3; ++k) {
+                toZUp(vertices + static_cast<size_t>(indices[3 * f + k]) * stride, corner[k]);
+            }
+
+            QVector3D normal = QVector3D::crossProduct(
+                QVector3D(corner[1][0] - corner[0][0], corner[1][1] - corner[0][1], corner[1][2] - corner[0][2]),
+                QVector3D(corner[2][0] - corner[0][0], corner[2][1] - corner[0][1], corner[2][2] - corner[0][2]))
+                .normalized();
+
+            p = put(p, normal.x());
+            p = put(p, normal.y());
+            p = put(p, normal.z());
+            for (const float *c : corner) {
+                p = put(p, c[0]);
+                p = put(p, c[1]);
+                p = put(p, c[2]);
+            }
+            p = put<quint16>(p, 0);
+        }
+    });
+
+    if (!writeBuffers(filePath, {body}, errorOut)) {
+        return false;
+    }
+
+    qDebug() << "STL export successful:" << faceCount << "facets to" << filePath;
+    return true;
+}
+
+bool MeshExporter::exportMesh(const MeshBuffers &mesh, const QString &filePath,
+                              const QString &format, QString &errorOut)
+{
+    if (format.compare("glb", Qt::CaseInsensitive) == 0) {
+        return exportAsGLB(mesh, filePath, errorOut);
+    }
+    if (format.compare("ply", Qt::CaseInsensitive) == 0) {
+        return exportAsPLY(mesh, filePath, errorOut);
+    }
+    if (format.compare("stl", Qt::CaseInsensitive) == 0) {
+        return exportAsSTL(mesh, filePath, errorOut);
+    }
+
+    errorOut = QString("Unknown mesh format: %1").arg(format);
+    return false;
+}
@@ -1,17 +1,89 @@
 #ifndef MESHEXPORTER_H
 #define MESHEXPORTER_H
 
+#include "MemoryBudget.h"
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QVariantMap>
 #include <QVector3D>
+#include <memory>
+#include <vector>
+
+struct DTMRaster;
+class TINProcessor;
+
+/**
+ * @brief GPU-ready terrain mesh: interleaved float32 vertices and uint32 indices
+ *
+ * Each vertex is position (x, y, z), normal (x, y, z) and colour (r, g, b, a),
+ * all float32, so the buffers can be handed to QQuick3DGeometry as they are.
+ */
+struct MeshBuffers {
+    static constexpr int kStride = 10 * sizeof(float);
+    static constexpr int kPositionOffset = 0;
+    static constexpr int kNormalOffset = 3 * sizeof(float);
+    static constexpr int kColorOffset = 6 * sizeof(float);
+
+    QByteArray vertexData;
+    QByteArray indexData;
+    int vertexCount = 0;
+    int indexCount = 0;
+    QVector3D boundsMin;
+    QVector3D boundsMax;
+    float minElev = 0.0f;
+    float maxElev = 0.0f;
+
+    // World X/Y of the mesh origin; world X = originX + x, world Y = originY - z
+    double originX = 0.0;
+    double originY = 0.0;
+    double verticalScale = 1.0;
+
+    // Budget held for the buffers; shared by copies, like the buffers themselves
+    std::shared_ptr<MemoryBudget::Reservation> reservation;
+};
+
+/**
+ * @brief Compact mesh chunk with fewer than 65536 vertices and uint16 indices
+ *
+ * Vertex layout (16 bytes):
+ * - position: 3 x uint16 quantised over [boundsMin, boundsMax], then 2 bytes padding
+ * - normal: 3 x int8 (n * 127), then 1 byte padding
+ * - colour: 4 x uint8 (c * 255)
+ *
+ * Decoded position = boundsMin + q * (boundsMax - boundsMin) / 65535.
+ * Triangles are in vertex-cache order and vertices in order of first use.
+ */
+struct MeshChunk {
+    static constexpr int kStride = 16;
+    static constexpr int kPositionOffset = 0;
+    static constexpr int kNormalOffset = 8;
+    static constexpr int kColorOffset = 12;
+    static constexpr int kMaxVertices = 65535;
+
+    QByteArray vertexData;
+    QByteArray indexData;   // quint16
+    int vertexCount = 0;
+    int indexCount = 0;
+    QVector3D boundsMin;
+    QVector3D boundsMax;
+
+    /**
+     * @brief Decode to the interleaved float layout of MeshBuffers
+     * @param vertexData Receives vertexCount * MeshBuffers::kStride bytes
+     */
+    void decodeVertices(QByteArray &vertexData) const;
+};
 
 /**
  * @brief Handles 3D mesh generation and export from DTM data
  * 
  * Provides functionality for:
- * - Generating 3D mesh with vertices, normals, colors, indices
+ * - Generating 3D mesh with vertices, normals, colors, indices as binary buffers
+ *   for the DTM grid or the TIN
  * - Exporting DTM as Wavefront OBJ format
+ * - Exporting mesh buffers as binary glTF (GLB), binary PLY and binary STL
+ * - Splitting meshes into vertex-cache-ordered 16-bit chunks for the GPU
  * - Elevation-based color mapping
  */
 class MeshExporter : public QObject
@@ -19,34 +91,155 @@ class MeshExporter : public QObject
     Q_OBJECT
 
 public:
+    // Upper bound of buildGridMesh memory per raster cell: vertex, two
+    // triangles and the compaction table
+    static constexpr qint64 kGridBytesPerCell = MeshBuffers::kStride + 6 * sizeof(quint32) + sizeof(int);
+
     explicit MeshExporter(QObject *parent = nullptr);
     ~MeshExporter();
 
+    /**
+     * @brief Build interleaved vertex and index buffers for a DTM grid
+     *
+     * Nodata cells are compacted away: only valid cells become vertices and
+     * only quads with four valid corners become triangles, so irregular
+     * sites do not carry flat skirts over the unsurveyed area.
+     * Fails without allocating when the buffers would not fit the memory
+     * budget; DTMGenerator::readRasterWithinBudget with kGridBytesPerCell
+     * reads a raster that does.
+     * @param raster DTM values and geotransform
+     * @param verticalScale Vertical exaggeration factor
+     * @param mesh Receives the buffers and bounds
+     * @param errorOut Output parameter for error message
+     * @return true on success, false on failure
+     */
+    bool buildGridMesh(const DTMRaster &raster,
+                       double verticalScale,
+                       MeshBuffers &mesh,
+                       QString &errorOut);
+
+    /**
+     * @brief Build interleaved vertex and index buffers for a TIN
+     *
+     * Uses the grid mesh axes, centred on the TIN's bounding box. Normals are
+     * area-weighted averages of the adjacent faces, and every triangle is
+     * wound counter-clockwise seen from above like the grid mesh. Vertices
+     * and faces are processed in parallel; each vertex gathers its normal
+     * from a vertex-to-face table, so no two threads write the same vertex.
+     * @param tinProcessor TIN to convert
+     * @param verticalScale Vertical exaggeration factor
+     * @param mesh Receives the buffers and bounds
+     * @param errorOut Output parameter for error message
+     * @return true on success, false on failure
+     */
+    bool buildTINMesh(const TINProcessor *tinProcessor,
+                      double verticalScale,
+                      MeshBuffers &mesh,
+                      QString &errorOut);
+
+    /**
+     * @brief Split a mesh into compact 16-bit chunks
+     *
+     * Triangles are ordered along a Morton curve of their centroids and cut
+     * greedily into chunks of at most MeshChunk::kMaxVertices vertices, so
+     * each chunk is a compact patch. Each chunk is then reordered with
+     * Tipsify for post-transform cache reuse, and its positions are quantised
+     * to 16 bits within its own bounds. Chunks are finished in parallel.
+     * @param mesh Mesh to split
+     * @param chunks Receives the chunks
+     * @param errorOut Output parameter for error message
+     * @return true on success, false on failure
+     */
+    bool buildChunks(const MeshBuffers &mesh,
+                     std::vector<MeshChunk> &chunks,
+                     QString &errorOut);
+
     /**
      * @brief Generate 3D mesh from DTM data
-     * @param dtmData Map containing width, height, data, minElev, maxElev, pixel sizes
+     * @param raster DTM values and geotransform
+     * @param verticalScale Vertical exaggeration factor
+     * @param errorOut Output parameter for error message
+     * @return Map with vertexData and indexData (QByteArray, see MeshBuffers),
+     *         stride and attribute offsets, counts and elevation range, and the
+     *         buffers' MemoryBudget reservation ("reservation", opaque), which
+     *         is released with the last copy of the map
+     */
+    QVariantMap generate3DMesh(const DTMRaster &raster,
+                               double verticalScale,
+                               QString &errorOut);
+
+    /**
+     * @brief Generate 3D mesh from the TIN
+     * @param tinProcessor TIN to convert
      * @param verticalScale Vertical exaggeration factor
      * @param errorOut Output parameter for error message
-     * @return Map with vertices, normals, colors, indices arrays
+     * @return Map with the same buffers and fields as generate3DMesh, without
+     *         the grid width and height
      */
-    QVariantMap generate3DMesh(const QVariantMap &dtmData,
-                              double verticalScale,
-                              QString &errorOut);
+    QVariantMap generateTINMesh(const TINProcessor *tinProcessor,
+                                double verticalScale,
+                                QString &errorOut);
 
     /**
      * @brief Export DTM as Wavefront OBJ file
-     * @param dtmData Map containing DTM raster data
+     *
+     * Nodata cells are compacted away as in buildGridMesh.
+     * Vertex and face lines are formatted with std::to_chars into chunk
+     * buffers on the thread pool, a batch at a time. Each batch is appended
+     * in order by a single background writer thread while the next batch is
+     * formatted.
+     * @param raster DTM values and geotransform
      * @param filePath Output OBJ file path
      * @param verticalScale Vertical exaggeration factor
      * @param errorOut Output parameter for error message
      * @return true on success, false on failure
      */
-    bool exportAsOBJ(const QVariantMap &dtmData,
-                    const QString &filePath,
-                    double verticalScale,
-                    QString &errorOut);
+    bool exportAsOBJ(const DTMRaster &raster,
+                     const QString &filePath,
+                     double verticalScale,
+                     QString &errorOut);
+
+    /**
+     * @brief Export mesh buffers as binary glTF 2.0 (.glb)
+     *
+     * The BIN chunk is the interleaved vertex buffer followed by the index
+     * buffer, written as they are. POSITION, NORMAL and COLOR_0 (float RGBA)
+     * are accessors into the vertex buffer view. glTF is y-up, so the mesh
+     * axes are kept; the world origin is stored in the node's extras.
+     * @return true on success, false on failure
+     */
+    bool exportAsGLB(const MeshBuffers &mesh, const QString &filePath, QString &errorOut);
+
+    /**
+     * @brief Export mesh buffers as binary PLY
+     *
+     * Vertices carry position, normal and 8-bit colour; faces are uint8
+     * counts with int32 indices. Coordinates are z-up (x east, y north,
+     * z up) relative to the world origin recorded in the header comments.
+     * @return true on success, false on failure
+     */
+    bool exportAsPLY(const MeshBuffers &mesh, const QString &filePath, QString &errorOut);
+
+    /**
+     * @brief Export mesh buffers as binary STL
+     *
+     * Facet normals are computed from the triangle. Coordinates are z-up
+     * like exportAsPLY; STL has no colour or origin.
+     * @return true on success, false on failure
+     */
+    bool exportAsSTL(const MeshBuffers &mesh, const QString &filePath, QString &errorOut);
+
+    /**
+     * @brief Export mesh buffers in a binary format
+     * @param format "glb", "ply" or "stl" (case-insensitive)
+     * @return true on success, false on failure
+     */
+    bool exportMesh(const MeshBuffers &mesh, const QString &filePath,
+                    const QString &format, QString &errorOut);
 
 private:
+    static QVariantMap meshToVariantMap(const MeshBuffers &mesh);
+
     // Helper to calculate elevation-based color
     QVector3D getElevationColor(float elevation, float minElev, float maxElev);
 };
@@ -0,0 +1,171 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace MeshOptimizer {
+
+namespace {
+
+// Spread the low 16 bits of v over the even bits
+std::uint32_t spreadBits(std::uint32_t v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+} // namespace
+
+std::vector<int> mortonOrder(const float *positions, size_t positionStride,
+                             const std::uint32_t *indices, int triangleCount)
+{
+    std::vector<float> cx(triangleCount), cz(triangleCount);
+    float minX = 0.0f, maxX = 0.0f, minZ = 0.0f, maxZ = 0.0f;
+    for (int t = 0; t < triangleCount; ++t) {
+        float x = 0.0f, z = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            const float *p = positions + indices[3 * t + k] * positionStride;
+            x += p[0];
+            z += p[2];
+        }
+        cx[t] = x / 3.0f;
+        cz[t] = z / 3.0f;
+        if (t == 0) {
+            minX = maxX = cx[t];
+            minZ = maxZ = cz[t];
+        } else {
+            minX = std::min(minX, cx[t]);
+            maxX = std::max(maxX, cx[t]);
+            minZ = std::min(minZ, cz[t]);
+            maxZ = std::max(maxZ, cz[t]);
+        }
+    }
+
+    // One scale for both axes keeps the cells square
+    float extent = std::max(maxX - minX, maxZ - minZ);
+    float scale = extent > 0.0f ? 65535.0f / extent : 0.0f;
+
+    std::vector<std::uint32_t> codes(triangleCount);
+    for (int t = 0; t < triangleCount; ++t) {
+        auto qx = static_cast<std::uint32_t>((cx[t] - minX) * scale);
+        auto qz = static_cast<std::uint32_t>((cz[t] - minZ) * scale);
+        codes[t] = spreadBits(qx) | (spreadBits(qz) << 1);
+    }
+
+    std::vector<int> order(triangleCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+    return order;
+}
+
+std::vector<int> tipsify(const std::uint32_t *indices, int triangleCount, int vertexCount,
+                         int cacheSize)
+{
+    // Vertex -> triangle adjacency (CSR)
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int i = 0; i < 3 * triangleCount; ++i) {
+        ++offsets[indices[i] + 1];
+    }
+    for (int v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<int> adjacency(offsets[vertexCount]);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < 3 * triangleCount; ++i) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<int> live(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<int> deadEnd;
+    std::vector<int> candidates;
+    std::vector<int> order;
+    order.reserve(triangleCount);
+
+    int time = cacheSize + 1;
+    int cursor = 0;
+    while (cursor < vertexCount && live[cursor] == 0) {
+        ++cursor;
+    }
+    int fan = cursor < vertexCount ? cursor : -1;
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (int a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            int t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            order.push_back(t);
+            for (int k = 0; k < 3; ++k) {
+                int v = static_cast<int>(indices[3 * t + k]);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays longest in the cache while its
+        // remaining triangles are emitted
+        int best = -1;
+        int bestPriority = -1;
+        for (int v : candidates) {
+            if (live[v] <= 0) continue;
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        // Dead end: most recently referenced vertex with triangles left, else
+        // the next such vertex in input order
+        while (best < 0 && !deadEnd.empty()) {
+            int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) best = v;
+        }
+        while (best < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) best = cursor;
+            else ++cursor;
+        }
+        fan = best;
+    }
+
+    return order;
+}
+
+double averageCacheMissRatio(const std::uint32_t *indices, int triangleCount, int vertexCount,
+                             int cacheSize)
+{
+    if (triangleCount == 0) {
+        return 0.0;
+    }
+
+    // FIFO: a vertex is cached while fewer than cacheSize misses followed its own
+    std::vector<long long> missedAt(vertexCount, -(1LL << 40));
+    long long misses = 0;
+    for (int i = 0; i < 3 * triangleCount; ++i) {
+        std::uint32_t v = indices[i];
+        if (misses - missedAt[v] >= cacheSize) {
+            missedAt[v] = misses++;
+        }
+    }
+    return static_cast<double>(misses) / triangleCount;
+}
+
+} // namespace MeshOptimizer
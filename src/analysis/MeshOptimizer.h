@@ -0,0 +1,52 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Triangle ordering for GPU vertex reuse
+ *
+ * Meshes are split into chunks of spatially close triangles, and each chunk's
+ * triangles are reordered so that the vertices of consecutive triangles are
+ * still in the GPU's post-transform vertex cache.
+ */
+namespace MeshOptimizer {
+
+constexpr int kCacheSize = 16;
+
+/**
+ * @brief Triangle order along a Z-order (Morton) curve of the centroids
+ *
+ * Consecutive runs of the result are compact patches, so cutting it greedily
+ * gives chunks with tight bounds.
+ * @param positions Vertex positions, read as (x, ?, z) at positionStride floats apart
+ * @param indices Triangle list
+ * @return Triangle indices in curve order
+ */
+std::vector<int> mortonOrder(const float *positions, size_t positionStride,
+                             const std::uint32_t *indices, int triangleCount);
+
+/**
+ * @brief Tipsify vertex cache ordering (Sander, Nehab and Barczak 2007)
+ *
+ * Fans out around a current vertex, then moves to the most recently used
+ * vertex that still has triangles and will stay in the cache while they are
+ * emitted, or back along a dead-end stack. Runs in linear time.
+ * @param indices Triangle list with local vertex indices below vertexCount
+ * @param cacheSize Modelled FIFO cache size in vertices
+ * @return Triangle indices in emission order
+ */
+std::vector<int> tipsify(const std::uint32_t *indices, int triangleCount, int vertexCount,
+                         int cacheSize = kCacheSize);
+
+/**
+ * @brief Average cache misses per triangle for a FIFO cache (ACMR)
+ */
+double averageCacheMissRatio(const std::uint32_t *indices, int triangleCount, int vertexCount,
+                             int cacheSize = kCacheSize);
+
+} // namespace MeshOptimizer
+
+#endif // MESHOPTIMIZER_H
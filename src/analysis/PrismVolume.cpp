@@ -0,0 +1,446 @@
+#include "PrismVolume.h"
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace PrismVolume {
+
+void ClipBoundary::addRing(const std::vector<double> &xy, bool hole)
+{
+    Ring ring;
+    ring.xy = xy;
+    ring.hole = hole;
+
+    // Drop an explicit closing vertex; rings are implicitly closed
+    size_t n = ring.xy.size() / 2;
+    if (n > 1 && ring.xy[0] == ring.xy[2 * n - 2] && ring.xy[1] == ring.xy[2 * n - 1]) {
+        ring.xy.resize(2 * (n - 1));
+        --n;
+    }
+    if (n < 3) {
+        return;
+    }
+
+    double signedArea = 0.0;
+    ring.minX = ring.maxX = ring.xy[0];
+    ring.minY = ring.maxY = ring.xy[1];
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        signedArea += ring.xy[2 * j] * ring.xy[2 * i + 1] - ring.xy[2 * i] * ring.xy[2 * j + 1];
+        ring.minX = std::min(ring.minX, ring.xy[2 * i]);
+        ring.maxX = std::max(ring.maxX, ring.xy[2 * i]);
+        ring.minY = std::min(ring.minY, ring.xy[2 * i + 1]);
+        ring.maxY = std::max(ring.maxY, ring.xy[2 * i + 1]);
+    }
+    if (signedArea == 0.0) {
+        return;
+    }
+
+    ring.weight = (hole ? -1.0 : 1.0) * (signedArea > 0.0 ? 1.0 : -1.0);
+    m_rings.push_back(std::move(ring));
+}
+
+int ClipBoundary::coverage(double x, double y) const
+{
+    int total = 0;
+    for (const Ring &ring : m_rings) {
+        if (x < ring.minX || x > ring.maxX || y < ring.minY || y > ring.maxY) continue;
+
+        const std::vector<double> &r = ring.xy;
+        size_t n = r.size() / 2;
+        bool inside = false;
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            double yi = r[2 * i + 1], yj = r[2 * j + 1];
+            if ((yi > y) != (yj > y)) {
+                double xCross = r[2 * j] + (y - yj) * (r[2 * i] - r[2 * j]) / (yi - yj);
+                if (x < xCross) inside = !inside;
+            }
+        }
+        if (inside) {
+            total += ring.hole ? -1 : 1;
+        }
+    }
+    return total;
+}
+
+void Totals::merge(const Totals &other)
+{
+    cut.add(other.cut);
+    fill.add(other.fill);
+    area.add(other.area);
+}
+
+int clipRingToTriangle(const std::vector<double> &ring,
+                       const double x[3], const double y[3],
+                       std::vector<double> &out)
+{
+    // Sutherland-Hodgman against the three edges of the (convex) triangle, taken CCW
+    double cx[3] = {x[0], x[1], x[2]};
+    double cy[3] = {y[0], y[1], y[2]};
+    if ((x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]) < 0.0) {
+        std::swap(cx[1], cx[2]);
+        std::swap(cy[1], cy[2]);
+    }
+
+    out = ring;
+    std::vector<double> input;
+
+    for (int e = 0; e < 3 && !out.empty(); ++e) {
+        double ax = cx[e], ay = cy[e];
+        double bx = cx[(e + 1) % 3], by = cy[(e + 1) % 3];
+        auto side = [&](double px, double py) {
+            return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+        };
+
+        input.swap(out);
+        out.clear();
+
+        size_t n = input.size() / 2;
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            double px = input[2 * j], py = input[2 * j + 1];
+            double qx = input[2 * i], qy = input[2 * i + 1];
+            double sp = side(px, py);
+            double sq = side(qx, qy);
+
+            if ((sp >= 0.0) != (sq >= 0.0)) {
+                double t = sp / (sp - sq);
+                out.push_back(px + t * (qx - px));
+                out.push_back(py + t * (qy - py));
+            }
+            if (sq >= 0.0) {
+                out.push_back(qx);
+                out.push_back(qy);
+            }
+        }
+    }
+
+    return static_cast<int>(out.size() / 2);
+}
+
+namespace {
+
+// Cut and fill of a prism with planimetric area `area` and vertex heights d
+// above the base plane
+void splitPrism(double area, const double d[3], double &cut, double &fill)
+{
+    int positive = (d[0] > 0.0) + (d[1] > 0.0) + (d[2] > 0.0);
+    int negative = (d[0] < 0.0) + (d[1] < 0.0) + (d[2] < 0.0);
+    double net = area * (d[0] + d[1] + d[2]) / 3.0;
+
+    cut = 0.0;
+    fill = 0.0;
+
+    if (negative == 0) {
+        cut = net;
+    } else if (positive == 0) {
+        fill = -net;
+    } else {
+        // One vertex lies alone on its side of the base plane; the zero line cuts
+        // a similar sub-triangle off that corner
+        int k = (positive == 1) ? (d[0] > 0.0 ? 0 : (d[1] > 0.0 ? 1 : 2))
+                                : (d[0] < 0.0 ? 0 : (d[1] < 0.0 ? 1 : 2));
+        int i = (k + 1) % 3;
+        int j = (k + 2) % 3;
+        double ti = d[k] / (d[k] - d[i]);
+        double tj = d[k] / (d[k] - d[j]);
+        double corner = area * ti * tj * d[k] / 3.0;
+
+        if (d[k] > 0.0) {
+            cut = corner;
+            fill = corner - net;
+        } else {
+            fill = -corner;
+            cut = net - corner;
+        }
+    }
+}
+
+} // namespace
+
+void addTriangle(const double x[3], const double y[3], const double z[3],
+                 double baseElevation, double weight, Totals &totals)
+{
+    double area = std::abs((x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0])) / 2.0;
+    if (area == 0.0) {
+        return;
+    }
+
+    double d[3] = {z[0] - baseElevation, z[1] - baseElevation, z[2] - baseElevation};
+    double cut, fill;
+    splitPrism(area, d, cut, fill);
+
+    totals.cut.add(weight * cut);
+    totals.fill.add(weight * fill);
+    totals.area.add(weight * area);
+}
+
+Totals compute(const std::vector<double> &xyz,
+               const std::vector<int> &indices,
+               double baseElevation,
+               const ClipBoundary *boundary)
+{
+    Totals totals;
+
+    int vertexCount = static_cast<int>(xyz.size() / 3);
+    int triangleCount = static_cast<int>(indices.size() / 3);
+    int batchCount = (triangleCount + kBatchSize - 1) / kBatchSize;
+
+    std::vector<Totals> partials(batchCount);
+
+    VolumeKernel::runBlocks(batchCount, [&](int batch) {
+        Totals &partial = partials[batch];
+        int end = std::min(triangleCount, (batch + 1) * kBatchSize);
+
+        for (int t = batch * kBatchSize; t < end; ++t) {
+            double x[3], y[3], z[3];
+            bool ok = true;
+            for (int k = 0; k < 3; ++k) {
+                int v = indices[3 * t + k];
+                if (v < 0 || v >= vertexCount) {
+                    ok = false;
+                    break;
+                }
+                x[k] = xyz[3 * v];
+                y[k] = xyz[3 * v + 1];
+                z[k] = xyz[3 * v + 2];
+            }
+            if (!ok) continue;
+
+            forEachPiece(x, y, z, boundary,
+                         [&](const double *px, const double *py, const double *pz, double weight) {
+                addTriangle(px, py, pz, baseElevation, weight, partial);
+            });
+        }
+    });
+
+    for (const Totals &partial : partials) {
+        totals.merge(partial);
+    }
+
+    return totals;
+}
+
+LevelTable::LevelTable(const std::vector<double> &xyz,
+                       const std::vector<int> &indices,
+                       const ClipBoundary *boundary)
+{
+    int vertexCount = static_cast<int>(xyz.size() / 3);
+    int triangleCount = static_cast<int>(indices.size() / 3);
+    int batchCount = (triangleCount + kBatchSize - 1) / kBatchSize;
+
+    // Clip in parallel batches; concatenating in batch order keeps the table deterministic
+    std::vector<std::vector<Piece>> batchPieces(batchCount);
+
+    VolumeKernel::runBlocks(batchCount, [&](int batch) {
+        std::vector<Piece> &pieces = batchPieces[batch];
+        int end = std::min(triangleCount, (batch + 1) * kBatchSize);
+
+        for (int t = batch * kBatchSize; t < end; ++t) {
+            double x[3], y[3], z[3];
+            bool ok = true;
+            for (int k = 0; k < 3; ++k) {
+                int v = indices[3 * t + k];
+                if (v < 0 || v >= vertexCount) {
+                    ok = false;
+                    break;
+                }
+                x[k] = xyz[3 * v];
+                y[k] = xyz[3 * v + 1];
+                z[k] = xyz[3 * v + 2];
+            }
+            if (!ok) continue;
+
+            forEachPiece(x, y, z, boundary,
+                         [&](const double *px, const double *py, const double *pz, double weight) {
+                double area = std::abs((px[1] - px[0]) * (py[2] - py[0]) - (px[2] - px[0]) * (py[1] - py[0])) / 2.0;
+                if (area == 0.0) return;
+
+                Piece piece;
+                std::copy(pz, pz + 3, piece.z);
+                piece.area = weight * area;
+                piece.zMin = std::min(pz[0], std::min(pz[1], pz[2]));
+                piece.zMax = std::max(pz[0], std::max(pz[1], pz[2]));
+                pieces.push_back(piece);
+            });
+        }
+    });
+
+    for (std::vector<Piece> &pieces : batchPieces) {
+        m_pieces.insert(m_pieces.end(), pieces.begin(), pieces.end());
+    }
+
+    std::stable_sort(m_pieces.begin(), m_pieces.end(),
+                     [](const Piece &a, const Piece &b) { return a.zMin < b.zMin; });
+
+    std::vector<int> byMax(m_pieces.size());
+    for (size_t i = 0; i < byMax.size(); ++i) {
+        byMax[i] = static_cast<int>(i);
+    }
+    std::stable_sort(byMax.begin(), byMax.end(),
+                     [this](int a, int b) { return m_pieces[a].zMax < m_pieces[b].zMax; });
+
+    size_t n = m_pieces.size();
+    m_maxSorted.resize(n);
+    m_areaAbove.assign(n + 1, 0.0);
+    m_volumeAbove.assign(n + 1, 0.0);
+    m_areaBelow.assign(n + 1, 0.0);
+    m_volumeBelow.assign(n + 1, 0.0);
+
+    VolumeKernel::CompensatedSum area, volume;
+    for (size_t i = n; i-- > 0;) {
+        const Piece &piece = m_pieces[i];
+        area.add(piece.area);
+        volume.add(piece.area * (piece.z[0] + piece.z[1] + piece.z[2]) / 3.0);
+        m_areaAbove[i] = area.value();
+        m_volumeAbove[i] = volume.value();
+    }
+
+    m_leafCount = 1;
+    while (m_leafCount < n) {
+        m_leafCount *= 2;
+    }
+    m_maxTree.assign(2 * m_leafCount, -std::numeric_limits<double>::infinity());
+    for (size_t i = 0; i < n; ++i) {
+        m_maxTree[m_leafCount + i] = m_pieces[i].zMax;
+    }
+    for (size_t node = m_leafCount; node-- > 1;) {
+        m_maxTree[node] = std::max(m_maxTree[2 * node], m_maxTree[2 * node + 1]);
+    }
+
+    area = VolumeKernel::CompensatedSum();
+    volume = VolumeKernel::CompensatedSum();
+    for (size_t i = 0; i < n; ++i) {
+        const Piece &piece = m_pieces[byMax[i]];
+        m_maxSorted[i] = piece.zMax;
+        area.add(piece.area);
+        volume.add(piece.area * (piece.z[0] + piece.z[1] + piece.z[2]) / 3.0);
+        m_areaBelow[i + 1] = area.value();
+        m_volumeBelow[i + 1] = volume.value();
+    }
+}
+
+double LevelTable::minElevation() const
+{
+    return m_pieces.empty() ? 0.0 : m_pieces.front().zMin;
+}
+
+double LevelTable::maxElevation() const
+{
+    return m_maxSorted.empty() ? 0.0 : m_maxSorted.back();
+}
+
+Totals LevelTable::outside(double baseElevation, size_t &above) const
+{
+    Totals totals;
+    auto byMin = [](const Piece &piece, double h) { return piece.zMin < h; };
+
+    // Pieces with zMin >= h are all cut
+    above = std::lower_bound(m_pieces.begin(), m_pieces.end(), baseElevation, byMin) - m_pieces.begin();
+    totals.cut.add(m_volumeAbove[above] - baseElevation * m_areaAbove[above]);
+
+    // Pieces with zMax <= h are all fill
+    size_t below = std::upper_bound(m_maxSorted.begin(), m_maxSorted.end(), baseElevation) - m_maxSorted.begin();
+    totals.fill.add(baseElevation * m_areaBelow[below] - m_volumeBelow[below]);
+
+    totals.area.add(m_areaAbove[0]);
+    return totals;
+}
+
+void LevelTable::addStraddling(const Piece &piece, double baseElevation, Totals &totals) const
+{
+    double d[3] = {piece.z[0] - baseElevation, piece.z[1] - baseElevation, piece.z[2] - baseElevation};
+    double cut, fill;
+    splitPrism(std::abs(piece.area), d, cut, fill);
+    double weight = piece.area < 0.0 ? -1.0 : 1.0;
+    totals.cut.add(weight * cut);
+    totals.fill.add(weight * fill);
+}
+
+void LevelTable::collectStraddling(size_t node, size_t begin, size_t end, size_t above, double baseElevation,
+                                   std::vector<size_t> &out) const
+{
+    // Skip runs that start at or above h or that lie wholly at or below it
+    if (begin >= above || m_maxTree[node] <= baseElevation) {
+        return;
+    }
+    if (end - begin == 1) {
+        out.push_back(begin);
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    collectStraddling(2 * node, begin, mid, above, baseElevation, out);
+    collectStraddling(2 * node + 1, mid, end, above, baseElevation, out);
+}
+
+Totals LevelTable::at(double baseElevation) const
+{
+    if (m_pieces.empty()) {
+        return Totals();
+    }
+
+    size_t above = 0;
+    Totals totals = outside(baseElevation, above);
+
+    std::vector<size_t> straddling;
+    collectStraddling(1, 0, m_leafCount, above, baseElevation, straddling);
+    for (size_t i : straddling) {
+        addStraddling(m_pieces[i], baseElevation, totals);
+    }
+
+    return totals;
+}
+
+std::vector<Totals> LevelTable::atLevels(const std::vector<double> &levels) const
+{
+    std::vector<Totals> results(levels.size());
+    if (m_pieces.empty() || levels.empty()) {
+        return results;
+    }
+
+    std::vector<size_t> order(levels.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levels[a] < levels[b]; });
+
+    // Each worker sweeps a contiguous run of ascending levels. Its active set
+    // holds the pieces with zMin < h < zMax: pieces join as h passes their
+    // zMin and leave once h reaches their zMax.
+    int workers = std::max(1, std::min(static_cast<int>(order.size()),
+                                       QThreadPool::globalInstance()->maxThreadCount()));
+    VolumeKernel::runBlocks(workers, [&](int worker) {
+        size_t first = order.size() * worker / workers;
+        size_t last = order.size() * (worker + 1) / workers;
+        if (first == last) return;
+
+        double start = levels[order[first]];
+        size_t next = 0;
+        Totals seed = outside(start, next);
+        std::vector<size_t> active;
+        collectStraddling(1, 0, m_leafCount, next, start, active);
+
+        for (size_t k = first; k < last; ++k) {
+            double h = levels[order[k]];
+            size_t above = next;
+            Totals totals = k == first ? seed : outside(h, above);
+
+            for (; next < above; ++next) {
+                active.push_back(next);
+            }
+
+            size_t kept = 0;
+            for (size_t i : active) {
+                const Piece &piece = m_pieces[i];
+                if (piece.zMax <= h) continue;
+                addStraddling(piece, h, totals);
+                active[kept++] = i;
+            }
+            active.resize(kept);
+
+            results[order[k]] = totals;
+        }
+    });
+    return results;
+}
+
+} // namespace PrismVolume
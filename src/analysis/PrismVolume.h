@@ -0,0 +1,234 @@
+#ifndef PRISMVOLUME_H
+#define PRISMVOLUME_H
+
+#include "VolumeKernel.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Exact TIN prism volumes with base-plane splitting and boundary clipping
+ *
+ * Each triangle is a planar facet. Its prism against the base plane is split
+ * at the zero crossing of z - base, so one triangle can contribute to both cut
+ * and fill. Triangles crossing the boundary are clipped to it exactly; no
+ * centroid test is used. Triangles are processed in fixed-size batches on the
+ * thread pool and batch partials are folded in order, so totals are identical
+ * for any thread count.
+ */
+namespace PrismVolume {
+
+constexpr int kBatchSize = 4096;
+
+/**
+ * @brief Clip region made of closed rings in world coordinates
+ *
+ * Outer rings add area and hole rings subtract it. Orientation of the input
+ * rings does not matter.
+ */
+class ClipBoundary
+{
+public:
+    /**
+     * @param xy Ring vertices as interleaved x, y pairs (closing vertex optional)
+     * @param hole true if the ring is a hole of a preceding outer ring
+     */
+    void addRing(const std::vector<double> &xy, bool hole);
+
+    bool isEmpty() const { return m_rings.empty(); }
+
+    struct Ring {
+        std::vector<double> xy;
+        double weight;  // +1 outer / -1 hole, times the ring orientation sign
+        bool hole;
+        double minX, minY, maxX, maxY;
+    };
+
+    const std::vector<Ring> &rings() const { return m_rings; }
+
+    /**
+     * @brief Net ring coverage at a point (1 inside the region, 0 outside)
+     */
+    int coverage(double x, double y) const;
+
+private:
+    std::vector<Ring> m_rings;
+};
+
+/**
+ * @brief Cut/fill totals in volume units and planimetric area
+ */
+struct Totals {
+    VolumeKernel::CompensatedSum cut;
+    VolumeKernel::CompensatedSum fill;
+    VolumeKernel::CompensatedSum area;
+
+    void merge(const Totals &other);
+};
+
+/**
+ * @brief Visit the pieces of a triangle that lie inside a boundary
+ *
+ * Calls sink(x, y, z, weight) for each signed sub-triangle. The weighted sum
+ * of any integral over the pieces equals that integral over the part of the
+ * triangle inside the boundary. Pieces keep the facet's plane, so z is
+ * interpolated exactly. With no boundary the triangle itself is emitted with
+ * weight 1.
+ */
+template <typename Sink>
+void forEachPiece(const double x[3], const double y[3], const double z[3],
+                  const ClipBoundary *boundary, Sink &&sink);
+
+/**
+ * @brief Exact cut/fill of one planar triangle against a base elevation
+ * @param weight Signed multiplicity of the piece (see forEachPiece)
+ */
+void addTriangle(const double x[3], const double y[3], const double z[3],
+                 double baseElevation, double weight, Totals &totals);
+
+/**
+ * @brief Compute cut/fill for a packed TIN in parallel triangle batches
+ * @param xyz Packed vertices [x0, y0, z0, ...]
+ * @param indices Packed triangle indices [i0, i1, i2, ...]
+ * @param baseElevation Reference elevation
+ * @param boundary Optional clip boundary (nullptr = whole TIN)
+ */
+Totals compute(const std::vector<double> &xyz,
+               const std::vector<int> &indices,
+               double baseElevation,
+               const ClipBoundary *boundary);
+
+/**
+ * @brief Clipped TIN pieces sorted by elevation, for cut/fill at many base levels
+ *
+ * Clipping is done once. For a base level h, pieces entirely above h add
+ * V - h * A to cut and pieces entirely below add h * A - V to fill. Both come
+ * from prefix sums over the pieces sorted by lowest and by highest vertex.
+ * Only the pieces straddling h are split exactly. A single level finds them
+ * through a tree of the largest zMax over runs of pieces in zMin order; many
+ * levels are swept in ascending order with a running set of straddling
+ * pieces. Either way a level costs the pieces that straddle it, not a pass
+ * over the whole TIN or over everything within the tallest piece's span.
+ */
+class LevelTable
+{
+public:
+    /**
+     * @param xyz Packed vertices [x0, y0, z0, ...]
+     * @param indices Packed triangle indices [i0, i1, i2, ...]
+     * @param boundary Optional clip boundary (nullptr = whole TIN)
+     */
+    LevelTable(const std::vector<double> &xyz,
+               const std::vector<int> &indices,
+               const ClipBoundary *boundary);
+
+    bool isEmpty() const { return m_pieces.empty(); }
+    double minElevation() const;
+    double maxElevation() const;
+
+    /**
+     * @brief Exact cut/fill against one base elevation
+     */
+    Totals at(double baseElevation) const;
+
+    /**
+     * @brief Exact cut/fill for each base elevation, in input order
+     */
+    std::vector<Totals> atLevels(const std::vector<double> &levels) const;
+
+private:
+    struct Piece {
+        double z[3];
+        double area;   // planimetric area times the piece weight
+        double zMin;
+        double zMax;
+    };
+
+    // Cut/fill of the pieces entirely above or below h; sets the first piece with zMin >= h
+    Totals outside(double baseElevation, size_t &above) const;
+    void addStraddling(const Piece &piece, double baseElevation, Totals &totals) const;
+    void collectStraddling(size_t node, size_t begin, size_t end, size_t above, double baseElevation,
+                           std::vector<size_t> &out) const;
+
+    std::vector<Piece> m_pieces;        // sorted by zMin
+    std::vector<double> m_maxSorted;    // zMax in ascending order
+    std::vector<double> m_areaAbove;    // suffix sums of area in zMin order
+    std::vector<double> m_volumeAbove;  // suffix sums of area * mean z in zMin order
+    std::vector<double> m_areaBelow;    // prefix sums of area in zMax order
+    std::vector<double> m_volumeBelow;  // prefix sums of area * mean z in zMax order
+    std::vector<double> m_maxTree;      // implicit tree of the largest zMax over runs of m_pieces
+    size_t m_leafCount = 0;             // leaves in m_maxTree, a power of two >= m_pieces.size()
+};
+
+// Implementation detail of forEachPiece
+int clipRingToTriangle(const std::vector<double> &ring,
+                       const double x[3], const double y[3],
+                       std::vector<double> &out);
+
+template <typename Sink>
+void forEachPiece(const double x[3], const double y[3], const double z[3],
+                  const ClipBoundary *boundary, Sink &&sink)
+{
+    if (!boundary) {
+        sink(x, y, z, 1.0);
+        return;
+    }
+
+    double minX = std::min(x[0], std::min(x[1], x[2]));
+    double maxX = std::max(x[0], std::max(x[1], x[2]));
+    double minY = std::min(y[0], std::min(y[1], y[2]));
+    double maxY = std::max(y[0], std::max(y[1], y[2]));
+
+    // Plane of the facet, used to lift clipped vertices back to 3D
+    double det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (det == 0.0) {
+        return;
+    }
+    double a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / det;
+    double b = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / det;
+
+    bool touched = false;
+    for (const ClipBoundary::Ring &ring : boundary->rings()) {
+        if (ring.maxX < minX || ring.minX > maxX || ring.maxY < minY || ring.minY > maxY) continue;
+        const std::vector<double> &r = ring.xy;
+        size_t n = r.size() / 2;
+        for (size_t i = 0, j = n - 1; i < n && !touched; j = i++) {
+            double ex0 = std::min(r[2 * i], r[2 * j]), ex1 = std::max(r[2 * i], r[2 * j]);
+            double ey0 = std::min(r[2 * i + 1], r[2 * j + 1]), ey1 = std::max(r[2 * i + 1], r[2 * j + 1]);
+            touched = !(ex1 < minX || ex0 > maxX || ey1 < minY || ey0 > maxY);
+        }
+        if (touched) break;
+    }
+
+    if (!touched) {
+        // No boundary edge comes near the triangle: it is entirely in or out
+        double cx = (x[0] + x[1] + x[2]) / 3.0;
+        double cy = (y[0] + y[1] + y[2]) / 3.0;
+        if (boundary->coverage(cx, cy) > 0) {
+            sink(x, y, z, 1.0);
+        }
+        return;
+    }
+
+    std::vector<double> clipped;
+    for (const ClipBoundary::Ring &ring : boundary->rings()) {
+        if (ring.maxX < minX || ring.minX > maxX || ring.maxY < minY || ring.minY > maxY) continue;
+        int count = clipRingToTriangle(ring.xy, x, y, clipped);
+
+        // Signed fan: piece orientation times ring weight gives the net coverage
+        for (int i = 1; i + 1 < count; ++i) {
+            double px[3] = {clipped[0], clipped[2 * i], clipped[2 * i + 2]};
+            double py[3] = {clipped[1], clipped[2 * i + 1], clipped[2 * i + 3]};
+            double cross = (px[1] - px[0]) * (py[2] - py[0]) - (px[2] - px[0]) * (py[1] - py[0]);
+            if (cross == 0.0) continue;
+            double pz[3];
+            for (int k = 0; k < 3; ++k) {
+                pz[k] = z[0] + a * (px[k] - x[0]) + b * (py[k] - y[0]);
+            }
+            sink(px, py, pz, cross > 0.0 ? ring.weight : -ring.weight);
+        }
+    }
+}
+
+} // namespace PrismVolume
+
+#endif // PRISMVOLUME_H
@@ -0,0 +1,87 @@
+#include "RasterStripReader.h"
+#include "VolumeKernel.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+RasterStripReader::RasterStripReader(GDALRasterBandH band, size_t maxStripBytes)
+    : m_band(band)
+    , m_width(band ? GDALGetRasterBandXSize(band) : 0)
+    , m_height(band ? GDALGetRasterBandYSize(band) : 0)
+    , m_stripRows(VolumeKernel::kBlockRows)
+    , m_nextRow(0)
+    , m_slot(0)
+    , m_error(band == nullptr)
+    , m_bufferRow{0, 0}
+{
+    if (m_width > 0 && m_height > 0) {
+        // Whole kernel blocks per strip, as many as fit the byte budget
+        size_t rowBytes = sizeof(float) * static_cast<size_t>(m_width);
+        int budgetRows = static_cast<int>(std::min<size_t>(maxStripBytes / rowBytes, m_height));
+        m_stripRows = std::max(VolumeKernel::kBlockRows,
+                               budgetRows / VolumeKernel::kBlockRows * VolumeKernel::kBlockRows);
+
+        size_t stripCells = static_cast<size_t>(m_width) * std::min(m_stripRows, m_height);
+        m_buffers[0].resize(stripCells);
+        if (m_stripRows < m_height) {
+            m_buffers[1].resize(stripCells);
+        }
+    }
+
+    // One dedicated reader thread: GDAL handles must not be used concurrently
+    m_ioPool.setMaxThreadCount(1);
+}
+
+RasterStripReader::~RasterStripReader()
+{
+    if (m_pending.isValid()) {
+        m_pending.waitForFinished();
+    }
+}
+
+void RasterStripReader::startRead(int slot, int firstRow)
+{
+    int rows = std::min(m_stripRows, m_height - firstRow);
+    m_bufferRow[slot] = firstRow;
+    float *buffer = m_buffers[slot].data();
+
+    m_pending = QtConcurrent::run(&m_ioPool, [this, buffer, firstRow, rows]() {
+        return GDALRasterIO(m_band, GF_Read, 0, firstRow, m_width, rows,
+                            buffer, m_width, rows, GDT_Float32, 0, 0) == CE_None;
+    });
+}
+
+bool RasterStripReader::next(Strip &strip)
+{
+    if (m_error) {
+        return false;
+    }
+
+    if (!m_pending.isValid()) {
+        if (m_nextRow >= m_height) {
+            return false;
+        }
+        startRead(m_slot, m_nextRow);
+        m_nextRow += m_stripRows;
+    }
+
+    bool ok = m_pending.result();
+    m_pending = QFuture<bool>();
+    if (!ok) {
+        m_error = true;
+        return false;
+    }
+
+    int slot = m_slot;
+    strip.data = m_buffers[slot].data();
+    strip.firstRow = m_bufferRow[slot];
+    strip.rows = std::min(m_stripRows, m_height - strip.firstRow);
+
+    // Prefetch into the other buffer while the caller consumes this one
+    m_slot = 1 - slot;
+    if (m_nextRow < m_height) {
+        startRead(m_slot, m_nextRow);
+        m_nextRow += m_stripRows;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef RASTERSTRIPREADER_H
+#define RASTERSTRIPREADER_H
+
+#include <gdal.h>
+#include <QFuture>
+#include <QThreadPool>
+#include <vector>
+
+/**
+ * @brief Streams a raster band as horizontal strips of float rows
+ *
+ * Keeps two strip buffers: while the caller works on the current strip, the
+ * next one is read on a dedicated background thread. Memory use is bounded by
+ * two strips regardless of raster size. Strip heights are a multiple of
+ * VolumeKernel::kBlockRows so block-based kernels see the same partitioning as
+ * a whole-raster read.
+ */
+class RasterStripReader
+{
+public:
+    struct Strip {
+        const float *data = nullptr;
+        int firstRow = 0;
+        int rows = 0;
+    };
+
+    static constexpr size_t kDefaultStripBytes = 32u * 1024u * 1024u;
+
+    /**
+     * @param band Band to read; must stay open for the reader's lifetime
+     * @param maxStripBytes Upper bound for one strip buffer
+     */
+    explicit RasterStripReader(GDALRasterBandH band, size_t maxStripBytes = kDefaultStripBytes);
+    ~RasterStripReader();
+
+    RasterStripReader(const RasterStripReader&) = delete;
+    RasterStripReader& operator=(const RasterStripReader&) = delete;
+
+    /**
+     * @brief Advance to the next strip and start prefetching the one after it
+     * @param strip Receives the strip; valid until the next call
+     * @return false at end of raster or on read error (see hasError())
+     */
+    bool next(Strip &strip);
+
+    bool hasError() const { return m_error; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int stripRows() const { return m_stripRows; }
+
+private:
+    void startRead(int slot, int firstRow);
+
+    GDALRasterBandH m_band;
+    int m_width;
+    int m_height;
+    int m_stripRows;
+    int m_nextRow;
+    int m_slot;
+    bool m_error;
+
+    std::vector<float> m_buffers[2];
+    int m_bufferRow[2];
+    QFuture<bool> m_pending;
+    QThreadPool m_ioPool;
+};
+
+#endif // RASTERSTRIPREADER_H
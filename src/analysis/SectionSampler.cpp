@@ -0,0 +1,467 @@
+#include "SectionSampler.h"
+#include "SurfaceSampling.h"
+#include "TINProcessor.h"
+#include "GDALHelpers.h"
+#include "MemoryBudget.h"
+#include "VolumeKernel.h"
+#include <gdal_priv.h>
+#include <QDebug>
+#include <QPointF>
+#include <algorithm>
+#include <cmath>
+
+using namespace GDALHelpers;
+using SurfaceSampling::Station;
+
+namespace {
+
+// Stations per parallel task; sections are independent so any split is exact
+constexpr int kStationsPerTask = 16;
+
+// Largest DTM window read for one run of stations once the whole window is over budget
+constexpr qint64 kStripBytes = 16ll * 1024 * 1024;
+
+// Cells of the DTM that a set of sample positions reads
+struct CellWindow {
+    double minCol = INFINITY;
+    double maxCol = -INFINITY;
+    double minRow = INFINITY;
+    double maxRow = -INFINITY;
+
+    void extend(const VolumeKernel::GridTransform &transform, double x, double y)
+    {
+        double col, row;
+        transform.toCell(x, y, col, row);
+        minCol = std::min(minCol, col);
+        maxCol = std::max(maxCol, col);
+        minRow = std::min(minRow, row);
+        maxRow = std::max(maxRow, row);
+    }
+
+    void extend(const CellWindow &other)
+    {
+        minCol = std::min(minCol, other.minCol);
+        maxCol = std::max(maxCol, other.maxCol);
+        minRow = std::min(minRow, other.minRow);
+        maxRow = std::max(maxRow, other.maxRow);
+    }
+};
+
+// A CellWindow clipped to the grid, with the extra cells bilinear samples read
+struct RasterWindow {
+    int col = 0;
+    int row = 0;
+    int width = 0;
+    int height = 0;
+
+    RasterWindow(const CellWindow &cells, int gridWidth, int gridHeight)
+    {
+        if (!(cells.minCol <= cells.maxCol && cells.minRow <= cells.maxRow)) {
+            return;
+        }
+        double col0 = std::max(0.0, std::floor(cells.minCol) - 1.0);
+        double row0 = std::max(0.0, std::floor(cells.minRow) - 1.0);
+        double col1 = std::min(static_cast<double>(gridWidth), std::ceil(cells.maxCol) + 2.0);
+        double row1 = std::min(static_cast<double>(gridHeight), std::ceil(cells.maxRow) + 2.0);
+        if (col0 < col1 && row0 < row1) {
+            col = static_cast<int>(col0);
+            row = static_cast<int>(row0);
+            width = static_cast<int>(col1 - col0);
+            height = static_cast<int>(row1 - row0);
+        }
+    }
+
+    bool isEmpty() const { return width <= 0 || height <= 0; }
+    qint64 bytes() const { return static_cast<qint64>(width) * height * sizeof(float); }
+};
+
+bool readWindow(GDALRasterBandH band, const RasterWindow &window, std::vector<float> &values, QString &errorOut)
+{
+    values.resize(static_cast<size_t>(window.width) * window.height);
+    if (window.isEmpty()) {
+        return true;
+    }
+    if (GDALRasterIO(band, GF_Read, window.col, window.row, window.width, window.height,
+                     values.data(), window.width, window.height, GDT_Float32, 0, 0) != CE_None) {
+        errorOut = "Failed to read DTM raster data";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read the DTM in strips for items [0, count): consecutive items are grouped
+ * while their window stays under kStripBytes, and each group's window is
+ * reserved, read and handed to sample(begin, end, surface) in turn.
+ */
+template <typename WindowFn, typename SampleFn>
+bool sampleStrips(int count, GDALRasterBandH band, const double gt[6], int gridWidth, int gridHeight,
+                  WindowFn windowOf, SampleFn sample, QString &errorOut)
+{
+    int begin = 0;
+    while (begin < count) {
+        CellWindow cells = windowOf(begin);
+        int end = begin + 1;
+        for (; end < count; ++end) {
+            CellWindow grown = cells;
+            grown.extend(windowOf(end));
+            if (RasterWindow(grown, gridWidth, gridHeight).bytes() > kStripBytes) {
+                break;
+            }
+            cells = grown;
+        }
+
+        RasterWindow window(cells, gridWidth, gridHeight);
+        MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(window.bytes());
+        if (!reservation) {
+            errorOut = QString("DTM strip %1 x %2 for section sampling does not fit the memory budget (%3 free)")
+                           .arg(window.width).arg(window.height)
+                           .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+            return false;
+        }
+        std::vector<float> values;
+        if (!readWindow(band, window, values, errorOut)) {
+            return false;
+        }
+        sample(begin, end, SurfaceSampling::RasterSurface(std::move(values), gt, window.col, window.row,
+                                                          window.width, window.height));
+        begin = end;
+    }
+    return true;
+}
+
+QList<double> toList(const std::vector<double> &values)
+{
+    return QList<double>(values.begin(), values.end());
+}
+
+QList<double> toList(const std::vector<float> &values)
+{
+    QList<double> list;
+    list.reserve(static_cast<qsizetype>(values.size()));
+    for (float value : values) {
+        list.append(value);
+    }
+    return list;
+}
+
+} // namespace
+
+SectionSampler::SectionSampler(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SectionSampler::~SectionSampler() = default;
+
+std::vector<double> SectionSampler::alignmentCoordinates(const QVariantList &alignment)
+{
+    std::vector<double> xy;
+    xy.reserve(alignment.size() * 2);
+    for (const QVariant &v : alignment) {
+        if (v.typeId() == QMetaType::QVariantMap) {
+            QVariantMap pt = v.toMap();
+            xy.push_back(pt["x"].toDouble());
+            xy.push_back(pt["y"].toDouble());
+        } else {
+            QPointF pt = v.toPointF();
+            xy.push_back(pt.x());
+            xy.push_back(pt.y());
+        }
+    }
+    return xy;
+}
+
+SectionSampler::Layout SectionSampler::layout(const std::vector<double> &alignment, double interval,
+                                              double offsetWidth, double sampleSpacing, double fromChainage)
+{
+    Layout result;
+    result.stations = SurfaceSampling::stationsAlong(alignment, interval);
+    result.profile = SurfaceSampling::stationsAlong(alignment, sampleSpacing);
+    result.offsets = SurfaceSampling::sectionOffsets(offsetWidth, sampleSpacing);
+
+    if (fromChainage > 0.0) {
+        auto before = [](const Station &station, double chainage) { return station.chainage < chainage; };
+        auto first = std::lower_bound(result.stations.begin(), result.stations.end(), fromChainage, before);
+        result.firstStation = static_cast<int>(first - result.stations.begin());
+        result.stations.erase(result.stations.begin(), first);
+        result.profile.erase(result.profile.begin(),
+                             std::lower_bound(result.profile.begin(), result.profile.end(), fromChainage, before));
+    }
+    return result;
+}
+
+template <typename Surface>
+void SectionSampler::sampleStations(const Surface &surface, const Layout &layout, int begin, int end,
+                                    Samples &samples)
+{
+    const std::vector<double> &offsets = layout.offsets;
+    int sampleCount = static_cast<int>(offsets.size());
+
+    int tasks = (end - begin + kStationsPerTask - 1) / kStationsPerTask;
+    VolumeKernel::runBlocks(tasks, [&](int task) {
+        int taskEnd = std::min(end, begin + (task + 1) * kStationsPerTask);
+        for (int s = begin + task * kStationsPerTask; s < taskEnd; ++s) {
+            const Station &station = layout.stations[s];
+            float *row = samples.sections.data() + static_cast<size_t>(s) * sampleCount;
+            for (int k = 0; k < sampleCount; ++k) {
+                row[k] = surface.elevationAt(station.x + offsets[k] * station.normalX,
+                                             station.y + offsets[k] * station.normalY);
+            }
+        }
+    });
+}
+
+template <typename Surface>
+void SectionSampler::sampleProfile(const Surface &surface, const Layout &layout, int begin, int end,
+                                   Samples &samples)
+{
+    constexpr int kProfilePerTask = 1024;
+    int tasks = (end - begin + kProfilePerTask - 1) / kProfilePerTask;
+    VolumeKernel::runBlocks(tasks, [&](int task) {
+        int taskEnd = std::min(end, begin + (task + 1) * kProfilePerTask);
+        for (int p = begin + task * kProfilePerTask; p < taskEnd; ++p) {
+            samples.profile[p] = surface.elevationAt(layout.profile[p].x, layout.profile[p].y);
+        }
+    });
+}
+
+template <typename Surface>
+QVariantMap SectionSampler::sampleSurface(const Surface &surface, const Layout &layout, double baseElevation)
+{
+    int stationCount = static_cast<int>(layout.stations.size());
+    int profileCount = static_cast<int>(layout.profile.size());
+
+    Samples samples;
+    samples.sections.resize(static_cast<size_t>(stationCount) * layout.offsets.size());
+    samples.profile.resize(profileCount);
+    sampleStations(surface, layout, 0, stationCount, samples);
+    sampleProfile(surface, layout, 0, profileCount, samples);
+    return sectionResult(layout, samples, baseElevation);
+}
+
+QVariantMap SectionSampler::sectionResult(const Layout &layout, const Samples &samples, double baseElevation)
+{
+    const std::vector<Station> &stations = layout.stations;
+    const std::vector<Station> &profile = layout.profile;
+    const std::vector<double> &offsets = layout.offsets;
+
+    int stationCount = static_cast<int>(stations.size());
+    int sampleCount = static_cast<int>(offsets.size());
+
+    std::vector<double> cutAreas(stationCount);
+    std::vector<double> fillAreas(stationCount);
+
+    int sectionTasks = (stationCount + kStationsPerTask - 1) / kStationsPerTask;
+    VolumeKernel::runBlocks(sectionTasks, [&](int task) {
+        int end = std::min(stationCount, (task + 1) * kStationsPerTask);
+        for (int s = task * kStationsPerTask; s < end; ++s) {
+            const float *row = samples.sections.data() + static_cast<size_t>(s) * sampleCount;
+            SurfaceSampling::sectionAreas(offsets.data(), row, sampleCount, baseElevation,
+                                          cutAreas[s], fillAreas[s]);
+        }
+    });
+
+    // Average end areas between consecutive sections
+    std::vector<double> cutVolumes;
+    std::vector<double> fillVolumes;
+    VolumeKernel::CompensatedSum totalCut;
+    VolumeKernel::CompensatedSum totalFill;
+    for (int s = 0; s + 1 < stationCount; ++s) {
+        double length = stations[s + 1].chainage - stations[s].chainage;
+        cutVolumes.push_back(0.5 * (cutAreas[s] + cutAreas[s + 1]) * length);
+        fillVolumes.push_back(0.5 * (fillAreas[s] + fillAreas[s + 1]) * length);
+        totalCut.add(cutVolumes.back());
+        totalFill.add(fillVolumes.back());
+    }
+
+    std::vector<double> chainages, stationX, stationY, profileChainages;
+    for (const Station &station : stations) {
+        chainages.push_back(station.chainage);
+        stationX.push_back(station.x);
+        stationY.push_back(station.y);
+    }
+    for (const Station &point : profile) {
+        profileChainages.push_back(point.chainage);
+    }
+
+    QVariantMap result;
+    result["firstStation"] = layout.firstStation;
+    result["stationCount"] = stationCount;
+    result["samplesPerSection"] = sampleCount;
+    result["chainages"] = QVariant::fromValue(toList(chainages));
+    result["stationX"] = QVariant::fromValue(toList(stationX));
+    result["stationY"] = QVariant::fromValue(toList(stationY));
+    result["offsets"] = QVariant::fromValue(toList(offsets));
+    result["sectionElevations"] = QVariant::fromValue(toList(samples.sections));
+    result["profileChainages"] = QVariant::fromValue(toList(profileChainages));
+    result["profileElevations"] = QVariant::fromValue(toList(samples.profile));
+    result["cutAreas"] = QVariant::fromValue(toList(cutAreas));
+    result["fillAreas"] = QVariant::fromValue(toList(fillAreas));
+    result["cutVolumes"] = QVariant::fromValue(toList(cutVolumes));
+    result["fillVolumes"] = QVariant::fromValue(toList(fillVolumes));
+    result["totalCut"] = totalCut.value();
+    result["totalFill"] = totalFill.value();
+    result["net"] = totalCut.value() - totalFill.value();
+    result["nodata"] = static_cast<double>(VolumeKernel::kNoData);
+    return result;
+}
+
+QVariantMap SectionSampler::sampleGrid(const QString &dtmPath,
+                                       const QVariantList &alignment,
+                                       double interval,
+                                       double offsetWidth,
+                                       double sampleSpacing,
+                                       double baseElevation,
+                                       QString &errorOut,
+                                       double fromChainage)
+{
+    QVariantMap result;
+
+    std::vector<double> xy = alignmentCoordinates(alignment);
+    if (xy.size() < 4 || interval <= 0.0 || offsetWidth < 0.0) {
+        errorOut = "Sections need an alignment of at least two points and a positive interval";
+        return result;
+    }
+
+    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
+    if (!dataset) {
+        errorOut = QString("Failed to open DTM for section sampling: %1").arg(dtmPath);
+        return result;
+    }
+
+    GDALRasterBandH band = GDALGetRasterBand(dataset.get(), 1);
+    double gt[6];
+    if (!band || GDALGetGeoTransform(dataset.get(), gt) != CE_None) {
+        errorOut = "Failed to read DTM band or geotransform";
+        return result;
+    }
+    int width = GDALGetRasterBandXSize(band);
+    int height = GDALGetRasterBandYSize(band);
+
+    if (sampleSpacing <= 0.0) {
+        sampleSpacing = std::min(std::hypot(gt[1], gt[4]), std::hypot(gt[2], gt[5]));
+    }
+
+    // Only the window covering the sampled sections and long section is read
+    VolumeKernel::GridTransform transform(gt);
+    if (!transform.isValid()) {
+        errorOut = "DTM geotransform is not invertible";
+        return result;
+    }
+
+    Layout plan = layout(xy, interval, offsetWidth, sampleSpacing, fromChainage);
+    auto stationWindow = [&](int s) {
+        const Station &station = plan.stations[s];
+        double dx = plan.offsets.back() * station.normalX;
+        double dy = plan.offsets.back() * station.normalY;
+        CellWindow cells;
+        cells.extend(transform, station.x - dx, station.y - dy);
+        cells.extend(transform, station.x + dx, station.y + dy);
+        return cells;
+    };
+    auto profileWindow = [&](int p) {
+        CellWindow cells;
+        cells.extend(transform, plan.profile[p].x, plan.profile[p].y);
+        return cells;
+    };
+
+    int stationCount = static_cast<int>(plan.stations.size());
+    int profileCount = static_cast<int>(plan.profile.size());
+    CellWindow cells;
+    for (int s = 0; s < stationCount; ++s) {
+        cells.extend(stationWindow(s));
+    }
+    for (int p = 0; p < profileCount; ++p) {
+        cells.extend(profileWindow(p));
+    }
+    if (plan.stations.empty() && plan.profile.empty()) {
+        result = sampleSurface(SurfaceSampling::RasterSurface({}, gt, 0, 0, 0, 0), plan, baseElevation);
+        result["method"] = "grid";
+        return result;
+    }
+
+    RasterWindow window(cells, width, height);
+    if (window.isEmpty()) {
+        errorOut = "Alignment does not overlap the DTM";
+        return result;
+    }
+
+    // The window covering all sections is read in one go when the budget
+    // allows; otherwise runs of stations and long-section points are read
+    // strip by strip, which gives the same samples
+    MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(window.bytes());
+    if (reservation) {
+        std::vector<float> values;
+        if (!readWindow(band, window, values, errorOut)) {
+            return result;
+        }
+
+        qDebug() << "Sampling sections on DTM window" << window.width << "x" << window.height
+                 << "interval" << interval << "width" << offsetWidth << "spacing" << sampleSpacing;
+
+        SurfaceSampling::RasterSurface surface(std::move(values), gt, window.col, window.row,
+                                               window.width, window.height);
+        result = sampleSurface(surface, plan, baseElevation);
+        result["method"] = "grid";
+        return result;
+    }
+
+    qDebug() << "DTM window" << window.width << "x" << window.height << "is over the memory budget;"
+             << "sampling sections in strips";
+
+    Samples samples;
+    samples.sections.resize(static_cast<size_t>(stationCount) * plan.offsets.size());
+    samples.profile.resize(profileCount);
+    bool ok = sampleStrips(stationCount, band, gt, width, height, stationWindow,
+                           [&](int begin, int end, const SurfaceSampling::RasterSurface &surface) {
+        sampleStations(surface, plan, begin, end, samples);
+    }, errorOut);
+    ok = ok && sampleStrips(profileCount, band, gt, width, height, profileWindow,
+                            [&](int begin, int end, const SurfaceSampling::RasterSurface &surface) {
+        sampleProfile(surface, plan, begin, end, samples);
+    }, errorOut);
+    if (!ok) {
+        return result;
+    }
+
+    result = sectionResult(plan, samples, baseElevation);
+    result["method"] = "grid";
+    return result;
+}
+
+QVariantMap SectionSampler::sampleTIN(TINProcessor *tinProcessor,
+                                      const QVariantList &alignment,
+                                      double interval,
+                                      double offsetWidth,
+                                      double sampleSpacing,
+                                      double baseElevation,
+                                      QString &errorOut,
+                                      double fromChainage)
+{
+    QVariantMap result;
+
+    std::vector<double> xy = alignmentCoordinates(alignment);
+    if (xy.size() < 4 || interval <= 0.0 || offsetWidth < 0.0) {
+        errorOut = "Sections need an alignment of at least two points and a positive interval";
+        return result;
+    }
+
+    if (!tinProcessor || !tinProcessor->hasData()) {
+        errorOut = "TIN not generated. Call generateTIN first.";
+        return result;
+    }
+
+    if (sampleSpacing <= 0.0) {
+        sampleSpacing = interval / 10.0;
+    }
+
+    qDebug() << "Sampling sections on TIN, interval" << interval << "width" << offsetWidth
+             << "spacing" << sampleSpacing;
+
+    SurfaceSampling::TINSurface surface(tinProcessor->packedVertices(), tinProcessor->packedTriangles());
+    result = sampleSurface(surface, layout(xy, interval, offsetWidth, sampleSpacing, fromChainage),
+                           baseElevation);
+    result["method"] = "TIN";
+    return result;
+}
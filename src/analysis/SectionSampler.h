@@ -0,0 +1,116 @@
+#ifndef SECTIONSAMPLER_H
+#define SECTIONSAMPLER_H
+
+#include "SurfaceSampling.h"
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <vector>
+
+class TINProcessor;
+
+/**
+ * @brief Long sections and cross sections along an alignment
+ *
+ * Provides functionality for:
+ * - Stations every chainage interval along a drawn polyline
+ * - Cross sections of +/- offset width at each station, sampled in parallel
+ * - A long section along the alignment itself
+ * - Bilinear sampling of the DTM raster or linear interpolation on the TIN
+ * - End-area cut/fill volumes between consecutive sections
+ *
+ * Results are packed arrays (QList<double>) rather than lists of maps, so long
+ * alignments stay cheap to hand to QML.
+ */
+class SectionSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SectionSampler(QObject *parent = nullptr);
+    ~SectionSampler();
+
+    /**
+     * @brief Sample sections on a DTM raster
+     * @param dtmPath Path to DTM raster file
+     * @param alignment Polyline points (maps with x, y keys)
+     * @param interval Chainage spacing between cross sections
+     * @param offsetWidth Half-width of each cross section (left and right of the alignment)
+     * @param sampleSpacing Spacing of samples across sections and along the long section
+     *        (0 = one DTM cell)
+     * @param baseElevation Formation level for end-area cut/fill
+     * @param errorOut Output parameter for error message
+     * @param fromChainage Only sample stations at or after this chainage (for re-sampling
+     *        the edited tail of an alignment); firstStation in the result gives their index
+     * @return Map of packed section arrays (see sampleSurface)
+     */
+    QVariantMap sampleGrid(const QString &dtmPath,
+                           const QVariantList &alignment,
+                           double interval,
+                           double offsetWidth,
+                           double sampleSpacing,
+                           double baseElevation,
+                           QString &errorOut,
+                           double fromChainage = 0.0);
+
+    /**
+     * @brief Sample sections on the TIN
+     * @param tinProcessor TIN processor with generated triangulation
+     * @param sampleSpacing Sample spacing (0 = interval / 10)
+     * @see sampleGrid
+     */
+    QVariantMap sampleTIN(TINProcessor *tinProcessor,
+                          const QVariantList &alignment,
+                          double interval,
+                          double offsetWidth,
+                          double sampleSpacing,
+                          double baseElevation,
+                          QString &errorOut,
+                          double fromChainage = 0.0);
+
+    // Helper to flatten alignment points into x, y pairs
+    static std::vector<double> alignmentCoordinates(const QVariantList &alignment);
+
+private:
+    // Stations, long-section points and offsets to sample
+    struct Layout {
+        std::vector<SurfaceSampling::Station> stations;
+        std::vector<SurfaceSampling::Station> profile;
+        std::vector<double> offsets;
+        int firstStation = 0;
+    };
+
+    static Layout layout(const std::vector<double> &alignment, double interval, double offsetWidth,
+                         double sampleSpacing, double fromChainage);
+
+    // Elevations across every section (station-major) and along the long section
+    struct Samples {
+        std::vector<float> sections;
+        std::vector<float> profile;
+    };
+
+    // Fill the sections of stations [begin, end) or the long-section points [begin, end)
+    template <typename Surface>
+    static void sampleStations(const Surface &surface, const Layout &layout, int begin, int end,
+                               Samples &samples);
+    template <typename Surface>
+    static void sampleProfile(const Surface &surface, const Layout &layout, int begin, int end,
+                              Samples &samples);
+
+    /**
+     * @brief Sample all stations on any surface with elevationAt(x, y)
+     * @return Map with method, firstStation, stationCount, samplesPerSection, chainages,
+     *         stationX, stationY, offsets, sectionElevations (station-major),
+     *         profileChainages, profileElevations, cutAreas, fillAreas,
+     *         cutVolumes, fillVolumes (between consecutive stations),
+     *         totalCut, totalFill, net
+     */
+    template <typename Surface>
+    static QVariantMap sampleSurface(const Surface &surface, const Layout &layout, double baseElevation);
+
+    // End-area cut/fill and the packed result map of sampleSurface from sampled elevations
+    static QVariantMap sectionResult(const Layout &layout, const Samples &samples, double baseElevation);
+};
+
+#endif // SECTIONSAMPLER_H
@@ -0,0 +1,244 @@
+#include "SurfaceSampling.h"
+#include "VolumeKernel.h"
+#include <algorithm>
+#include <cmath>
+
+using VolumeKernel::kNoData;
+
+namespace SurfaceSampling {
+
+RasterSurface::RasterSurface(std::vector<float> values, const double geoTransform[6],
+                             int windowCol, int windowRow, int windowWidth, int windowHeight)
+    : m_values(std::move(values))
+    , m_transform(geoTransform)
+    , m_col(windowCol)
+    , m_row(windowRow)
+    , m_width(windowWidth)
+    , m_height(windowHeight)
+{
+    if (!m_transform.isValid()) {
+        m_width = m_height = 0;
+    }
+}
+
+float RasterSurface::elevationAt(double x, double y) const
+{
+    if (m_width <= 0 || m_height <= 0) {
+        return kNoData;
+    }
+
+    double u, v;
+    m_transform.toCell(x, y, u, v);
+    u -= m_col;
+    v -= m_row;
+
+    // Half a cell of clamping at the window edge keeps the outer cells usable
+    if (u < -0.5 || v < -0.5 || u > m_width - 0.5 || v > m_height - 0.5) {
+        return kNoData;
+    }
+    u = std::clamp(u, 0.0, static_cast<double>(m_width - 1));
+    v = std::clamp(v, 0.0, static_cast<double>(m_height - 1));
+
+    int c0 = std::min(static_cast<int>(u), std::max(0, m_width - 2));
+    int r0 = std::min(static_cast<int>(v), std::max(0, m_height - 2));
+    int c1 = std::min(c0 + 1, m_width - 1);
+    int r1 = std::min(r0 + 1, m_height - 1);
+    double fx = u - c0;
+    double fy = v - r0;
+
+    const float z00 = m_values[static_cast<size_t>(r0) * m_width + c0];
+    const float z10 = m_values[static_cast<size_t>(r0) * m_width + c1];
+    const float z01 = m_values[static_cast<size_t>(r1) * m_width + c0];
+    const float z11 = m_values[static_cast<size_t>(r1) * m_width + c1];
+
+    double w00 = (1.0 - fx) * (1.0 - fy);
+    double w10 = fx * (1.0 - fy);
+    double w01 = (1.0 - fx) * fy;
+    double w11 = fx * fy;
+    if ((w00 > 0.0 && z00 == kNoData) || (w10 > 0.0 && z10 == kNoData)
+        || (w01 > 0.0 && z01 == kNoData) || (w11 > 0.0 && z11 == kNoData)) {
+        return kNoData;
+    }
+
+    double z = 0.0;
+    if (w00 > 0.0) z += w00 * z00;
+    if (w10 > 0.0) z += w10 * z10;
+    if (w01 > 0.0) z += w01 * z01;
+    if (w11 > 0.0) z += w11 * z11;
+    return static_cast<float>(z);
+}
+
+TINSurface::TINSurface(const std::vector<double> &xyz, const std::vector<int> &indices)
+    : m_xyz(xyz)
+    , m_indices(indices)
+{
+    size_t vertexCount = m_xyz.size() / 3;
+    size_t triangleCount = m_indices.size() / 3;
+    if (vertexCount < 3 || triangleCount == 0) {
+        return;
+    }
+
+    double maxX = m_xyz[0], maxY = m_xyz[1];
+    m_minX = m_xyz[0];
+    m_minY = m_xyz[1];
+    for (size_t v = 1; v < vertexCount; ++v) {
+        m_minX = std::min(m_minX, m_xyz[3 * v]);
+        m_minY = std::min(m_minY, m_xyz[3 * v + 1]);
+        maxX = std::max(maxX, m_xyz[3 * v]);
+        maxY = std::max(maxY, m_xyz[3 * v + 1]);
+    }
+
+    // About one triangle per bucket on average
+    double area = std::max((maxX - m_minX) * (maxY - m_minY), 1e-12);
+    m_cellSize = std::max(std::sqrt(area / static_cast<double>(triangleCount)), 1e-9);
+    m_columns = std::max(1, static_cast<int>((maxX - m_minX) / m_cellSize) + 1);
+    m_rows = std::max(1, static_cast<int>((maxY - m_minY) / m_cellSize) + 1);
+    m_buckets.resize(static_cast<size_t>(m_columns) * m_rows);
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        double tMinX = INFINITY, tMinY = INFINITY, tMaxX = -INFINITY, tMaxY = -INFINITY;
+        bool ok = true;
+        for (int k = 0; k < 3; ++k) {
+            int v = m_indices[3 * t + k];
+            if (v < 0 || static_cast<size_t>(v) >= vertexCount) {
+                ok = false;
+                break;
+            }
+            tMinX = std::min(tMinX, m_xyz[3 * v]);
+            tMaxX = std::max(tMaxX, m_xyz[3 * v]);
+            tMinY = std::min(tMinY, m_xyz[3 * v + 1]);
+            tMaxY = std::max(tMaxY, m_xyz[3 * v + 1]);
+        }
+        if (!ok) continue;
+
+        int c0 = static_cast<int>((tMinX - m_minX) / m_cellSize);
+        int c1 = std::min(m_columns - 1, static_cast<int>((tMaxX - m_minX) / m_cellSize));
+        int r0 = static_cast<int>((tMinY - m_minY) / m_cellSize);
+        int r1 = std::min(m_rows - 1, static_cast<int>((tMaxY - m_minY) / m_cellSize));
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                m_buckets[static_cast<size_t>(r) * m_columns + c].push_back(static_cast<int>(t));
+            }
+        }
+    }
+}
+
+float TINSurface::elevationAt(double x, double y) const
+{
+    if (m_buckets.empty()) {
+        return kNoData;
+    }
+
+    double fc = (x - m_minX) / m_cellSize;
+    double fr = (y - m_minY) / m_cellSize;
+    if (fc < 0.0 || fr < 0.0 || fc >= m_columns || fr >= m_rows) {
+        return kNoData;
+    }
+
+    const std::vector<int> &bucket = m_buckets[static_cast<size_t>(fr) * m_columns + static_cast<size_t>(fc)];
+    for (int t : bucket) {
+        const double *a = &m_xyz[3 * m_indices[3 * t]];
+        const double *b = &m_xyz[3 * m_indices[3 * t + 1]];
+        const double *c = &m_xyz[3 * m_indices[3 * t + 2]];
+
+        double det = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+        if (det == 0.0) continue;
+
+        double l1 = ((x - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (y - a[1])) / det;
+        double l2 = ((b[0] - a[0]) * (y - a[1]) - (x - a[0]) * (b[1] - a[1])) / det;
+        double l0 = 1.0 - l1 - l2;
+
+        // Small tolerance so points on shared edges are not lost to rounding
+        constexpr double kEdgeTolerance = -1e-9;
+        if (l0 >= kEdgeTolerance && l1 >= kEdgeTolerance && l2 >= kEdgeTolerance) {
+            return static_cast<float>(l0 * a[2] + l1 * b[2] + l2 * c[2]);
+        }
+    }
+
+    return kNoData;
+}
+
+std::vector<Station> stationsAlong(const std::vector<double> &xy, double interval)
+{
+    std::vector<Station> stations;
+    size_t n = xy.size() / 2;
+    if (n < 2 || interval <= 0.0) {
+        return stations;
+    }
+
+    double segmentStart = 0.0;
+    double next = 0.0;
+
+    for (size_t i = 0; i + 1 < n; ++i) {
+        double dx = xy[2 * i + 2] - xy[2 * i];
+        double dy = xy[2 * i + 3] - xy[2 * i + 1];
+        double length = std::hypot(dx, dy);
+        if (length == 0.0) continue;
+
+        double ux = dx / length;
+        double uy = dy / length;
+        double segmentEnd = segmentStart + length;
+        bool lastSegment = (i + 2 == n);
+
+        // On the last segment, stop short of the end so rounding cannot add a
+        // second station a hair before the closing one
+        double stop = lastSegment ? segmentEnd - 1e-9 * interval : segmentEnd;
+        while (next < stop) {
+            double t = next - segmentStart;
+            stations.push_back({next, xy[2 * i] + ux * t, xy[2 * i + 1] + uy * t, uy, -ux});
+            next = interval * static_cast<double>(stations.size());
+        }
+
+        if (lastSegment) {
+            stations.push_back({segmentEnd, xy[2 * i + 2], xy[2 * i + 3], uy, -ux});
+        }
+
+        segmentStart = segmentEnd;
+    }
+
+    return stations;
+}
+
+std::vector<double> sectionOffsets(double halfWidth, double spacing)
+{
+    if (halfWidth <= 0.0 || spacing <= 0.0) {
+        return {0.0};
+    }
+
+    int perSide = std::max(1, static_cast<int>(std::ceil(halfWidth / spacing)));
+    std::vector<double> offsets(2 * perSide + 1);
+    for (int i = 0; i <= 2 * perSide; ++i) {
+        offsets[i] = halfWidth * static_cast<double>(i - perSide) / perSide;
+    }
+    return offsets;
+}
+
+void sectionAreas(const double *offsets, const float *elevations, int count,
+                  double baseElevation, double &cutArea, double &fillArea)
+{
+    cutArea = 0.0;
+    fillArea = 0.0;
+
+    for (int i = 0; i + 1 < count; ++i) {
+        if (elevations[i] == kNoData || elevations[i + 1] == kNoData) continue;
+
+        double width = offsets[i + 1] - offsets[i];
+        double d0 = elevations[i] - baseElevation;
+        double d1 = elevations[i + 1] - baseElevation;
+
+        if (d0 >= 0.0 && d1 >= 0.0) {
+            cutArea += 0.5 * (d0 + d1) * width;
+        } else if (d0 <= 0.0 && d1 <= 0.0) {
+            fillArea -= 0.5 * (d0 + d1) * width;
+        } else {
+            // Split at the crossing into a cut and a fill triangle
+            double t = d0 / (d0 - d1);
+            double area0 = 0.5 * std::abs(d0) * t * width;
+            double area1 = 0.5 * std::abs(d1) * (1.0 - t) * width;
+            cutArea += d0 > 0.0 ? area0 : area1;
+            fillArea += d0 > 0.0 ? area1 : area0;
+        }
+    }
+}
+
+} // namespace SurfaceSampling
@@ -0,0 +1,106 @@
+#ifndef SURFACESAMPLING_H
+#define SURFACESAMPLING_H
+
+#include "VolumeKernel.h"
+#include <vector>
+
+/**
+ * @brief Point sampling of raster and TIN surfaces along alignments
+ *
+ * Both surfaces answer elevationAt(x, y) for world coordinates, returning
+ * VolumeKernel::kNoData where the surface is undefined. They are read-only
+ * after construction, so stations can be sampled from any number of threads.
+ */
+namespace SurfaceSampling {
+
+/**
+ * @brief Bilinear sampling of a raster window held in memory
+ *
+ * Values sit at cell centres (VolumeKernel::GridTransform). A sample is nodata if any of the
+ * four cells it interpolates between is nodata.
+ */
+class RasterSurface
+{
+public:
+    /**
+     * @param values Row-major window values
+     * @param geoTransform GDAL geotransform of the full grid
+     * @param windowCol Column of the window's first cell in the full grid
+     * @param windowRow Row of the window's first cell in the full grid
+     * @param windowWidth Window width in cells
+     * @param windowHeight Window height in cells
+     */
+    RasterSurface(std::vector<float> values, const double geoTransform[6],
+                  int windowCol, int windowRow, int windowWidth, int windowHeight);
+
+    float elevationAt(double x, double y) const;
+
+private:
+    std::vector<float> m_values;
+    VolumeKernel::GridTransform m_transform;
+    int m_col;
+    int m_row;
+    int m_width;
+    int m_height;
+};
+
+/**
+ * @brief Linear interpolation on a TIN through a uniform bucket grid of triangles
+ */
+class TINSurface
+{
+public:
+    /**
+     * @param xyz Packed vertices [x0, y0, z0, ...]
+     * @param indices Packed triangle indices [i0, i1, i2, ...]
+     */
+    TINSurface(const std::vector<double> &xyz, const std::vector<int> &indices);
+
+    float elevationAt(double x, double y) const;
+
+private:
+    std::vector<double> m_xyz;
+    std::vector<int> m_indices;
+    double m_minX = 0.0;
+    double m_minY = 0.0;
+    double m_cellSize = 1.0;
+    int m_columns = 0;
+    int m_rows = 0;
+    std::vector<std::vector<int>> m_buckets;
+};
+
+/**
+ * @brief A point on an alignment with its unit right-hand normal
+ */
+struct Station {
+    double chainage;
+    double x;
+    double y;
+    double normalX;
+    double normalY;
+};
+
+/**
+ * @brief Stations every interval along a polyline, plus one at its end
+ * @param xy Polyline vertices as interleaved x, y pairs
+ * @param interval Chainage spacing; must be positive
+ */
+std::vector<Station> stationsAlong(const std::vector<double> &xy, double interval);
+
+/**
+ * @brief Evenly spaced offsets across [-halfWidth, halfWidth], always including 0
+ */
+std::vector<double> sectionOffsets(double halfWidth, double spacing);
+
+/**
+ * @brief Cut and fill area of one cross section against a base elevation
+ *
+ * Trapezoidal between consecutive valid samples, split exactly where the
+ * section crosses the base. Gaps next to nodata samples are skipped.
+ */
+void sectionAreas(const double *offsets, const float *elevations, int count,
+                  double baseElevation, double &cutArea, double &fillArea);
+
+} // namespace SurfaceSampling
+
+#endif // SURFACESAMPLING_H
@@ -1,11 +1,27 @@
 #include "TINProcessor.h"
 #include "GDALHelpers.h"
+#include "MemoryBudget.h"
+#include "VolumeKernel.h"
+#include "utilities/Trace.h"
 #include <geos_c.h>
 #include <QDebug>
+#include <QHash>
+#include <QPair>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 
 using namespace GDALHelpers;
 
+namespace {
+
+// Rough peak cost of one input point while building: its GEOS point and the
+// two Delaunay triangles it contributes, the vertex map, the position hash
+// entry and the packed vertex and triangle arrays
+constexpr qint64 kBytesPerPoint = 1024;
+
+} // namespace
+
 TINProcessor::TINProcessor(QObject *parent)
     : QObject(parent)
 {
@@ -17,10 +33,13 @@ void TINProcessor::clear()
 {
     m_vertices.clear();
     m_triangles.clear();
+    m_packedVertices.clear();
+    m_packedTriangles.clear();
 }
 
 QVariantMap TINProcessor::generate(const QVariantList &points, QString &errorOut)
 {
+    TRACE_SCOPE("tin", "TINProcessor::generate");
     QVariantMap result;
     result["success"] = false;
     
@@ -31,59 +50,98 @@ QVariantMap TINProcessor::generate(const QVariantList &points, QString &errorOut
         return result;
     }
     
+    MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(points.size() * kBytesPerPoint);
+    if (!reservation) {
+        errorOut = QString("TIN from %1 points needs about %2, more than the %3 left in the memory budget")
+                       .arg(points.size())
+                       .arg(MemoryBudget::formatBytes(points.size() * kBytesPerPoint))
+                       .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return result;
+    }
+
     qDebug() << "Generating TIN from" << points.size() << "points...";
     
-    // Create GEOS MultiPoint for Delaunay triangulation
+    GEOSContextHandle_t context = GEOSContext::forThread();
+
+    // Create GEOS MultiPoint for Delaunay triangulation; points are owned by
+    // their guards until the collection takes them
     std::vector<GeometryGuard> pointGeoms;
     pointGeoms.reserve(points.size());
-    
-    GEOSGeometry** rawPointGeoms = new GEOSGeometry*[points.size()];
+
+    // Delaunay output reuses the input coordinates, so vertices are found by
+    // exact position; the first of any duplicates wins, as before
+    QHash<QPair<double, double>, int> vertexIndex;
+    vertexIndex.reserve(points.size());
     
     for (int i = 0; i < points.size(); ++i) {
         QVariantMap m = points[i].toMap();
         
         if (!m.contains("x") || !m.contains("y") || !m.contains("z")) {
             errorOut = QString("Point %1 missing x, y, or z coordinate").arg(i);
-            delete[] rawPointGeoms;
+            clear();
             return result;
         }
+
+        double x = m["x"].toDouble();
+        double y = m["y"].toDouble();
+        double z = m["z"].toDouble();
         
-        GEOSCoordSequence* s = GEOSCoordSeq_create(1, 3); // 3D coordinates
-        GEOSCoordSeq_setX(s, 0, m["x"].toDouble());
-        GEOSCoordSeq_setY(s, 0, m["y"].toDouble());
-        GEOSCoordSeq_setZ(s, 0, m["z"].toDouble());
+        GEOSCoordSequence* s = GEOSCoordSeq_create_r(context, 1, 3); // 3D coordinates
+        GEOSCoordSeq_setX_r(context, s, 0, x);
+        GEOSCoordSeq_setY_r(context, s, 0, y);
+        GEOSCoordSeq_setZ_r(context, s, 0, z);
         
-        GEOSGeometry* pointGeom = GEOSGeom_createPoint(s);
+        GeometryGuard pointGeom(context, GEOSGeom_createPoint_r(context, s));
         if (!pointGeom) {
             errorOut = QString("Failed to create GEOS point geometry at index %1").arg(i);
-            delete[] rawPointGeoms;
+            clear();
             return result;
         }
-        
-        rawPointGeoms[i] = pointGeom;
+        pointGeoms.push_back(std::move(pointGeom));
         
         // Store vertices
         QVariantMap vertex;
-        vertex["x"] = m["x"].toDouble();
-        vertex["y"] = m["y"].toDouble();
-        vertex["z"] = m["z"].toDouble();
+        vertex["x"] = x;
+        vertex["y"] = y;
+        vertex["z"] = z;
         m_vertices.append(vertex);
+
+        m_packedVertices.push_back(x);
+        m_packedVertices.push_back(y);
+        m_packedVertices.push_back(z);
+
+        QPair<double, double> key = qMakePair(x, y);
+        if (!vertexIndex.contains(key)) {
+            vertexIndex.insert(key, i);
+        }
     }
     
     // Create collection
-    GEOSGeometry* collection = GEOSGeom_createCollection(GEOS_MULTIPOINT, rawPointGeoms, points.size());
-    delete[] rawPointGeoms; // Ownership transferred to collection
+    std::vector<GEOSGeometry*> rawPointGeoms(pointGeoms.size());
+    for (size_t i = 0; i < pointGeoms.size(); ++i) {
+        rawPointGeoms[i] = pointGeoms[i].get();
+    }
+    GEOSGeometry* collection = GEOSGeom_createCollection_r(context, GEOS_MULTIPOINT, rawPointGeoms.data(),
+                                                           static_cast<unsigned int>(rawPointGeoms.size()));
     
     if (!collection) {
         errorOut = "Failed to create point collection for TIN";
         clear();
         return result;
     }
-    
-    GeometryGuard collectionGuard(collection);
+
+    // Ownership transferred to collection
+    for (GeometryGuard &pointGeom : pointGeoms) {
+        pointGeom.release();
+    }
+    GeometryGuard collectionGuard(context, collection);
     
     // Perform Delaunay triangulation
-    GEOSGeometry* triangles = GEOSDelaunayTriangulation(collection, 0.0, 0); // 0 = return triangles (not edges)
+    GeometryGuard triangles;
+    {
+        TRACE_SCOPE("tin", "GEOSDelaunayTriangulation");
+        triangles = GeometryGuard(context, GEOSDelaunayTriangulation_r(context, collection, 0.0, 0)); // 0 = return triangles (not edges)
+    }
     
     if (!triangles) {
         errorOut = "Delaunay triangulation failed";
@@ -91,9 +149,7 @@ QVariantMap TINProcessor::generate(const QVariantList &points, QString &errorOut
         return result;
     }
     
-    GeometryGuard trianglesGuard(triangles);
-    
-    int numTriangles = GEOSGetNumGeometries(triangles);
+    int numTriangles = GEOSGetNumGeometries_r(context, triangles.get());
     qDebug() << "TIN generated:" << numTriangles << "triangles";
     
     if (numTriangles == 0) {
@@ -102,49 +158,58 @@ QVariantMap TINProcessor::generate(const QVariantList &points, QString &errorOut
         return result;
     }
     
-    // Extract triangles - store as point indices
-    // For each triangle, find matching vertices in m_vertices
-    for (int t = 0; t < numTriangles; ++t) {
-        const GEOSGeometry* tri = GEOSGetGeometryN(triangles, t);
-        if (!tri) continue;
-        
-        const GEOSGeometry* ring = GEOSGetExteriorRing(tri);
-        if (!ring) continue;
-        
-        const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq(ring);
-        if (!seq) continue;
-        
-        QVariantList triIndices;
-        unsigned int numCoords;
-        GEOSCoordSeq_getSize(seq, &numCoords);
-        
-        // Triangle has 4 coords (closed ring), we need first 3
-        for (unsigned int c = 0; c < 3 && c < numCoords; ++c) {
-            double x, y;
-            GEOSCoordSeq_getX(seq, c, &x);
-            GEOSCoordSeq_getY(seq, c, &y);
+    // Extract triangles as point indices in parallel. The triangulation is only
+    // read; each worker goes through its own thread's GEOS context.
+    constexpr int kTrianglesPerBlock = 4096;
+    std::vector<int> cornerIndices(static_cast<size_t>(numTriangles) * 3, -1);
+    std::atomic<int> unmatched{0};
+    int blockCount = (numTriangles + kTrianglesPerBlock - 1) / kTrianglesPerBlock;
+
+    VolumeKernel::runBlocks(blockCount, [&](int block) {
+        TRACE_SCOPE("tin", "extract triangle block");
+        GEOSContextHandle_t workerContext = GEOSContext::forThread();
+        int end = std::min(numTriangles, (block + 1) * kTrianglesPerBlock);
+
+        for (int t = block * kTrianglesPerBlock; t < end; ++t) {
+            const GEOSGeometry* tri = GEOSGetGeometryN_r(workerContext, triangles.get(), t);
+            if (!tri) continue;
             
-            // Find matching vertex index
-            bool found = false;
-            for (int v = 0; v < m_vertices.size(); ++v) {
-                QVariantMap vert = m_vertices[v].toMap();
-                if (std::abs(vert["x"].toDouble() - x) < 0.001 &&
-                    std::abs(vert["y"].toDouble() - y) < 0.001) {
-                    triIndices.append(v);
-                    found = true;
-                    break;
-                }
-            }
+            const GEOSGeometry* ring = GEOSGetExteriorRing_r(workerContext, tri);
+            if (!ring) continue;
+            
+            const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq_r(workerContext, ring);
+            if (!seq) continue;
+            
+            unsigned int numCoords = 0;
+            GEOSCoordSeq_getSize_r(workerContext, seq, &numCoords);
             
-            if (!found) {
-                qWarning() << "Could not find matching vertex for triangle" << t << "coord" << c;
+            // Triangle has 4 coords (closed ring), we need first 3
+            for (unsigned int c = 0; c < 3 && c < numCoords; ++c) {
+                double x, y;
+                GEOSCoordSeq_getX_r(workerContext, seq, c, &x);
+                GEOSCoordSeq_getY_r(workerContext, seq, c, &y);
+                
+                auto it = vertexIndex.constFind(qMakePair(x, y));
+                if (it != vertexIndex.constEnd()) {
+                    cornerIndices[static_cast<size_t>(t) * 3 + c] = it.value();
+                } else {
+                    unmatched.fetch_add(1, std::memory_order_relaxed);
+                }
             }
         }
-        
-        if (triIndices.size() == 3) {
-            m_triangles.append(triIndices[0]);
-            m_triangles.append(triIndices[1]);
-            m_triangles.append(triIndices[2]);
+    });
+
+    if (unmatched.load() > 0) {
+        qWarning() << "Could not find matching vertices for" << unmatched.load() << "triangle corners";
+    }
+
+    for (size_t t = 0; t < cornerIndices.size(); t += 3) {
+        const int *corners = cornerIndices.data() + t;
+        if (corners[0] < 0 || corners[1] < 0 || corners[2] < 0) continue;
+
+        for (int c = 0; c < 3; ++c) {
+            m_triangles.append(corners[c]);
+            m_packedTriangles.push_back(corners[c]);
         }
     }
     
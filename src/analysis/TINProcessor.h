@@ -5,6 +5,7 @@
 #include <QString>
 #include <QVariantList>
 #include <QVariantMap>
+#include <vector>
 
 /**
  * @brief Handles Triangulated Irregular Network (TIN) operations
@@ -41,6 +42,18 @@ public:
      */
     QVariantList getTriangles() const { return m_triangles; }
 
+    /**
+     * @brief Get stored TIN vertices as packed coordinates
+     * @return [x0, y0, z0, x1, y1, z1, ...], same order as getVertices()
+     */
+    const std::vector<double> &packedVertices() const { return m_packedVertices; }
+
+    /**
+     * @brief Get stored TIN triangle indices as a packed array
+     * @return [v0, v1, v2, v0, v1, v2, ...], same content as getTriangles()
+     */
+    const std::vector<int> &packedTriangles() const { return m_packedTriangles; }
+
     /**
      * @brief Check if TIN data is available
      */
@@ -54,6 +67,10 @@ public:
 private:
     QVariantList m_vertices;    // Stored TIN vertices [{x, y, z}, ...]
     QVariantList m_triangles;   // Stored TIN triangles as flat index list [i0, i1, i2, ...]
+
+    // Packed copies for numeric consumers (volume, rasterisation)
+    std::vector<double> m_packedVertices;
+    std::vector<int> m_packedTriangles;
 };
 
 #endif // TINPROCESSOR_H
@@ -0,0 +1,119 @@
+#include "TINRasterizer.h"
+#include "VolumeKernel.h"
+#include <algorithm>
+#include <cmath>
+
+using VolumeKernel::kBlockRows;
+
+TINRasterizer::TINRasterizer(const std::vector<double> &xyz,
+                             const std::vector<int> &indices,
+                             const double geoTransform[6],
+                             int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_valid(false)
+{
+    VolumeKernel::GridTransform transform(geoTransform);
+    if (!transform.isValid() || width <= 0 || height <= 0 || indices.size() < 3) {
+        return;
+    }
+
+    int vertexCount = static_cast<int>(xyz.size() / 3);
+    m_triangles.reserve(indices.size() / 3);
+    m_blockTriangles.resize((height + kBlockRows - 1) / kBlockRows);
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        Triangle tri;
+        bool ok = true;
+        for (int k = 0; k < 3; ++k) {
+            int v = indices[t + k];
+            if (v < 0 || v >= vertexCount) {
+                ok = false;
+                break;
+            }
+            transform.toCell(xyz[3 * v], xyz[3 * v + 1], tri.col[k], tri.row[k]);
+            tri.z[k] = xyz[3 * v + 2];
+        }
+        if (!ok) continue;
+
+        double minRow = std::min({tri.row[0], tri.row[1], tri.row[2]});
+        double maxRow = std::max({tri.row[0], tri.row[1], tri.row[2]});
+        int rowBegin = std::max(0, static_cast<int>(std::ceil(minRow)));
+        int rowLast = std::min(height - 1, static_cast<int>(std::floor(maxRow)));
+        if (rowBegin > rowLast) continue;
+
+        int index = static_cast<int>(m_triangles.size());
+        m_triangles.push_back(tri);
+        for (int b = rowBegin / kBlockRows; b <= rowLast / kBlockRows; ++b) {
+            m_blockTriangles[b].push_back(index);
+        }
+    }
+
+    m_valid = !m_triangles.empty();
+}
+
+void TINRasterizer::fillTriangle(const Triangle &tri, float *strip, int firstRow, int rowBegin, int rowEnd) const
+{
+    const double *c = tri.col;
+    const double *r = tri.row;
+    const double *z = tri.z;
+
+    double det = (c[1] - c[0]) * (r[2] - r[0]) - (c[2] - c[0]) * (r[1] - r[0]);
+    if (det == 0.0) {
+        return;
+    }
+
+    // Plane z = z0 + a * (col - c0) + b * (row - r0)
+    double a = ((z[1] - z[0]) * (r[2] - r[0]) - (z[2] - z[0]) * (r[1] - r[0])) / det;
+    double b = ((c[1] - c[0]) * (z[2] - z[0]) - (c[2] - c[0]) * (z[1] - z[0])) / det;
+
+    double minRow = std::min({r[0], r[1], r[2]});
+    double maxRow = std::max({r[0], r[1], r[2]});
+    int first = std::max(rowBegin, static_cast<int>(std::ceil(minRow)));
+    int last = std::min(rowEnd - 1, static_cast<int>(std::floor(maxRow)));
+
+    for (int row = first; row <= last; ++row) {
+        double xMin = INFINITY;
+        double xMax = -INFINITY;
+        for (int i = 0, j = 2; i < 3; j = i++) {
+            double lo = std::min(r[i], r[j]);
+            double hi = std::max(r[i], r[j]);
+            if (row < lo || row > hi) continue;
+            if (r[i] == r[j]) {
+                xMin = std::min({xMin, c[i], c[j]});
+                xMax = std::max({xMax, c[i], c[j]});
+            } else {
+                double x = c[j] + (row - r[j]) * (c[i] - c[j]) / (r[i] - r[j]);
+                xMin = std::min(xMin, x);
+                xMax = std::max(xMax, x);
+            }
+        }
+
+        int colBegin = std::max(0, static_cast<int>(std::ceil(xMin)));
+        int colLast = std::min(m_width - 1, static_cast<int>(std::floor(xMax)));
+        float *out = strip + static_cast<size_t>(row - firstRow) * m_width;
+        for (int col = colBegin; col <= colLast; ++col) {
+            out[col] = static_cast<float>(z[0] + a * (col - c[0]) + b * (row - r[0]));
+        }
+    }
+}
+
+void TINRasterizer::rasterize(float *strip, int firstRow, int rows) const
+{
+    std::fill(strip, strip + static_cast<size_t>(rows) * m_width, VolumeKernel::kNoData);
+    if (!m_valid) {
+        return;
+    }
+
+    // Each block only writes its own rows, so blocks can be filled concurrently
+    VolumeKernel::forEachBlock(rows, [&](int, int localBegin, int localEnd) {
+        int rowBegin = firstRow + localBegin;
+        int rowEnd = firstRow + localEnd;
+        int globalBlock = rowBegin / kBlockRows;
+        if (globalBlock >= static_cast<int>(m_blockTriangles.size())) return;
+
+        for (int index : m_blockTriangles[globalBlock]) {
+            fillTriangle(m_triangles[index], strip, firstRow, rowBegin, rowEnd);
+        }
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef TINRASTERIZER_H
+#define TINRASTERIZER_H
+
+#include <vector>
+
+/**
+ * @brief Linearly interpolates a TIN onto the cells of a raster grid
+ *
+ * Cells are sampled at their centres (VolumeKernel::GridTransform). Rows are produced on demand for any strip, so a TIN can be compared
+ * with a streamed DTM without materialising a full raster. Triangles are
+ * bucketed by kernel block once, and each block of a strip is filled in parallel.
+ */
+class TINRasterizer
+{
+public:
+    /**
+     * @param xyz Packed TIN vertices [x0, y0, z0, x1, ...]
+     * @param indices Packed triangle vertex indices [i0, i1, i2, ...]
+     * @param geoTransform GDAL geotransform of the target grid
+     * @param width Grid width in cells
+     * @param height Grid height in cells
+     */
+    TINRasterizer(const std::vector<double> &xyz,
+                  const std::vector<int> &indices,
+                  const double geoTransform[6],
+                  int width, int height);
+
+    bool isValid() const { return m_valid; }
+
+    /**
+     * @brief Fill rows [firstRow, firstRow + rows) with interpolated elevations
+     * @param strip Output buffer of width * rows floats; cells outside the TIN get nodata
+     * @param firstRow Global index of the first row; must be a multiple of kBlockRows
+     * @param rows Number of rows to fill
+     */
+    void rasterize(float *strip, int firstRow, int rows) const;
+
+private:
+    struct Triangle {
+        double col[3];
+        double row[3];
+        double z[3];
+    };
+
+    void fillTriangle(const Triangle &tri, float *strip, int firstRow, int rowBegin, int rowEnd) const;
+
+    int m_width;
+    int m_height;
+    bool m_valid;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<int>> m_blockTriangles;
+};
+
+#endif // TINRASTERIZER_H
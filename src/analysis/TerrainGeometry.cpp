@@ -0,0 +1,77 @@
+#include "TerrainGeometry.h"
+
+TerrainGeometry::TerrainGeometry(QQuick3DObject *parent)
+    : QQuick3DGeometry(parent)
+{
+}
+
+TerrainGeometry::~TerrainGeometry() = default;
+
+void TerrainGeometry::setMesh(const MeshBuffers &mesh)
+{
+    clear();
+
+    setVertexData(mesh.vertexData);
+    setIndexData(mesh.indexData);
+    setBounds(mesh.boundsMin, mesh.boundsMax);
+    setAttributes(QQuick3DGeometry::Attribute::U32Type);
+
+    m_vertexCount = mesh.vertexCount;
+    m_indexCount = mesh.indexCount;
+    m_boundsMin = mesh.boundsMin;
+    m_boundsMax = mesh.boundsMax;
+
+    update();
+    emit meshChanged();
+}
+
+void TerrainGeometry::setChunk(const MeshChunk &chunk)
+{
+    clear();
+
+    QByteArray vertices;
+    chunk.decodeVertices(vertices);
+    setVertexData(vertices);
+    setIndexData(chunk.indexData);
+    setBounds(chunk.boundsMin, chunk.boundsMax);
+    setAttributes(QQuick3DGeometry::Attribute::U16Type);
+
+    m_vertexCount = chunk.vertexCount;
+    m_indexCount = chunk.indexCount;
+    m_boundsMin = chunk.boundsMin;
+    m_boundsMax = chunk.boundsMax;
+
+    update();
+    emit meshChanged();
+}
+
+void TerrainGeometry::setAttributes(QQuick3DGeometry::Attribute::ComponentType indexType)
+{
+    setPrimitiveType(QQuick3DGeometry::PrimitiveType::Triangles);
+    setStride(MeshBuffers::kStride);
+
+    addAttribute(QQuick3DGeometry::Attribute::PositionSemantic,
+                 MeshBuffers::kPositionOffset,
+                 QQuick3DGeometry::Attribute::F32Type);
+    addAttribute(QQuick3DGeometry::Attribute::NormalSemantic,
+                 MeshBuffers::kNormalOffset,
+                 QQuick3DGeometry::Attribute::F32Type);
+    addAttribute(QQuick3DGeometry::Attribute::ColorSemantic,
+                 MeshBuffers::kColorOffset,
+                 QQuick3DGeometry::Attribute::F32Type);
+    addAttribute(QQuick3DGeometry::Attribute::IndexSemantic,
+                 0,
+                 indexType);
+}
+
+void TerrainGeometry::clearMesh()
+{
+    clear();
+    m_vertexCount = 0;
+    m_indexCount = 0;
+    m_boundsMin = QVector3D();
+    m_boundsMax = QVector3D();
+
+    update();
+    emit meshChanged();
+}
@@ -0,0 +1,67 @@
+#ifndef TERRAINGEOMETRY_H
+#define TERRAINGEOMETRY_H
+
+#include "MeshExporter.h"
+#include <QQuick3DGeometry>
+
+/**
+ * @brief Qt Quick 3D geometry for DTM and TIN meshes
+ *
+ * Takes MeshBuffers as they are (implicitly shared QByteArrays), so a mesh
+ * reaches the GPU without being converted to QML values. Filled from C++
+ * through EarthworkEngine::loadTerrainMesh() or, one chunk per geometry,
+ * EarthworkEngine::loadTerrainChunk().
+ *
+ * QML usage:
+ *   Model { geometry: TerrainGeometry { id: terrain } }
+ *   Earthwork.loadTerrainMesh(terrain, 2.0)
+ */
+class TerrainGeometry : public QQuick3DGeometry
+{
+    Q_OBJECT
+    Q_PROPERTY(int vertexCount READ vertexCount NOTIFY meshChanged)
+    Q_PROPERTY(int triangleCount READ triangleCount NOTIFY meshChanged)
+    Q_PROPERTY(QVector3D boundsMin READ boundsMin NOTIFY meshChanged)
+    Q_PROPERTY(QVector3D boundsMax READ boundsMax NOTIFY meshChanged)
+
+public:
+    explicit TerrainGeometry(QQuick3DObject *parent = nullptr);
+    ~TerrainGeometry();
+
+    /**
+     * @brief Replace the geometry with a new mesh
+     */
+    void setMesh(const MeshBuffers &mesh);
+
+    /**
+     * @brief Replace the geometry with one 16-bit mesh chunk
+     *
+     * Indices are uploaded as uint16. QQuick3DGeometry only takes 32-bit
+     * vertex attributes, so the quantised vertices are decoded to the float
+     * layout of MeshBuffers on upload.
+     */
+    void setChunk(const MeshChunk &chunk);
+
+    /**
+     * @brief Remove all geometry
+     */
+    Q_INVOKABLE void clearMesh();
+
+    int vertexCount() const { return m_vertexCount; }
+    int triangleCount() const { return m_indexCount / 3; }
+    QVector3D boundsMin() const { return m_boundsMin; }
+    QVector3D boundsMax() const { return m_boundsMax; }
+
+signals:
+    void meshChanged();
+
+private:
+    void setAttributes(QQuick3DGeometry::Attribute::ComponentType indexType);
+
+    int m_vertexCount = 0;
+    int m_indexCount = 0;
+    QVector3D m_boundsMin;
+    QVector3D m_boundsMax;
+};
+
+#endif // TERRAINGEOMETRY_H
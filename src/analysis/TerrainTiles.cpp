@@ -0,0 +1,533 @@
+#include "TerrainTiles.h"
+#include "GridMesh.h"
+#include "MemoryBudget.h"
+#include <gdal_priv.h>
+#include <QtConcurrent>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <algorithm>
+#include <cmath>
+
+using namespace GDALHelpers;
+
+namespace {
+
+constexpr float kNoData = -9999.0f;
+constexpr int kCacheKiB = 256 * 1024;
+
+// Level 0 is a single tile; each level halves the step down to one base pixel
+int maxLevelFor(int width, int height)
+{
+    int maxLevel = 0;
+    while ((static_cast<qint64>(TerrainTiles::kTileCells) << maxLevel) < std::max(width, height) - 1) {
+        ++maxLevel;
+    }
+    return maxLevel;
+}
+
+struct OverviewProgress {
+    TerrainTiles::ProgressCallback progress;
+    TerrainTiles::CancelCheck isCanceled;
+};
+
+// GDALBuildOverviews progress: report 0-100% and stop when the job is cancelled
+int CPL_STDCALL overviewProgress(double complete, const char *, void *data)
+{
+    auto *overview = static_cast<OverviewProgress *>(data);
+    if (overview->progress) overview->progress(static_cast<int>(complete * 100.0));
+    return overview->isCanceled && overview->isCanceled() ? FALSE : TRUE;
+}
+
+} // namespace
+
+TerrainTiles::TerrainTiles(QObject *parent)
+    : QObject(parent)
+{
+    m_cache.setMaxCost(kCacheKiB);
+    m_buildPool.setMaxThreadCount(2);
+}
+
+TerrainTiles::~TerrainTiles()
+{
+    m_buildPool.clear();
+    m_buildPool.waitForDone();
+}
+
+quint64 TerrainTiles::cacheKey(const TileKey &key)
+{
+    return (static_cast<quint64>(key.level) << 56)
+         | (static_cast<quint64>(static_cast<quint32>(key.y) & 0x0FFFFFFF) << 28)
+         | (static_cast<quint64>(static_cast<quint32>(key.x) & 0x0FFFFFFF));
+}
+
+void TerrainTiles::close()
+{
+    {
+        QMutexLocker lock(&m_readMutex);
+        m_dataset = DatasetGuard();
+        m_dtmPath.clear();
+        m_levels.clear();
+        m_width = 0;
+        m_height = 0;
+    }
+    {
+        QMutexLocker lock(&m_cacheMutex);
+        m_cache.clear();
+    }
+    ++m_generation;
+}
+
+bool TerrainTiles::overviewsCurrent(const QString &dtmPath)
+{
+    // Without an .ovr any overviews are internal and were written with the DTM;
+    // an .ovr older than the DTM was built for an earlier DTM at the same path
+    QFileInfo overviews(dtmPath + ".ovr");
+    return !overviews.exists() || overviews.lastModified() >= QFileInfo(dtmPath).lastModified();
+}
+
+void TerrainTiles::attachOverviews()
+{
+    GDALRasterBandH band = GDALGetRasterBand(m_dataset.get(), 1);
+    bool current = overviewsCurrent(m_dtmPath);
+
+    for (Level &level : m_levels) {
+        level.band = level.step == 1 ? band : nullptr;
+
+        for (int i = 0; current && level.step > 1 && i < GDALGetOverviewCount(band); ++i) {
+            GDALRasterBandH overview = GDALGetOverview(band, i);
+            if (GDALGetRasterBandXSize(overview) == level.width && GDALGetRasterBandYSize(overview) == level.height) {
+                level.band = overview;
+                break;
+            }
+        }
+    }
+}
+
+bool TerrainTiles::open(const QString &dtmPath, double verticalScale, QString &errorOut)
+{
+    close();
+    QMutexLocker lock(&m_readMutex);
+
+    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
+    if (!dataset) {
+        errorOut = QString("Failed to open DTM: %1").arg(dtmPath);
+        return false;
+    }
+
+    GDALRasterBandH band = GDALGetRasterBand(dataset.get(), 1);
+    double gt[6];
+    if (!band || GDALGetGeoTransform(dataset.get(), gt) != CE_None) {
+        errorOut = "Failed to read DTM band or geotransform";
+        return false;
+    }
+
+    int width = GDALGetRasterBandXSize(band);
+    int height = GDALGetRasterBandYSize(band);
+    if (width < 2 || height < 2) {
+        errorOut = "DTM is too small to tile";
+        return false;
+    }
+
+    // Stored statistics, else a sampled min/max; the range only sets colours
+    // and culling bounds, so an exact pass over the DTM is not worth it here
+    double minMax[2];
+    double mean, stdDev;
+    if (GDALGetRasterStatistics(band, TRUE, FALSE, &minMax[0], &minMax[1], &mean, &stdDev) != CE_None
+        && GDALComputeRasterMinMax(band, TRUE, minMax) != CE_None) {
+        errorOut = "Failed to compute DTM elevation range";
+        return false;
+    }
+
+    int maxLevel = maxLevelFor(width, height);
+
+    m_levels.clear();
+    for (int level = 0; level <= maxLevel; ++level) {
+        Level info;
+        info.band = nullptr;
+        info.step = 1 << (maxLevel - level);
+        info.width = (width + info.step - 1) / info.step;
+        info.height = (height + info.step - 1) / info.step;
+        info.tilesX = std::max(1, (info.width - 1 + kTileCells - 1) / kTileCells);
+        info.tilesY = std::max(1, (info.height - 1 + kTileCells - 1) / kTileCells);
+        m_levels.push_back(info);
+    }
+
+    m_dtmPath = dtmPath;
+    m_dataset = std::move(dataset);
+    attachOverviews();
+    m_maxLevel = maxLevel;
+    m_width = width;
+    m_height = height;
+    m_pixelWidth = static_cast<float>(gt[1]);
+    m_pixelHeight = static_cast<float>(std::abs(gt[5]));
+    m_centerX = width * m_pixelWidth / 2.0f;
+    m_centerY = height * m_pixelHeight / 2.0f;
+    m_minElev = static_cast<float>(minMax[0]);
+    m_maxElev = static_cast<float>(minMax[1]);
+    m_scale = static_cast<float>(verticalScale);
+
+    m_boundsMin = QVector3D(-m_centerX, m_minElev * m_scale, -m_centerY);
+    m_boundsMax = QVector3D((width - 1) * m_pixelWidth - m_centerX, m_maxElev * m_scale,
+                            (height - 1) * m_pixelHeight - m_centerY);
+    if (m_scale < 0.0f) {
+        std::swap(m_boundsMin[1], m_boundsMax[1]);
+    }
+
+    qDebug() << "Terrain tiles:" << width << "x" << height << "DTM," << (maxLevel + 1) << "levels";
+    return true;
+}
+
+bool TerrainTiles::needsOverviews() const
+{
+    QMutexLocker lock(&m_readMutex);
+    for (const Level &level : m_levels) {
+        if (level.step > 1 && !level.band) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TerrainTiles::buildOverviews(const QString &dtmPath, QString &errorOut,
+                                  ProgressCallback progressCallback, CancelCheck isCanceled)
+{
+    QString overviewPath = dtmPath + ".ovr";
+    if (!overviewsCurrent(dtmPath)) {
+        QFile::remove(overviewPath);
+    }
+
+    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
+    if (!dataset) {
+        errorOut = QString("Failed to open DTM: %1").arg(dtmPath);
+        return false;
+    }
+
+    int maxLevel = maxLevelFor(GDALGetRasterXSize(dataset.get()), GDALGetRasterYSize(dataset.get()));
+    std::vector<int> factors;
+    for (int level = maxLevel - 1; level >= 0; --level) {
+        factors.push_back(1 << (maxLevel - level));
+    }
+    if (factors.empty()) {
+        return true;
+    }
+
+    OverviewProgress progress{progressCallback, isCanceled};
+    if (GDALBuildOverviews(dataset.get(), "AVERAGE", static_cast<int>(factors.size()), factors.data(),
+                           0, nullptr, overviewProgress, &progress) != CE_None) {
+        // A partial .ovr would pass for current on the next open
+        dataset = DatasetGuard();
+        QFile::remove(overviewPath);
+        errorOut = isCanceled && isCanceled() ? QString("Canceled")
+                                              : QString("Failed to build DTM overviews: %1").arg(dtmPath);
+        return false;
+    }
+    return true;
+}
+
+void TerrainTiles::reloadOverviews()
+{
+    {
+        QMutexLocker lock(&m_readMutex);
+        if (!isOpen()) {
+            return;
+        }
+
+        // Overviews are found when a dataset is opened, so the new .ovr needs a fresh handle
+        DatasetGuard dataset(GDALOpen(m_dtmPath.toUtf8().constData(), GA_ReadOnly));
+        if (!dataset) {
+            qWarning() << "Failed to re-open DTM for its overviews:" << m_dtmPath;
+            return;
+        }
+        m_dataset = std::move(dataset);
+        attachOverviews();
+    }
+
+    // Coarse tiles cached so far were decimated from the base band
+    QMutexLocker lock(&m_cacheMutex);
+    m_cache.clear();
+}
+
+float TerrainTiles::sampleX(const Level &level, int col) const
+{
+    // A level sample sits at the centre of the base pixels it averages
+    float base = std::min((col + 0.5f) * level.step - 0.5f, static_cast<float>(m_width - 1));
+    return base * m_pixelWidth - m_centerX;
+}
+
+float TerrainTiles::sampleZ(const Level &level, int row) const
+{
+    float base = std::min((row + 0.5f) * level.step - 0.5f, static_cast<float>(m_height - 1));
+    return base * m_pixelHeight - m_centerY;
+}
+
+bool TerrainTiles::tileWindow(const TileKey &key, int &col0, int &row0, int &col1, int &row1) const
+{
+    if (key.level < 0 || key.level > m_maxLevel) {
+        return false;
+    }
+    const Level &level = m_levels[key.level];
+    if (key.x < 0 || key.y < 0 || key.x >= level.tilesX || key.y >= level.tilesY) {
+        return false;
+    }
+
+    col0 = key.x * kTileCells;
+    row0 = key.y * kTileCells;
+    col1 = std::min(col0 + kTileCells, level.width - 1);
+    row1 = std::min(row0 + kTileCells, level.height - 1);
+    return col0 < col1 && row0 < row1;
+}
+
+void TerrainTiles::tileBounds(const TileKey &key, QVector3D &min, QVector3D &max) const
+{
+    int col0, row0, col1, row1;
+    tileWindow(key, col0, row0, col1, row1);
+    const Level &level = m_levels[key.level];
+    min = QVector3D(sampleX(level, col0), m_boundsMin.y(), sampleZ(level, row0));
+    max = QVector3D(sampleX(level, col1), m_boundsMax.y(), sampleZ(level, row1));
+}
+
+std::vector<TerrainTiles::TileKey> TerrainTiles::select(const QVector3D &camera, double fieldOfView,
+                                                        double viewportHeight, double maxPixelError) const
+{
+    std::vector<TileKey> selected;
+    if (!isOpen()) {
+        return selected;
+    }
+
+    // Pixels per unit of sample spacing at distance 1
+    double projection = viewportHeight / (2.0 * std::tan(fieldOfView * M_PI / 360.0));
+    double pixelSize = std::max(m_pixelWidth, m_pixelHeight);
+
+    std::vector<TileKey> stack{{0, 0, 0}};
+    while (!stack.empty()) {
+        TileKey key = stack.back();
+        stack.pop_back();
+
+        QVector3D min, max;
+        tileBounds(key, min, max);
+        QVector3D nearest(std::clamp(camera.x(), min.x(), max.x()),
+                          std::clamp(camera.y(), min.y(), max.y()),
+                          std::clamp(camera.z(), min.z(), max.z()));
+        double distance = (camera - nearest).length();
+
+        double spacing = m_levels[key.level].step * pixelSize;
+        bool refine = key.level < m_maxLevel
+                      && (distance <= 0.0 || spacing * projection / distance > maxPixelError);
+        if (!refine) {
+            selected.push_back(key);
+            continue;
+        }
+
+        int col0, row0, col1, row1;
+        for (int child = 0; child < 4; ++child) {
+            TileKey next{key.level + 1, 2 * key.x + (child & 1), 2 * key.y + (child >> 1)};
+            if (tileWindow(next, col0, row0, col1, row1)) {
+                stack.push_back(next);
+            }
+        }
+    }
+    return selected;
+}
+
+bool TerrainTiles::buildTile(const TileKey &key, MeshBuffers &mesh, QString &errorOut)
+{
+    int col0, row0, col1, row1;
+    int borderCol0, borderRow0, gridWidth, gridHeight;
+    int step;
+    std::vector<float> grid;
+    float minElev, maxElev, scale, cellX, cellZ;
+    Level level;
+    {
+        QMutexLocker lock(&m_readMutex);
+        if (!isOpen()) {
+            errorOut = "Terrain tiles are not open";
+            return false;
+        }
+        if (!tileWindow(key, col0, row0, col1, row1)) {
+            errorOut = QString("No terrain tile %1/%2/%3").arg(key.level).arg(key.x).arg(key.y);
+            return false;
+        }
+        level = m_levels[key.level];
+        step = level.step;
+
+        // One extra sample around the tile so edge normals match the neighbours
+        borderCol0 = std::max(col0 - 1, 0);
+        borderRow0 = std::max(row0 - 1, 0);
+        gridWidth = std::min(col1 + 1, level.width - 1) - borderCol0 + 1;
+        gridHeight = std::min(row1 + 1, level.height - 1) - borderRow0 + 1;
+        grid.resize(static_cast<size_t>(gridWidth) * gridHeight);
+
+        CPLErr err;
+        if (level.band) {
+            err = GDALRasterIO(level.band, GF_Read, borderCol0, borderRow0, gridWidth, gridHeight,
+                               grid.data(), gridWidth, gridHeight, GDT_Float32, 0, 0);
+        } else {
+            // No matching overview: let GDAL decimate the base band
+            GDALRasterBandH band = GDALGetRasterBand(m_dataset.get(), 1);
+            int x0 = borderCol0 * step;
+            int y0 = borderRow0 * step;
+            err = GDALRasterIO(band, GF_Read, x0, y0,
+                               std::min(gridWidth * step, m_width - x0),
+                               std::min(gridHeight * step, m_height - y0),
+                               grid.data(), gridWidth, gridHeight, GDT_Float32, 0, 0);
+        }
+        if (err != CE_None) {
+            errorOut = "Failed to read DTM tile data";
+            return false;
+        }
+
+        minElev = m_minElev;
+        maxElev = m_maxElev;
+        scale = m_scale;
+        cellX = step * m_pixelWidth;
+        cellZ = step * m_pixelHeight;
+    }
+
+    std::vector<float> normals(grid.size() * 3);
+    GridMesh::centralDifferenceNormals(grid.data(), gridWidth, gridHeight, cellX, cellZ, scale,
+                                       kNoData, minElev, normals.data(), 3);
+
+    int nx = col1 - col0 + 1;
+    int ny = row1 - row0 + 1;
+    int innerCount = nx * ny;
+    int skirtCount = 2 * (nx + ny);
+    int innerIndices = (nx - 1) * (ny - 1) * 6;
+    int skirtIndices = 2 * ((nx - 1) + (ny - 1)) * 6;
+
+    // The buffers stay charged to the memory budget while the cache or a caller
+    // holds the mesh; when the budget is short, least recently used tiles go first
+    qint64 meshBytes = static_cast<qint64>(innerCount + skirtCount) * MeshBuffers::kStride
+                     + static_cast<qint64>(innerIndices + skirtIndices) * static_cast<qint64>(sizeof(quint32));
+    MemoryBudget::Reservation reservation = MemoryBudget::tryReserve(meshBytes);
+    if (!reservation) {
+        {
+            QMutexLocker lock(&m_cacheMutex);
+            m_cache.setMaxCost(std::max<qsizetype>(0, m_cache.totalCost() - meshBytes / 1024 - 1));
+            m_cache.setMaxCost(kCacheKiB);
+        }
+        reservation = MemoryBudget::tryReserve(meshBytes);
+    }
+    if (!reservation) {
+        errorOut = QString("Terrain tile does not fit the memory budget (%1 free)")
+                       .arg(MemoryBudget::formatBytes(MemoryBudget::available()));
+        return false;
+    }
+    mesh.reservation = std::make_shared<MemoryBudget::Reservation>(std::move(reservation));
+
+    mesh.vertexData.resize(static_cast<qsizetype>(innerCount + skirtCount) * MeshBuffers::kStride);
+    mesh.indexData.resize(static_cast<qsizetype>(innerIndices + skirtIndices) * sizeof(quint32));
+    float *vertices = reinterpret_cast<float *>(mesh.vertexData.data());
+    quint32 *indices = reinterpret_cast<quint32 *>(mesh.indexData.data());
+    constexpr int stride = MeshBuffers::kStride / sizeof(float);
+
+    float tileMin = INFINITY;
+    float tileMax = -INFINITY;
+    for (int r = 0; r < ny; ++r) {
+        for (int c = 0; c < nx; ++c) {
+            size_t g = static_cast<size_t>(row0 + r - borderRow0) * gridWidth + (col0 + c - borderCol0);
+            float elev = grid[g];
+            float y = (elev == kNoData ? minElev : elev) * scale;
+            tileMin = std::min(tileMin, y);
+            tileMax = std::max(tileMax, y);
+
+            float *v = vertices + static_cast<size_t>(r * nx + c) * stride;
+            v[0] = sampleX(level, col0 + c);
+            v[1] = y;
+            v[2] = sampleZ(level, row0 + r);
+            v[3] = normals[3 * g];
+            v[4] = normals[3 * g + 1];
+            v[5] = normals[3 * g + 2];
+            GridMesh::elevationColor(elev, minElev, maxElev, kNoData, v + 6);
+            v[9] = 1.0f;
+        }
+    }
+
+    quint32 *out = indices;
+    for (int r = 0; r < ny - 1; ++r) {
+        for (int c = 0; c < nx - 1; ++c) {
+            quint32 topLeft = static_cast<quint32>(r * nx + c);
+            quint32 topRight = topLeft + 1;
+            quint32 bottomLeft = topLeft + nx;
+            quint32 bottomRight = bottomLeft + 1;
+
+            *out++ = topLeft;
+            *out++ = bottomLeft;
+            *out++ = topRight;
+
+            *out++ = topRight;
+            *out++ = bottomLeft;
+            *out++ = bottomRight;
+        }
+    }
+
+    // Skirts: each edge is copied and dropped below the tile, deep enough to
+    // cover the height difference to a neighbour at another level
+    float skirtDepth = 0.5f * (tileMax - tileMin) + std::max(cellX, cellZ);
+    quint32 next = static_cast<quint32>(innerCount);
+    auto addSkirt = [&](int first, int count, int delta) {
+        for (int k = 0; k < count; ++k) {
+            const float *edge = vertices + static_cast<size_t>(first + k * delta) * stride;
+            float *skirt = vertices + static_cast<size_t>(next + k) * stride;
+            std::copy(edge, edge + stride, skirt);
+            skirt[1] -= skirtDepth;
+        }
+        for (int k = 0; k + 1 < count; ++k) {
+            quint32 a = static_cast<quint32>(first + k * delta);
+            quint32 b = static_cast<quint32>(first + (k + 1) * delta);
+            *out++ = a;
+            *out++ = next + k;
+            *out++ = b;
+
+            *out++ = b;
+            *out++ = next + k;
+            *out++ = next + k + 1;
+        }
+        next += count;
+    };
+    addSkirt(0, nx, 1);                    // first row
+    addSkirt((ny - 1) * nx, nx, 1);        // last row
+    addSkirt(0, ny, nx);                   // first column
+    addSkirt(nx - 1, ny, nx);              // last column
+
+    mesh.vertexCount = innerCount + skirtCount;
+    mesh.indexCount = innerIndices + skirtIndices;
+    mesh.minElev = minElev;
+    mesh.maxElev = maxElev;
+    mesh.boundsMin = QVector3D(sampleX(level, col0), tileMin - skirtDepth, sampleZ(level, row0));
+    mesh.boundsMax = QVector3D(sampleX(level, col1), tileMax, sampleZ(level, row1));
+
+    QMutexLocker lock(&m_cacheMutex);
+    m_cache.insert(cacheKey(key), new MeshBuffers(mesh),
+                   std::max<qsizetype>(1, (mesh.vertexData.size() + mesh.indexData.size()) / 1024));
+    return true;
+}
+
+void TerrainTiles::requestTile(const TileKey &key, QObject *context, const TileCallback &done)
+{
+    {
+        QMutexLocker lock(&m_cacheMutex);
+        if (const MeshBuffers *cached = m_cache.object(cacheKey(key))) {
+            MeshBuffers mesh = *cached;
+            lock.unlock();
+            done(mesh, QString());
+            return;
+        }
+    }
+
+    int generation = m_generation;
+    QPointer<QObject> target(context);
+    (void)QtConcurrent::run(&m_buildPool, [this, key, generation, target, done]() {
+        MeshBuffers mesh;
+        QString error;
+        buildTile(key, mesh, error);
+
+        QMetaObject::invokeMethod(this, [this, generation, target, done, mesh, error]() {
+            if (generation != m_generation || !target) {
+                return;
+            }
+            done(mesh, error);
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,166 @@
+#ifndef TERRAINTILES_H
+#define TERRAINTILES_H
+
+#include "GDALHelpers.h"
+#include "MeshExporter.h"
+#include <QCache>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QVector3D>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Chunked quadtree level-of-detail terrain built from DTM overviews
+ *
+ * Provides functionality for:
+ * - A quadtree of tiles with kTileCells x kTileCells cells each; level 0 is one
+ *   tile over the whole DTM and every level halves the sample spacing
+ * - Tile heights read from the matching GDAL overview, so a coarse tile costs
+ *   the same to build as a fine one; until the overviews are built in the
+ *   background, coarse tiles decimate the base band
+ * - Skirts around every tile to hide cracks between neighbouring levels
+ * - Tile selection by projected screen-space error from the camera
+ * - Lazy, cached tile builds on a background pool; cached tiles are charged
+ *   to MemoryBudget and evicted when a new tile does not fit
+ *
+ * Tiles use the same centred frame as MeshExporter::buildGridMesh, so the full
+ * grid mesh and the tiles line up.
+ */
+class TerrainTiles : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kTileCells = 64;
+
+    struct TileKey {
+        int level;
+        int x;
+        int y;
+    };
+
+    using TileCallback = std::function<void(const MeshBuffers &mesh, const QString &error)>;
+    using ProgressCallback = std::function<void(int)>;
+    using CancelCheck = std::function<bool()>;
+
+    explicit TerrainTiles(QObject *parent = nullptr);
+    ~TerrainTiles();
+
+    /**
+     * @brief Open a DTM for tiling
+     *
+     * Cheap enough for the GUI thread: the elevation range comes from stored
+     * statistics or a sampled min/max, and only overviews that are newer than
+     * the DTM are used. See needsOverviews().
+     * @param dtmPath Path to DTM raster file
+     * @param verticalScale Vertical exaggeration factor
+     * @param errorOut Output parameter for error message
+     * @return true on success, false on failure
+     */
+    bool open(const QString &dtmPath, double verticalScale, QString &errorOut);
+
+    /**
+     * @brief Release the DTM and drop cached tiles; pending builds are discarded
+     */
+    void close();
+
+    /**
+     * @brief Whether a coarse level of the open DTM has no current overview
+     */
+    bool needsOverviews() const;
+
+    /**
+     * @brief Build the overviews the tile levels read (thread-safe, slow)
+     *
+     * An .ovr older than the DTM belongs to an earlier DTM at the same path and
+     * is replaced; current overviews are kept. Meant to run as a background job
+     * holding the DTM, followed by reloadOverviews().
+     * @return true on success, false on failure or cancellation
+     */
+    static bool buildOverviews(const QString &dtmPath, QString &errorOut,
+                               ProgressCallback progressCallback = nullptr,
+                               CancelCheck isCanceled = nullptr);
+
+    /**
+     * @brief Re-open the DTM to pick up overviews built since open()
+     */
+    void reloadOverviews();
+
+    bool isOpen() const { return m_width > 0; }
+    int levelCount() const { return m_maxLevel + 1; }
+    QVector3D boundsMin() const { return m_boundsMin; }
+    QVector3D boundsMax() const { return m_boundsMax; }
+
+    /**
+     * @brief Tiles to draw for a camera position
+     *
+     * A tile is refined while its sample spacing, projected at its distance
+     * from the camera, exceeds maxPixelError pixels.
+     * @param camera Camera position in the mesh frame
+     * @param fieldOfView Vertical field of view in degrees
+     * @param viewportHeight Viewport height in pixels
+     * @param maxPixelError Largest allowed projected sample spacing in pixels
+     */
+    std::vector<TileKey> select(const QVector3D &camera, double fieldOfView,
+                                double viewportHeight, double maxPixelError) const;
+
+    /**
+     * @brief Build one tile's mesh (thread-safe)
+     * @return true on success, false on failure
+     */
+    bool buildTile(const TileKey &key, MeshBuffers &mesh, QString &errorOut);
+
+    /**
+     * @brief Deliver a tile from the cache, or build it in the background
+     *
+     * done is called on context's thread: immediately for cached tiles,
+     * otherwise once the build finishes. Builds that finish after close() or a
+     * re-open are dropped.
+     */
+    void requestTile(const TileKey &key, QObject *context, const TileCallback &done);
+
+private:
+    struct Level {
+        GDALRasterBandH band;   // base band, the overview with this level's step, or nullptr
+        int step;               // base pixels per sample
+        int width;              // samples across the level
+        int height;
+        int tilesX;
+        int tilesY;
+    };
+
+    static quint64 cacheKey(const TileKey &key);
+    static bool overviewsCurrent(const QString &dtmPath);
+    void attachOverviews();
+    bool tileWindow(const TileKey &key, int &col0, int &row0, int &col1, int &row1) const;
+    void tileBounds(const TileKey &key, QVector3D &min, QVector3D &max) const;
+    float sampleX(const Level &level, int col) const;
+    float sampleZ(const Level &level, int row) const;
+
+    QString m_dtmPath;
+    GDALHelpers::DatasetGuard m_dataset;
+    std::vector<Level> m_levels;
+    int m_maxLevel = 0;
+    int m_width = 0;
+    int m_height = 0;
+    float m_pixelWidth = 1.0f;
+    float m_pixelHeight = 1.0f;
+    float m_centerX = 0.0f;
+    float m_centerY = 0.0f;
+    float m_minElev = 0.0f;
+    float m_maxElev = 0.0f;
+    float m_scale = 1.0f;
+    QVector3D m_boundsMin;
+    QVector3D m_boundsMax;
+
+    int m_generation = 0;
+    mutable QMutex m_readMutex;       // GDAL handles are not thread-safe
+    QMutex m_cacheMutex;
+    QCache<quint64, MeshBuffers> m_cache;  // cost in KiB
+    QThreadPool m_buildPool;
+};
+
+#endif // TERRAINTILES_H
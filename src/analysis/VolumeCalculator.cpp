@@ -1,10 +1,22 @@
 #include "VolumeCalculator.h"
+#include "DTMGenerator.h"
 #include "TINProcessor.h"
 #include "GDALHelpers.h"
+#include "VolumeKernel.h"
+#include "RasterStripReader.h"
+#include "TINRasterizer.h"
+#include "PrismVolume.h"
+#include "ElevationHistogram.h"
+#include "IsopachWriter.h"
+#include "utilities/Trace.h"
 #include <gdal_priv.h>
-#include <geos_c.h>
 #include <QDebug>
+#include <QPointF>
+#include <QStringList>
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <memory>
 
 using namespace GDALHelpers;
 
@@ -15,271 +27,896 @@ VolumeCalculator::VolumeCalculator(QObject *parent)
 
 VolumeCalculator::~VolumeCalculator() = default;
 
-void* VolumeCalculator::createBoundaryGeometry(const QVariantList &points, QString &errorOut)
+std::vector<double> VolumeCalculator::ringCoordinates(const QVariantList &points)
 {
-    if (points.size() < 3) {
-        return nullptr;
+    std::vector<double> coords;
+    coords.reserve(points.size() * 2);
+    for (const QVariant &v : points) {
+        if (v.typeId() == QMetaType::QVariantMap) {
+            QVariantMap pt = v.toMap();
+            coords.push_back(pt["x"].toDouble());
+            coords.push_back(pt["y"].toDouble());
+        } else {
+            QPointF pt = v.toPointF();
+            coords.push_back(pt.x());
+            coords.push_back(pt.y());
+        }
+    }
+    return coords;
+}
+
+bool VolumeCalculator::isPoint(const QVariant &value)
+{
+    return value.typeId() == QMetaType::QPointF
+        || (value.typeId() == QMetaType::QVariantMap && value.toMap().contains("x"));
+}
+
+std::vector<VolumeCalculator::BoundaryRegion> VolumeCalculator::parseRegions(const QVariantList &boundary)
+{
+    std::vector<BoundaryRegion> regions;
+    if (boundary.isEmpty()) {
+        return regions;
+    }
+
+    // Rings of a polygon given as [outer, hole, ...] or as a single ring of points
+    auto addPolygon = [](const QVariantList &polygon, BoundaryRegion &region) {
+        if (!polygon.isEmpty() && isPoint(polygon.first())) {
+            region.rings.push_back(ringCoordinates(polygon));
+            return;
+        }
+        for (const QVariant &ring : polygon) {
+            region.rings.push_back(ringCoordinates(ring.toList()));
+        }
+    };
+
+    // A plain list of points is one polygon, e.g. the boundary drawn in CADPage;
+    // fewer than three points means no boundary, as before
+    if (isPoint(boundary.first())) {
+        if (boundary.size() < 3) {
+            return regions;
+        }
+        BoundaryRegion region;
+        region.rings.push_back(ringCoordinates(boundary));
+        regions.push_back(std::move(region));
+        return regions;
+    }
+
+    // Otherwise each entry is a region: a polygon ring list, or a map with a name
+    // and "points" + "holes", "rings", or "polygons" (multipolygon)
+    for (int i = 0; i < boundary.size(); ++i) {
+        BoundaryRegion region;
+        const QVariant &entry = boundary[i];
+
+        if (entry.typeId() == QMetaType::QVariantMap) {
+            QVariantMap map = entry.toMap();
+            region.name = map.value("name").toString();
+            if (map.contains("points")) {
+                region.rings.push_back(ringCoordinates(map["points"].toList()));
+                for (const QVariant &hole : map.value("holes").toList()) {
+                    region.rings.push_back(ringCoordinates(hole.toList()));
+                }
+            }
+            if (map.contains("rings")) {
+                addPolygon(map["rings"].toList(), region);
+            }
+            for (const QVariant &polygon : map.value("polygons").toList()) {
+                addPolygon(polygon.toList(), region);
+            }
+        } else {
+            addPolygon(entry.toList(), region);
+        }
+
+        if (region.name.isEmpty()) {
+            region.name = QString("Region %1").arg(i + 1);
+        }
+        regions.push_back(std::move(region));
+    }
+
+    return regions;
+}
+
+namespace {
+
+// Supplies the reference surface rows matching a DTM strip (nullptr = flat base)
+using ReferenceRows = std::function<const float*(int firstRow, int rows)>;
+
+struct GridSource {
+    DatasetGuard dataset;
+    GDALRasterBandH band = nullptr;
+    double geoTransform[6] = {0, 1, 0, 0, 0, 1};
+    int width = 0;
+    int height = 0;
+};
+
+bool openGrid(const QString &path, GridSource &grid, QString &errorOut)
+{
+    grid.dataset = DatasetGuard(GDALOpen(path.toUtf8().constData(), GA_ReadOnly));
+    if (!grid.dataset) {
+        errorOut = QString("Failed to open DTM for volume calculation: %1").arg(path);
+        return false;
+    }
+
+    grid.band = GDALGetRasterBand(grid.dataset.get(), 1);
+    if (!grid.band) {
+        errorOut = "Failed to get raster band for volume calculation";
+        return false;
+    }
+
+    if (GDALGetGeoTransform(grid.dataset.get(), grid.geoTransform) != CE_None) {
+        errorOut = "Failed to get geotransform from DTM";
+        return false;
+    }
+
+    grid.width = GDALGetRasterBandXSize(grid.band);
+    grid.height = GDALGetRasterBandYSize(grid.band);
+    return true;
+}
+
+// Read an in-memory DTM through a MEM dataset over its values (no copy)
+bool openGrid(const DTMRaster &raster, GridSource &grid, QString &errorOut)
+{
+    grid.dataset = wrapFloatRaster(raster.values.data(), raster.width, raster.height,
+                                   raster.geoTransform, VolumeKernel::kNoData);
+    if (!grid.dataset) {
+        errorOut = "Failed to wrap DTM raster for volume calculation";
+        return false;
     }
 
-    GEOSGeometry** pointGeoms = new GEOSGeometry*[points.size()];
-    for (int i = 0; i < points.size(); ++i) {
-        QVariantMap m = points[i].toMap();
-        GEOSCoordSequence* s = GEOSCoordSeq_create(1, 2);
-        GEOSCoordSeq_setX(s, 0, m["x"].toDouble());
-        GEOSCoordSeq_setY(s, 0, m["y"].toDouble());
-        pointGeoms[i] = GEOSGeom_createPoint(s);
+    grid.band = GDALGetRasterBand(grid.dataset.get(), 1);
+    std::copy(raster.geoTransform, raster.geoTransform + 6, grid.geoTransform);
+    grid.width = raster.width;
+    grid.height = raster.height;
+    return true;
+}
+
+// Stream the band in strips; the next strip is read while fn(strip) runs
+bool streamStrips(const GridSource &grid,
+                  const std::function<bool(const RasterStripReader::Strip &)> &fn,
+                  QString &errorOut)
+{
+    TRACE_SCOPE("volume", "stream raster strips");
+    RasterStripReader reader(grid.band);
+    RasterStripReader::Strip strip;
+
+    while (reader.next(strip)) {
+        if (!fn(strip)) {
+            return false;
+        }
+    }
+
+    if (reader.hasError()) {
+        errorOut = "Failed to read DTM raster data";
+        return false;
+    }
+
+    return true;
+}
+
+bool streamTotals(const GridSource &grid,
+                  const VolumeKernel::RasterMask *mask,
+                  double baseElevation,
+                  const ReferenceRows &reference,
+                  VolumeKernel::Totals &totals,
+                  IsopachWriter *isopach,
+                  QString &errorOut)
+{
+    return streamStrips(grid, [&](const RasterStripReader::Strip &strip) {
+        const float *referenceRows = nullptr;
+        if (reference) {
+            referenceRows = reference(strip.firstRow, strip.rows);
+            if (!referenceRows) {
+                errorOut = "Failed to read reference surface data";
+                return false;
+            }
+        }
+        VolumeKernel::accumulate(strip.data, referenceRows, grid.width, strip.rows, strip.firstRow,
+                                 baseElevation, mask, totals);
+        if (isopach) {
+            isopach->writeStrip(strip.data, referenceRows, strip.firstRow, strip.rows, baseElevation, mask);
+        }
+        return true;
+    }, errorOut);
+}
+
+void storeTotals(const VolumeKernel::Totals &totals, const double geoTransform[6], QVariantMap &result)
+{
+    double pixelArea = std::abs(geoTransform[1] * geoTransform[5]);
+    double cut = totals.cut.value() * pixelArea;
+    double fill = totals.fill.value() * pixelArea;
+
+    result["cut"] = cut;
+    result["fill"] = fill;
+    result["net"] = cut - fill;
+    result["area"] = static_cast<double>(totals.cells) * pixelArea;
+}
+
+// Elevation range of the band for sizing the balance histogram, without a
+// pass over the full raster: stored statistics when the file has them,
+// otherwise GDAL's approximate min/max, which reads overviews when present
+// and a sample of blocks when not. Cells outside the range still land in the
+// open-ended end bins, so an approximate range costs no accuracy.
+bool elevationRange(const GridSource &grid, double &minOut, double &maxOut)
+{
+    double mean = 0.0;
+    double stdDev = 0.0;
+    if (GDALGetRasterStatistics(grid.band, TRUE, FALSE, &minOut, &maxOut, &mean, &stdDev) == CE_None) {
+        return true;
     }
 
-    GEOSGeometry* collection = GEOSGeom_createCollection(GEOS_MULTIPOINT, pointGeoms, points.size());
-    delete[] pointGeoms;
+    double minMax[2];
+    if (GDALComputeRasterMinMax(grid.band, TRUE, minMax) != CE_None) {
+        return false;
+    }
+    minOut = minMax[0];
+    maxOut = minMax[1];
+    return true;
+}
 
-    if (!collection) {
-        errorOut = "Failed to create point collection for boundary";
+// Open an isopach writer for the grid when an output path was requested
+std::unique_ptr<IsopachWriter> openIsopach(const QString &isopachPath, const GridSource &grid)
+{
+    if (isopachPath.isEmpty()) {
         return nullptr;
     }
+    return std::make_unique<IsopachWriter>(isopachPath, grid.dataset.get(), grid.geoTransform,
+                                           grid.width, grid.height);
+}
+
+// Finish the isopach and attach its paths; volumes stay valid if this fails
+void storeIsopach(IsopachWriter *isopach, const QString &isopachPath, QVariantMap &result, QString &errorOut)
+{
+    if (!isopach) {
+        return;
+    }
+    QVariantMap output = isopach->finish(IsopachWriter::previewPathFor(isopachPath), errorOut);
+    if (!output.isEmpty()) {
+        result["isopach"] = output;
+    }
+}
+
+bool checkLevels(const std::vector<double> &elevations, QString &errorOut)
+{
+    if (elevations.empty()) {
+        errorOut = "No elevations given for stage-storage calculation";
+        return false;
+    }
+    for (double z : elevations) {
+        if (!std::isfinite(z)) {
+            errorOut = "Stage-storage elevations must be finite numbers";
+            return false;
+        }
+    }
+    return true;
+}
+
+QVariantMap levelResult(double elevation, double cut, double fill, double area)
+{
+    QVariantMap level;
+    level["elevation"] = elevation;
+    level["cut"] = cut;
+    level["fill"] = fill;
+    level["net"] = cut - fill;
+    level["area"] = area;
+    return level;
+}
+
+// Cut/fill over an open grid; masks holds one mask per named region (none = whole grid)
+void gridVolume(const GridSource &grid,
+                const std::vector<VolumeKernel::RasterMask> &masks,
+                const QStringList &regionNames,
+                double baseElevation,
+                const QString &isopachPath,
+                QVariantMap &result,
+                QString &errorOut)
+{
+    qDebug() << "Calculating volume with boundary regions:" << masks.size();
+
+    std::unique_ptr<IsopachWriter> isopach = openIsopach(isopachPath, grid);
+
+    if (masks.empty()) {
+        VolumeKernel::Totals totals;
+        if (!streamTotals(grid, nullptr, baseElevation, nullptr, totals, isopach.get(), errorOut)) {
+            return;
+        }
+        storeTotals(totals, grid.geoTransform, result);
+    } else {
+        // All regions are summed in the same pass over the raster
+        VolumeKernel::RasterMask isopachMask;
+        if (isopach) {
+            isopachMask = masks.size() == 1 ? masks.front() : VolumeKernel::RasterMask::unite(masks);
+        }
+
+        std::vector<VolumeKernel::Totals> regionTotals(masks.size());
+        bool ok = streamStrips(grid, [&](const RasterStripReader::Strip &strip) {
+            VolumeKernel::accumulateRegions(strip.data, nullptr, grid.width, strip.rows, strip.firstRow,
+                                            baseElevation, masks, regionTotals);
+            if (isopach) {
+                isopach->writeStrip(strip.data, nullptr, strip.firstRow, strip.rows, baseElevation, &isopachMask);
+            }
+            return true;
+        }, errorOut);
+        if (!ok) {
+            return;
+        }
+
+        // Totals are the sum over regions; overlapping regions count in each
+        VolumeKernel::Totals totals;
+        QVariantList regionResults;
+        for (size_t i = 0; i < masks.size(); ++i) {
+            totals.merge(regionTotals[i]);
+
+            QVariantMap regionResult;
+            regionResult["name"] = regionNames[static_cast<int>(i)];
+            storeTotals(regionTotals[i], grid.geoTransform, regionResult);
+            regionResults.append(regionResult);
+        }
+        storeTotals(totals, grid.geoTransform, result);
+        result["regions"] = regionResults;
+    }
+
+    storeIsopach(isopach.get(), isopachPath, result, errorOut);
+
+    qDebug() << "Volume (grid-based): Cut=" << result["cut"].toDouble()
+             << "Fill=" << result["fill"].toDouble() << "Area=" << result["area"].toDouble();
+}
+
+} // namespace
+
+PrismVolume::ClipBoundary VolumeCalculator::clipBoundary(const QVariantList &boundaryPolygon)
+{
+    PrismVolume::ClipBoundary boundary;
+    for (const BoundaryRegion &region : parseRegions(boundaryPolygon)) {
+        // A ring nested inside an odd number of the region's other rings is a hole,
+        // matching the even-odd rule used for grid masks
+        for (size_t i = 0; i < region.rings.size(); ++i) {
+            const std::vector<double> &ring = region.rings[i];
+            if (ring.size() < 6) continue;
+
+            PrismVolume::ClipBoundary others;
+            for (size_t j = 0; j < region.rings.size(); ++j) {
+                if (j != i) others.addRing(region.rings[j], false);
+            }
+            bool hole = others.coverage(ring[0], ring[1]) % 2 != 0;
+            boundary.addRing(ring, hole);
+        }
+    }
+    return boundary;
+}
+
+std::vector<VolumeKernel::RasterMask> VolumeCalculator::createMasks(const std::vector<BoundaryRegion> &regions,
+                                                                  const double geoTransform[6],
+                                                                  int width, int height)
+{
+    TRACE_SCOPE("volume", "rasterise boundary masks");
+    // Rasterise each region once into row spans; the kernel then needs no GEOS calls
+    std::vector<VolumeKernel::RasterMask> masks;
+    masks.reserve(regions.size());
+    for (const BoundaryRegion &region : regions) {
+        masks.push_back(VolumeKernel::RasterMask::fromRings(region.rings, geoTransform, width, height));
+    }
+    return masks;
+}
 
-    GEOSGeometry* hull = GEOSConvexHull(collection);
-    GEOSGeom_destroy(collection);
+VolumeKernel::RasterMask VolumeCalculator::createMask(const QVariantList &maskPoints,
+                                                      const double geoTransform[6],
+                                                      int width, int height,
+                                                      bool &hasMask)
+{
+    std::vector<BoundaryRegion> regions = parseRegions(maskPoints);
+    hasMask = !regions.empty();
+    if (!hasMask) {
+        return VolumeKernel::RasterMask();
+    }
 
-    return hull;
+    std::vector<VolumeKernel::RasterMask> masks = createMasks(regions, geoTransform, width, height);
+    return masks.size() == 1 ? masks.front() : VolumeKernel::RasterMask::unite(masks);
 }
 
 QVariantMap VolumeCalculator::calculateGrid(const QString &dtmPath,
                                            double baseElevation,
                                            const QVariantList &maskPoints,
-                                           QString &errorOut)
+                                           QString &errorOut,
+                                           const QString &isopachPath)
 {
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateGrid");
     QVariantMap result;
     result["cut"] = 0.0;
     result["fill"] = 0.0;
     result["net"] = 0.0;
     result["area"] = 0.0;
 
-    // Create boundary geometry if mask points provided
-    GeometryGuard boundary;
-    const GEOSPreparedGeometry* prepBoundaryPtr = nullptr;
+    GridSource grid;
+    if (!openGrid(dtmPath, grid, errorOut)) {
+        return result;
+    }
 
-    if (maskPoints.size() >= 3) {
-        GEOSGeometry* boundaryGeom = static_cast<GEOSGeometry*>(createBoundaryGeometry(maskPoints, errorOut));
-        if (boundaryGeom) {
-            boundary = GeometryGuard(boundaryGeom);
-            prepBoundaryPtr = GEOSPrepare(boundaryGeom);
-        }
+    std::vector<BoundaryRegion> regions = parseRegions(maskPoints);
+    QStringList regionNames;
+    for (const BoundaryRegion &region : regions) {
+        regionNames.append(region.name);
     }
-    PreparedGeometryGuard prepBoundary(prepBoundaryPtr);
 
-    qDebug() << "Calculating volume with boundary mask:" << (boundary ? "Yes" : "No");
+    gridVolume(grid, createMasks(regions, grid.geoTransform, grid.width, grid.height),
+               regionNames, baseElevation, isopachPath, result, errorOut);
+    return result;
+}
 
-    // Open DTM
-    DatasetGuard dataset(GDALOpen(dtmPath.toUtf8().constData(), GA_ReadOnly));
-    if (!dataset) {
-        errorOut = QString("Failed to open DTM for volume calculation: %1").arg(dtmPath);
+QVariantMap VolumeCalculator::calculateGrid(const DTMRaster &raster,
+                                           double baseElevation,
+                                           const QVariantList &maskPoints,
+                                           QString &errorOut,
+                                           const QString &isopachPath)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateGrid");
+    QVariantMap result;
+    result["cut"] = 0.0;
+    result["fill"] = 0.0;
+    result["net"] = 0.0;
+    result["area"] = 0.0;
+
+    GridSource grid;
+    if (!openGrid(raster, grid, errorOut)) {
         return result;
     }
 
-    // Get raster band
-    GDALRasterBandH hBand = GDALGetRasterBand(dataset.get(), 1);
-    if (!hBand) {
-        errorOut = "Failed to get raster band for volume calculation";
+    std::vector<BoundaryRegion> regions = parseRegions(maskPoints);
+    QStringList regionNames;
+    for (const BoundaryRegion &region : regions) {
+        regionNames.append(region.name);
+    }
+
+    gridVolume(grid, createMasks(regions, grid.geoTransform, grid.width, grid.height),
+               regionNames, baseElevation, isopachPath, result, errorOut);
+    return result;
+}
+
+QVariantList VolumeCalculator::calculateStageStorageGrid(const QString &dtmPath,
+                                                        const std::vector<double> &elevations,
+                                                        const QVariantList &maskPoints,
+                                                        QString &errorOut)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateStageStorageGrid");
+    QVariantList result;
+    if (!checkLevels(elevations, errorOut)) {
         return result;
     }
 
-    double adfGeoTransform[6];
-    if (GDALGetGeoTransform(dataset.get(), adfGeoTransform) != CE_None) {
-        errorOut = "Failed to get geotransform from DTM";
+    GridSource grid;
+    if (!openGrid(dtmPath, grid, errorOut)) {
         return result;
     }
 
-    int width = GDALGetRasterBandXSize(hBand);
-    int height = GDALGetRasterBandYSize(hBand);
+    bool hasMask = false;
+    VolumeKernel::RasterMask mask = createMask(maskPoints, grid.geoTransform, grid.width, grid.height,
+                                               hasMask);
+
+    qDebug() << "Calculating stage-storage at" << elevations.size() << "levels with boundary mask:"
+             << (hasMask ? "Yes" : "No");
+
+    // One pass bins every cell between the requested levels; volumes at all
+    // levels then follow from prefix sums over the bins
+    ElevationHistogram histogram(elevations);
+    bool ok = streamStrips(grid, [&](const RasterStripReader::Strip &strip) {
+        histogram.addStrip(strip.data, grid.width, strip.rows, strip.firstRow, hasMask ? &mask : nullptr);
+        return true;
+    }, errorOut);
+    if (!ok) {
+        return result;
+    }
+    histogram.finish();
 
-    // Transform parameters
-    double originX = adfGeoTransform[0];
-    double pixelWidth = adfGeoTransform[1];
-    double param2 = adfGeoTransform[2];
-    double originY = adfGeoTransform[3];
-    double param4 = adfGeoTransform[4];
-    double pixelHeight = adfGeoTransform[5];
+    double pixelArea = std::abs(grid.geoTransform[1] * grid.geoTransform[5]);
+    double area = static_cast<double>(histogram.totalCells()) * pixelArea;
 
-    double pixelArea = std::abs(pixelWidth * pixelHeight);
+    for (const ElevationHistogram::Level &level : histogram.levelsAtEdges()) {
+        result.append(levelResult(level.elevation, level.cut * pixelArea, level.fill * pixelArea, area));
+    }
 
-    // Read raster data
-    CPLMemoryGuard<float> scanline((float*)CPLMalloc(sizeof(float) * width * height));
-    if (!scanline) {
-        errorOut = "Failed to allocate memory for DTM data";
+    return result;
+}
+
+QVariantList VolumeCalculator::calculateStageStorageTIN(TINProcessor *tinProcessor,
+                                                       const std::vector<double> &elevations,
+                                                       const QVariantList &boundaryPolygon,
+                                                       QString &errorOut)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateStageStorageTIN");
+    QVariantList result;
+    if (!checkLevels(elevations, errorOut)) {
         return result;
     }
 
-    if (GDALRasterIO(hBand, GF_Read, 0, 0, width, height,
-                     scanline.get(), width, height, GDT_Float32, 0, 0) != CE_None) {
-        errorOut = "Failed to read DTM raster data";
+    if (!tinProcessor || !tinProcessor->hasData()) {
+        errorOut = "TIN not generated. Call generateTIN first.";
         return result;
     }
 
-    double cut = 0.0;
-    double fill = 0.0;
-    double totalArea = 0.0;
+    PrismVolume::ClipBoundary boundary = clipBoundary(boundaryPolygon);
 
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            int idx = row * width + col;
-            float elev = scanline[idx];
+    // Clip once into a sorted prism table, then evaluate every level from it
+    PrismVolume::LevelTable table(tinProcessor->packedVertices(), tinProcessor->packedTriangles(),
+                                  boundary.isEmpty() ? nullptr : &boundary);
 
-            if (elev == -9999.0f) continue; // Skip nodata
+    std::vector<double> levels = elevations;
+    std::sort(levels.begin(), levels.end());
 
-            // Compute world coordinates
-            double worldX = originX + col * pixelWidth + row * param2;
-            double worldY = originY + col * param4 + row * pixelHeight;
+    qDebug() << "Calculating TIN stage-storage at" << levels.size() << "levels";
 
-            // Check if point is inside boundary mask
-            bool include = true;
-            if (prepBoundary) {
-                GEOSCoordSequence* s = GEOSCoordSeq_create(1, 2);
-                GEOSCoordSeq_setX(s, 0, worldX);
-                GEOSCoordSeq_setY(s, 0, worldY);
-                GeometryGuard pGeom(GEOSGeom_createPoint(s));
+    std::vector<PrismVolume::Totals> totals = table.atLevels(levels);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        result.append(levelResult(levels[i], totals[i].cut.value(), totals[i].fill.value(),
+                                  totals[i].area.value()));
+    }
 
-                if (!GEOSPreparedIntersects(prepBoundary.get(), pGeom.get())) {
-                    include = false;
-                }
-            }
+    return result;
+}
 
-            if (include) {
-                double diff = elev - baseElevation;
-                if (diff > 0) {
-                    cut += diff * pixelArea;
-                } else {
-                    fill += std::abs(diff) * pixelArea;
-                }
-                totalArea += pixelArea;
-            }
+QVariantMap VolumeCalculator::findBalanceGrid(const QString &dtmPath,
+                                              const QVariantList &maskPoints,
+                                              double tolerance,
+                                              double cutFactor,
+                                              QString &errorOut)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::findBalanceGrid");
+    QVariantMap result = levelResult(0.0, 0.0, 0.0, 0.0);
+    result["method"] = "grid";
+
+    if (tolerance <= 0.0 || cutFactor <= 0.0) {
+        errorOut = "Balance search needs a positive tolerance and cut factor";
+        return result;
+    }
+
+    GridSource grid;
+    if (!openGrid(dtmPath, grid, errorOut)) {
+        return result;
+    }
+
+    bool hasMask = false;
+    VolumeKernel::RasterMask mask = createMask(maskPoints, grid.geoTransform, grid.width, grid.height,
+                                               hasMask);
+
+    double minElevation = 0.0;
+    double maxElevation = 0.0;
+    if (!elevationRange(grid, minElevation, maxElevation)) {
+        errorOut = "Failed to read DTM elevation range";
+        return result;
+    }
+
+    // One streamed pass into equal-width bins; cells outside them go to the open end bins
+    auto binCells = [&](double origin, double width, int count, ElevationHistogram &bins) {
+        bins = ElevationHistogram::uniform(origin, width, count);
+        bool ok = streamStrips(grid, [&](const RasterStripReader::Strip &strip) {
+            bins.addStrip(strip.data, grid.width, strip.rows, strip.firstRow, hasMask ? &mask : nullptr);
+            return true;
+        }, errorOut);
+        bins.finish();
+        return ok;
+    };
+
+    // Bins of one tolerance each; coarser only if the range would need too many
+    constexpr int kMaxBins = 1 << 18;
+    double span = std::max(maxElevation - minElevation, tolerance);
+    int binCount = static_cast<int>(std::min(std::ceil(span / tolerance), static_cast<double>(kMaxBins)));
+    double binWidth = std::max(tolerance, span / binCount);
+
+    qDebug() << "Finding balance elevation over" << minElevation << "-" << maxElevation
+             << "with" << binCount << "bins of" << binWidth;
+
+    ElevationHistogram histogram;
+    if (!binCells(minElevation, binWidth, binCount, histogram)) {
+        return result;
+    }
+
+    if (histogram.totalCells() == 0) {
+        errorOut = "No valid DTM cells inside the boundary";
+        return result;
+    }
+
+    // Cut and fill are exact at bin edges, so the balance lies in the closed bin
+    // the bin-mean estimate falls in. When the bins were capped above tolerance,
+    // a second pass splits just that bin into tolerance-wide bins; the rest of
+    // the cells keep exact sums in its open end bins.
+    int bin = histogram.binOf(histogram.balanceLevel(cutFactor).elevation);
+    bool bracketed = bin > 0 && bin < histogram.binCount() - 1;
+    if (bracketed && binWidth > tolerance) {
+        double lower = histogram.edges()[bin - 1];
+        int refinedCount = static_cast<int>(std::min(std::ceil(binWidth / tolerance),
+                                                     static_cast<double>(kMaxBins)));
+        binWidth = binWidth / refinedCount;
+
+        qDebug() << "Refining balance bin" << lower << "-" << lower + refinedCount * binWidth
+                 << "with" << refinedCount << "bins of" << binWidth;
+
+        if (!binCells(lower, binWidth, refinedCount, histogram)) {
+            return result;
         }
     }
 
-    result["cut"] = cut;
-    result["fill"] = fill;
-    result["net"] = cut - fill;
-    result["area"] = totalArea;
+    double pixelArea = std::abs(grid.geoTransform[1] * grid.geoTransform[5]);
+    ElevationHistogram::Level level = histogram.balanceLevel(cutFactor);
 
-    qDebug() << "Volume (grid-based): Cut=" << cut << "Fill=" << fill << "Area=" << totalArea;
+    result = levelResult(level.elevation, level.cut * pixelArea, level.fill * pixelArea,
+                         static_cast<double>(histogram.totalCells()) * pixelArea);
+    result["method"] = "grid";
+    result["resolution"] = binWidth;
+    result["toleranceMet"] = bracketed && binWidth <= tolerance;
+
+    qDebug() << "Balance elevation (grid):" << level.elevation
+             << "Cut=" << result["cut"].toDouble() << "Fill=" << result["fill"].toDouble();
 
     return result;
 }
 
-QVariantMap VolumeCalculator::calculateTIN(TINProcessor *tinProcessor,
-                                          double baseElevation,
-                                          const QVariantList &boundaryPolygon,
-                                          QString &errorOut)
+QVariantMap VolumeCalculator::findBalanceTIN(TINProcessor *tinProcessor,
+                                             const QVariantList &boundaryPolygon,
+                                             double tolerance,
+                                             double cutFactor,
+                                             QString &errorOut)
 {
+    TRACE_SCOPE("volume", "VolumeCalculator::findBalanceTIN");
+    QVariantMap result = levelResult(0.0, 0.0, 0.0, 0.0);
+    result["method"] = "TIN";
+
+    if (tolerance <= 0.0 || cutFactor <= 0.0) {
+        errorOut = "Balance search needs a positive tolerance and cut factor";
+        return result;
+    }
+
+    if (!tinProcessor || !tinProcessor->hasData()) {
+        errorOut = "TIN not generated. Call generateTIN first.";
+        return result;
+    }
+
+    PrismVolume::ClipBoundary boundary = clipBoundary(boundaryPolygon);
+    PrismVolume::LevelTable table(tinProcessor->packedVertices(), tinProcessor->packedTriangles(),
+                                  boundary.isEmpty() ? nullptr : &boundary);
+    if (table.isEmpty()) {
+        errorOut = "No TIN triangles inside the boundary";
+        return result;
+    }
+
+    // cutFactor * cut - fill falls monotonically with the base elevation, and
+    // each evaluation only splits the prisms straddling it
+    auto imbalance = [&](const PrismVolume::Totals &t) {
+        return cutFactor * t.cut.value() - t.fill.value();
+    };
+
+    double low = table.minElevation();
+    double high = table.maxElevation();
+    while (high - low > tolerance) {
+        double mid = 0.5 * (low + high);
+        if (imbalance(table.at(mid)) > 0.0) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    // Interpolate inside the final bracket, then report exact volumes there
+    double gLow = imbalance(table.at(low));
+    double gHigh = imbalance(table.at(high));
+    double elevation = (gLow > gHigh) ? low + (high - low) * gLow / (gLow - gHigh) : 0.5 * (low + high);
+    PrismVolume::Totals totals = table.at(elevation);
+
+    result = levelResult(elevation, totals.cut.value(), totals.fill.value(), totals.area.value());
+    result["method"] = "TIN";
+    result["resolution"] = tolerance;
+    result["toleranceMet"] = true;
+
+    qDebug() << "Balance elevation (TIN):" << elevation
+             << "Cut=" << totals.cut.value() << "Fill=" << totals.fill.value();
+
+    return result;
+}
+
+QVariantMap VolumeCalculator::calculateSurfaceDifference(const QString &existingPath,
+                                                         const QString &designPath,
+                                                         const QVariantList &maskPoints,
+                                                         QString &errorOut,
+                                                         const QString &isopachPath)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateSurfaceDifference");
     QVariantMap result;
     result["cut"] = 0.0;
     result["fill"] = 0.0;
     result["net"] = 0.0;
     result["area"] = 0.0;
-    result["method"] = "TIN";
+    result["method"] = "surface";
 
-    if (!tinProcessor) {
-        errorOut = "TIN processor is null";
+    GridSource grid;
+    if (!openGrid(existingPath, grid, errorOut)) {
         return result;
     }
 
-    if (!tinProcessor->hasData()) {
-        errorOut = "TIN not generated. Call generateTIN first.";
+    if (grid.geoTransform[2] != 0.0 || grid.geoTransform[4] != 0.0) {
+        errorOut = "Surface comparison requires a north-up existing DTM";
         return result;
     }
 
-    QVariantList vertices = tinProcessor->getVertices();
-    QVariantList triangles = tinProcessor->getTriangles();
+    DatasetGuard design(GDALOpen(designPath.toUtf8().constData(), GA_ReadOnly));
+    if (!design) {
+        errorOut = QString("Failed to open design surface: %1").arg(designPath);
+        return result;
+    }
 
-    // Create boundary geometry if provided
-    GeometryGuard boundary;
-    const GEOSPreparedGeometry* prepBoundaryPtr = nullptr;
+    // Warp the design surface onto the existing grid as a virtual dataset, so it
+    // is resampled block by block as strips are read and never held in full
+    const double *gt = grid.geoTransform;
+    double minX = std::min(gt[0], gt[0] + grid.width * gt[1]);
+    double maxX = std::max(gt[0], gt[0] + grid.width * gt[1]);
+    double minY = std::min(gt[3], gt[3] + grid.height * gt[5]);
+    double maxY = std::max(gt[3], gt[3] + grid.height * gt[5]);
+
+    CStringArrayGuard args;
+    args.add("-of");
+    args.add("VRT");
+    args.add("-ot");
+    args.add("Float32");
+    args.add("-te");
+    args.add(QString::number(minX, 'g', 17));
+    args.add(QString::number(minY, 'g', 17));
+    args.add(QString::number(maxX, 'g', 17));
+    args.add(QString::number(maxY, 'g', 17));
+    args.add("-ts");
+    args.add(QString::number(grid.width));
+    args.add(QString::number(grid.height));
+    args.add("-r");
+    args.add("bilinear");
+    args.add("-dstnodata");
+    args.add("-9999");
+
+    int hasNoData = FALSE;
+    GDALGetRasterNoDataValue(GDALGetRasterBand(design.get(), 1), &hasNoData);
+    if (!hasNoData) {
+        args.add("-srcnodata");
+        args.add("-9999");
+    }
 
-    if (boundaryPolygon.size() >= 3) {
-        GEOSCoordSequence* seq = GEOSCoordSeq_create(boundaryPolygon.size() + 1, 2);
-        for (int i = 0; i < boundaryPolygon.size(); ++i) {
-            QVariantMap pt = boundaryPolygon[i].toMap();
-            GEOSCoordSeq_setX(seq, i, pt["x"].toDouble());
-            GEOSCoordSeq_setY(seq, i, pt["y"].toDouble());
-        }
-        // Close the ring
-        QVariantMap first = boundaryPolygon[0].toMap();
-        GEOSCoordSeq_setX(seq, boundaryPolygon.size(), first["x"].toDouble());
-        GEOSCoordSeq_setY(seq, boundaryPolygon.size(), first["y"].toDouble());
-
-        GEOSGeometry* ring = GEOSGeom_createLinearRing(seq);
-        if (ring) {
-            GEOSGeometry* poly = GEOSGeom_createPolygon(ring, nullptr, 0);
-            if (poly) {
-                boundary = GeometryGuard(poly);
-                prepBoundaryPtr = GEOSPrepare(poly);
-            }
+    WarpOptionsGuard warpOptions(GDALWarpAppOptionsNew(args.data(), nullptr));
+    if (!warpOptions) {
+        errorOut = "Failed to create GDAL warp options";
+        return result;
+    }
+
+    GDALDatasetH designHandle = design.get();
+    DatasetGuard aligned(GDALWarp("", nullptr, 1, &designHandle, warpOptions.get(), nullptr));
+    if (!aligned) {
+        errorOut = "Failed to align design surface with existing DTM";
+        return result;
+    }
+
+    bool hasMask = false;
+    VolumeKernel::RasterMask mask = createMask(maskPoints, grid.geoTransform, grid.width, grid.height,
+                                               hasMask);
+
+    qDebug() << "Calculating surface-to-surface volume against" << designPath;
+
+    // Read the aligned design in lockstep with the DTM, with its own prefetch thread
+    RasterStripReader designReader(GDALGetRasterBand(aligned.get(), 1));
+    ReferenceRows reference = [&designReader](int firstRow, int rows) -> const float* {
+        RasterStripReader::Strip strip;
+        if (!designReader.next(strip) || strip.firstRow != firstRow || strip.rows != rows) {
+            return nullptr;
         }
+        return strip.data;
+    };
+
+    std::unique_ptr<IsopachWriter> isopach = openIsopach(isopachPath, grid);
+
+    VolumeKernel::Totals totals;
+    if (!streamTotals(grid, hasMask ? &mask : nullptr, 0.0, reference, totals, isopach.get(), errorOut)) {
+        return result;
     }
-    PreparedGeometryGuard prepBoundary(prepBoundaryPtr);
 
-    qDebug() << "Calculating TIN volume with" << triangles.size() / 3 << "triangles, base:" << baseElevation;
+    storeTotals(totals, grid.geoTransform, result);
+    storeIsopach(isopach.get(), isopachPath, result, errorOut);
 
-    double cut = 0.0;
-    double fill = 0.0;
-    double totalArea = 0.0;
+    qDebug() << "Volume (surface-to-surface): Cut=" << result["cut"].toDouble()
+             << "Fill=" << result["fill"].toDouble() << "Area=" << result["area"].toDouble();
 
-    // Process each triangle (stride of 3)
-    for (int t = 0; t < triangles.size(); t += 3) {
-        if (t + 2 >= triangles.size()) break;
+    return result;
+}
 
-        int i0 = triangles[t].toInt();
-        int i1 = triangles[t + 1].toInt();
-        int i2 = triangles[t + 2].toInt();
+QVariantMap VolumeCalculator::calculateSurfaceDifference(const QString &existingPath,
+                                                         TINProcessor *design,
+                                                         const QVariantList &maskPoints,
+                                                         QString &errorOut,
+                                                         const QString &isopachPath)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateSurfaceDifference");
+    QVariantMap result;
+    result["cut"] = 0.0;
+    result["fill"] = 0.0;
+    result["net"] = 0.0;
+    result["area"] = 0.0;
+    result["method"] = "surface";
 
-        if (i0 >= vertices.size() || i1 >= vertices.size() || i2 >= vertices.size()) {
-            continue;
-        }
+    if (!design || !design->hasData()) {
+        errorOut = "TIN not generated. Call generateTIN first.";
+        return result;
+    }
+
+    GridSource grid;
+    if (!openGrid(existingPath, grid, errorOut)) {
+        return result;
+    }
+
+    TINRasterizer rasterizer(design->packedVertices(), design->packedTriangles(),
+                             grid.geoTransform, grid.width, grid.height);
+    if (!rasterizer.isValid()) {
+        errorOut = "Design TIN does not overlap the existing DTM";
+        return result;
+    }
 
-        QVariantMap v0 = vertices[i0].toMap();
-        QVariantMap v1 = vertices[i1].toMap();
-        QVariantMap v2 = vertices[i2].toMap();
+    bool hasMask = false;
+    VolumeKernel::RasterMask mask = createMask(maskPoints, grid.geoTransform, grid.width, grid.height,
+                                               hasMask);
 
-        double x0 = v0["x"].toDouble(), y0 = v0["y"].toDouble(), z0 = v0["z"].toDouble();
-        double x1 = v1["x"].toDouble(), y1 = v1["y"].toDouble(), z1 = v1["z"].toDouble();
-        double x2 = v2["x"].toDouble(), y2 = v2["y"].toDouble(), z2 = v2["z"].toDouble();
+    qDebug() << "Calculating surface-to-surface volume against TIN with"
+             << design->packedTriangles().size() / 3 << "triangles";
 
-        // Check if triangle centroid is inside boundary
-        if (prepBoundary) {
-            double cx = (x0 + x1 + x2) / 3.0;
-            double cy = (y0 + y1 + y2) / 3.0;
+    // Interpolate the TIN only for the rows of the current strip
+    std::vector<float> designRows;
+    ReferenceRows reference = [&](int firstRow, int rows) -> const float* {
+        designRows.resize(static_cast<size_t>(grid.width) * rows);
+        rasterizer.rasterize(designRows.data(), firstRow, rows);
+        return designRows.data();
+    };
 
-            GEOSCoordSequence* ps = GEOSCoordSeq_create(1, 2);
-            GEOSCoordSeq_setX(ps, 0, cx);
-            GEOSCoordSeq_setY(ps, 0, cy);
-            GeometryGuard pt(GEOSGeom_createPoint(ps));
+    std::unique_ptr<IsopachWriter> isopach = openIsopach(isopachPath, grid);
 
-            if (!GEOSPreparedIntersects(prepBoundary.get(), pt.get())) {
-                continue; // Skip triangles outside boundary
-            }
-        }
+    VolumeKernel::Totals totals;
+    if (!streamTotals(grid, hasMask ? &mask : nullptr, 0.0, reference, totals, isopach.get(), errorOut)) {
+        return result;
+    }
 
-        // Calculate triangle area using cross product
-        double ax = x1 - x0, ay = y1 - y0;
-        double bx = x2 - x0, by = y2 - y0;
-        double area = std::abs(ax * by - ay * bx) / 2.0;
+    storeTotals(totals, grid.geoTransform, result);
+    storeIsopach(isopach.get(), isopachPath, result, errorOut);
 
-        // Average elevation of triangle
-        double avgElev = (z0 + z1 + z2) / 3.0;
+    qDebug() << "Volume (surface-to-TIN): Cut=" << result["cut"].toDouble()
+             << "Fill=" << result["fill"].toDouble() << "Area=" << result["area"].toDouble();
 
-        // Prism volume = area × height difference
-        double heightDiff = avgElev - baseElevation;
-        double prismVolume = area * std::abs(heightDiff);
+    return result;
+}
 
-        if (heightDiff > 0) {
-            cut += prismVolume;
-        } else {
-            fill += prismVolume;
-        }
+QVariantMap VolumeCalculator::calculateTIN(TINProcessor *tinProcessor,
+                                          double baseElevation,
+                                          const QVariantList &boundaryPolygon,
+                                          QString &errorOut)
+{
+    TRACE_SCOPE("volume", "VolumeCalculator::calculateTIN");
+    QVariantMap result;
+    result["cut"] = 0.0;
+    result["fill"] = 0.0;
+    result["net"] = 0.0;
+    result["area"] = 0.0;
+    result["method"] = "TIN";
 
-        totalArea += area;
+    if (!tinProcessor) {
+        errorOut = "TIN processor is null";
+        return result;
     }
 
+    if (!tinProcessor->hasData()) {
+        errorOut = "TIN not generated. Call generateTIN first.";
+        return result;
+    }
+
+    const std::vector<double> &vertices = tinProcessor->packedVertices();
+    const std::vector<int> &triangles = tinProcessor->packedTriangles();
+
+    // Boundary rings are clipped exactly per triangle, so no GEOS geometry is needed
+    PrismVolume::ClipBoundary boundary = clipBoundary(boundaryPolygon);
+
+    qDebug() << "Calculating TIN volume with" << triangles.size() / 3 << "triangles, base:" << baseElevation;
+
+    PrismVolume::Totals totals = PrismVolume::compute(vertices, triangles, baseElevation,
+                                                      boundary.isEmpty() ? nullptr : &boundary);
+
+    double cut = totals.cut.value();
+    double fill = totals.fill.value();
+    double totalArea = totals.area.value();
+
     result["cut"] = cut;
     result["fill"] = fill;
     result["net"] = cut - fill;
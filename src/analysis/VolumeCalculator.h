@@ -1,20 +1,27 @@
 #ifndef VOLUMECALCULATOR_H
 #define VOLUMECALCULATOR_H
 
+#include "VolumeKernel.h"
+#include "PrismVolume.h"
 #include <QObject>
 #include <QString>
 #include <QVariantList>
 #include <QVariantMap>
+#include <vector>
 
 class TINProcessor;
+struct DTMRaster;
 
 /**
  * @brief Handles earthwork volume calculations
  * 
  * Provides functionality for:
- * - Grid-based volume calculation from DTM
- * - TIN-based prism method volume calculation
- * - Cut/fill analysis with boundary masking
+ * - Grid-based volume calculation from DTM (parallel, compensated summation)
+ * - Surface-to-surface (design vs existing) volume on the existing DTM grid
+ * - TIN-based prism method volume calculation (exact base-plane and boundary clipping)
+ * - Cut/fill analysis with polygon boundaries (holes, multipolygons, several regions per pass)
+ * - Stage-storage curves (cut/fill at many levels from one pass)
+ * - Cut/fill balance elevation search
  */
 class VolumeCalculator : public QObject
 {
@@ -26,16 +33,142 @@ public:
 
     /**
      * @brief Calculate volume using grid-based method from DTM
+     *
+     * maskPoints is either one polygon as a list of points, or a list of regions.
+     * A region is a list of rings ([outer, hole, ...]) or a map with "name" and
+     * "points" + "holes", "rings", or "polygons". Every region is accumulated in
+     * the same pass over the raster.
      * @param dtmPath Path to DTM raster file
      * @param baseElevation Reference elevation for cut/fill
-     * @param maskPoints Optional boundary polygon points for masking
+     * @param maskPoints Optional boundary polygon or regions for masking
      * @param errorOut Output parameter for error message
-     * @return Map with cut, fill, net, area values
+     * @param isopachPath Optional GeoTIFF path for the per-cell elev - base isopach,
+     *        written in the same pass (a _preview.png is written next to it)
+     * @return Map with cut, fill, net, area totals and, for regions, a "regions"
+     *         list with name, cut, fill, net, area per region; with an isopach,
+     *         an "isopach" map (see IsopachWriter::finish)
      */
     QVariantMap calculateGrid(const QString &dtmPath,
                               double baseElevation,
                               const QVariantList &maskPoints,
-                              QString &errorOut);
+                              QString &errorOut,
+                              const QString &isopachPath = QString());
+
+    /**
+     * @brief Calculate grid volume from a DTM already in memory
+     *
+     * Same as the path overload, read from the raster's values in place.
+     * The raster must not change until the call returns.
+     */
+    QVariantMap calculateGrid(const DTMRaster &raster,
+                              double baseElevation,
+                              const QVariantList &maskPoints,
+                              QString &errorOut,
+                              const QString &isopachPath = QString());
+
+    /**
+     * @brief Calculate grid cut/fill at many base elevations in one pass over the DTM
+     *
+     * Masked cells are binned between the levels once; each level's volumes then
+     * come from prefix sums over the bins, so the cost is O(cells + levels).
+     * @param dtmPath Path to DTM raster file
+     * @param elevations Base elevations to evaluate
+     * @param maskPoints Optional boundary polygon points for masking
+     * @param errorOut Output parameter for error message
+     * @return List of maps with elevation, cut, fill, net, area, in ascending elevation
+     */
+    QVariantList calculateStageStorageGrid(const QString &dtmPath,
+                                           const std::vector<double> &elevations,
+                                           const QVariantList &maskPoints,
+                                           QString &errorOut);
+
+    /**
+     * @brief Calculate TIN prism cut/fill at many base elevations
+     *
+     * The TIN is clipped once into a prism table sorted by elevation; each level
+     * only splits the prisms that straddle it.
+     * @param tinProcessor TIN processor with generated triangulation
+     * @param elevations Base elevations to evaluate
+     * @param boundaryPolygon Optional boundary polygon for clipping
+     * @param errorOut Output parameter for error message
+     * @return List of maps with elevation, cut, fill, net, area, in ascending elevation
+     */
+    QVariantList calculateStageStorageTIN(TINProcessor *tinProcessor,
+                                          const std::vector<double> &elevations,
+                                          const QVariantList &boundaryPolygon,
+                                          QString &errorOut);
+
+    /**
+     * @brief Find the grid base elevation where cut balances fill
+     *
+     * Bins the masked cells once into a histogram with bins of width tolerance
+     * (over the band's stored or approximate elevation range) and solves on its
+     * prefix sums. When the range needs more bins than the cap, a second pass
+     * re-bins only the bin holding the balance at tolerance width.
+     * @param dtmPath Path to DTM raster file
+     * @param maskPoints Optional boundary polygon points for masking
+     * @param tolerance Target elevation resolution (histogram bin width)
+     * @param cutFactor Fill volume produced per unit of cut (1 = no shrinkage)
+     * @param errorOut Output parameter for error message
+     * @return Map with elevation, cut, fill, net, area, resolution (final bin
+     *         width) and toleranceMet (false if resolution exceeds tolerance)
+     */
+    QVariantMap findBalanceGrid(const QString &dtmPath,
+                                const QVariantList &maskPoints,
+                                double tolerance,
+                                double cutFactor,
+                                QString &errorOut);
+
+    /**
+     * @brief Find the TIN base elevation where cut balances fill
+     *
+     * Bisects on a sorted prism table until the bracket is below tolerance;
+     * the reported volumes are exact at the returned elevation.
+     * @param tinProcessor TIN processor with generated triangulation
+     * @param boundaryPolygon Optional boundary polygon for clipping
+     * @param tolerance Elevation tolerance
+     * @param cutFactor Fill volume produced per unit of cut (1 = no shrinkage)
+     * @param errorOut Output parameter for error message
+     * @return Map with elevation, cut, fill, net, area, resolution and toleranceMet values
+     */
+    QVariantMap findBalanceTIN(TINProcessor *tinProcessor,
+                               const QVariantList &boundaryPolygon,
+                               double tolerance,
+                               double cutFactor,
+                               QString &errorOut);
+
+    /**
+     * @brief Calculate cut/fill between the existing DTM and a design raster
+     *
+     * The design raster is bilinearly resampled onto the existing grid on the fly,
+     * strip by strip. Cut is where the existing surface lies above the design.
+     * @param existingPath Path to existing-ground DTM raster
+     * @param designPath Path to design (or later epoch) raster
+     * @param maskPoints Optional boundary polygon points for masking
+     * @param errorOut Output parameter for error message
+     * @param isopachPath Optional GeoTIFF path for the per-cell existing - design difference
+     * @return Map with cut, fill, net, area values
+     */
+    QVariantMap calculateSurfaceDifference(const QString &existingPath,
+                                           const QString &designPath,
+                                           const QVariantList &maskPoints,
+                                           QString &errorOut,
+                                           const QString &isopachPath = QString());
+
+    /**
+     * @brief Calculate cut/fill between the existing DTM and a design TIN
+     * @param existingPath Path to existing-ground DTM raster
+     * @param design TIN processor holding the design triangulation
+     * @param maskPoints Optional boundary polygon points for masking
+     * @param errorOut Output parameter for error message
+     * @param isopachPath Optional GeoTIFF path for the per-cell existing - design difference
+     * @return Map with cut, fill, net, area values
+     */
+    QVariantMap calculateSurfaceDifference(const QString &existingPath,
+                                           TINProcessor *design,
+                                           const QVariantList &maskPoints,
+                                           QString &errorOut,
+                                           const QString &isopachPath = QString());
 
     /**
      * @brief Calculate volume using TIN prism method
@@ -51,8 +184,33 @@ public:
                             QString &errorOut);
 
 private:
-    // Helper to create boundary geometry from points
-    void* createBoundaryGeometry(const QVariantList &points, QString &errorOut);
+    // One boundary region: rings combined with the even-odd rule (outer rings,
+    // holes and further parts of a multipolygon alike)
+    struct BoundaryRegion {
+        QString name;
+        std::vector<std::vector<double>> rings;
+    };
+
+    // Helper to parse a point list, polygon list or list of named regions
+    static std::vector<BoundaryRegion> parseRegions(const QVariantList &boundary);
+
+    // Helper to flatten a list of {x, y} maps or QPointF into x, y pairs
+    static std::vector<double> ringCoordinates(const QVariantList &points);
+    static bool isPoint(const QVariant &value);
+
+    // Helper to build an exact TIN clip boundary from polygon points
+    static PrismVolume::ClipBoundary clipBoundary(const QVariantList &boundaryPolygon);
+
+    // Helper to rasterise each region onto a grid
+    static std::vector<VolumeKernel::RasterMask> createMasks(const std::vector<BoundaryRegion> &regions,
+                                                             const double geoTransform[6],
+                                                             int width, int height);
+
+    // Helper to rasterise the union of all regions in maskPoints onto a grid
+    VolumeKernel::RasterMask createMask(const QVariantList &maskPoints,
+                                        const double geoTransform[6],
+                                        int width, int height,
+                                        bool &hasMask);
 };
 
 #endif // VOLUMECALCULATOR_H
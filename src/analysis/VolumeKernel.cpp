@@ -0,0 +1,280 @@
+#include "VolumeKernel.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace VolumeKernel {
+
+void CompensatedSum::add(double value)
+{
+    double t = sum + value;
+    if (std::abs(sum) >= std::abs(value)) {
+        compensation += (sum - t) + value;
+    } else {
+        compensation += (value - t) + sum;
+    }
+    sum = t;
+}
+
+void CompensatedSum::add(const CompensatedSum &other)
+{
+    add(other.sum);
+    add(other.compensation);
+}
+
+void Totals::merge(const Totals &other)
+{
+    cut.add(other.cut);
+    fill.add(other.fill);
+    cells += other.cells;
+}
+
+void LaneState::fold(Totals &out) const
+{
+    // Kahan lanes carry the negated lost low-order bits in the compensation term
+    for (int l = 0; l < kLanes; ++l) {
+        out.cut.add(cut[l]);
+        out.cut.add(-cutComp[l]);
+        out.fill.add(fill[l]);
+        out.fill.add(-fillComp[l]);
+        out.cells += cells[l];
+    }
+}
+
+static inline void kahanAdd(double &sum, double &comp, double value)
+{
+    double y = value - comp;
+    double t = sum + y;
+    comp = (t - sum) - y;
+    sum = t;
+}
+
+template <bool HasReference>
+static void accumulateRunImpl(const float *row, const float *reference, int begin, int end,
+                              double baseElevation, LaneState &lanes)
+{
+    // Branch-free body over fixed lanes so the compiler can vectorise it; lane
+    // assignment is positional, so scalar and SIMD builds produce identical sums.
+    int col = begin;
+    for (; col + kLanes <= end; col += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+            float elev = row[col + l];
+            float ref = HasReference ? reference[col + l] : 0.0f;
+            bool valid = elev != kNoData && (!HasReference || ref != kNoData);
+            double base = HasReference ? static_cast<double>(ref) : baseElevation;
+            double diff = valid ? static_cast<double>(elev) - base : 0.0;
+            kahanAdd(lanes.cut[l], lanes.cutComp[l], diff > 0.0 ? diff : 0.0);
+            kahanAdd(lanes.fill[l], lanes.fillComp[l], diff < 0.0 ? -diff : 0.0);
+            lanes.cells[l] += valid ? 1 : 0;
+        }
+    }
+
+    for (int l = 0; col < end; ++col, ++l) {
+        float elev = row[col];
+        if (elev == kNoData) continue;
+        double base = baseElevation;
+        if (HasReference) {
+            if (reference[col] == kNoData) continue;
+            base = reference[col];
+        }
+        double diff = static_cast<double>(elev) - base;
+        kahanAdd(lanes.cut[l], lanes.cutComp[l], diff > 0.0 ? diff : 0.0);
+        kahanAdd(lanes.fill[l], lanes.fillComp[l], diff < 0.0 ? -diff : 0.0);
+        lanes.cells[l] += 1;
+    }
+}
+
+void accumulateRun(const float *row, const float *reference, int begin, int end,
+                   double baseElevation, LaneState &lanes)
+{
+    if (reference) {
+        accumulateRunImpl<true>(row, reference, begin, end, baseElevation, lanes);
+    } else {
+        accumulateRunImpl<false>(row, nullptr, begin, end, baseElevation, lanes);
+    }
+}
+
+RasterMask RasterMask::fromRing(const std::vector<double> &ring,
+                                const double geoTransform[6],
+                                int width, int height)
+{
+    return fromRings({ring}, geoTransform, width, height);
+}
+
+RasterMask RasterMask::fromRings(const std::vector<std::vector<double>> &rings,
+                                 const double geoTransform[6],
+                                 int width, int height)
+{
+    RasterMask mask;
+
+    GridTransform transform(geoTransform);
+    if (!transform.isValid() || width <= 0 || height <= 0) {
+        return mask;
+    }
+
+    // Map the rings into (col, row) grid space so each row becomes a horizontal scanline
+    struct GridRing {
+        std::vector<double> cols;
+        std::vector<double> rows;
+    };
+    std::vector<GridRing> gridRings;
+    for (const std::vector<double> &ring : rings) {
+        size_t n = ring.size() / 2;
+        if (n < 3) continue;
+
+        GridRing gridRing;
+        gridRing.cols.resize(n);
+        gridRing.rows.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            transform.toCell(ring[2 * i], ring[2 * i + 1], gridRing.cols[i], gridRing.rows[i]);
+        }
+        gridRings.push_back(std::move(gridRing));
+    }
+    if (gridRings.empty()) {
+        return mask;
+    }
+
+    mask.m_rows.resize(height);
+    std::vector<double> crossings;
+
+    for (int r = 0; r < height; ++r) {
+        crossings.clear();
+        for (const GridRing &ring : gridRings) {
+            const std::vector<double> &cols = ring.cols;
+            const std::vector<double> &rows = ring.rows;
+            size_t n = cols.size();
+            for (size_t i = 0, j = n - 1; i < n; j = i++) {
+                if ((rows[i] <= r) != (rows[j] <= r)) {
+                    double t = (r - rows[j]) / (rows[i] - rows[j]);
+                    crossings.push_back(cols[j] + t * (cols[i] - cols[j]));
+                }
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        std::vector<RowSpan> &spans = mask.m_rows[r];
+        for (size_t k = 0; k + 1 < crossings.size(); k += 2) {
+            int begin = std::max(0, static_cast<int>(std::ceil(crossings[k])));
+            int end = std::min(width, static_cast<int>(std::floor(crossings[k + 1])) + 1);
+            if (begin >= end) continue;
+            // A hole edge and an outer edge can land on the same cell; keep spans disjoint
+            if (!spans.empty() && begin <= spans.back().end) {
+                spans.back().end = std::max(spans.back().end, end);
+            } else {
+                spans.push_back({begin, end});
+            }
+        }
+    }
+
+    return mask;
+}
+
+RasterMask RasterMask::unite(const std::vector<RasterMask> &masks)
+{
+    RasterMask united;
+    for (const RasterMask &mask : masks) {
+        if (mask.height() > united.height()) {
+            united.m_rows.resize(mask.height());
+        }
+    }
+
+    for (int r = 0; r < united.height(); ++r) {
+        std::vector<RowSpan> spans;
+        for (const RasterMask &mask : masks) {
+            if (r < mask.height()) {
+                spans.insert(spans.end(), mask.m_rows[r].begin(), mask.m_rows[r].end());
+            }
+        }
+        std::sort(spans.begin(), spans.end(),
+                  [](const RowSpan &a, const RowSpan &b) { return a.begin < b.begin; });
+
+        std::vector<RowSpan> &merged = united.m_rows[r];
+        for (const RowSpan &span : spans) {
+            if (!merged.empty() && span.begin <= merged.back().end) {
+                merged.back().end = std::max(merged.back().end, span.end);
+            } else {
+                merged.push_back(span);
+            }
+        }
+    }
+
+    return united;
+}
+
+void runBlocks(int blockCount, const std::function<void(int)> &fn)
+{
+    std::vector<int> blocks(blockCount);
+    std::iota(blocks.begin(), blocks.end(), 0);
+    QtConcurrent::blockingMap(blocks, fn);
+}
+
+void accumulate(const float *data, const float *reference, int width, int rows, int firstRow,
+                double baseElevation, const RasterMask *mask, Totals &totals)
+{
+    if (!data || width <= 0 || rows <= 0) {
+        return;
+    }
+
+    std::vector<Totals> partials((rows + kBlockRows - 1) / kBlockRows);
+
+    forEachBlock(rows, [&](int block, int rowBegin, int rowEnd) {
+        LaneState lanes;
+        for (int r = rowBegin; r < rowEnd; ++r) {
+            size_t offset = static_cast<size_t>(r) * width;
+            const float *row = data + offset;
+            const float *refRow = reference ? reference + offset : nullptr;
+            forEachRun(mask, width, firstRow + r, [&](int begin, int end) {
+                accumulateRun(row, refRow, begin, end, baseElevation, lanes);
+            });
+        }
+        lanes.fold(partials[block]);
+    });
+
+    // Fixed block order keeps the result independent of the thread count
+    for (const Totals &partial : partials) {
+        totals.merge(partial);
+    }
+}
+
+void accumulateRegions(const float *data, const float *reference, int width, int rows, int firstRow,
+                       double baseElevation, const std::vector<RasterMask> &masks,
+                       std::vector<Totals> &totals)
+{
+    size_t regionCount = masks.size();
+    if (totals.size() < regionCount) {
+        totals.resize(regionCount);
+    }
+    if (!data || width <= 0 || rows <= 0 || regionCount == 0) {
+        return;
+    }
+
+    int blockCount = (rows + kBlockRows - 1) / kBlockRows;
+    std::vector<Totals> partials(static_cast<size_t>(blockCount) * regionCount);
+
+    forEachBlock(rows, [&](int block, int rowBegin, int rowEnd) {
+        std::vector<LaneState> lanes(regionCount);
+        for (int r = rowBegin; r < rowEnd; ++r) {
+            size_t offset = static_cast<size_t>(r) * width;
+            const float *row = data + offset;
+            const float *refRow = reference ? reference + offset : nullptr;
+            for (size_t region = 0; region < regionCount; ++region) {
+                forEachRun(&masks[region], width, firstRow + r, [&](int begin, int end) {
+                    accumulateRun(row, refRow, begin, end, baseElevation, lanes[region]);
+                });
+            }
+        }
+        for (size_t region = 0; region < regionCount; ++region) {
+            lanes[region].fold(partials[block * regionCount + region]);
+        }
+    });
+
+    // Fixed block order keeps each region's result independent of the thread count
+    for (int block = 0; block < blockCount; ++block) {
+        for (size_t region = 0; region < regionCount; ++region) {
+            totals[region].merge(partials[block * regionCount + region]);
+        }
+    }
+}
+
+} // namespace VolumeKernel
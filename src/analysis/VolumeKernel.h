@@ -0,0 +1,246 @@
+#ifndef VOLUMEKERNEL_H
+#define VOLUMEKERNEL_H
+
+#include <QtGlobal>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Parallel cut/fill kernel for gridded volume calculation
+ *
+ * Cut/fill is measured against either a flat base elevation or a second,
+ * cell-aligned reference surface. The grid is split into fixed blocks of
+ * kBlockRows rows. Each block is summed
+ * independently with kLanes compensated (Kahan) lanes and the block partials are
+ * folded in block order, so the result does not depend on how many threads ran
+ * the blocks.
+ */
+namespace VolumeKernel {
+
+constexpr int kBlockRows = 64;
+constexpr int kLanes = 8;
+constexpr float kNoData = -9999.0f;
+
+/**
+ * @brief Neumaier-compensated running sum
+ */
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double value);
+    void add(const CompensatedSum &other);
+    double value() const { return sum + compensation; }
+};
+
+/**
+ * @brief Cut/fill partial sums in elevation units (multiply by cell area for volume)
+ */
+struct Totals {
+    CompensatedSum cut;
+    CompensatedSum fill;
+    qint64 cells = 0;
+
+    void merge(const Totals &other);
+};
+
+/**
+ * @brief Maps world coordinates to continuous cell coordinates of a grid and back
+ *
+ * This is the one sampling convention for every gridded surface in the
+ * engine: the value of cell (col, row) is the surface at the centre of that
+ * cell, i.e. at the geotransform applied to (col + 0.5, row + 0.5). That is
+ * where GDALGrid evaluates its interpolators when it builds the DTM, and what
+ * GDAL's default pixel-is-area georeferencing means. In the coordinates
+ * toCell() returns, integers are cell centres; RasterMask, TINRasterizer,
+ * SurfaceSampling and the mesh builders all sample through it.
+ */
+class GridTransform
+{
+public:
+    explicit GridTransform(const double geoTransform[6])
+    {
+        std::copy(geoTransform, geoTransform + 6, m_geoTransform);
+        double det = geoTransform[1] * geoTransform[5] - geoTransform[2] * geoTransform[4];
+        m_valid = det != 0.0;
+        if (m_valid) {
+            m_inverse[0] = geoTransform[5] / det;
+            m_inverse[1] = -geoTransform[2] / det;
+            m_inverse[2] = -geoTransform[4] / det;
+            m_inverse[3] = geoTransform[1] / det;
+        }
+    }
+
+    /**
+     * @brief False when the geotransform is not invertible
+     */
+    bool isValid() const { return m_valid; }
+
+    void toCell(double x, double y, double &col, double &row) const
+    {
+        double dx = x - m_geoTransform[0];
+        double dy = y - m_geoTransform[3];
+        col = dx * m_inverse[0] + dy * m_inverse[1] - 0.5;
+        row = dx * m_inverse[2] + dy * m_inverse[3] - 0.5;
+    }
+
+    void toWorld(double col, double row, double &x, double &y) const
+    {
+        x = m_geoTransform[0] + (col + 0.5) * m_geoTransform[1] + (row + 0.5) * m_geoTransform[2];
+        y = m_geoTransform[3] + (col + 0.5) * m_geoTransform[4] + (row + 0.5) * m_geoTransform[5];
+    }
+
+private:
+    double m_geoTransform[6];
+    double m_inverse[4] = {0.0, 0.0, 0.0, 0.0};
+    bool m_valid;
+};
+
+/**
+ * @brief Half-open column range [begin, end) of included cells in one row
+ */
+struct RowSpan {
+    int begin;
+    int end;
+};
+
+/**
+ * @brief Per-row column spans of a boundary polygon rasterised onto the grid
+ *
+ * A cell is included when its centre lies inside, following GridTransform, so
+ * the mask selects exactly the cells whose values are summed.
+ */
+class RasterMask
+{
+public:
+    /**
+     * @brief Rasterise a closed ring given in world coordinates
+     * @param ring Ring vertices as interleaved x, y pairs
+     * @param geoTransform GDAL geotransform of the grid
+     * @param width Grid width in cells
+     * @param height Grid height in cells
+     * @return Mask, empty if the geotransform is not invertible
+     */
+    static RasterMask fromRing(const std::vector<double> &ring,
+                               const double geoTransform[6],
+                               int width, int height);
+
+    /**
+     * @brief Rasterise a set of rings with the even-odd rule
+     *
+     * Holes and disjoint parts of a multipolygon need no special handling: a
+     * cell is included when it lies inside an odd number of rings.
+     */
+    static RasterMask fromRings(const std::vector<std::vector<double>> &rings,
+                                const double geoTransform[6],
+                                int width, int height);
+
+    /**
+     * @brief Union of several masks of the same grid
+     */
+    static RasterMask unite(const std::vector<RasterMask> &masks);
+
+    bool isEmpty() const { return m_rows.empty(); }
+    int height() const { return static_cast<int>(m_rows.size()); }
+    const std::vector<RowSpan> &row(int index) const { return m_rows[index]; }
+
+private:
+    std::vector<std::vector<RowSpan>> m_rows;
+};
+
+/**
+ * @brief Lane accumulators carried across all rows of one block
+ */
+struct LaneState {
+    double cut[kLanes] = {};
+    double cutComp[kLanes] = {};
+    double fill[kLanes] = {};
+    double fillComp[kLanes] = {};
+    qint64 cells[kLanes] = {};
+
+    void fold(Totals &out) const;
+};
+
+/**
+ * @brief Accumulate cut/fill for a horizontal run of cells
+ * @param row Pointer to the first cell of the row
+ * @param reference Matching row of the reference surface, or nullptr for a flat base
+ * @param begin First column (inclusive)
+ * @param end Last column (exclusive)
+ * @param baseElevation Reference elevation used when reference is nullptr
+ * @param lanes Lane accumulators of the current block
+ */
+void accumulateRun(const float *row, const float *reference, int begin, int end,
+                   double baseElevation, LaneState &lanes);
+
+/**
+ * @brief Compute cut/fill totals over a row-major float grid in parallel
+ * @param data Grid values, width * rows entries
+ * @param reference Cell-aligned reference surface (same layout as data), or nullptr
+ * @param width Grid width in cells
+ * @param rows Number of rows in data
+ * @param firstRow Global index of data's first row; must be a multiple of kBlockRows
+ * @param baseElevation Reference elevation for cut/fill when reference is nullptr
+ * @param mask Optional boundary mask indexed by global row (nullptr = all cells)
+ * @param totals Running totals; block partials are folded into it in block order
+ */
+void accumulate(const float *data, const float *reference, int width, int rows, int firstRow,
+                double baseElevation, const RasterMask *mask, Totals &totals);
+
+/**
+ * @brief Compute cut/fill totals for several mask regions in one parallel pass
+ *
+ * Each block walks its rows once and sums every region's spans into that
+ * region's own lanes, so N zones cost one pass over the strip instead of N.
+ * @param masks One mask per region, indexed by global row
+ * @param totals Running totals per region (resized to masks.size() if needed)
+ */
+void accumulateRegions(const float *data, const float *reference, int width, int rows, int firstRow,
+                       double baseElevation, const std::vector<RasterMask> &masks,
+                       std::vector<Totals> &totals);
+
+/**
+ * @brief Run fn(block, rowBegin, rowEnd) for every kernel block of a strip in parallel
+ * @param rows Number of rows in the strip; block rows are strip-local
+ */
+template <typename BlockFn>
+void forEachBlock(int rows, BlockFn fn);
+
+/**
+ * @brief Run fn(begin, end) for each included column run of one row
+ * @param mask Optional boundary mask (nullptr = whole row)
+ * @param width Grid width in cells
+ * @param globalRow Row index in the full grid
+ */
+template <typename RunFn>
+void forEachRun(const RasterMask *mask, int width, int globalRow, RunFn fn)
+{
+    if (!mask) {
+        fn(0, width);
+        return;
+    }
+    if (globalRow >= mask->height()) {
+        return;
+    }
+    for (const RowSpan &span : mask->row(globalRow)) {
+        fn(span.begin, std::min(span.end, width));
+    }
+}
+
+// Out-of-line so QtConcurrent stays out of this header
+void runBlocks(int blockCount, const std::function<void(int)> &fn);
+
+template <typename BlockFn>
+void forEachBlock(int rows, BlockFn fn)
+{
+    int blockCount = (rows + kBlockRows - 1) / kBlockRows;
+    runBlocks(blockCount, [&](int block) {
+        int rowBegin = block * kBlockRows;
+        fn(block, rowBegin, std::min(rows, rowBegin + kBlockRows));
+    });
+}
+
+} // namespace VolumeKernel
+
+#endif // VOLUMEKERNEL_H
@@ -0,0 +1,332 @@
+#include "BatchRunner.h"
+#include "analysis/AnalysisPipeline.h"
+#include "analysis/DTMGenerator.h"
+#include "analysis/MemoryBudget.h"
+#include "analysis/MeshExporter.h"
+#include "analysis/TINProcessor.h"
+#include "analysis/VolumeCalculator.h"
+#include "database/DatabaseManager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+
+BatchRunner::BatchRunner(const Options &options, DatabaseManager *database, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_database(database)
+    , m_scheduler(new JobScheduler(this))
+{
+    if (m_options.maxConcurrent <= 0) {
+        m_options.maxConcurrent = std::max(1, QThread::idealThreadCount());
+    }
+}
+
+void BatchRunner::start(const std::vector<Project> &projects)
+{
+    m_timer.start();
+
+    for (const Project &project : projects) {
+        // Database projects are prefixed with their ID so equal names do not collide
+        QString name = project.name;
+        name.replace(QRegularExpression("[^A-Za-z0-9_.-]"), "_");
+        if (project.projectId >= 0) {
+            name = QString("%1_%2").arg(project.projectId).arg(name);
+        }
+        m_queue.push_back({project, QDir(m_options.outputDir).filePath(name)});
+    }
+
+    submitNext();
+    if (m_inFlight == 0) {
+        emit finished(m_failed);
+    }
+}
+
+void BatchRunner::submitNext()
+{
+    while (m_inFlight < m_options.maxConcurrent && !m_queue.empty()) {
+        Pending pending = m_queue.front();
+        m_queue.pop_front();
+        qint64 startedMs = m_timer.elapsed();
+
+        QString error;
+        QVariantList points = loadPoints(pending.project, error);
+        if (points.isEmpty() || !QDir().mkpath(pending.outputDir)) {
+            projectDone(pending, startedMs, QVariant(),
+                        error.isEmpty() ? "Failed to create output directory " + pending.outputDir : error);
+            continue;
+        }
+
+        Options options = m_options;
+        QString outputDir = pending.outputDir;
+        JobScheduler::Job job = [options, outputDir, points](JobScheduler::Context &context,
+                                                             QString &errorOut) -> QVariant {
+            QVariantMap result = processProject(options, outputDir, points, context, errorOut);
+            result["peakMemory"] = context.peakMemory();
+            return result;
+        };
+
+        ++m_inFlight;
+        m_scheduler->submit(pending.project.name, outputDir, JobScheduler::NormalPriority, job,
+                            [this, pending, startedMs](const QVariant &result, const QString &error) {
+            --m_inFlight;
+            projectDone(pending, startedMs, result, error);
+            submitNext();
+            if (m_inFlight == 0 && m_queue.empty()) {
+                emit finished(m_failed);
+            }
+        });
+    }
+}
+
+void BatchRunner::projectDone(const Pending &pending, qint64 startedMs, const QVariant &result, const QString &error)
+{
+    double seconds = (m_timer.elapsed() - startedMs) / 1000.0;
+
+    QJsonObject entry;
+    entry["name"] = pending.project.name;
+    entry["source"] = pending.project.pointFile.isEmpty()
+        ? QString("project:%1").arg(pending.project.projectId) : pending.project.pointFile;
+    entry["outputDir"] = pending.outputDir;
+    entry["seconds"] = seconds;
+    qint64 peakMemory = result.toMap().value("peakMemory").toLongLong();
+    entry["peakMemory"] = peakMemory;
+    entry["status"] = error.isEmpty() ? "ok" : "failed";
+    if (!error.isEmpty()) {
+        entry["error"] = error;
+        ++m_failed;
+    }
+    entry["results"] = QJsonObject::fromVariantMap(result.toMap());
+    m_report.append(entry);
+
+    std::printf("[%d/%d] %-40s %s %8.2f s %10s%s%s\n",
+                static_cast<int>(m_report.size()),
+                static_cast<int>(m_report.size() + m_inFlight + m_queue.size()),
+                pending.project.name.toUtf8().constData(),
+                error.isEmpty() ? "ok    " : "FAILED", seconds,
+                MemoryBudget::formatBytes(peakMemory).toUtf8().constData(),
+                error.isEmpty() ? "" : "  ", error.toUtf8().constData());
+    std::fflush(stdout);
+}
+
+QVariantList BatchRunner::loadPoints(const Project &project, QString &errorOut)
+{
+    if (!project.pointFile.isEmpty()) {
+        return readPointFile(project.pointFile, errorOut);
+    }
+
+    // The database connection belongs to this thread, so projects load here
+    if (!m_database || !m_database->loadProject(project.projectId)) {
+        errorOut = QString("Failed to load project %1").arg(project.projectId);
+        return QVariantList();
+    }
+    QVariantList points = m_database->getPoints();
+    if (points.size() < 3) {
+        errorOut = QString("Project %1 has %2 points (need at least 3)").arg(project.projectId).arg(points.size());
+        return QVariantList();
+    }
+    return points;
+}
+
+QVariantList BatchRunner::readPointFile(const QString &filePath, QString &errorOut)
+{
+    QVariantList points;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorOut = QString("Failed to open point file: %1").arg(filePath);
+        return points;
+    }
+
+    QTextStream in(&file);
+    in.readLine(); // Skip header
+
+    int lineNumber = 1;
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        ++lineNumber;
+        if (line.trimmed().isEmpty()) continue;
+
+        QStringList parts = line.split(',');
+        bool okX = false, okY = false, okZ = false;
+        QVariantMap point;
+        if (parts.size() >= 4) {
+            point["x"] = parts[1].toDouble(&okX);
+            point["y"] = parts[2].toDouble(&okY);
+            point["z"] = parts[3].toDouble(&okZ);
+        }
+        if (!okX || !okY || !okZ) {
+            errorOut = QString("%1:%2: expected name,x,y,z").arg(filePath).arg(lineNumber);
+            return QVariantList();
+        }
+        points.append(point);
+    }
+
+    if (points.size() < 3) {
+        errorOut = QString("%1 has %2 points (need at least 3)").arg(filePath).arg(points.size());
+        return QVariantList();
+    }
+    return points;
+}
+
+QVariantMap BatchRunner::processProject(const Options &options, const QString &outputDir,
+                                        const QVariantList &points, JobScheduler::Context &context,
+                                        QString &errorOut)
+{
+    QDir dir(outputDir);
+    const QStringList &operations = options.operations;
+    QVariantMap result;
+
+    // Components are created per job, so concurrent projects share no state
+    DTMGenerator dtmGenerator;
+    VolumeCalculator volumeCalculator;
+    MeshExporter meshExporter;
+
+    // Volume and mesh apply to the DTM unless only the TIN was asked for
+    bool gridSurface = operations.contains("dtm") || !operations.contains("tin");
+    bool grid = operations.contains("contours")
+        || (gridSurface && (operations.contains("dtm") || operations.contains("volume") || operations.contains("mesh")));
+    if (grid) {
+        QVariantMap spec;
+        QVariantMap dtm;
+        dtm["points"] = points;
+        dtm["pixelSize"] = options.pixelSize;
+        spec["dtm"] = dtm;
+        if (operations.contains("contours")) {
+            QVariantMap contours;
+            contours["interval"] = options.interval;
+            spec["contours"] = contours;
+        }
+        if (gridSurface && operations.contains("volume")) {
+            QVariantMap volume;
+            volume["baseElevation"] = options.baseElevation;
+            spec["volume"] = volume;
+        }
+        if (gridSurface && operations.contains("mesh")) {
+            QVariantMap mesh;
+            mesh["verticalScale"] = options.verticalScale;
+            mesh["format"] = options.meshFormat;
+            mesh["filePath"] = dir.filePath("dtm_mesh." + options.meshFormat);
+            spec["mesh"] = mesh;
+        }
+
+        AnalysisPipeline pipeline(&dtmGenerator, &volumeCalculator, &meshExporter);
+        result = pipeline.run(spec, dir.filePath("dtm.tif"), context, errorOut);
+        result["dtm"] = dir.filePath("dtm.tif");
+
+        // Contours go to GeoJSON; the report only keeps the count
+        if (result.contains("contours")) {
+            QVariantList contours = result["contours"].toList();
+            QString contourPath = dir.filePath("contours.geojson");
+            QString writeError;
+            if (!writeContours(contours, contourPath, writeError) && errorOut.isEmpty()) {
+                errorOut = "contours: " + writeError;
+            }
+            QVariantMap summary;
+            summary["count"] = contours.size();
+            summary["filePath"] = contourPath;
+            result["contours"] = summary;
+        }
+        if (!errorOut.isEmpty()) {
+            return result;
+        }
+    }
+
+    if (operations.contains("tin") && !context.isCanceled()) {
+        TINProcessor tinProcessor;
+        QVariantMap tin = tinProcessor.generate(points, errorOut);
+        if (!tin["success"].toBool()) {
+            errorOut = "tin: " + errorOut;
+            return result;
+        }
+
+        QVariantMap tinResult;
+        tinResult["vertexCount"] = tin["vertexCount"];
+        tinResult["triangleCount"] = tin["triangleCount"];
+
+        if (operations.contains("volume")) {
+            tinResult["volume"] = volumeCalculator.calculateTIN(&tinProcessor, options.baseElevation,
+                                                                QVariantList(), errorOut);
+        }
+        if (operations.contains("mesh") && errorOut.isEmpty()) {
+            QString meshPath = dir.filePath("tin_mesh." + options.meshFormat);
+            MeshBuffers mesh;
+            if (meshExporter.buildTINMesh(&tinProcessor, options.verticalScale, mesh, errorOut)
+                && meshExporter.exportMesh(mesh, meshPath, options.meshFormat, errorOut)) {
+                tinResult["mesh"] = meshPath;
+            }
+        }
+        if (!errorOut.isEmpty()) {
+            errorOut = "tin: " + errorOut;
+        }
+        result["tin"] = tinResult;
+    }
+
+    context.setProgress(100);
+    return result;
+}
+
+bool BatchRunner::writeContours(const QVariantList &contours, const QString &filePath, QString &errorOut)
+{
+    QJsonArray features;
+    for (const QVariant &value : contours) {
+        QVariantMap contour = value.toMap();
+
+        QJsonArray coordinates;
+        for (const QVariant &point : contour["points"].toList()) {
+            QVariantMap pt = point.toMap();
+            coordinates.append(QJsonArray{pt["x"].toDouble(), pt["y"].toDouble()});
+        }
+
+        QJsonObject geometry;
+        geometry["type"] = "LineString";
+        geometry["coordinates"] = coordinates;
+
+        QJsonObject properties;
+        properties["elevation"] = contour["elevation"].toDouble();
+
+        QJsonObject feature;
+        feature["type"] = "Feature";
+        feature["geometry"] = geometry;
+        feature["properties"] = properties;
+        features.append(feature);
+    }
+
+    QJsonObject collection;
+    collection["type"] = "FeatureCollection";
+    collection["features"] = features;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorOut = QString("Failed to write contours: %1").arg(filePath);
+        return false;
+    }
+    file.write(QJsonDocument(collection).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+bool BatchRunner::writeReport(const QString &filePath, QString &errorOut) const
+{
+    QJsonObject report;
+    report["generatedAt"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["elapsedSeconds"] = m_timer.elapsed() / 1000.0;
+    report["operations"] = QJsonArray::fromStringList(m_options.operations);
+    report["failed"] = m_failed;
+    report["memoryBudget"] = MemoryBudget::limit();
+    report["peakMemory"] = MemoryBudget::peak();
+    report["projects"] = m_report;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorOut = QString("Failed to write report: %1").arg(filePath);
+        return false;
+    }
+    file.write(QJsonDocument(report).toJson());
+    return true;
+}
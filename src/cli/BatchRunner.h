@@ -0,0 +1,101 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "analysis/JobScheduler.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <deque>
+#include <vector>
+
+class DatabaseManager;
+
+/**
+ * @brief Runs earthwork processing over many projects without a GUI
+ *
+ * Provides functionality for:
+ * - Projects from a project database or from point files (the CSV layout of
+ *   DatabaseManager::exportToCSV: a header, then name,x,y,z[,code,description])
+ * - DTM, contours, grid volume and mesh export through AnalysisPipeline, and
+ *   TIN, TIN volume and TIN mesh export, per project
+ * - One job per project on a JobScheduler, several projects at a time; each
+ *   job has its own components, so projects share no state
+ * - A JSON report with per-project results, errors, timings and peak memory
+ *
+ * Points are loaded on the runner's thread just before a project's job is
+ * submitted, so only the projects in flight are held in memory.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QStringList operations = {"dtm", "contours"};  // dtm, contours, volume, mesh, tin
+        double pixelSize = 1.0;
+        double interval = 1.0;
+        double baseElevation = 0.0;
+        double verticalScale = 1.0;
+        QString meshFormat = "glb";
+        QString outputDir;
+        int maxConcurrent = 0;  // projects in flight; 0 = ideal thread count
+    };
+
+    struct Project {
+        QString name;
+        QString pointFile;      // empty for database projects
+        int projectId = -1;
+    };
+
+    BatchRunner(const Options &options, DatabaseManager *database, QObject *parent = nullptr);
+
+    /**
+     * @brief Start processing; finished() is emitted when every project is done
+     */
+    void start(const std::vector<Project> &projects);
+
+    /**
+     * @brief Write the report of all finished projects as JSON
+     * @return true on success, false on failure
+     */
+    bool writeReport(const QString &filePath, QString &errorOut) const;
+
+    /**
+     * @brief Read a point file in the exportToCSV layout
+     * @return Points as {x, y, z} maps; empty with errorOut set on failure
+     */
+    static QVariantList readPointFile(const QString &filePath, QString &errorOut);
+
+signals:
+    void finished(int failedCount);
+
+private:
+    struct Pending {
+        Project project;
+        QString outputDir;
+    };
+
+    void submitNext();
+    void projectDone(const Pending &pending, qint64 startedMs, const QVariant &result, const QString &error);
+    QVariantList loadPoints(const Project &project, QString &errorOut);
+
+    static QVariantMap processProject(const Options &options, const QString &outputDir,
+                                      const QVariantList &points, JobScheduler::Context &context,
+                                      QString &errorOut);
+    static bool writeContours(const QVariantList &contours, const QString &filePath, QString &errorOut);
+
+    Options m_options;
+    DatabaseManager *m_database;
+    QScopedPointer<JobScheduler> m_scheduler;
+    std::deque<Pending> m_queue;
+    int m_inFlight = 0;
+    int m_failed = 0;
+    QJsonArray m_report;
+    QElapsedTimer m_timer;
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,138 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <gdal_priv.h>
+#include <cstdio>
+
+#include "database/DatabaseManager.h"
+#include "cli/BatchRunner.h"
+#include "analysis/MemoryBudget.h"
+#include "utilities/Trace.h"
+
+// Headless batch processing, e.g. for nightly runs:
+//   sitesurveyor-cli --database site.db --operations dtm,contours,volume --output-dir out
+//   sitesurveyor-cli --operations tin,volume,mesh --output-dir out points/*.csv
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("SiteSurveyor");
+    app.setOrganizationName("Geomatics");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch DTM, TIN, contour, volume and mesh processing");
+    parser.addHelpOption();
+    parser.addPositionalArgument("points", "Point files (CSV: header, then name,x,y,z[,code,description])",
+                                 "[points...]");
+
+    QCommandLineOption databaseOption("database", "Project database to process.", "path");
+    QCommandLineOption projectOption("project",
+        "Project ID or name to process (repeatable; default all projects in the database).", "project");
+    QCommandLineOption operationsOption("operations",
+        "Comma-separated operations: dtm, contours, volume, mesh, tin. With tin, volume and mesh "
+        "use the TIN unless dtm is also given.", "list", "dtm,contours");
+    QCommandLineOption pixelSizeOption("pixel-size", "DTM pixel size.", "size", "1.0");
+    QCommandLineOption intervalOption("interval", "Contour interval.", "interval", "1.0");
+    QCommandLineOption baseOption("base-elevation", "Base elevation for cut/fill.", "elevation", "0.0");
+    QCommandLineOption scaleOption("vertical-scale", "Vertical exaggeration for meshes.", "scale", "1.0");
+    QCommandLineOption formatOption("mesh-format", "Mesh format: glb, ply, stl or obj (DTM only).",
+                                    "format", "glb");
+    QCommandLineOption outputOption("output-dir", "Directory for per-project outputs.", "dir", ".");
+    QCommandLineOption jobsOption("jobs", "Projects processed at once (default: number of cores).", "count", "0");
+    QCommandLineOption reportOption("report", "JSON report path (default: <output-dir>/report.json).", "path");
+    QCommandLineOption traceOption("trace", "Record trace spans and write them as Chrome/Perfetto JSON.", "path");
+    QCommandLineOption memoryOption("memory-budget",
+        "Memory for analysis buffers across all projects, in MB (default: half of the installed RAM). "
+        "Larger DTMs are streamed or meshed at reduced resolution.", "MB", "0");
+
+    parser.addOptions({databaseOption, projectOption, operationsOption, pixelSizeOption, intervalOption,
+                       baseOption, scaleOption, formatOption, outputOption, jobsOption, reportOption,
+                       traceOption, memoryOption});
+    parser.process(app);
+
+    Trace::setEnabled(parser.isSet(traceOption));
+    MemoryBudget::setLimit(static_cast<qint64>(parser.value(memoryOption).toDouble() * 1024.0 * 1024.0));
+
+    BatchRunner::Options options;
+    options.operations = parser.value(operationsOption).split(',', Qt::SkipEmptyParts);
+    options.pixelSize = parser.value(pixelSizeOption).toDouble();
+    options.interval = parser.value(intervalOption).toDouble();
+    options.baseElevation = parser.value(baseOption).toDouble();
+    options.verticalScale = parser.value(scaleOption).toDouble();
+    options.meshFormat = parser.value(formatOption).toLower();
+    options.outputDir = QDir(parser.value(outputOption)).absolutePath();
+    options.maxConcurrent = parser.value(jobsOption).toInt();
+
+    static const QStringList known = {"dtm", "contours", "volume", "mesh", "tin"};
+    for (QString &operation : options.operations) {
+        operation = operation.trimmed().toLower();
+        if (!known.contains(operation)) {
+            std::fprintf(stderr, "Unknown operation: %s\n", operation.toUtf8().constData());
+            return 2;
+        }
+    }
+
+    std::vector<BatchRunner::Project> projects;
+    for (const QString &file : parser.positionalArguments()) {
+        BatchRunner::Project project;
+        project.name = QFileInfo(file).completeBaseName();
+        project.pointFile = QFileInfo(file).absoluteFilePath();
+        projects.push_back(project);
+    }
+
+    DatabaseManager database;
+    if (parser.isSet(databaseOption)) {
+        if (!database.openDatabase(parser.value(databaseOption))) {
+            std::fprintf(stderr, "Failed to open database: %s\n",
+                         parser.value(databaseOption).toUtf8().constData());
+            return 1;
+        }
+
+        QStringList wanted = parser.values(projectOption);
+        for (const QVariant &value : database.getProjects()) {
+            QVariantMap entry = value.toMap();
+            QString id = entry["id"].toString();
+            QString name = entry["name"].toString();
+            if (!wanted.isEmpty() && !wanted.contains(id) && !wanted.contains(name)) continue;
+
+            BatchRunner::Project project;
+            project.name = name;
+            project.projectId = entry["id"].toInt();
+            projects.push_back(project);
+        }
+    }
+
+    if (projects.empty()) {
+        std::fprintf(stderr, "Nothing to process: give point files or --database\n");
+        return 2;
+    }
+    if (!QDir().mkpath(options.outputDir)) {
+        std::fprintf(stderr, "Failed to create %s\n", options.outputDir.toUtf8().constData());
+        return 1;
+    }
+
+    GDALAllRegister();
+
+    QString reportPath = parser.isSet(reportOption)
+        ? parser.value(reportOption) : QDir(options.outputDir).filePath("report.json");
+
+    BatchRunner runner(options, &database);
+    int failed = 0;
+    QObject::connect(&runner, &BatchRunner::finished, &app, [&](int failedCount) {
+        failed = failedCount;
+        QString error;
+        if (!runner.writeReport(reportPath, error)) {
+            std::fprintf(stderr, "%s\n", error.toUtf8().constData());
+        }
+        std::printf("%d projects, %d failed; report: %s\n", static_cast<int>(projects.size()),
+                    failedCount, reportPath.toUtf8().constData());
+        if (parser.isSet(traceOption) && !Trace::writeChromeJson(parser.value(traceOption), error)) {
+            std::fprintf(stderr, "%s\n", error.toUtf8().constData());
+        }
+        QCoreApplication::quit();
+    }, Qt::QueuedConnection);
+
+    runner.start(projects);
+    int status = app.exec();
+    return status != 0 ? status : (failed > 0 ? 1 : 0);
+}
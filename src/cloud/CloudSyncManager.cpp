@@ -1,5 +1,6 @@
 #include "CloudSyncManager.h"
 #include "../database/DatabaseManager.h"
+#include "../utilities/Trace.h"
 
 #include <QNetworkRequest>
 #include <QHttpMultiPart>
@@ -109,6 +110,7 @@ void CloudSyncManager::clearError()
 
 void CloudSyncManager::uploadDatabase()
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::uploadDatabase");
     if (m_isUploading) {
         setError(tr("Upload already in progress"));
         return;
@@ -192,6 +194,7 @@ void CloudSyncManager::uploadDatabase()
 
 void CloudSyncManager::uploadNextChunk()
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::uploadNextChunk");
     // Chunk size 5MB - Appwrite/S3 requires minimum 5MB for multipart upload parts
     // (except for the final part which can be smaller)
     const qint64 CHUNK_SIZE = 5 * 1024 * 1024; 
@@ -252,6 +255,7 @@ void CloudSyncManager::uploadNextChunk()
 
 void CloudSyncManager::onChunkUploadFinished(QNetworkReply *reply)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::onChunkUploadFinished");
     reply->deleteLater();
 
     if (reply->error() != QNetworkReply::NoError) {
@@ -323,6 +327,7 @@ void CloudSyncManager::onUploadProgress(qint64 bytesSent, qint64 bytesTotal)
 
 void CloudSyncManager::onUploadFinished(QNetworkReply *reply)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::onUploadFinished");
     m_isUploading = false;
     m_uploadProgress = 0.0;
     emit uploadingChanged();
@@ -358,6 +363,7 @@ void CloudSyncManager::onUploadFinished(QNetworkReply *reply)
 
 void CloudSyncManager::listCloudBackups()
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::listCloudBackups");
     if (!isConfigured()) {
         setError(tr("Cloud sync not configured. Please set API key."));
         return;
@@ -376,6 +382,7 @@ void CloudSyncManager::listCloudBackups()
 
 void CloudSyncManager::onListFinished(QNetworkReply *reply)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::onListFinished");
     if (reply->error() != QNetworkReply::NoError) {
         QString errorBody = QString::fromUtf8(reply->readAll());
         setError(tr("Failed to list backups: %1 - %2").arg(reply->errorString()).arg(errorBody));
@@ -417,6 +424,7 @@ void CloudSyncManager::onListFinished(QNetworkReply *reply)
 
 void CloudSyncManager::downloadBackup(const QString &fileId, const QString &fileName)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::downloadBackup");
     if (m_isDownloading) {
         setError(tr("Download already in progress"));
         return;
@@ -459,6 +467,7 @@ void CloudSyncManager::onDownloadProgress(qint64 bytesReceived, qint64 bytesTota
 
 void CloudSyncManager::onDownloadFinished(QNetworkReply *reply)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::onDownloadFinished");
     m_isDownloading = false;
     m_downloadProgress = 0.0;
     emit downloadingChanged();
@@ -511,6 +520,7 @@ void CloudSyncManager::onDownloadFinished(QNetworkReply *reply)
 
 void CloudSyncManager::deleteCloudBackup(const QString &fileId)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::deleteCloudBackup");
     if (!isConfigured()) {
         setError(tr("Cloud sync not configured. Please set API key."));
         return;
@@ -530,6 +540,7 @@ void CloudSyncManager::deleteCloudBackup(const QString &fileId)
 
 void CloudSyncManager::onDeleteFinished(QNetworkReply *reply)
 {
+    TRACE_SCOPE("cloud", "CloudSyncManager::onDeleteFinished");
     QString fileId = m_pendingDeleteId;
     m_pendingDeleteId.clear();
 
@@ -1,4 +1,5 @@
 #include "DatabaseManager.h"
+#include "utilities/Trace.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSqlRecord>
@@ -96,6 +97,7 @@ DatabaseManager::~DatabaseManager()
 
 bool DatabaseManager::openDatabase(const QString &path)
 {
+    TRACE_SCOPE("database", "DatabaseManager::openDatabase");
     if (m_db.isOpen()) {
         closeDatabase();
     }
@@ -217,6 +219,7 @@ QString DatabaseManager::browseForNewDatabase()
 
 bool DatabaseManager::initSpatialite()
 {
+    TRACE_SCOPE("database", "DatabaseManager::initSpatialite");
 #ifdef WITH_SPATIALITE
     m_spatialiteCache = spatialite_alloc_connection();
     if (!m_spatialiteCache) {
@@ -263,6 +266,7 @@ bool DatabaseManager::initSpatialite()
 
 bool DatabaseManager::createTables()
 {
+    TRACE_SCOPE("database", "DatabaseManager::createTables");
     QStringList statements;
 
     // Projects table - use center_lat/center_lon for backwards compatibility
@@ -447,6 +451,7 @@ bool DatabaseManager::createTables()
 
 void DatabaseManager::runMigrations()
 {
+    TRACE_SCOPE("database", "DatabaseManager::runMigrations");
     // Migration 1: Add phone column to personnel table if it doesn't exist
     {
         QSqlQuery checkQuery(m_db);
@@ -555,6 +560,7 @@ bool DatabaseManager::createProject(const QString &name, const QString &descript
 
 QVariantList DatabaseManager::getProjects(const QString &discipline)
 {
+    TRACE_SCOPE("database", "DatabaseManager::getProjects");
     QVariantList projects;
     QSqlQuery query(m_db);
 
@@ -604,6 +610,7 @@ QVariantList DatabaseManager::getProjects(const QString &discipline)
 
 QVariantList DatabaseManager::getRecentProjects(int limit)
 {
+    TRACE_SCOPE("database", "DatabaseManager::getRecentProjects");
     QVariantList projects;
     QSqlQuery query(m_db);
     
@@ -663,6 +670,7 @@ bool DatabaseManager::deleteProject(int projectId)
 
 bool DatabaseManager::deleteProjects(const QVariantList &projectIds)
 {
+    TRACE_SCOPE("database", "DatabaseManager::deleteProjects");
     if (projectIds.isEmpty()) {
         return true;
     }
@@ -775,6 +783,7 @@ void DatabaseManager::setCurrentDiscipline(const QString &discipline)
 
 bool DatabaseManager::loadProject(int projectId)
 {
+    TRACE_SCOPE("database", "DatabaseManager::loadProject");
     QSqlQuery query(m_db);
     query.prepare("SELECT name FROM projects WHERE id = :id");
     query.bindValue(":id", projectId);
@@ -928,6 +937,7 @@ bool DatabaseManager::deletePoint(int pointId)
 
 QVariantList DatabaseManager::getPoints()
 {
+    TRACE_SCOPE("database", "DatabaseManager::getPoints");
     QVariantList points;
 
     if (m_currentProjectId < 0) return points;
@@ -974,6 +984,7 @@ QVariantMap DatabaseManager::getPoint(int pointId)
 
 QVariantList DatabaseManager::getPointsInBounds(double minX, double minY, double maxX, double maxY)
 {
+    TRACE_SCOPE("database", "DatabaseManager::getPointsInBounds");
     QVariantList points;
 
     if (m_currentProjectId < 0) return points;
@@ -1521,6 +1532,7 @@ double DatabaseManager::calculateDistance(int pointId1, int pointId2)
 
 double DatabaseManager::calculateArea(const QVariantList &pointIds)
 {
+    TRACE_SCOPE("database", "DatabaseManager::calculateArea");
     if (pointIds.size() < 3) return 0;
 
     if (!m_spatialiteLoaded) {
@@ -1558,6 +1570,7 @@ double DatabaseManager::calculateArea(const QVariantList &pointIds)
 
 QVariantList DatabaseManager::getPointsWithinRadius(double centerX, double centerY, double radiusMeters)
 {
+    TRACE_SCOPE("database", "DatabaseManager::getPointsWithinRadius");
     QVariantList points;
 
     if (m_currentProjectId < 0) return points;
@@ -1611,6 +1624,7 @@ QVariantList DatabaseManager::getPointsWithinRadius(double centerX, double cente
 // Export/Import
 bool DatabaseManager::exportToCSV(const QString &filePath)
 {
+    TRACE_SCOPE("database", "DatabaseManager::exportToCSV");
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         emit errorOccurred(tr("Failed to open file for writing"));
@@ -1638,6 +1652,7 @@ bool DatabaseManager::exportToCSV(const QString &filePath)
 
 bool DatabaseManager::importFromCSV(const QString &filePath)
 {
+    TRACE_SCOPE("database", "DatabaseManager::importFromCSV");
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         emit errorOccurred(tr("Failed to open file for reading"));
@@ -1670,6 +1685,7 @@ bool DatabaseManager::importFromCSV(const QString &filePath)
 // Database Backup/Restore
 bool DatabaseManager::createBackup(const QString &reason)
 {
+    TRACE_SCOPE("database", "DatabaseManager::createBackup");
     if (m_dbPath.isEmpty() || !m_db.isOpen()) {
         emit errorOccurred(tr("No database is currently open"));
         return false;
@@ -1727,6 +1743,7 @@ QString DatabaseManager::getBackupDirectory() const
 
 QVariantList DatabaseManager::listBackups()
 {
+    TRACE_SCOPE("database", "DatabaseManager::listBackups");
     QVariantList backups;
     QString backupDir = getBackupDirectory();
     
@@ -1752,6 +1769,7 @@ QVariantList DatabaseManager::listBackups()
 
 bool DatabaseManager::restoreFromBackup(const QString &backupPath)
 {
+    TRACE_SCOPE("database", "DatabaseManager::restoreFromBackup");
     if (!QFile::exists(backupPath)) {
         emit errorOccurred(tr("Backup file does not exist"));
         return false;
@@ -1786,6 +1804,7 @@ bool DatabaseManager::restoreFromBackup(const QString &backupPath)
 
 bool DatabaseManager::deleteOldBackups(int keepCount)
 {
+    TRACE_SCOPE("database", "DatabaseManager::deleteOldBackups");
     QString backupDir = getBackupDirectory();
     QDir dir(backupDir);
     
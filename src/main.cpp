@@ -10,7 +10,10 @@
 #include "cloud/CloudSyncManager.h"
 
 #include "analysis/EarthworkEngine.h"
+#include "analysis/MemoryBudget.h"
+#include "analysis/TerrainGeometry.h"
 #include "utilities/CoordinateTransformer.h"
+#include "utilities/Trace.h"
 
 int main(int argc, char *argv[])
 {
@@ -18,11 +21,18 @@ int main(int argc, char *argv[])
     app.setApplicationName("SiteSurveyor");
     app.setOrganizationName("Geomatics");
 
+    // Trace spans are recorded when enabled in Settings and written out on exit
+    QSettings settings;
+    Trace::setEnabled(settings.value("diagnostics/tracing", false).toBool());
+
+    // Analysis buffers are held to a memory budget; 0 keeps the default share of RAM
+    MemoryBudget::setLimit(static_cast<qint64>(settings.value("analysis/memoryBudgetMB", 0.0).toDouble()
+                                               * 1024.0 * 1024.0));
+
     // Initialize database manager
     DatabaseManager dbManager;
 
     // Load saved database path from settings, or use default
-    QSettings settings;
     QString defaultDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir().mkpath(defaultDataPath);
     QString defaultDbPath = defaultDataPath + "/sitesurveyor.db";
@@ -55,6 +65,9 @@ int main(int argc, char *argv[])
 
     QQmlApplicationEngine engine;
 
+    // Register QML types
+    qmlRegisterType<TerrainGeometry>("SiteSurveyor.Analysis", 1, 0, "TerrainGeometry");
+
     // Expose objects to QML
     engine.rootContext()->setContextProperty("Database", &dbManager);
     engine.rootContext()->setContextProperty("Earthwork", &earthwork);
@@ -71,5 +84,16 @@ int main(int argc, char *argv[])
 
     engine.load(url);
 
-    return app.exec();
+    int exitCode = app.exec();
+
+    if (Trace::isEnabled()) {
+        QString traceError;
+        if (Trace::writeChromeJson(Trace::defaultFilePath(), traceError)) {
+            qDebug() << "Trace written to:" << Trace::defaultFilePath();
+        } else {
+            qWarning() << traceError;
+        }
+    }
+
+    return exitCode;
 }
@@ -0,0 +1,226 @@
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+
+constexpr quint64 kEventsPerThread = 16384;
+
+struct Event {
+    const char *category;
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+    int threadId;
+};
+
+// Single-writer ring: only the owning thread advances head. Buffers outlive
+// their threads and are handed to the next new thread, so each event keeps
+// the id of the thread that wrote it.
+struct ThreadBuffer {
+    std::unique_ptr<Event[]> events{new Event[kEventsPerThread]};
+    std::atomic<quint64> head{0};       // events written so far
+    std::atomic<quint64> first{0};      // first event kept after clear()
+    std::atomic<bool> inUse{false};
+};
+
+// Only taken when a thread records its first span and when dumping
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    QHash<int, QString> threadNames;
+    int nextThreadId = 1;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+std::atomic<bool> g_enabled{false};
+
+QString currentThreadName(int threadId)
+{
+    QThread *thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        return "Main";
+    }
+    QString name = thread ? thread->objectName() : QString();
+    return name.isEmpty() ? QString("Thread %1").arg(threadId) : QString("%1 %2").arg(name).arg(threadId);
+}
+
+// Claims a free buffer for the calling thread and returns it on thread exit
+struct ThreadSlot {
+    ThreadBuffer *buffer = nullptr;
+    int threadId = 0;
+
+    ThreadSlot()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        threadId = reg.nextThreadId++;
+        reg.threadNames.insert(threadId, currentThreadName(threadId));
+
+        for (const std::unique_ptr<ThreadBuffer> &candidate : reg.buffers) {
+            if (!candidate->inUse.load(std::memory_order_relaxed)) {
+                buffer = candidate.get();
+                break;
+            }
+        }
+        if (!buffer) {
+            reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = reg.buffers.back().get();
+        }
+        buffer->inUse.store(true, std::memory_order_relaxed);
+    }
+
+    ~ThreadSlot()
+    {
+        buffer->inUse.store(false, std::memory_order_release);
+    }
+};
+
+// Copy the events still held by a buffer. Events the owner overwrites while
+// they are being copied are dropped rather than reported torn.
+void collect(const ThreadBuffer &buffer, std::vector<Event> &out)
+{
+    quint64 end = buffer.head.load(std::memory_order_acquire);
+    quint64 begin = std::max(buffer.first.load(std::memory_order_acquire),
+                             end > kEventsPerThread ? end - kEventsPerThread : 0);
+
+    size_t base = out.size();
+    for (quint64 i = begin; i < end; ++i) {
+        out.push_back(buffer.events[i % kEventsPerThread]);
+    }
+
+    // The owner may be part way through writing event "head", over event head - capacity
+    quint64 after = buffer.head.load(std::memory_order_acquire) + 1;
+    quint64 valid = after > kEventsPerThread ? after - kEventsPerThread : 0;
+    if (valid > begin) {
+        size_t overwritten = static_cast<size_t>(std::min(valid, end) - begin);
+        out.erase(out.begin() + base, out.begin() + base + overwritten);
+    }
+}
+
+} // namespace
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+qint64 now()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char *category, const char *name, qint64 startNs, qint64 endNs)
+{
+    thread_local ThreadSlot slot;
+    ThreadBuffer *buffer = slot.buffer;
+
+    quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % kEventsPerThread] = {category, name, startNs, endNs - startNs, slot.threadId};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void clear()
+{
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : reg.buffers) {
+        buffer->first.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+}
+
+bool writeChromeJson(const QString &filePath, QString &errorOut)
+{
+    std::vector<Event> events;
+    QHash<int, QString> threadNames;
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : reg.buffers) {
+            collect(*buffer, events);
+        }
+        threadNames = reg.threadNames;
+    }
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.startNs < b.startNs;
+    });
+
+    qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+
+    QSet<int> seenThreads;
+    for (const Event &event : events) {
+        seenThreads.insert(event.threadId);
+    }
+    for (int threadId : seenThreads) {
+        QJsonObject meta;
+        meta["name"] = "thread_name";
+        meta["ph"] = "M";
+        meta["pid"] = pid;
+        meta["tid"] = threadId;
+        meta["args"] = QJsonObject{{"name", threadNames.value(threadId)}};
+        traceEvents.append(meta);
+    }
+
+    // Complete ("X") events; timestamps are in microseconds
+    for (const Event &event : events) {
+        QJsonObject entry;
+        entry["name"] = event.name;
+        entry["cat"] = event.category;
+        entry["ph"] = "X";
+        entry["ts"] = event.startNs / 1000.0;
+        entry["dur"] = event.durationNs / 1000.0;
+        entry["pid"] = pid;
+        entry["tid"] = event.threadId;
+        traceEvents.append(entry);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorOut = "Cannot write trace file: " + file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QString defaultFilePath()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/sitesurveyor-trace.json";
+}
+
+} // namespace Trace
@@ -0,0 +1,95 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief Scoped-span tracing for finding where time goes in analysis runs
+ *
+ * TRACE_SCOPE("category", "name") records the time from the macro to the end
+ * of the enclosing block as one span. Each thread writes its spans into its
+ * own fixed-size ring buffer without locks; once a buffer is full the oldest
+ * spans are overwritten. Recording is off until setEnabled(true) and costs
+ * one atomic load per span while off. Building without WITH_TRACING removes
+ * the macros entirely.
+ *
+ * writeChromeJson() dumps the buffers in the Chrome trace event format,
+ * which chrome://tracing and ui.perfetto.dev open directly.
+ *
+ * Names and categories must be string literals; only the pointers are kept.
+ */
+namespace Trace {
+
+/**
+ * @brief Turn recording on or off for all threads
+ */
+void setEnabled(bool enabled);
+bool isEnabled();
+
+/**
+ * @brief Monotonic time in nanoseconds since the first call
+ */
+qint64 now();
+
+/**
+ * @brief Record a finished span on the calling thread's buffer
+ */
+void record(const char *category, const char *name, qint64 startNs, qint64 endNs);
+
+/**
+ * @brief Drop all recorded spans
+ */
+void clear();
+
+/**
+ * @brief Write all buffered spans as Chrome trace event JSON
+ * @return false with errorOut set if the file cannot be written
+ */
+bool writeChromeJson(const QString &filePath, QString &errorOut);
+
+/**
+ * @brief sitesurveyor-trace.json in the application data directory
+ */
+QString defaultFilePath();
+
+/**
+ * @brief Records its lifetime as a span when tracing is enabled
+ */
+class Span
+{
+public:
+    Span(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_start(isEnabled() ? now() : -1)
+    {
+    }
+
+    ~Span()
+    {
+        if (m_start >= 0) {
+            record(m_category, m_name, m_start, now());
+        }
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    qint64 m_start;
+};
+
+} // namespace Trace
+
+#ifdef WITH_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(category, name)
+#else
+#define TRACE_SCOPE(category, name) ((void)0)
+#endif
+
+#endif // TRACE_H